@@ -0,0 +1,288 @@
+/* capture-tpacket.c
+ * Routines for capturing through a Linux TPACKET_V3 memory-mapped ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "capture-tpacket.h"
+
+#ifdef HAVE_TPACKET3
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+/* Each block is handed over when it's full or after this many ms. */
+#define TPACKET_BLOCK_SIZE      (1 << 22)
+#define TPACKET_FRAME_SIZE      (1 << 11)
+#define TPACKET_MIN_BLOCKS      16
+#define TPACKET_BLOCK_TIMEOUT   60
+
+#ifndef ETH_P_8021Q
+#define ETH_P_8021Q             0x8100
+#endif
+
+struct _tpacket_capture {
+    int                 fd;
+    guint8             *map;
+    size_t              map_len;
+    guint               block_count;
+    guint               block_idx;          /* next block to look at */
+    int                 snaplen;
+    guint8             *vlan_buf;           /* packet with its VLAN tag put back */
+    guint64             recv;
+    guint64             drops;
+};
+
+tpacket_capture *
+tpacket_open(const char *ifname, int snaplen, gboolean promisc, int buffer_size,
+             int fanout_group, char *errmsg, size_t errmsg_len)
+{
+    tpacket_capture    *tp;
+    struct tpacket_req3 req;
+    struct sockaddr_ll  sll;
+    struct packet_mreq  mreq;
+    unsigned int        ifindex;
+    int                 version = TPACKET_V3;
+    int                 fanout;
+
+    ifindex = if_nametoindex(ifname);
+    if (ifindex == 0) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "No such interface: %s", ifname);
+        return NULL;
+    }
+
+    tp = g_new0(tpacket_capture, 1);
+    tp->snaplen = snaplen > 0 ? snaplen : 65535;
+    tp->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (tp->fd == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't open a packet socket: %s", g_strerror(errno));
+        g_free(tp);
+        return NULL;
+    }
+
+    if (setsockopt(tp->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "TPACKET_V3 isn't supported: %s", g_strerror(errno));
+        goto fail;
+    }
+
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = TPACKET_BLOCK_SIZE;
+    req.tp_block_nr = (guint)(((guint64)buffer_size * 1024 * 1024) / TPACKET_BLOCK_SIZE);
+    if (req.tp_block_nr < TPACKET_MIN_BLOCKS)
+        req.tp_block_nr = TPACKET_MIN_BLOCKS;
+    req.tp_frame_size = TPACKET_FRAME_SIZE;
+    req.tp_frame_nr = (TPACKET_BLOCK_SIZE / TPACKET_FRAME_SIZE) * req.tp_block_nr;
+    req.tp_retire_blk_tov = TPACKET_BLOCK_TIMEOUT;
+    if (setsockopt(tp->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't set up the capture ring: %s", g_strerror(errno));
+        goto fail;
+    }
+    tp->block_count = req.tp_block_nr;
+    tp->map_len = (size_t)req.tp_block_size * req.tp_block_nr;
+    tp->map = (guint8 *)mmap(NULL, tp->map_len, PROT_READ|PROT_WRITE, MAP_SHARED, tp->fd, 0);
+    if (tp->map == MAP_FAILED) {
+        tp->map = NULL;
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't map the capture ring: %s", g_strerror(errno));
+        goto fail;
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = (int)ifindex;
+    if (bind(tp->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't bind to %s: %s", ifname, g_strerror(errno));
+        goto fail;
+    }
+
+    if (promisc) {
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = (int)ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(tp->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof mreq) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't put %s into promiscuous mode: %s", ifname, g_strerror(errno));
+            goto fail;
+        }
+    }
+
+    if (fanout_group != 0) {
+        fanout = (fanout_group & 0xffff) | (PACKET_FANOUT_HASH << 16);
+        if (setsockopt(tp->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof fanout) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't join fanout group %d: %s", fanout_group, g_strerror(errno));
+            goto fail;
+        }
+    }
+
+    tp->vlan_buf = (guint8 *)g_malloc(tp->snaplen + 4);
+    return tp;
+
+fail:
+    tpacket_close(tp);
+    return NULL;
+}
+
+gboolean
+tpacket_set_filter(tpacket_capture *tp, const struct bpf_program *fcode)
+{
+    struct sock_fprog prog;
+
+    /* libpcap's struct bpf_insn has the same layout as struct sock_filter. */
+    prog.len = fcode->bf_len;
+    prog.filter = (struct sock_filter *)fcode->bf_insns;
+    return setsockopt(tp->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog) == 0;
+}
+
+/*
+ * The kernel takes the VLAN tag out of the packet and reports it in the
+ * header; put it back, as libpcap does, so the packet looks as it did
+ * on the wire.
+ */
+static const guint8 *
+tpacket_vlan_insert(tpacket_capture *tp, const struct tpacket3_hdr *ppd,
+                    const guint8 *pd, struct pcap_pkthdr *phdr)
+{
+    guint16 tpid = ETH_P_8021Q;
+    guint16 tci  = (guint16)ppd->hv1.tp_vlan_tci;
+
+    if (phdr->caplen < 2 * 6)
+        return pd;
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+    if (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID)
+        tpid = (guint16)ppd->hv1.tp_vlan_tpid;
+#endif
+    tpid = g_htons(tpid);
+    tci = g_htons(tci);
+    memcpy(tp->vlan_buf, pd, 2 * 6);
+    memcpy(tp->vlan_buf + 12, &tpid, 2);
+    memcpy(tp->vlan_buf + 14, &tci, 2);
+    memcpy(tp->vlan_buf + 16, pd + 12, phdr->caplen - 12);
+    phdr->len += 4;
+    phdr->caplen += 4;
+    if (phdr->caplen > (guint32)tp->snaplen)
+        phdr->caplen = tp->snaplen;
+    return tp->vlan_buf;
+}
+
+int
+tpacket_dispatch(tpacket_capture *tp, int timeout, pcap_handler callback, u_char *user)
+{
+    struct tpacket_block_desc *pbd;
+    const struct tpacket3_hdr *ppd;
+    struct pcap_pkthdr         phdr;
+    struct pollfd              pfd;
+    const guint8              *pd;
+    guint32                    i, num_pkts;
+
+    pbd = (struct tpacket_block_desc *)(tp->map + (size_t)tp->block_idx * TPACKET_BLOCK_SIZE);
+    if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER)) {
+        pfd.fd = tp->fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) == -1)
+            return errno == EINTR ? 0 : -1;
+        if (!(pbd->hdr.bh1.block_status & TP_STATUS_USER))
+            return 0;
+    }
+
+    num_pkts = pbd->hdr.bh1.num_pkts;
+    ppd = (const struct tpacket3_hdr *)((guint8 *)pbd + pbd->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < num_pkts; i++) {
+        phdr.ts.tv_sec = ppd->tp_sec;
+        phdr.ts.tv_usec = ppd->tp_nsec;
+        phdr.len = ppd->tp_len;
+        phdr.caplen = ppd->tp_snaplen;
+        if (phdr.caplen > (guint32)tp->snaplen)
+            phdr.caplen = tp->snaplen;
+        pd = (const guint8 *)ppd + ppd->tp_mac;
+        if (ppd->tp_status & TP_STATUS_VLAN_VALID)
+            pd = tpacket_vlan_insert(tp, ppd, pd, &phdr);
+        callback(user, &phdr, pd);
+        ppd = (const struct tpacket3_hdr *)((const guint8 *)ppd + ppd->tp_next_offset);
+    }
+
+    /* Hand the block back to the kernel. */
+    __sync_synchronize();
+    pbd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    tp->block_idx = (tp->block_idx + 1) % tp->block_count;
+    return (int)num_pkts;
+}
+
+gboolean
+tpacket_stats(tpacket_capture *tp, struct pcap_stat *ps)
+{
+    struct tpacket_stats_v3 st;
+    socklen_t               len = sizeof st;
+
+    /* The kernel resets its counters every time they're read. */
+    if (getsockopt(tp->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == -1)
+        return FALSE;
+    tp->recv += st.tp_packets;
+    tp->drops += st.tp_drops;
+    ps->ps_recv += (u_int)tp->recv;
+    ps->ps_drop += (u_int)tp->drops;
+    return TRUE;
+}
+
+void
+tpacket_close(tpacket_capture *tp)
+{
+    if (tp->map != NULL)
+        munmap(tp->map, tp->map_len);
+    if (tp->fd != -1)
+        close(tp->fd);
+    g_free(tp->vlan_buf);
+    g_free(tp);
+}
+
+#endif /* HAVE_TPACKET3 */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,107 @@
+/* capture-tpacket.h
+ * Definitions for capturing through a Linux TPACKET_V3 memory-mapped ring
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CAPTURE_TPACKET_H__
+#define __CAPTURE_TPACKET_H__
+
+#ifdef __linux__
+#include <linux/if_packet.h>
+#ifdef TPACKET3_HDRLEN
+#define HAVE_TPACKET3
+#endif
+#endif
+
+#ifdef HAVE_TPACKET3
+
+#include <pcap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A TPACKET_V3 capture reads from an AF_PACKET socket through a ring of
+ * blocks shared with the kernel.  The kernel fills a block with as many
+ * packets as fit, or as arrive before a timeout, and then hands the
+ * whole block over, so a busy capture makes no system call per packet.
+ *
+ * Only interfaces whose link-layer header is Ethernet are supported;
+ * the caller is expected to fall back to libpcap for anything else.
+ */
+typedef struct _tpacket_capture tpacket_capture;
+
+/** Open a capture on a network interface.
+ *
+ * @param ifname the interface name
+ * @param snaplen the maximum number of bytes to capture per packet
+ * @param promisc TRUE to put the interface into promiscuous mode
+ * @param buffer_size the size of the ring in MiB, or 0 for the default
+ * @param fanout_group if non-zero, join this PACKET_FANOUT group, so
+ *        that packets are spread over all the sockets in the group
+ * @param errmsg filled in on failure
+ * @param errmsg_len the size of errmsg
+ * @return the capture, or NULL on failure
+ */
+extern tpacket_capture *tpacket_open(const char *ifname, int snaplen,
+                                     gboolean promisc, int buffer_size,
+                                     int fanout_group,
+                                     char *errmsg, size_t errmsg_len);
+
+/** Attach a compiled capture filter to the socket. */
+extern gboolean tpacket_set_filter(tpacket_capture *tp,
+                                   const struct bpf_program *fcode);
+
+/** Wait up to timeout milliseconds for a block of packets and hand each
+ * packet in it to the callback, as pcap_dispatch() would.  The time
+ * stamps have nanosecond resolution, with the nanoseconds in tv_usec.
+ *
+ * @return the number of packets processed, or -1 on error (errno is set)
+ */
+extern int tpacket_dispatch(tpacket_capture *tp, int timeout,
+                            pcap_handler callback, u_char *user);
+
+/** Add the kernel's receive and drop counts since the capture was
+ * opened to ps_recv and ps_drop. */
+extern gboolean tpacket_stats(tpacket_capture *tp, struct pcap_stat *ps);
+
+extern void tpacket_close(tpacket_capture *tp);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HAVE_TPACKET3 */
+
+#endif /* __CAPTURE_TPACKET_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
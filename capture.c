@@ -336,6 +336,8 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      /* dumpcap is still writing it */
+      wtap_set_growing(((capture_file *)cap_session->cf)->wth);
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
@@ -413,9 +415,13 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
 /* Capture child told us how many dropped packets it counted.
  */
 void
-capture_input_drops(capture_session *cap_session, guint32 dropped)
+capture_input_drops(capture_session *cap_session, guint32 dropped,
+                    guint32 queued, guint32 queued_bytes)
 {
   g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO, "%u packet%s dropped", dropped, plurality(dropped, "", "s"));
+  if (queued != 0)
+    g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO, "%u packet%s (%u bytes) queued at most",
+          queued, plurality(queued, "", "s"), queued_bytes);
 
   g_assert(cap_session->state == CAPTURE_RUNNING);
 
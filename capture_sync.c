@@ -1809,9 +1809,21 @@ sync_pipe_input_cb(gint source, gpointer user_data)
         /* the capture child will close the sync_pipe, nothing to do for now */
         break;
         }
-    case SP_DROPS:
-        capture_input_drops(cap_session, (guint32)strtoul(buffer, NULL, 10));
+    case SP_DROPS: {
+        /* The drop count, optionally followed by the most packets and
+           bytes the capture queue held */
+        char *ch;
+        guint32 dropped, queued = 0, queued_bytes = 0;
+
+        dropped = (guint32)strtoul(buffer, &ch, 10);
+        if (*ch == ':') {
+            queued = (guint32)strtoul(ch + 1, &ch, 10);
+            if (*ch == ':')
+                queued_bytes = (guint32)strtoul(ch + 1, NULL, 10);
+        }
+        capture_input_drops(cap_session, dropped, queued, queued_bytes);
         break;
+        }
     default:
         g_assert_not_reached();
     }
@@ -105,10 +105,12 @@ extern void
 capture_input_new_packets(capture_session *cap_session, int to_read);
 
 /**
- * Capture child told us how many dropped packets it counted.
+ * Capture child told us how many dropped packets it counted, and the
+ * most packets and bytes its capture queue held (0 if it had none).
  */
 extern void
-capture_input_drops(capture_session *cap_session, guint32 dropped);
+capture_input_drops(capture_session *cap_session, guint32 dropped,
+                    guint32 queued, guint32 queued_bytes);
 
 /**
  * Capture child told us that an error has occurred while starting the capture.
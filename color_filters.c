@@ -58,6 +58,12 @@ static GSList *color_filter_list = NULL;
 static GSList *color_filter_deleted_list = NULL;
 static GSList *color_filter_valid_list   = NULL;
 
+/* the enabled filters of color_filter_list, applied together as a
+ * dfilter group; rebuilt on first use after the list has changed */
+static dfilter_group_t *color_filter_group = NULL;
+static GPtrArray       *color_filter_group_filters = NULL;
+static gboolean         color_filter_group_valid = FALSE;
+
 /* Color Filters can en-/disabled. */
 static gboolean filters_enabled = TRUE;
 
@@ -131,6 +137,48 @@ color_filters_add_tmp(GSList **cfl)
     return;
 }
 
+/* The compiled filters have changed; rebuild the group before using it.
+ * The group is freed right away, as the filters in it might go away. */
+static void
+color_filters_invalidate_group(void)
+{
+    if (color_filter_group != NULL) {
+        dfilter_group_free(color_filter_group);
+        color_filter_group = NULL;
+    }
+    color_filter_group_valid = FALSE;
+}
+
+static void
+color_filters_build_group(void)
+{
+    GSList         *curr;
+    color_filter_t *colorf;
+
+    color_filters_invalidate_group();
+    if (color_filter_group_filters == NULL)
+        color_filter_group_filters = g_ptr_array_new();
+    g_ptr_array_set_size(color_filter_group_filters, 0);
+
+    for (curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        colorf = (color_filter_t *)curr->data;
+        if (!colorf->disabled && colorf->c_colorfilter != NULL)
+            g_ptr_array_add(color_filter_group_filters, colorf);
+    }
+
+    if (color_filter_group_filters->len > 0) {
+        dfilter_t **dfs;
+        guint       i;
+
+        dfs = g_new(dfilter_t *, color_filter_group_filters->len);
+        for (i = 0; i < color_filter_group_filters->len; i++)
+            dfs[i] = ((color_filter_t *)g_ptr_array_index(color_filter_group_filters, i))->c_colorfilter;
+        color_filter_group = dfilter_group_new(dfs, color_filter_group_filters->len);
+        g_free(dfs);
+    }
+    color_filter_group_valid = TRUE;
+}
+
 static gint
 color_filters_find_by_name_cb(gconstpointer arg1, gconstpointer arg2)
 {
@@ -186,6 +234,7 @@ color_filters_set_tmp(guint8 filt_nr, gchar *filter, gboolean disabled)
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
                 colorf->disabled = ((i!=filt_nr) ? TRUE : disabled);
+                color_filters_invalidate_group();
                 /* Remember that there are now temporary coloring filters set */
                 if( filter )
                     tmp_colors_set = TRUE;
@@ -286,6 +335,7 @@ void
 color_filters_init(void)
 {
     /* delete all currently existing filters */
+    color_filters_invalidate_group();
     color_filter_list_delete(&color_filter_list);
 
     /* start the list with the temporary colorizing rules */
@@ -300,6 +350,8 @@ color_filters_init(void)
 void
 color_filters_reload(void)
 {
+    color_filters_invalidate_group();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -319,6 +371,13 @@ color_filters_cleanup(void)
 {
     /* delete the previously deleted filters */
     color_filter_list_delete(&color_filter_deleted_list);
+
+    /* and the group, which is rebuilt when it's needed again */
+    color_filters_invalidate_group();
+    if (color_filter_group_filters != NULL) {
+        g_ptr_array_free(color_filter_group_filters, TRUE);
+        color_filter_group_filters = NULL;
+    }
 }
 
 static void
@@ -371,6 +430,8 @@ color_filter_validate_cb(gpointer filter_arg, gpointer unused _U_)
 void
 color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl)
 {
+    color_filters_invalidate_group();
+
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
@@ -435,21 +496,18 @@ color_filters_prime_edt(epan_dissect_t *edt)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    int match;
 
     /* If we have color filters, "search" for the matching one. */
     if (color_filters_used()) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt)) {
-                return colorf;
-            }
-            curr = g_slist_next(curr);
+        if (!color_filter_group_valid)
+            color_filters_build_group();
+
+        /* The group shares field reads and common tests between the filters */
+        if (color_filter_group != NULL) {
+            match = dfilter_group_apply_edt(color_filter_group, edt);
+            if (match >= 0)
+                return (const color_filter_t *)g_ptr_array_index(color_filter_group_filters, match);
         }
     }
 
@@ -603,6 +661,7 @@ read_filters_file(FILE *f, gpointer user_data)
                 /* internal call */
                 colorf->c_colorfilter = temp_dfilter;
                 *cfl = g_slist_append(*cfl, colorf);
+                color_filters_invalidate_group();
             } else {
                 /* external call */
                 /* just editing, don't need the compiled filter */
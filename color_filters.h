@@ -56,7 +56,8 @@ void color_filters_init(void);
 /** Reload the color filters */
 void color_filters_reload(void);
 
-/** Cleanup remaining color filter zombies */
+/** Cleanup remaining color filter zombies, and forget the color filters
+ * set for frames; called when the capture file is closed. */
 void color_filters_cleanup(void);
 
 /** Color filters currently used?
@@ -31,10 +31,16 @@
 #include <glib.h>
 
 #include <epan/epan.h>
+#include <epan/epan-int.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
+#include <epan/tvbuff.h>
 #include <epan/dfilter/dfilter.h>
 
+#include <wiretap/wtap.h>
+
 #include <wsutil/plugins.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/privileges.h>
@@ -48,6 +54,7 @@ static void open_failure_message(const char *filename, int err,
 	gboolean for_writing);
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
+static int apply_group(const char *cf_name, int argc, char **argv, int optindex);
 
 int
 main(int argc, char **argv)
@@ -122,11 +129,19 @@ main(int argc, char **argv)
 	prefs_apply_all();
 
 	/* Check for filter on command line */
-	if (argc <= 1) {
+	if (argc <= 1 || (strcmp(argv[1], "-r") == 0 && argc <= 3)) {
 		fprintf(stderr, "Usage: dftest <filter>\n");
+		fprintf(stderr, "       dftest -r <infile> [-x] <filter> ...\n");
 		exit(1);
 	}
 
+	if (strcmp(argv[1], "-r") == 0) {
+		int ret = apply_group(argv[2], argc, argv, 3);
+
+		epan_cleanup();
+		exit(ret);
+	}
+
 	/* Get filter text */
 	text = get_args_as_string(argc, argv, 1);
 
@@ -151,6 +166,144 @@ main(int argc, char **argv)
 	exit(0);
 }
 
+/*
+ * The previous frames that the dissectors may ask about when we read a
+ * file.
+ */
+static const frame_data *ref;
+static frame_data ref_frame;
+static frame_data *prev_dis;
+static frame_data prev_dis_frame;
+
+static const nstime_t *
+dftest_get_frame_ts(void *data _U_, guint32 frame_num)
+{
+	if (ref && ref->num == frame_num)
+		return &ref->abs_ts;
+
+	if (prev_dis && prev_dis->num == frame_num)
+		return &prev_dis->abs_ts;
+
+	return NULL;
+}
+
+/*
+ * Apply the filters given on the command line to the packets of a file as
+ * one dfilter group, the way the coloring rules are applied, and print
+ * the number of each packet with the index of the first filter that
+ * matches it, or "-" if none does.  Filters preceded by "-x" are compiled
+ * but left out of the group, like disabled coloring rules.
+ */
+static int
+apply_group(const char *cf_name, int argc, char **argv, int optindex)
+{
+	dfilter_t	**dfs;
+	dfilter_t	**group_dfs;
+	dfilter_group_t	*group;
+	guint		num_dfs = 0, i;
+	epan_t		*epan;
+	epan_dissect_t	*edt;
+	wtap		*wth;
+	frame_data	fdata;
+	nstime_t	elapsed_time;
+	guint32		cum_bytes = 0;
+	guint32		num = 0;
+	gint64		data_offset;
+	int		err;
+	gchar		*err_info = NULL;
+	int		match;
+	int		ret = 0;
+
+	dfs = g_new0(dfilter_t *, argc);
+	group_dfs = g_new0(dfilter_t *, argc);
+	for (; optindex < argc; optindex++) {
+		gboolean disabled = FALSE;
+
+		if (strcmp(argv[optindex], "-x") == 0 && optindex + 1 < argc) {
+			disabled = TRUE;
+			optindex++;
+		}
+		if (!dfilter_compile(argv[optindex], &dfs[num_dfs])) {
+			fprintf(stderr, "dftest: %s\n", dfilter_error_msg);
+			ret = 2;
+			goto done;
+		}
+		/* NULL entries in a group never match */
+		group_dfs[num_dfs] = disabled ? NULL : dfs[num_dfs];
+		num_dfs++;
+	}
+
+	wth = wtap_open_offline(cf_name, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		fprintf(stderr, "dftest: The file \"%s\" could not be opened: %s.\n",
+			cf_name, wtap_strerror(err));
+		g_free(err_info);
+		ret = 2;
+		goto done;
+	}
+
+	group = dfilter_group_new(group_dfs, num_dfs);
+
+	epan = epan_new();
+	epan->get_frame_ts = dftest_get_frame_ts;
+	edt = epan_dissect_new(epan, TRUE, FALSE);
+
+	nstime_set_unset(&elapsed_time);
+	ref = NULL;
+	prev_dis = NULL;
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		struct wtap_pkthdr *phdr = wtap_phdr(wth);
+		const guint8 *pd = wtap_buf_ptr(wth);
+
+		num++;
+		frame_data_init(&fdata, num, phdr, data_offset, cum_bytes);
+		frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, prev_dis);
+		if (ref == &fdata) {
+			ref_frame = fdata;
+			ref = &ref_frame;
+		}
+
+		for (i = 0; i < num_dfs; i++) {
+			if (group_dfs[i] != NULL)
+				epan_dissect_prime_dfilter(edt, group_dfs[i]);
+		}
+		epan_dissect_run(edt, wtap_file_type_subtype(wth), phdr,
+				 tvb_new_real_data(pd, phdr->caplen, phdr->len),
+				 &fdata, NULL);
+
+		match = dfilter_group_apply_edt(group, edt);
+		if (match < 0)
+			printf("%u -\n", num);
+		else
+			printf("%u %d\n", num, match);
+
+		frame_data_set_after_dissect(&fdata, &cum_bytes);
+		prev_dis_frame = fdata;
+		prev_dis = &prev_dis_frame;
+
+		epan_dissect_reset(edt);
+		frame_data_destroy(&fdata);
+	}
+	if (err != 0) {
+		fprintf(stderr, "dftest: An error occurred while reading \"%s\": %s.\n",
+			cf_name, wtap_strerror(err));
+		g_free(err_info);
+		ret = 2;
+	}
+
+	epan_dissect_free(edt);
+	epan_free(epan);
+	dfilter_group_free(group);
+	wtap_close(wth);
+
+done:
+	for (i = 0; i < num_dfs; i++)
+		dfilter_free(dfs[i]);
+	g_free(dfs);
+	g_free(group_dfs);
+	return ret;
+}
+
 /*
  * General errors are reported with an console message in "dftest".
  */
@@ -126,6 +126,7 @@
 #endif /* _WIN32 */
 
 #include "pcapio.h"
+#include "capture-tpacket.h"
 
 #ifdef _WIN32
 #include "capture-wpcap.h"
@@ -155,6 +156,7 @@
 #include "wsutil/tempfile.h"
 #include "log.h"
 #include "wsutil/file_util.h"
+#include "wsutil/ws_compress.h"
 
 #include "ws80211_utils.h"
 
@@ -179,9 +181,6 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
@@ -305,6 +304,37 @@ typedef enum {
     PIPNEXIST
 } cap_pipe_err_t;
 
+/*
+ * When capturing with threads, each interface has a ring that its
+ * capture thread (the only producer) fills and the main thread (the
+ * only consumer) drains, so no lock is needed.  Packet headers go into
+ * a fixed number of slots; packet data is copied into a byte buffer,
+ * contiguously, wrapping to the start of the buffer when a packet
+ * doesn't fit at the end.  Both are allocated when the capture starts.
+ *
+ * head, data_head and the high-water marks are only written by the
+ * producer, tail and data_tail only by the consumer.  The counters
+ * are free-running; positions are taken modulo the sizes.
+ */
+typedef struct _pcap_ring_slot {
+    struct pcap_pkthdr  phdr;
+    guint               data_off;       /**< Offset of the packet data in the data buffer */
+    guint               data_end;       /**< Value of data_tail once this packet is consumed */
+} pcap_ring_slot;
+
+typedef struct _pcap_ring {
+    pcap_ring_slot     *slots;
+    guint               slot_count;     /**< Power of two */
+    u_char             *data;
+    guint               data_size;
+    volatile gint       head;           /**< Number of slots filled so far */
+    guint               data_head;      /**< Number of data bytes used so far */
+    volatile gint       tail;           /**< Number of slots consumed so far */
+    volatile gint       data_tail;      /**< Number of data bytes released so far */
+    guint               max_packets;    /**< High-water mark, in packets */
+    guint               max_bytes;      /**< High-water mark, in bytes */
+} pcap_ring;
+
 typedef struct _pcap_options {
     guint32                      received;
     guint32                      dropped;
@@ -319,6 +349,12 @@ typedef struct _pcap_options {
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
+    pcap_ring                   *ring;                   /**< Packets queued for the writer, if using threads */
+#ifdef HAVE_TPACKET3
+    tpacket_capture             *tpacket;                /**< TPACKET_V3 ring, if used instead of pcap_h */
+    int                          fanout_group;           /**< PACKET_FANOUT group of tpacket, or 0 */
+    struct _pcap_options        *fanout_next;            /**< Next socket of the same fanout group */
+#endif
                                                          /**< capture pipe (unix only "input file") */
     gboolean                     from_cap_pipe;          /**< TRUE if we are capturing data from a capture pipe */
     gboolean                     from_cap_socket;        /**< TRUE if we're capturing from socket */
@@ -358,19 +394,16 @@ typedef struct _loop_data {
     gboolean  report_packet_count; /**< Set by SIGINFO handler; print packet count */
 #endif
     GArray   *pcaps;
+    GAsyncQueue *writer_wakeup_q; /**< Capture threads push to this to wake the writer, if using threads */
+    volatile gint writer_idle;  /**< TRUE while the writer waits for packets to be queued */
     /* output file(s) */
     FILE     *pdh;
+    char     *pdh_buf;          /**< stdio buffer for pdh when not using a ring buffer */
     int       save_file_fd;
     guint64   bytes_written;
     guint32   autostop_files;
 } loop_data;
 
-typedef struct _pcap_queue_element {
-    pcap_options       *pcap_opts;
-    struct pcap_pkthdr  phdr;
-    u_char             *pd;
-} pcap_queue_element;
-
 /*
  * Standard secondary message for unexpected errors.
  */
@@ -419,7 +452,15 @@ static gboolean need_timeout_workaround;
 #define PIPE_READ_TIMEOUT   250000
 #endif
 
-#define WRITER_THREAD_TIMEOUT 100000 /* usecs */
+/*
+ * How long, in microseconds, the writer waits for a capture thread to
+ * queue a packet before it goes round its loop anyway, to check whether
+ * it should stop.
+ */
+#define WRITER_THREAD_IDLE_TIMEOUT PIPE_READ_TIMEOUT
+
+/* Long options of our own; capture_opts.h uses the ones below this */
+#define LONGOPT_COMPRESS        (LONGOPT_NUM_CAP_COMMENT+1)
 
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
@@ -429,6 +470,10 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+#ifdef HAVE_TPACKET3
+static int tpacket_threads = 0;   /* > 0 to capture through TPACKET_V3 with this many threads */
+#endif
+static ws_compress_type ring_compress_type = WS_COMPRESS_NONE;  /* compress completed ringbuffer files */
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
@@ -437,12 +482,13 @@ static void capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_
                                          const u_char *pd);
 static void capture_loop_get_errmsg(char *errmsg, int errmsglen, const char *fname,
                                     int err, gboolean is_close);
+static void pcap_ring_free(pcap_ring *ring);
 
 static void WS_MSVC_NORETURN exit_main(int err) G_GNUC_NORETURN;
 
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
-static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
+static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, guint32 queued, guint32 queued_bytes, gchar *name);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -564,6 +610,7 @@ print_usage(gboolean print_ver)
     fprintf(output, "  -b <ringbuffer opt.> ... duration:NUM - switch to next file after NUM secs\n");
     fprintf(output, "                           filesize:NUM - switch to next file after NUM KB\n");
     fprintf(output, "                              files:NUM - ringbuffer: replace after NUM files\n");
+    fprintf(output, "  --compress <type>        compress completed ringbuffer files with zstd or lz4\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap (default)\n");
     fprintf(output, "  -P                       use libpcap format instead of pcapng\n");
     fprintf(output, "  --capture-comment <comment>\n");
@@ -571,10 +618,14 @@ print_usage(gboolean print_ver)
     fprintf(output, "                           (only for pcapng)\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
-    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
-    fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
+    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered per interface\n");
+    fprintf(output, "  -C <byte_limit>          maximum number of bytes buffered per interface\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+#ifdef HAVE_TPACKET3
+    fprintf(output, "  -T <threads>             capture Ethernet interfaces through a TPACKET_V3\n");
+    fprintf(output, "                           ring, spread over <threads> threads each\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v                       print version information and exit\n");
     fprintf(output, "  -h                       display this help and exit\n");
@@ -2610,6 +2661,138 @@ cap_pipe_dispatch(loop_data *ld, pcap_options *pcap_opts, guchar *data, char *er
 }
 
 
+#ifdef HAVE_TPACKET3
+/* Switch an opened network interface over to a TPACKET_V3 ring.  On
+   failure, report why and keep capturing with libpcap.  pcap_h is
+   replaced by a dead handle, which is kept for compiling the capture
+   filter. */
+static void
+capture_loop_open_tpacket(pcap_options *pcap_opts, interface_options *interface_opts,
+                          guint idx)
+{
+    char             errmsg[MSG_MAX_LENGTH+1];
+    tpacket_capture *tp;
+    int              snaplen;
+    int              fanout_group = 0;
+
+    if (pcap_opts->linktype != DLT_EN10MB) {
+        g_snprintf(errmsg, sizeof(errmsg),
+                   "%s isn't an Ethernet interface.", interface_opts->name);
+        report_capture_error("Couldn't capture through a TPACKET_V3 ring, using libpcap instead.",
+                             errmsg);
+        return;
+    }
+
+    snaplen = pcap_snapshot(pcap_opts->pcap_h);
+    if (tpacket_threads > 1) {
+        /* Fanout group IDs are shared by the whole system. */
+        fanout_group = (int)((getpid() + idx) % 0xffff) + 1;
+    }
+    tp = tpacket_open(interface_opts->name, snaplen, interface_opts->promisc_mode,
+                      interface_opts->buffer_size, fanout_group,
+                      errmsg, sizeof(errmsg));
+    if (tp == NULL) {
+        report_capture_error("Couldn't capture through a TPACKET_V3 ring, using libpcap instead.",
+                             errmsg);
+        return;
+    }
+
+    pcap_close(pcap_opts->pcap_h);
+    pcap_opts->pcap_h = pcap_open_dead(pcap_opts->linktype, snaplen);
+    pcap_opts->tpacket = tp;
+    pcap_opts->fanout_group = fanout_group;
+    pcap_opts->snaplen = snaplen;
+    pcap_opts->ts_nsec = TRUE;
+}
+
+/* Open the other sockets of each interface's fanout group; each gets a
+   pcap_options of its own, and thus a capture thread of its own. */
+static gboolean
+capture_loop_open_fanout(capture_options *capture_opts, loop_data *ld,
+                         char *errmsg, size_t errmsg_len)
+{
+    interface_options  interface_opts;
+    pcap_options      *pcap_opts, *member;
+    guint              i;
+    int                t;
+
+    for (i = 0; i < capture_opts->ifaces->len; i++) {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+        if (pcap_opts->tpacket == NULL)
+            continue;
+        interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
+        for (t = 1; t < tpacket_threads; t++) {
+            member = (pcap_options *)g_malloc(sizeof (pcap_options));
+            *member = *pcap_opts;
+            member->received = 0;
+            member->dropped = 0;
+            member->flushed = 0;
+            member->pcap_h = NULL;
+            member->tpacket = tpacket_open(interface_opts.name, pcap_opts->snaplen,
+                                           interface_opts.promisc_mode,
+                                           interface_opts.buffer_size,
+                                           pcap_opts->fanout_group,
+                                           errmsg, errmsg_len);
+            if (member->tpacket == NULL) {
+                g_free(member);
+                return FALSE;
+            }
+            pcap_opts->fanout_next = member;
+            g_array_append_val(ld->pcaps, member);
+            pcap_opts = member;
+        }
+    }
+    return TRUE;
+}
+#endif
+
+/* Get the libpcap statistics for an interface; for a TPACKET_V3 fanout
+   group, the kernel counts for all of its sockets are added up. */
+static int
+capture_loop_pcap_stats(pcap_options *pcap_opts, struct pcap_stat *stats)
+{
+#ifdef HAVE_TPACKET3
+    pcap_options *member;
+
+    if (pcap_opts->tpacket != NULL) {
+        memset(stats, 0, sizeof *stats);
+        for (member = pcap_opts; member != NULL; member = member->fanout_next) {
+            if (!tpacket_stats(member->tpacket, stats))
+                return -1;
+        }
+        return 0;
+    }
+#endif
+    return pcap_stats(pcap_opts->pcap_h, stats);
+}
+
+/* Once the capture threads have stopped, add the counters of the other
+   sockets of each fanout group to those of the interface. */
+static void
+capture_loop_sum_fanout_counters(loop_data *ld _U_)
+{
+#ifdef HAVE_TPACKET3
+    guint         i;
+    pcap_options *pcap_opts, *member;
+
+    for (i = 0; i < ld->pcaps->len; i++) {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+        if (pcap_opts->tpacket == NULL || pcap_opts->pcap_h == NULL)
+            continue;   /* not the first socket of a group */
+        for (member = pcap_opts->fanout_next; member != NULL; member = member->fanout_next) {
+            pcap_opts->received += member->received;
+            pcap_opts->dropped += member->dropped;
+            pcap_opts->flushed += member->flushed;
+            member->received = member->dropped = member->flushed = 0;
+            if (pcap_opts->ring != NULL && member->ring != NULL) {
+                pcap_opts->ring->max_packets += member->ring->max_packets;
+                pcap_opts->ring->max_bytes += member->ring->max_bytes;
+            }
+        }
+    }
+#endif
+}
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2694,6 +2877,12 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         pcap_opts->received = 0;
         pcap_opts->dropped = 0;
         pcap_opts->flushed = 0;
+        pcap_opts->ring = NULL;
+#ifdef HAVE_TPACKET3
+        pcap_opts->tpacket = NULL;
+        pcap_opts->fanout_group = 0;
+        pcap_opts->fanout_next = NULL;
+#endif
         pcap_opts->pcap_h = NULL;
 #ifdef MUST_DO_SELECT
         pcap_opts->pcap_fd = -1;
@@ -2792,6 +2981,11 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
                 return FALSE;
             }
             pcap_opts->linktype = get_pcap_linktype(pcap_opts->pcap_h, interface_opts.name);
+#ifdef HAVE_TPACKET3
+            if (tpacket_threads > 0) {
+                capture_loop_open_tpacket(pcap_opts, &interface_opts, i);
+            }
+#endif
         } else {
             /* We couldn't open "iface" as a network device. */
             /* Try to open it as a pipe */
@@ -2845,6 +3039,15 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         g_array_insert_val(capture_opts->ifaces, i, interface_opts);
     }
 
+#ifdef HAVE_TPACKET3
+    /* The other sockets of each fanout group go after all the interfaces,
+       so that ld->pcaps is still indexed by interface for those. */
+    if (tpacket_threads > 1 &&
+        !capture_loop_open_fanout(capture_opts, ld, errmsg, errmsg_len)) {
+        return FALSE;
+    }
+#endif
+
     /* If not using libcap: we now can now set euid/egid to ruid/rgid         */
     /*  to remove any suid privileges.                                        */
     /* If using libcap: we can now remove NET_RAW and NET_ADMIN capabilities  */
@@ -2886,6 +3089,16 @@ static void capture_loop_close_input(loop_data *ld)
             pcap_close(pcap_opts->pcap_h);
             pcap_opts->pcap_h = NULL;
         }
+#ifdef HAVE_TPACKET3
+        if (pcap_opts->tpacket != NULL) {
+            tpacket_close(pcap_opts->tpacket);
+            pcap_opts->tpacket = NULL;
+        }
+#endif
+        if (pcap_opts->ring != NULL) {
+            pcap_ring_free(pcap_opts->ring);
+            pcap_opts->ring = NULL;
+        }
     }
 
     ld->go = FALSE;
@@ -2899,15 +3112,16 @@ static void capture_loop_close_input(loop_data *ld)
 
 /* init the capture filter */
 static initfilter_status_t
-capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
+capture_loop_init_filter(pcap_options *pcap_opts,
                          const gchar * name, const gchar * cfilter)
 {
+    pcap_t            *pcap_h = pcap_opts->pcap_h;
     struct bpf_program fcode;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_filter: %s", cfilter);
 
     /* capture filters only work on real interfaces */
-    if (cfilter && !from_cap_pipe) {
+    if (cfilter && !pcap_opts->from_cap_pipe) {
         /* A capture filter was specified; set it up. */
         if (!compile_capture_filter(name, pcap_h, &fcode, cfilter)) {
             /* Treat this specially - our caller might try to compile this
@@ -2915,6 +3129,21 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
                the display and capture filter syntaxes are different. */
             return INITFILTER_BAD_FILTER;
         }
+#ifdef HAVE_TPACKET3
+        if (pcap_opts->tpacket != NULL) {
+            pcap_options *member;
+
+            /* pcap_h is a dead handle, only used to compile the filter. */
+            for (member = pcap_opts; member != NULL; member = member->fanout_next) {
+                if (!tpacket_set_filter(member->tpacket, &fcode)) {
+#ifdef HAVE_PCAP_FREECODE
+                    pcap_freecode(&fcode);
+#endif
+                    return INITFILTER_OTHER_ERROR;
+                }
+            }
+        } else
+#endif
         if (pcap_setfilter(pcap_h, &fcode) < 0) {
 #ifdef HAVE_PCAP_FREECODE
             pcap_freecode(&fcode);
@@ -2956,6 +3185,10 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
         if (ld->pdh == NULL) {
             err = errno;
+        } else {
+            /* Write in large chunks rather than stdio's default BUFSIZ */
+            ld->pdh_buf = (char *)g_malloc(PCAPIO_WRITE_BUFFER_SIZE);
+            setvbuf(ld->pdh, ld->pdh_buf, _IOFBF, PCAPIO_WRITE_BUFFER_SIZE);
         }
     }
     if (ld->pdh) {
@@ -3013,6 +3246,8 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         if (!successful) {
             fclose(ld->pdh);
             ld->pdh = NULL;
+            g_free(ld->pdh_buf);
+            ld->pdh_buf = NULL;
         }
     }
 
@@ -3056,13 +3291,13 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
         return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
     } else {
         if (capture_opts->use_pcapng) {
-            for (i = 0; i < global_ld.pcaps->len; i++) {
+            for (i = 0; i < capture_opts->ifaces->len; i++) {
                 pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
                 if (!pcap_opts->from_cap_pipe) {
                     guint64 isb_ifrecv, isb_ifdrop;
                     struct pcap_stat stats;
 
-                    if (pcap_stats(pcap_opts->pcap_h, &stats) >= 0) {
+                    if (capture_loop_pcap_stats(pcap_opts, &stats) >= 0) {
                         isb_ifrecv = pcap_opts->received;
                         isb_ifdrop = stats.ps_drop + pcap_opts->dropped + pcap_opts->flushed;
                    } else {
@@ -3085,8 +3320,12 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
             if (err_close != NULL) {
                 *err_close = errno;
             }
+            g_free(ld->pdh_buf);
+            ld->pdh_buf = NULL;
             return (FALSE);
         } else {
+            g_free(ld->pdh_buf);
+            ld->pdh_buf = NULL;
             return (TRUE);
         }
     }
@@ -3142,6 +3381,24 @@ capture_loop_dispatch(loop_data *ld,
         }
 #endif
     }
+#ifdef HAVE_TPACKET3
+    else if (pcap_opts->tpacket != NULL)
+    {
+        /* dispatch a block from the TPACKET_V3 ring */
+        if (use_threads) {
+            inpkts = tpacket_dispatch(pcap_opts->tpacket, CAP_READ_TIMEOUT, capture_loop_queue_packet_cb, (u_char *)pcap_opts);
+        } else {
+            inpkts = tpacket_dispatch(pcap_opts->tpacket, CAP_READ_TIMEOUT, capture_loop_write_packet_cb, (u_char *)pcap_opts);
+        }
+        if (inpkts < 0) {
+            g_snprintf(errmsg, errmsg_len,
+                       "Error while capturing packets: %s", g_strerror(errno));
+            report_capture_error(errmsg, please_report);
+            pcap_opts->pcap_err = TRUE;
+            ld->go = FALSE;
+        }
+    }
+#endif
     else
     {
         /* dispatch from pcap */
@@ -3345,7 +3602,9 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 /* ringbuffer is enabled */
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
-                                             capture_opts->group_read_access);
+                                             capture_opts->group_read_access,
+                                             (capture_opts->has_autostop_filesize) ? (guint64)capture_opts->autostop_filesize * 1000 : 0,
+                                             ring_compress_type);
 
                 /* we need the ringbuf name */
                 if (*save_file_fd != -1) {
@@ -3521,6 +3780,188 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+/* Round up to a power of two, which must fit in a guint. */
+static guint
+pcap_ring_round_up(guint64 n)
+{
+    guint size = 1;
+
+    while (size < n && size < G_MAXUINT/2 + 1)
+        size <<= 1;
+    return size;
+}
+
+/* Allocate a ring that can hold at least packet_limit packets and at
+   least byte_limit bytes of packet data.  Packets of up to snaplen
+   bytes always fit in an empty ring: the data buffer is at least twice
+   that size, so such a packet fits either after the last one or, if
+   there isn't room before the end of the buffer, at its start. */
+static pcap_ring *
+pcap_ring_new(guint64 packet_limit, guint64 byte_limit, int snaplen)
+{
+    pcap_ring *ring;
+
+    /* A preallocated ring needs both limits; derive a missing one from
+       the other, allowing for packets of up to snaplen bytes, or 2048
+       bytes if that's more than most packets will be. */
+    if (snaplen <= 0)
+        snaplen = WTAP_MAX_PACKET_SIZE;
+    if (packet_limit == 0)
+        packet_limit = byte_limit / 64;
+    if (byte_limit == 0)
+        byte_limit = packet_limit * MIN(snaplen, 2048);
+    if (byte_limit < 2 * (guint64)snaplen)
+        byte_limit = 2 * (guint64)snaplen;
+
+    ring = g_new0(pcap_ring, 1);
+    ring->slot_count = pcap_ring_round_up(packet_limit);
+    ring->slots = g_new(pcap_ring_slot, ring->slot_count);
+    ring->data_size = pcap_ring_round_up(byte_limit);
+    ring->data = (u_char *)g_malloc(ring->data_size);
+    return ring;
+}
+
+static void
+pcap_ring_free(pcap_ring *ring)
+{
+    g_free(ring->data);
+    g_free(ring->slots);
+    g_free(ring);
+}
+
+/* Called by the capture thread; returns FALSE if the ring is full. */
+static gboolean
+pcap_ring_put(pcap_ring *ring, const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    guint           head      = (guint)ring->head;
+    guint           tail      = (guint)g_atomic_int_get(&ring->tail);
+    guint           data_tail = (guint)g_atomic_int_get(&ring->data_tail);
+    guint           pos, skip, used;
+    pcap_ring_slot *slot;
+
+    if (head - tail >= ring->slot_count)
+        return FALSE;
+
+    /* Keep the packet data contiguous; if it doesn't fit before the end
+       of the buffer, skip the rest of the buffer and start over at the
+       beginning. */
+    pos = ring->data_head & (ring->data_size - 1);
+    skip = (phdr->caplen > ring->data_size - pos) ? ring->data_size - pos : 0;
+    used = ring->data_head - data_tail;
+    if (phdr->caplen > ring->data_size - used ||
+        skip > ring->data_size - used - phdr->caplen)
+        return FALSE;
+
+    slot = &ring->slots[head & (ring->slot_count - 1)];
+    slot->phdr = *phdr;
+    slot->data_off = skip ? 0 : pos;
+    memcpy(ring->data + slot->data_off, pd, phdr->caplen);
+    ring->data_head += skip + phdr->caplen;
+    slot->data_end = ring->data_head;
+
+    if (head + 1 - tail > ring->max_packets)
+        ring->max_packets = head + 1 - tail;
+    if (ring->data_head - data_tail > ring->max_bytes)
+        ring->max_bytes = ring->data_head - data_tail;
+
+    /* Publish the slot. */
+    g_atomic_int_set(&ring->head, (gint)(head + 1));
+    return TRUE;
+}
+
+/* Called by the main thread; returns the oldest queued packet, if any. */
+static const pcap_ring_slot *
+pcap_ring_peek(pcap_ring *ring)
+{
+    guint tail = (guint)ring->tail;
+
+    if ((guint)g_atomic_int_get(&ring->head) == tail)
+        return NULL;
+    return &ring->slots[tail & (ring->slot_count - 1)];
+}
+
+/* Called by the main thread once it's done with the packet returned by
+   pcap_ring_peek(). */
+static void
+pcap_ring_release(pcap_ring *ring, const pcap_ring_slot *slot)
+{
+    g_atomic_int_set(&ring->data_tail, (gint)slot->data_end);
+    g_atomic_int_set(&ring->tail, (gint)((guint)ring->tail + 1));
+}
+
+/* Write out the queued packet with the oldest time stamp of all the
+   interfaces.  Returns the number of packets written (0 or 1). */
+static int
+capture_loop_write_queued_packet(loop_data *ld)
+{
+    pcap_options         *pcap_opts, *oldest_opts = NULL;
+    const pcap_ring_slot *slot, *oldest = NULL;
+    guint64               ts, oldest_ts = 0;
+    guint                 i;
+
+    for (i = 0; i < ld->pcaps->len; i++) {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+        slot = pcap_ring_peek(pcap_opts->ring);
+        if (slot == NULL)
+            continue;
+        ts = (guint64)slot->phdr.ts.tv_sec * 1000000000 +
+             (pcap_opts->ts_nsec ? (guint64)slot->phdr.ts.tv_usec : (guint64)slot->phdr.ts.tv_usec * 1000);
+        if (oldest == NULL || ts < oldest_ts) {
+            oldest = slot;
+            oldest_opts = pcap_opts;
+            oldest_ts = ts;
+        }
+    }
+    if (oldest == NULL)
+        return 0;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+          "Dequeued a packet of length %d captured on interface %d.",
+          oldest->phdr.caplen, oldest_opts->interface_id);
+    capture_loop_write_packet_cb((u_char *)oldest_opts, &oldest->phdr,
+                                 oldest_opts->ring->data + oldest->data_off);
+    pcap_ring_release(oldest_opts->ring, oldest);
+    return 1;
+}
+
+/* Called by the main thread when nothing is queued on any interface;
+   waits until a capture thread queues a packet, or for at most
+   WRITER_THREAD_IDLE_TIMEOUT. */
+static void
+capture_loop_wait_for_queued_packet(loop_data *ld)
+{
+    pcap_options *pcap_opts;
+    gpointer      wakeup = NULL;
+    guint         i;
+#if !GLIB_CHECK_VERSION(2,31,18)
+    GTimeVal      wait_time;
+#endif
+
+    g_atomic_int_set(&ld->writer_idle, TRUE);
+
+    /* A packet queued before we said we were idle doesn't wake us */
+    for (i = 0; i < ld->pcaps->len; i++) {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+        if (pcap_ring_peek(pcap_opts->ring) != NULL)
+            break;
+    }
+    if (i == ld->pcaps->len) {
+#if GLIB_CHECK_VERSION(2,31,18)
+        wakeup = g_async_queue_timeout_pop(ld->writer_wakeup_q, WRITER_THREAD_IDLE_TIMEOUT);
+#else
+        g_get_current_time(&wait_time);
+        g_time_val_add(&wait_time, WRITER_THREAD_IDLE_TIMEOUT);
+        wakeup = g_async_queue_timed_pop(ld->writer_wakeup_q, &wait_time);
+#endif
+    }
+
+    /* If a capture thread has seen that we're idle, it's pushing a
+       wakeup that we haven't got; take it, so it doesn't cut the next
+       wait short. */
+    if (wakeup == NULL && !g_atomic_int_compare_and_exchange(&ld->writer_idle, TRUE, FALSE))
+        g_async_queue_pop(ld->writer_wakeup_q);
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3548,10 +3989,12 @@ static gboolean
 capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct pcap_stat *stats)
 {
 #ifdef WIN32
-    DWORD              upd_time, cur_time; /* GetTickCount() returns a "DWORD" (which is 'unsigned long') */
+    DWORD              upd_time, flush_time, cur_time; /* GetTickCount() returns a "DWORD" (which is 'unsigned long') */
 #else
-    struct timeval     upd_time, cur_time;
+    struct timeval     upd_time, flush_time, cur_time;
 #endif
+    gboolean           upd_due, flush_due;
+    gboolean           pipe_unflushed        = FALSE;
     int                err_close;
     int                inpkts;
     condition         *cnd_file_duration     = NULL;
@@ -3583,6 +4026,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.inpkts_to_sync_pipe = 0;
     global_ld.err                 = 0;  /* no error seen yet */
     global_ld.pdh                 = NULL;
+    global_ld.pdh_buf             = NULL;
     global_ld.autostop_files      = 0;
     global_ld.save_file_fd        = -1;
 
@@ -3606,7 +4050,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
          * is NULL. This might be a bug in WPCap. Therefore we provide an empty
          * string.
          */
-        switch (capture_loop_init_filter(pcap_opts->pcap_h, pcap_opts->from_cap_pipe,
+        switch (capture_loop_init_filter(pcap_opts,
                                          interface_opts.name,
                                          interface_opts.cfilter?interface_opts.cfilter:"")) {
 
@@ -3688,15 +4132,21 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 #else
     gettimeofday(&upd_time, NULL);
 #endif
+    flush_time = upd_time;
     start_time = create_timestamp();
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop running!");
 
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            pcap_opts->ring = pcap_ring_new(pcap_queue_packet_limit,
+                                            pcap_queue_byte_limit,
+                                            pcap_opts->snaplen);
+        }
+        global_ld.writer_wakeup_q = g_async_queue_new();
+        global_ld.writer_idle = FALSE;
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
 #if GLIB_CHECK_VERSION(2,31,0)
@@ -3710,37 +4160,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-#if GLIB_CHECK_VERSION(2,31,18)
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-#else
-            GTimeVal write_thread_time;
-
-            g_get_current_time(&write_thread_time);
-            g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timed_pop_unlocked(pcap_queue, &write_thread_time);
-#endif
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                      "Dequeued a packet of length %d captured on interface %d.",
-                      queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-
-                capture_loop_write_packet_cb((u_char *) queue_element->pcap_opts,
-                                             &queue_element->phdr,
-                                             queue_element->pd);
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
+            inpkts = capture_loop_write_queued_packet(&global_ld);
+            if (inpkts == 0) {
+                /* Nothing queued on any interface; don't spin. */
+                capture_loop_wait_for_queued_packet(&global_ld);
             }
         } else {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, 0);
@@ -3775,7 +4198,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                     continue;
             } /* cnd_autostop_size */
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                pipe_unflushed = TRUE;
             }
         } /* inpkts */
 
@@ -3785,15 +4208,31 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
          */
 #define DUMPCAP_UPD_TIME 500
 
+        /* Whoever reads our pipe wants the packets promptly, but flushing
+         * after every dispatch turns each small batch into its own write.
+         * Flush at most every 50ms; stdio writes out a full buffer anyway.
+         */
+#define DUMPCAP_PIPE_FLUSH_TIME 50
+
 #ifdef WIN32
         cur_time = GetTickCount();  /* Note: wraps to 0 if sys runs for 49.7 days */
-        if ((cur_time - upd_time) > DUMPCAP_UPD_TIME) { /* wrap just causes an extra update */
+        upd_due = (cur_time - upd_time) > DUMPCAP_UPD_TIME; /* wrap just causes an extra update */
+        flush_due = (cur_time - flush_time) > DUMPCAP_PIPE_FLUSH_TIME;
 #else
         gettimeofday(&cur_time, NULL);
-        if (((guint64)cur_time.tv_sec * 1000000 + cur_time.tv_usec) >
-            ((guint64)upd_time.tv_sec * 1000000 + upd_time.tv_usec + DUMPCAP_UPD_TIME*1000)) {
+        upd_due = ((guint64)cur_time.tv_sec * 1000000 + cur_time.tv_usec) >
+            ((guint64)upd_time.tv_sec * 1000000 + upd_time.tv_usec + DUMPCAP_UPD_TIME*1000);
+        flush_due = ((guint64)cur_time.tv_sec * 1000000 + cur_time.tv_usec) >
+            ((guint64)flush_time.tv_sec * 1000000 + flush_time.tv_usec + DUMPCAP_PIPE_FLUSH_TIME*1000);
 #endif
 
+        if (pipe_unflushed && flush_due) {
+            fflush(global_ld.pdh);
+            pipe_unflushed = FALSE;
+            flush_time = cur_time;
+        }
+
+        if (upd_due) {
             upd_time = cur_time;
 
 #if 0
@@ -3805,6 +4244,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
                 fflush(global_ld.pdh);
+                pipe_unflushed = FALSE;
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -3833,8 +4273,6 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
-
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
@@ -3843,31 +4281,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_opts->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_opts,
-                                         &queue_element->phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
+        while (capture_loop_write_queued_packet(&global_ld)) {
             global_ld.inpkts_to_sync_pipe += 1;
-            if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
-            }
+        }
+        g_async_queue_unref(global_ld.writer_wakeup_q);
+        global_ld.writer_wakeup_q = NULL;
+        if (capture_opts->output_to_pipe) {
+            fflush(global_ld.pdh);
         }
     }
+    capture_loop_sum_fanout_counters(&global_ld);
 
 
     /* delete stop conditions */
@@ -3978,7 +4401,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
              * platforms; initialize it to 0 to handle that.
              */
             stats->ps_ifdrop = 0;
-            if (pcap_stats(pcap_opts->pcap_h, stats) >= 0) {
+            if (capture_loop_pcap_stats(pcap_opts, stats) >= 0) {
                 *stats_known = TRUE;
                 /* Let the parent process know. */
                 pcap_dropped += stats->ps_drop;
@@ -3989,7 +4412,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 report_capture_error(errmsg, please_report);
             }
         }
-        report_packet_drops(received, pcap_dropped, pcap_opts->dropped, pcap_opts->flushed, stats->ps_ifdrop, interface_opts.console_display_name);
+        report_packet_drops(received, pcap_dropped, pcap_opts->dropped, pcap_opts->flushed, stats->ps_ifdrop,
+                            pcap_opts->ring ? pcap_opts->ring->max_packets : 0,
+                            pcap_opts->ring ? pcap_opts->ring->max_bytes : 0,
+                            interface_opts.console_display_name);
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4160,8 +4586,6 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
                              const u_char *pd)
 {
     pcap_options       *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
-    pcap_queue_element *queue_element;
-    gboolean            limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4171,35 +4595,8 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
-    if (queue_element == NULL) {
-       pcap_opts->dropped++;
-       return;
-    }
-    queue_element->pcap_opts = pcap_opts;
-    queue_element->phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_opts->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!pcap_ring_put(pcap_opts->ring, phdr, pd)) {
         pcap_opts->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
@@ -4208,12 +4605,11 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Queued a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
+        /* Wake the writer if it's waiting; only one thread gets to */
+        if (g_atomic_int_get(&global_ld.writer_idle) &&
+            g_atomic_int_compare_and_exchange(&global_ld.writer_idle, TRUE, FALSE))
+            g_async_queue_push(global_ld.writer_wakeup_q, GINT_TO_POINTER(1));
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
 }
 
 static int
@@ -4269,6 +4665,7 @@ main(int argc, char *argv[])
     int               opt;
     struct option     long_options[] = {
         {(char *)"capture-comment", required_argument, NULL, LONGOPT_NUM_CAP_COMMENT },
+        {(char *)"compress", required_argument, NULL, LONGOPT_COMPRESS },
         {0, 0, 0, 0 }
     };
 
@@ -4362,7 +4759,13 @@ main(int argc, char *argv[])
 #define OPTSTRING_d ""
 #endif
 
-#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "C:c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I "k:L" OPTSTRING_m "MN:npPq" OPTSTRING_r "Ss:t" OPTSTRING_u "vw:y:Z:"
+#ifdef HAVE_TPACKET3
+#define OPTSTRING_T "T:"
+#else
+#define OPTSTRING_T ""
+#endif
+
+#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "C:c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I "k:L" OPTSTRING_m "MN:npPq" OPTSTRING_r "Ss:t" OPTSTRING_T OPTSTRING_u "vw:y:Z:"
 
 #ifdef DEBUG_CHILD_DUMPCAP
     if ((debug_log = ws_fopen("dumpcap_debug_log.tmp","w")) == NULL) {
@@ -4695,6 +5098,21 @@ main(int argc, char *argv[])
         case 'q':        /* Quiet */
             quiet = TRUE;
             break;
+        case LONGOPT_COMPRESS:   /* Compress completed ringbuffer files */
+            if (strcmp(optarg, "zstd") == 0) {
+                ring_compress_type = WS_COMPRESS_ZSTD;
+            } else if (strcmp(optarg, "lz4") == 0) {
+                ring_compress_type = WS_COMPRESS_LZ4;
+            } else {
+                cmdarg_err("\"%s\" isn't a valid compression type; use \"zstd\" or \"lz4\".",
+                           optarg);
+                exit_main(1);
+            }
+            if (!ws_compress_available(ring_compress_type)) {
+                cmdarg_err("This version of dumpcap can't write %s compressed files.", optarg);
+                exit_main(1);
+            }
+            break;
         case 't':
             use_threads = TRUE;
             break;
@@ -4744,6 +5162,11 @@ main(int argc, char *argv[])
         case 'N':
             pcap_queue_packet_limit = get_positive_int(optarg, "packet_limit");
             break;
+#ifdef HAVE_TPACKET3
+        case 'T':
+            tpacket_threads = get_positive_int(optarg, "number of TPACKET_V3 threads");
+            break;
+#endif
         default:
             cmdarg_err("Invalid Option: %s", argv[optind-1]);
             /* FALLTHROUGH */
@@ -4774,6 +5197,11 @@ main(int argc, char *argv[])
     if ((pcap_queue_byte_limit > 0) || (pcap_queue_packet_limit > 0)) {
         use_threads = TRUE;
     }
+#ifdef HAVE_TPACKET3
+    if (tpacket_threads > 1) {
+        use_threads = TRUE;
+    }
+#endif
     if ((pcap_queue_byte_limit == 0) && (pcap_queue_packet_limit == 0)) {
         /* Use some default if the user hasn't specified some */
         /* XXX: Are these defaults good enough? */
@@ -4833,6 +5261,10 @@ main(int argc, char *argv[])
 #endif
             }
         }
+        if (ring_compress_type != WS_COMPRESS_NONE && !global_capture_opts.multi_files_on) {
+            cmdarg_err("Compression requested, but a ring buffer isn't being used.");
+            exit_main(1);
+        }
     }
 
     /*
@@ -5199,17 +5631,19 @@ report_capture_error(const char *error_msg, const char *secondary_error_msg)
 }
 
 static void
-report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name)
+report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, guint32 queued, guint32 queued_bytes, gchar *name)
 {
-    char tmp[SP_DECISIZE+1+1];
+    char tmp[3*SP_DECISIZE+2+1];
     guint32 total_drops = pcap_drops + drops + flushed;
 
-    g_snprintf(tmp, sizeof(tmp), "%u", total_drops);
+    /* The most packets and bytes the interface's queue held follow the
+       drop count; parents that only want the drop count stop at the ':' */
+    g_snprintf(tmp, sizeof(tmp), "%u:%u:%u", total_drops, queued, queued_bytes);
 
     if (capture_child) {
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
-            "Packets received/dropped on interface '%s': %u/%u (pcap:%u/dumpcap:%u/flushed:%u/ps_ifdrop:%u)",
-            name, received, total_drops, pcap_drops, drops, flushed, ps_ifdrop);
+            "Packets received/dropped on interface '%s': %u/%u (pcap:%u/dumpcap:%u/flushed:%u/ps_ifdrop:%u) (queued at most:%u/%u bytes)",
+            name, received, total_drops, pcap_drops, drops, flushed, ps_ifdrop, queued, queued_bytes);
         /* XXX: Need to provide interface id, changes to consumers required. */
         pipe_write_block(2, SP_DROPS, tmp);
     } else {
@@ -5217,6 +5651,11 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
             "Packets received/dropped on interface '%s': %u/%u (pcap:%u/dumpcap:%u/flushed:%u/ps_ifdrop:%u) (%.1f%%)\n",
             name, received, total_drops, pcap_drops, drops, flushed, ps_ifdrop,
             received ? 100.0 * received / (received + total_drops) : 0.0);
+        if (queued != 0) {
+            fprintf(stderr,
+                "Packets queued on interface '%s' at most: %u (%u bytes)\n",
+                name, queued, queued_bytes);
+        }
         /* stderr could be line buffered */
         fflush(stderr);
     }
@@ -50,6 +50,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
@@ -95,19 +99,37 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The digests of the last dup_window packets are kept in the fd_hash[]
+ * ring.  fd_hash_index maps a digest and length to the newest ring entry
+ * with that digest; each entry links to the previous entry with the same
+ * digest, so looking up a packet doesn't depend on the window size.
  */
 typedef struct _fd_hash_t {
     md5_byte_t digest[16];
     guint32    len;
     nstime_t   time;
+    guint64    seq;        /* Sequence number of this entry, 0 if unused */
+    int        prev_same;  /* Previous entry with the same digest, or -1 */
+    guint64    prev_seq;   /* Its sequence number, to detect reused entries */
 } fd_hash_t;
 
+#define LONGOPT_COMPRESS        1   /* --compress; not a valid option character */
+
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
-#define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
+#define MAX_DUP_DEPTH     1000000   /* the maximum window (and maximum size of fd_hash[]) for de-duplication */
+
+typedef enum {
+    DUP_HASH_MD5,
+    DUP_HASH_MURMUR3
+} dup_hash_t;
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+static fd_hash_t  *fd_hash       = NULL;
+static GHashTable *fd_hash_index = NULL;
+static guint64     fd_hash_seq   = 0;
+static int         dup_window    = DEFAULT_DUP_DEPTH;
+static int         cur_dup_entry = 0;
+static dup_hash_t  dup_hash      = DUP_HASH_MD5;
 
 #define ONE_MILLION    1000000
 #define ONE_BILLION 1000000000
@@ -149,6 +171,7 @@ static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcap     */
 #endif
 static int                    out_frame_type            = -2; /* Leave frame type alone */
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    verbose                   = 0;  /* Not so verbose         */
 static struct time_adjustment time_adj                  = {{0, 0}, 0}; /* no adjustment */
 static nstime_t               relative_time_window      = {0, 0}; /* de-dup time window */
@@ -523,99 +546,235 @@ set_rel_time(char *optarg_str_p)
     relative_time_window.nsecs = (int)val;
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
-    md5_state_t ms;
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+static guint64
+murmur3_fmix64(guint64 k)
+{
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
 
-    /* Calculate our digest */
-    md5_init(&ms);
-    md5_append(&ms, fd, len);
-    md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+/*
+ * MurmurHash3 x64 128-bit variant, seed 0.  Not cryptographically
+ * secure, but much faster than MD5 and good enough to tell packets apart.
+ */
+static void
+murmur3_x64_128(const guint8 *data, guint32 len, md5_byte_t digest[16])
+{
+    const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+    const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+    guint32 nblocks = len / 16;
+    guint64 h1 = 0, h2 = 0, k1, k2;
+    const guint8 *tail;
+    guint32 i;
+
+    for (i = 0; i < nblocks; i++) {
+        memcpy(&k1, data + i * 16, 8);
+        memcpy(&k2, data + i * 16 + 8, 8);
+        k1 = GUINT64_FROM_LE(k1);
+        k2 = GUINT64_FROM_LE(k2);
+
+        k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
 
-    fd_hash[cur_dup_entry].len = len;
+    tail = data + nblocks * 16;
+    k1 = 0;
+    k2 = 0;
+    switch (len & 15) {
+    case 15: k2 ^= ((guint64)tail[14]) << 48; /* FALL THROUGH */
+    case 14: k2 ^= ((guint64)tail[13]) << 40; /* FALL THROUGH */
+    case 13: k2 ^= ((guint64)tail[12]) << 32; /* FALL THROUGH */
+    case 12: k2 ^= ((guint64)tail[11]) << 24; /* FALL THROUGH */
+    case 11: k2 ^= ((guint64)tail[10]) << 16; /* FALL THROUGH */
+    case 10: k2 ^= ((guint64)tail[ 9]) << 8;  /* FALL THROUGH */
+    case  9: k2 ^= ((guint64)tail[ 8]);
+             k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+             /* FALL THROUGH */
+    case  8: k1 ^= ((guint64)tail[ 7]) << 56; /* FALL THROUGH */
+    case  7: k1 ^= ((guint64)tail[ 6]) << 48; /* FALL THROUGH */
+    case  6: k1 ^= ((guint64)tail[ 5]) << 40; /* FALL THROUGH */
+    case  5: k1 ^= ((guint64)tail[ 4]) << 32; /* FALL THROUGH */
+    case  4: k1 ^= ((guint64)tail[ 3]) << 24; /* FALL THROUGH */
+    case  3: k1 ^= ((guint64)tail[ 2]) << 16; /* FALL THROUGH */
+    case  2: k1 ^= ((guint64)tail[ 1]) << 8;  /* FALL THROUGH */
+    case  1: k1 ^= ((guint64)tail[ 0]);
+             k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+             break;
+    default:
+             break;
+    }
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = murmur3_fmix64(h1);
+    h2 = murmur3_fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    h1 = GUINT64_TO_LE(h1);
+    h2 = GUINT64_TO_LE(h2);
+    memcpy(digest, &h1, 8);
+    memcpy(digest + 8, &h2, 8);
+}
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
-    }
+/* The digest is already well mixed; use part of it as the hash. */
+static guint
+fd_hash_key_hash(gconstpointer key)
+{
+    const fd_hash_t *fh = (const fd_hash_t *)key;
+    guint h;
 
-    return FALSE;
+    memcpy(&h, fh->digest, sizeof h);
+    return h ^ fh->len;
 }
 
 static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
+fd_hash_key_equal(gconstpointer a, gconstpointer b)
+{
+    const fd_hash_t *fh_a = (const fd_hash_t *)a;
+    const fd_hash_t *fh_b = (const fd_hash_t *)b;
+
+    return fh_a->len == fh_b->len && memcmp(fh_a->digest, fh_b->digest, 16) == 0;
+}
+
+static void
+fd_hash_init(void)
+{
+    /* A window of 0 still needs one entry to hash into. */
+    fd_hash = g_new0(fd_hash_t, dup_window > 0 ? dup_window : 1);
+    fd_hash_index = g_hash_table_new(fd_hash_key_hash, fd_hash_key_equal);
+    fd_hash_seq = 0;
+    cur_dup_entry = 0;
+}
+
+static void
+fd_hash_cleanup(void)
+{
+    if (fd_hash_index)
+        g_hash_table_destroy(fd_hash_index);
+    fd_hash_index = NULL;
+    g_free(fd_hash);
+    fd_hash = NULL;
+}
+
+/*
+ * Add the digest of a packet to the next entry of the ring, evicting the
+ * oldest packet.  Returns the newest older entry with the same digest and
+ * length, or NULL if there isn't one.
+ */
+static fd_hash_t *
+fd_hash_add(guint8* fd, guint32 len, const nstime_t *current)
+{
+    fd_hash_t  *fh, *newest;
     md5_state_t ms;
 
     cur_dup_entry++;
     if (cur_dup_entry >= dup_window)
         cur_dup_entry = 0;
 
+    fh = &fd_hash[cur_dup_entry];
+
+    /* Evict the entry we're about to overwrite. */
+    if (fh->seq != 0 && g_hash_table_lookup(fd_hash_index, fh) == fh)
+        g_hash_table_remove(fd_hash_index, fh);
+
     /* Calculate our digest */
-    md5_init(&ms);
-    md5_append(&ms, fd, len);
-    md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+    if (dup_hash == DUP_HASH_MURMUR3) {
+        murmur3_x64_128(fd, len, fh->digest);
+    } else {
+        md5_init(&ms);
+        md5_append(&ms, fd, len);
+        md5_finish(&ms, fh->digest);
+    }
+
+    fh->len = len;
+    if (current) {
+        fh->time.secs = current->secs;
+        fh->time.nsecs = current->nsecs;
+    } else {
+        nstime_set_unset(&fh->time);
+    }
+    fh->seq = ++fd_hash_seq;
+
+    newest = (fd_hash_t *)g_hash_table_lookup(fd_hash_index, fh);
+    if (newest) {
+        fh->prev_same = (int)(newest - fd_hash);
+        fh->prev_seq = newest->seq;
+    } else {
+        fh->prev_same = -1;
+        fh->prev_seq = 0;
+    }
+    g_hash_table_replace(fd_hash_index, fh, fh);
+
+    return newest;
+}
+
+/* Previous entry with the same digest as fh, if it's still in the ring. */
+static fd_hash_t *
+fd_hash_prev_same(const fd_hash_t *fh)
+{
+    fd_hash_t *prev;
+
+    if (fh->prev_same < 0)
+        return NULL;
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].time.secs = current->secs;
-    fd_hash[cur_dup_entry].time.nsecs = current->nsecs;
+    prev = &fd_hash[fh->prev_same];
+    return prev->seq == fh->prev_seq ? prev : NULL;
+}
+
+static const char *
+dup_hash_name(void)
+{
+    return dup_hash == DUP_HASH_MURMUR3 ? "Murmur3" : "MD5";
+}
+
+static gboolean
+is_duplicate(guint8* fd, guint32 len) {
+    /* Everything in the index is within the window. */
+    return fd_hash_add(fd, len, NULL) != NULL;
+}
+
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+    fd_hash_t *fh;
 
     /*
      * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
+     * We only look at cached packets with the same digest,
+     * starting from the most recently added one and working
+     * backwards towards older packets.  This approach allows
+     * the dup test to be terminated when the relative time of
+     * a cached entry is found to be beyond the dup time window.
      *
      * Of course this assumes that the input trace file is
      * "well-formed" in the sense that the packet timestamps are
      * in strict chronologically increasing order (which is NOT
      * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
      */
 
-    for (i = cur_dup_entry - 1;; i--) {
+    for (fh = fd_hash_add(fd, len, current); fh != NULL; fh = fd_hash_prev_same(fh)) {
         nstime_t delta;
         int cmp;
 
-        if (i < 0)
-            i = dup_window - 1;
-
-        if (i == cur_dup_entry) {
-            /*
-             * We've decremented back to where we started.
-             * Check no more!
-             */
-            break;
-        }
-
-        if (nstime_is_unset(&(fd_hash[i].time))) {
+        if (nstime_is_unset(&(fh->time))) {
             /*
-             * We've decremented to an unused fd_hash[] entry.
+             * No timestamp; it can't be a duplicate by time.
              * Check no more!
              */
             break;
         }
 
-        nstime_delta(&delta, current, &fd_hash[i].time);
+        nstime_delta(&delta, current, &fh->time);
 
         if (delta.secs < 0 || delta.nsecs < 0) {
             /*
@@ -648,8 +807,8 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
              * Check no more!
              */
             break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
+        } else {
+            /* Same digest and length within the time window. */
             return TRUE;
         }
     }
@@ -693,6 +852,8 @@ usage(gboolean is_error)
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -v (verbose option) is\n");
     fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "  -H <hash>              hash function used to find duplicates: \"md5\"\n");
+    fprintf(output, "                         (default) or the faster, non-cryptographic \"murmur3\".\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
@@ -740,6 +901,8 @@ usage(gboolean is_error)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file(s) as they're written;\n");
+    fprintf(output, "                         <type> is gzip, zstd or lz4, if supported.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h                     display this help and exit.\n");
@@ -797,6 +960,17 @@ list_capture_types(void) {
     g_free(captypes);
 }
 
+static void
+list_compression_types(void) {
+    GSList *names, *name;
+
+    names = wtap_get_all_compression_type_names_list();
+    fprintf(stderr, "editcap: The available compression types for the \"--compress\" option are:\n");
+    for (name = names; name != NULL; name = g_slist_next(name))
+        fprintf(stderr, "    %s\n", (const char *)name->data);
+    g_slist_free(names);
+}
+
 static void
 list_encap_types(void) {
     int i;
@@ -836,6 +1010,10 @@ main(int argc, char *argv[])
     int           i, j, read_err, write_err;
     gchar        *read_err_info;
     int           opt;
+    static const struct option long_options[] = {
+        {(char *)"compress", required_argument, NULL, LONGOPT_COMPRESS },
+        {0, 0, 0, 0 }
+    };
 
     char         *p;
     guint32       snaplen            = 0; /* No limit               */
@@ -844,6 +1022,7 @@ main(int argc, char *argv[])
     wtap_dumper  *pdh                = NULL;
     unsigned int  count              = 1;
     unsigned int  duplicate_count    = 0;
+    GTimer       *dup_timer          = NULL;
     gint64        data_offset;
     int           err_type;
     guint8       *buf;
@@ -899,8 +1078,18 @@ main(int argc, char *argv[])
 #endif
 
     /* Process the options */
-    while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hi:Lrs:S:t:T:vw:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "A:B:c:C:dD:E:F:hH:i:Lrs:S:t:T:vw:", long_options, NULL)) != -1) {
         switch (opt) {
+        case LONGOPT_COMPRESS:
+            out_compression_type = wtap_name_to_compression_type(optarg);
+            if (out_compression_type == WTAP_UNKNOWN_COMPRESSION) {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid compression type\n",
+                        optarg);
+                list_compression_types();
+                exit(1);
+            }
+            break;
+
         case 'A':
         {
             struct tm starttm;
@@ -1009,6 +1198,18 @@ main(int argc, char *argv[])
             }
             break;
 
+        case 'H':
+            if (strcmp(optarg, "md5") == 0) {
+                dup_hash = DUP_HASH_MD5;
+            } else if (strcmp(optarg, "murmur3") == 0) {
+                dup_hash = DUP_HASH_MURMUR3;
+            } else {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid hash function; use \"md5\" or \"murmur3\"\n",
+                        optarg);
+                exit(1);
+            }
+            break;
+
         case 'E':
             err_prob = strtod(optarg, &p);
             if (p == optarg || err_prob < 0.0 || err_prob > 1.0) {
@@ -1179,11 +1380,8 @@ main(int argc, char *argv[])
                 break;
 
         if (dup_detect || dup_detect_by_time) {
-            for (i = 0; i < dup_window; i++) {
-                memset(&fd_hash[i].digest, 0, 16);
-                fd_hash[i].len = 0;
-                nstime_set_unset(&fd_hash[i].time);
-            }
+            fd_hash_init();
+            dup_timer = g_timer_new();
         }
 
         while (wtap_read(wth, &read_err, &read_err_info, &data_offset)) {
@@ -1209,7 +1407,7 @@ main(int argc, char *argv[])
 
                 pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
                                         snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                        FALSE /* compressed */, shb_hdr, idb_inf, &write_err);
+                                        out_compression_type, shb_hdr, idb_inf, &write_err);
 
                 if (pdh == NULL) {
                     fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1250,7 +1448,7 @@ main(int argc, char *argv[])
 
                         pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
                                                 snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                                FALSE /* compressed */, shb_hdr, idb_inf, &write_err);
+                                                out_compression_type, shb_hdr, idb_inf, &write_err);
 
                         if (pdh == NULL) {
                             fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1279,7 +1477,7 @@ main(int argc, char *argv[])
 
                     pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
                                             snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                            FALSE /* compressed */, shb_hdr, idb_inf, &write_err);
+                                            out_compression_type, shb_hdr, idb_inf, &write_err);
                     if (pdh == NULL) {
                         fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                                 filename, wtap_strerror(write_err));
@@ -1430,8 +1628,8 @@ main(int argc, char *argv[])
                 if (dup_detect) {
                     if (is_duplicate(buf, phdr->caplen)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
-                                    count, phdr->caplen);
+                            fprintf(stderr, "Skipped: %u, Len: %u, %s Hash: ",
+                                    count, phdr->caplen, dup_hash_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -1442,8 +1640,8 @@ main(int argc, char *argv[])
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
-                                    count, phdr->caplen);
+                            fprintf(stderr, "Packet: %u, Len: %u, %s Hash: ",
+                                    count, phdr->caplen, dup_hash_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
                                         (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -1462,8 +1660,8 @@ main(int argc, char *argv[])
 
                         if (is_duplicate_rel_time(buf, phdr->caplen, &current)) {
                             if (verbose) {
-                                fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
-                                        count, phdr->caplen);
+                                fprintf(stderr, "Skipped: %u, Len: %u, %s Hash: ",
+                                        count, phdr->caplen, dup_hash_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -1474,8 +1672,8 @@ main(int argc, char *argv[])
                             continue;
                         } else {
                             if (verbose) {
-                                fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
-                                        count, phdr->caplen);
+                                fprintf(stderr, "Packet: %u, Len: %u, %s Hash: ",
+                                        count, phdr->caplen, dup_hash_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
                                             (unsigned char)fd_hash[cur_dup_entry].digest[i]);
@@ -1602,7 +1800,7 @@ main(int argc, char *argv[])
 
             pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
                                     snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
-                                    FALSE /* compressed */, shb_hdr, idb_inf, &write_err);
+                                    out_compression_type, shb_hdr, idb_inf, &write_err);
             if (pdh == NULL) {
                 fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                         filename, wtap_strerror(write_err));
@@ -1633,6 +1831,15 @@ main(int argc, char *argv[])
                 (long)relative_time_window.secs,
                 (long int)relative_time_window.nsecs);
     }
+    if (dup_timer) {
+        gdouble elapsed = g_timer_elapsed(dup_timer, NULL);
+
+        fprintf(stderr, "Duplicate detection: %u packet%s in %.3f seconds (%.0f packets/s) using %s.\n",
+                count - 1, plurality(count - 1, "", "s"), elapsed,
+                elapsed > 0.0 ? (count - 1) / elapsed : 0.0, dup_hash_name());
+        g_timer_destroy(dup_timer);
+        fd_hash_cleanup();
+    }
 
     return 0;
 }
@@ -38,25 +38,50 @@
 int _debug_conversation_indent = 0;
 #endif
 
+/*
+ * The conversation hash tables use open addressing with linear probing,
+ * rather than GHashTable's separately allocated nodes, so that a lookup
+ * usually touches a single cache line of the table.  Each slot holds
+ * the full hash value of its key, so that probes of slots with other
+ * keys rarely have to look at the key itself, and the chain of
+ * conversations with that key, ordered by setup_frame.  A slot is
+ * empty if its chain is NULL.
+ */
+typedef struct {
+	guint hash;
+	conversation_t *chain;
+} conversation_slot_t;
+
+typedef struct {
+	conversation_slot_t *slots;
+	guint size;		/* number of slots, a power of 2, or 0 */
+	guint count;		/* number of slots in use */
+	GHashFunc hash_func;
+	GEqualFunc equal_func;
+} conversation_table_t;
+
+/* Initial number of slots; the tables are kept at most 3/4 full */
+#define CONVERSATION_TABLE_MIN_SIZE 256
+
 /*
  * Hash table for conversations with no wildcards.
  */
-static GHashTable *conversation_hashtable_exact = NULL;
+static conversation_table_t conversation_hashtable_exact;
 
 /*
  * Hash table for conversations with one wildcard address.
  */
-static GHashTable *conversation_hashtable_no_addr2 = NULL;
+static conversation_table_t conversation_hashtable_no_addr2;
 
 /*
  * Hash table for conversations with one wildcard port.
  */
-static GHashTable *conversation_hashtable_no_port2 = NULL;
+static conversation_table_t conversation_hashtable_no_port2;
 
 /*
  * Hash table for conversations with one wildcard address and port.
  */
-static GHashTable *conversation_hashtable_no_addr2_or_port2 = NULL;
+static conversation_table_t conversation_hashtable_no_addr2_or_port2;
 
 
 #ifdef __NOT_USED__
@@ -77,15 +102,6 @@ static conversation_key *conversation_keys;
 
 static guint32 new_index;
 
-/*
- * Protocol-specific data attached to a conversation_t structure - protocol
- * index and opaque pointer.
- */
-typedef struct _conv_proto_data {
-	int	proto;
-	void	*proto_data;
-} conv_proto_data;
-
 /*
  * Creates a new conversation with known endpoints based on a conversation
  * created with the CONVERSATION_TEMPLATE option while keeping the
@@ -458,19 +474,103 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 }
 
 /*
- * Free the proto_data.  The conversation itself is se_allocated.
+ * Set up an empty conversation hash table; no slots are allocated until
+ * the first conversation is inserted.
  */
 static void
-free_data_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
+conversation_table_init(conversation_table_t *table, GHashFunc hash_func,
+    GEqualFunc equal_func)
 {
-	conversation_t *conv = (conversation_t *)value;
+	table->slots = NULL;
+	table->size = 0;
+	table->count = 0;
+	table->hash_func = hash_func;
+	table->equal_func = equal_func;
+}
+
+static void
+conversation_table_free(conversation_table_t *table)
+{
+	g_free(table->slots);
+	table->slots = NULL;
+	table->size = 0;
+	table->count = 0;
+}
+
+/*
+ * Return the slot holding the chain of conversations for key, or, if
+ * there's no such chain, the empty slot where it would go.  Returns NULL
+ * if the table has no slots at all.
+ */
+static conversation_slot_t *
+conversation_table_find_slot(const conversation_table_t *table,
+    const conversation_key *key, const guint hash)
+{
+	conversation_slot_t *slot;
+	guint mask, i;
+
+	if (table->size == 0)
+		return NULL;
+
+	mask = table->size - 1;
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		slot = &table->slots[i];
+		if (slot->chain == NULL)
+			return slot;
+		if (slot->hash == hash &&
+		    table->equal_func(slot->chain->key_ptr, key))
+			return slot;
+	}
+}
 
-	/* TODO: se_slist? */
-	g_slist_free(conv->data_list);
+/*
+ * Double the number of slots in a table, or allocate the initial ones.
+ */
+static void
+conversation_table_grow(conversation_table_t *table)
+{
+	conversation_slot_t *old_slots = table->slots;
+	guint old_size = table->size;
+	guint mask, i, j;
+
+	table->size = old_size ? old_size * 2 : CONVERSATION_TABLE_MIN_SIZE;
+	table->slots = g_new0(conversation_slot_t, table->size);
+	mask = table->size - 1;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_slots[i].chain == NULL)
+			continue;
+		for (j = old_slots[i].hash & mask; table->slots[j].chain; j = (j + 1) & mask)
+			;
+		table->slots[j] = old_slots[i];
+	}
+	g_free(old_slots);
+}
 
-	/* Not really necessary, but... */
-	conv->data_list = NULL;
+/*
+ * Empty a slot, moving back any of the entries after it that would no
+ * longer be found by probing past it, so that no tombstones are needed.
+ */
+static void
+conversation_table_remove_slot(conversation_table_t *table, conversation_slot_t *slot)
+{
+	guint mask = table->size - 1;
+	guint i, j, home;
 
+	i = (guint)(slot - table->slots);
+	for (j = (i + 1) & mask; table->slots[j].chain; j = (j + 1) & mask) {
+		home = table->slots[j].hash & mask;
+		/*
+		 * The entry can fill the hole at i unless its home slot
+		 * lies cyclically in (i, j].
+		 */
+		if (i < j ? (home <= i || home > j) : (home <= i && home > j)) {
+			table->slots[i] = table->slots[j];
+			i = j;
+		}
+	}
+	table->slots[i].chain = NULL;
+	table->count--;
 }
 
 /*
@@ -479,32 +579,16 @@ free_data_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
 void
 conversation_cleanup(void)
 {
-	/*  Clean up the hash tables, but only after freeing any proto_data
-	 *  that may be hanging off the conversations.
-	 *  The conversation keys are se_ allocated so we don't have to clean them up.
+	/*  Clean up the hash tables.
+	 *  The conversations, their keys and any proto_data arrays that
+	 *  outgrew the conversation are se_ allocated so we don't have to
+	 *  clean them up.
 	 */
 	conversation_keys = NULL;
-	if (conversation_hashtable_exact != NULL) {
-		g_hash_table_foreach(conversation_hashtable_exact, free_data_list, NULL);
-		g_hash_table_destroy(conversation_hashtable_exact);
-	}
-	if (conversation_hashtable_no_addr2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_addr2, free_data_list, NULL);
-		g_hash_table_destroy(conversation_hashtable_no_addr2);
-	}
-	if (conversation_hashtable_no_port2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_port2, free_data_list, NULL);
-		g_hash_table_destroy(conversation_hashtable_no_port2);
-	}
-	if (conversation_hashtable_no_addr2_or_port2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_addr2_or_port2, free_data_list, NULL);
-		g_hash_table_destroy(conversation_hashtable_no_addr2_or_port2);
-	}
-
-	conversation_hashtable_exact = NULL;
-	conversation_hashtable_no_addr2 = NULL;
-	conversation_hashtable_no_port2 = NULL;
-	conversation_hashtable_no_addr2_or_port2 = NULL;
+	conversation_table_free(&conversation_hashtable_exact);
+	conversation_table_free(&conversation_hashtable_no_addr2);
+	conversation_table_free(&conversation_hashtable_no_port2);
+	conversation_table_free(&conversation_hashtable_no_addr2_or_port2);
 }
 
 /*
@@ -522,18 +606,18 @@ conversation_init(void)
 	 * pointed to by conversation data structures that were freed
 	 * above.
 	 */
-	conversation_hashtable_exact =
-	    g_hash_table_new(conversation_hash_exact,
-	      conversation_match_exact);
-	conversation_hashtable_no_addr2 =
-	    g_hash_table_new(conversation_hash_no_addr2,
-	      conversation_match_no_addr2);
-	conversation_hashtable_no_port2 =
-	    g_hash_table_new(conversation_hash_no_port2,
-	      conversation_match_no_port2);
-	conversation_hashtable_no_addr2_or_port2 =
-	    g_hash_table_new(conversation_hash_no_addr2_or_port2,
-	      conversation_match_no_addr2_or_port2);
+	conversation_table_init(&conversation_hashtable_exact,
+	    conversation_hash_exact,
+	    conversation_match_exact);
+	conversation_table_init(&conversation_hashtable_no_addr2,
+	    conversation_hash_no_addr2,
+	    conversation_match_no_addr2);
+	conversation_table_init(&conversation_hashtable_no_port2,
+	    conversation_hash_no_port2,
+	    conversation_match_no_port2);
+	conversation_table_init(&conversation_hashtable_no_addr2_or_port2,
+	    conversation_hash_no_addr2_or_port2,
+	    conversation_match_no_addr2_or_port2);
 
 	/*
 	 * Start the conversation indices over at 0.
@@ -548,17 +632,27 @@ conversation_init(void)
  * Mostly adapted from the old conversation_new().
  */
 static void
-conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
+conversation_insert_into_hashtable(conversation_table_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *chain_tail, *cur, *prev;
+	conversation_slot_t *slot;
+	guint hash;
 
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
+	/* Make sure there's room for a new chain before looking for the slot */
+	if ((hashtable->count + 1) * 4 > hashtable->size * 3)
+		conversation_table_grow(hashtable);
+
+	hash = hashtable->hash_func(conv->key_ptr);
+	slot = conversation_table_find_slot(hashtable, conv->key_ptr, hash);
+	chain_head = slot->chain;
 
 	if (NULL==chain_head) {
 		/* New entry */
 		conv->next = NULL;
 		conv->last = conv;
-		g_hash_table_insert(hashtable, conv->key_ptr, conv);
+		slot->hash = hash;
+		slot->chain = conv;
+		hashtable->count++;
 		DPRINT(("created a new conversation chain"));
 	}
 	else {
@@ -587,7 +681,7 @@ conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
 				conv->next = chain_head;
 				conv->last = chain_tail;
 				chain_head->last = NULL;
-				g_hash_table_insert(hashtable, conv->key_ptr, conv);
+				slot->chain = conv;
 			}
 			else {
 				/* Inserting into the middle of the chain */
@@ -604,17 +698,24 @@ conversation_insert_into_hashtable(GHashTable *hashtable, conversation_t *conv)
  * taking into account ordering and hash chains and all that good stuff.
  */
 static void
-conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
+conversation_remove_from_hashtable(conversation_table_t *hashtable, conversation_t *conv)
 {
 	conversation_t *chain_head, *cur, *prev;
+	conversation_slot_t *slot;
 
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, conv->key_ptr);
+	slot = conversation_table_find_slot(hashtable, conv->key_ptr,
+	    hashtable->hash_func(conv->key_ptr));
+	if (slot == NULL || slot->chain == NULL) {
+		/* XXX: Conversation not found. Wrong hashtable? */
+		return;
+	}
+	chain_head = slot->chain;
 
 	if (conv == chain_head) {
 		/* We are currently the front of the chain */
 		if (NULL == conv->next) {
 			/* We are the only conversation in the chain */
-			g_hash_table_remove(hashtable, conv->key_ptr);
+			conversation_table_remove_slot(hashtable, slot);
 		}
 		else {
 			/* Update the head of the chain */
@@ -626,7 +727,7 @@ conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
 			else
 				chain_head->latest_found = conv->latest_found;
 
-			g_hash_table_insert(hashtable, chain_head->key_ptr, chain_head);
+			slot->chain = chain_head;
 		}
 	}
 	else {
@@ -672,7 +773,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	DISSECTOR_ASSERT(!(options | CONVERSATION_TEMPLATE) || ((options | (NO_ADDR2 | NO_PORT2 | NO_PORT2_FORCE))) &&
 				"A conversation template may not be constructed without wildcard options");
 */
-	GHashTable* hashtable;
+	conversation_table_t *hashtable;
 	conversation_t *conversation=NULL;
 	conversation_key *new_key;
 
@@ -682,15 +783,15 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 
 	if (options & NO_ADDR2) {
 		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
+			hashtable = &conversation_hashtable_no_addr2_or_port2;
 		} else {
-			hashtable = conversation_hashtable_no_addr2;
+			hashtable = &conversation_hashtable_no_addr2;
 		}
 	} else {
 		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
+			hashtable = &conversation_hashtable_no_port2;
 		} else {
-			hashtable = conversation_hashtable_exact;
+			hashtable = &conversation_hashtable_exact;
 		}
 	}
 
@@ -708,7 +809,9 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 
 	conversation->index = new_index;
 	conversation->setup_frame = conversation->last_frame = setup_frame;
-	conversation->data_list = NULL;
+	conversation->proto_data = conversation->inline_proto_data;
+	conversation->num_proto_data = 0;
+	conversation->max_proto_data = CONVERSATION_INLINE_PROTO_DATA;
 
 	/* clear dissector handle */
 	conversation->dissector_handle = NULL;
@@ -746,16 +849,16 @@ conversation_set_port2(conversation_t *conv, const guint32 port)
 
 	DINDENT();
 	if (conv->options & NO_ADDR2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_port2, conv);
 	}
 	conv->options &= ~NO_PORT2;
 	conv->key_ptr->port2  = port;
 	if (conv->options & NO_ADDR2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_addr2, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_no_addr2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_exact, conv);
 	}
 	DENDENT();
 }
@@ -780,16 +883,16 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 
 	DINDENT();
 	if (conv->options & NO_PORT2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_addr2, conv);
 	}
 	conv->options &= ~NO_ADDR2;
 	SE_COPY_ADDRESS(&conv->key_ptr->addr2, addr);
 	if (conv->options & NO_PORT2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_no_port2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_exact, conv);
 	}
 	DENDENT();
 }
@@ -799,12 +902,13 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
  * {addr1, port1, addr2, port2} and set up before frame_num.
  */
 static conversation_t *
-conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
+conversation_lookup_hashtable(conversation_table_t *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
     const port_type ptype, const guint32 port1, const guint32 port2)
 {
 	conversation_t* convo=NULL;
 	conversation_t* match=NULL;
 	conversation_t* chain_head=NULL;
+	conversation_slot_t *slot;
 	conversation_key key;
 
 	/*
@@ -817,7 +921,10 @@ conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, co
 	key.port1 = port1;
 	key.port2 = port2;
 
-	chain_head = (conversation_t *)g_hash_table_lookup(hashtable, &key);
+	slot = conversation_table_find_slot(hashtable, &key,
+	    hashtable->hash_func(&key));
+	if (slot != NULL)
+		chain_head = slot->chain;
 
 	if (chain_head && (chain_head->setup_frame <= frame_num)) {
 		match = chain_head;
@@ -894,14 +1001,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying exact match"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_exact,
+         conversation_lookup_hashtable(&conversation_hashtable_exact,
          frame_num, addr_a, addr_b, ptype,
          port_a, port_b);
       /* Didn't work, try the other direction */
       if (conversation == NULL) {
 	      DPRINT(("trying opposite direction"));
 	      conversation =
-		 conversation_lookup_hashtable(conversation_hashtable_exact,
+		 conversation_lookup_hashtable(&conversation_hashtable_exact,
 		 frame_num, addr_b, addr_a, ptype,
 		 port_b, port_a);
       }
@@ -910,7 +1017,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_exact,
+            conversation_lookup_hashtable(&conversation_hashtable_exact,
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -935,14 +1042,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest address"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+         conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP.
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
             frame_num, addr_b, addr_a, ptype,
             port_a, port_b);
       }
@@ -987,7 +1094,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_ADDR_B)) {
          DPRINT(("trying dest addr:port as source addr:port with wildcarded dest addr"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+            conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1031,14 +1138,14 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
        */
       DPRINT(("trying wildcarded dest port"));
       conversation =
-         conversation_lookup_hashtable(conversation_hashtable_no_port2,
+         conversation_lookup_hashtable(&conversation_hashtable_no_port2,
          frame_num, addr_a, addr_b, ptype, port_a, port_b);
       if ((conversation == NULL) && (addr_a->type == AT_FC)) {
          /* In Fibre channel, OXID & RXID are never swapped as
           * TCP/UDP ports are in TCP/IP
           */
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_hashtable(&conversation_hashtable_no_port2,
             frame_num, addr_b, addr_a, ptype, port_a, port_b);
       }
       if (conversation != NULL) {
@@ -1082,7 +1189,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
       if (!(options & NO_PORT_B)) {
          DPRINT(("trying dest addr:port as source addr:port and wildcarded dest port"));
          conversation =
-            conversation_lookup_hashtable(conversation_hashtable_no_port2,
+            conversation_lookup_hashtable(&conversation_hashtable_no_port2,
             frame_num, addr_b, addr_a, ptype, port_b, port_a);
          if (conversation != NULL) {
             /*
@@ -1121,7 +1228,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
     */
    DPRINT(("trying wildcarding dest addr:port"));
    conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
       frame_num, addr_a, addr_b, ptype, port_a, port_b);
    if (conversation != NULL) {
       /*
@@ -1168,11 +1275,11 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
    DPRINT(("trying dest addr:port as source addr:port and wildcarding dest addr:port"));
    if (addr_a->type == AT_FC)
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
       frame_num, addr_b, addr_a, ptype, port_a, port_b);
    else
       conversation =
-      conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+      conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
       frame_num, addr_b, addr_a, ptype, port_b, port_a);
    if (conversation != NULL) {
       /*
@@ -1208,50 +1315,57 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
    return NULL;
 }
 
-static gint
-p_compare(gconstpointer a, gconstpointer b)
+/*
+ * Find the first item of protocol data for proto attached to a
+ * conversation.  The array is kept sorted by protocol, and is usually
+ * short enough to fit in the conversation itself.
+ */
+static conv_proto_data *
+conversation_find_proto_data(const conversation_t *conv, const int proto)
 {
-	const conv_proto_data *ap = (const conv_proto_data *)a;
-	const conv_proto_data *bp = (const conv_proto_data *)b;
+	guint i;
 
-	if (ap->proto > bp->proto)
-		return 1;
-	else if (ap->proto == bp->proto)
-		return 0;
-	else
-		return -1;
+	for (i = 0; i < conv->num_proto_data && conv->proto_data[i].proto <= proto; i++) {
+		if (conv->proto_data[i].proto == proto)
+			return &conv->proto_data[i];
+	}
+	return NULL;
 }
 
 void
 conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_data)
 {
-	conv_proto_data *p1 = se_new(conv_proto_data);
+	guint i;
 
-	p1->proto = proto;
-	p1->proto_data = proto_data;
+	if (conv->num_proto_data == conv->max_proto_data) {
+		/* Outgrew the array; the old one is freed with the conversation */
+		conv_proto_data *new_data;
 
-	/* Add it to the list of items for this conversation. */
+		conv->max_proto_data *= 2;
+		new_data = (conv_proto_data *)se_alloc(conv->max_proto_data * sizeof(conv_proto_data));
+		memcpy(new_data, conv->proto_data, conv->num_proto_data * sizeof(conv_proto_data));
+		conv->proto_data = new_data;
+	}
 
-	conv->data_list = g_slist_insert_sorted(conv->data_list, (gpointer *)p1,
-	    p_compare);
+	/*
+	 * Add it to the items for this conversation, before any others for
+	 * the same protocol, so that it's the one that's found.
+	 */
+	for (i = conv->num_proto_data; i > 0 && conv->proto_data[i - 1].proto >= proto; i--)
+		conv->proto_data[i] = conv->proto_data[i - 1];
+	conv->proto_data[i].proto = proto;
+	conv->proto_data[i].proto_data = proto_data;
+	conv->num_proto_data++;
 }
 
 void *
 conversation_get_proto_data(const conversation_t *conv, const int proto)
 {
-	conv_proto_data temp, *p1;
-	GSList *item;
-
-	temp.proto = proto;
-	temp.proto_data = NULL;
-
-	item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
-	    p_compare);
+	conv_proto_data *p1;
 
-	if (item != NULL) {
-		p1 = (conv_proto_data *)item->data;
+	p1 = conversation_find_proto_data(conv, proto);
+	if (p1 != NULL)
 		return p1->proto_data;
-	}
 
 	return NULL;
 }
@@ -1259,19 +1373,13 @@ conversation_get_proto_data(const conversation_t *conv, const int proto)
 void
 conversation_delete_proto_data(conversation_t *conv, const int proto)
 {
-	conv_proto_data temp;
-	GSList *item;
-
-	temp.proto = proto;
-	temp.proto_data = NULL;
-
-	item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
-	    p_compare);
+	guint i, j;
 
-	while(item){
-		conv->data_list = g_slist_remove(conv->data_list, item->data);
-		item=item->next;
+	for (i = 0, j = 0; i < conv->num_proto_data; i++) {
+		if (conv->proto_data[i].proto != proto)
+			conv->proto_data[j++] = conv->proto_data[i];
 	}
+	conv->num_proto_data = j;
 }
 
 void
@@ -1359,28 +1467,49 @@ find_or_create_conversation(packet_info *pinfo)
 	return conv;
 }
 
-GHashTable *
-get_conversation_hashtable_exact(void)
+static conversation_table_t *
+conversation_table_by_id(const conversation_table_e table)
 {
-	return conversation_hashtable_exact;
-}
+	switch (table) {
 
-GHashTable *
-get_conversation_hashtable_no_addr2(void)
-{
-	return conversation_hashtable_no_addr2;
+	case CONVERSATION_TABLE_EXACT:
+		return &conversation_hashtable_exact;
+
+	case CONVERSATION_TABLE_NO_ADDR2:
+		return &conversation_hashtable_no_addr2;
+
+	case CONVERSATION_TABLE_NO_PORT2:
+		return &conversation_hashtable_no_port2;
+
+	case CONVERSATION_TABLE_NO_ADDR2_OR_PORT2:
+		return &conversation_hashtable_no_addr2_or_port2;
+	}
+	return NULL;
 }
 
-GHashTable *
-get_conversation_hashtable_no_port2(void)
+guint
+conversation_table_size(const conversation_table_e table)
 {
-	return conversation_hashtable_no_port2;
+	conversation_table_t *hashtable = conversation_table_by_id(table);
+
+	return hashtable ? hashtable->count : 0;
 }
 
-GHashTable *
-get_conversation_hashtable_no_addr2_or_port2(void)
+void
+conversation_table_foreach(const conversation_table_e table, GHFunc func, gpointer user_data)
 {
-	return conversation_hashtable_no_addr2_or_port2;
+	conversation_table_t *hashtable = conversation_table_by_id(table);
+	guint i;
+
+	if (hashtable == NULL)
+		return;
+
+	for (i = 0; i < hashtable->size; i++) {
+		conversation_t *chain_head = hashtable->slots[i].chain;
+
+		if (chain_head != NULL)
+			func(chain_head->key_ptr, chain_head, user_data);
+	}
 }
 
 /*
@@ -69,6 +69,18 @@ typedef struct conversation_key {
 	guint32	port2;
 } conversation_key;
 
+/**
+ * Protocol-specific data attached to a conversation - protocol index and
+ * opaque pointer.
+ */
+typedef struct _conv_proto_data {
+	int	proto;
+	void	*proto_data;
+} conv_proto_data;
+
+/** Number of items of protocol data kept in the conversation itself */
+#define CONVERSATION_INLINE_PROTO_DATA 4
+
 typedef struct conversation {
 	struct conversation *next;	/** pointer to next conversation on hash chain */
 	struct conversation *last;	/** pointer to the last conversation on hash chain */
@@ -78,23 +90,27 @@ typedef struct conversation {
 	guint32 setup_frame;		/** frame number that setup this conversation */
 	/* Assume that setup_frame is also the lowest frame number for now. */
 	guint32 last_frame;		/** highest frame number in this conversation */
-	GSList *data_list;			/** list of data associated with conversation */
+	conv_proto_data *proto_data;	/** data associated with conversation, sorted by protocol */
+	guint	num_proto_data;		/** number of items in proto_data */
+	guint	max_proto_data;		/** number of items proto_data has room for */
 	dissector_handle_t dissector_handle;
 								/** handle for protocol dissector client associated with conversation */
 	guint	options;			/** wildcard flags */
 	conversation_key *key_ptr;	/** pointer to the key for this conversation */
+	conv_proto_data inline_proto_data[CONVERSATION_INLINE_PROTO_DATA];
+								/** proto_data points here until it needs more room */
 } conversation_t;
 
 /**
  * Destroy all existing conversations
  */
-extern void conversation_cleanup(void);
+WS_DLL_PUBLIC void conversation_cleanup(void);
 
 /**
  * Initialize some variables every time a file is loaded or re-loaded.
  * Create a new hash table for the conversations in the new file.
  */
-extern void conversation_init(void);
+WS_DLL_PUBLIC void conversation_init(void);
 
 /*
  * Given two address/port pairs for a packet, create a new conversation
@@ -178,20 +194,26 @@ try_conversation_dissector(const address *addr_a, const address *addr_b, const p
 
 /* These routines are used to set undefined values for a conversation */
 
-extern void conversation_set_port2(conversation_t *conv, const guint32 port);
-extern void conversation_set_addr2(conversation_t *conv, const address *addr);
+WS_DLL_PUBLIC void conversation_set_port2(conversation_t *conv, const guint32 port);
+WS_DLL_PUBLIC void conversation_set_addr2(conversation_t *conv, const address *addr);
 
-WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_exact(void);
-
-WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2(void);
+/** The conversation hash tables, one for each combination of wildcards */
+typedef enum {
+	CONVERSATION_TABLE_EXACT,
+	CONVERSATION_TABLE_NO_ADDR2,
+	CONVERSATION_TABLE_NO_PORT2,
+	CONVERSATION_TABLE_NO_ADDR2_OR_PORT2
+} conversation_table_e;
 
+/** Return the number of distinct keys in a conversation hash table. */
 WS_DLL_PUBLIC
-GHashTable * get_conversation_hashtable_no_port2(void);
+guint conversation_table_size(const conversation_table_e table);
 
+/** Call func for each key in a conversation hash table, with the
+ *  conversation_key and the first conversation_t with that key.
+ */
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2_or_port2(void);
+void conversation_table_foreach(const conversation_table_e table, GHFunc func, gpointer user_data);
 
 
 #ifdef __cplusplus
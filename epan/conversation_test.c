@@ -0,0 +1,358 @@
+/* conversation_test.c
+ * Conversation hash table tests
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <epan/emem.h>
+#include <epan/packet.h>
+#include <epan/conversation.h>
+
+/*
+ * All the conversations are UDP ones with both address 2 and port 2
+ * wildcarded, so that they go into the NO_ADDR2_OR_PORT2 table, keyed
+ * on address 1 and port 1 only; find_conversation() doesn't fill in
+ * the wildcards of a UDP conversation, so looking one up doesn't move
+ * it.  conversation_set_port2() takes one out of that table.
+ */
+#define TEST_OPTIONS	(NO_ADDR2|NO_PORT2)
+#define TEST_TABLE	CONVERSATION_TABLE_NO_ADDR2_OR_PORT2
+
+/* Number of slots the table starts with (CONVERSATION_TABLE_MIN_SIZE) */
+#define TEST_TABLE_SLOTS	256
+
+static const guint8 addr1_data[4] = { 10, 0, 0, 1 };
+static const guint8 other_data[4] = { 192, 0, 2, 99 };
+static address addr1, other;
+
+static void
+reset_conversations(void)
+{
+	conversation_cleanup();
+	conversation_init();
+}
+
+static conversation_t *
+new_test_conversation(guint32 setup_frame, guint32 port1)
+{
+	return conversation_new(setup_frame, &addr1, &other, PT_UDP, port1, 0,
+	    TEST_OPTIONS);
+}
+
+static conversation_t *
+find_test_conversation(guint32 frame_num, guint32 port1)
+{
+	return find_conversation(frame_num, &addr1, &other, PT_UDP, port1, 0,
+	    NO_ADDR_B|NO_PORT_B);
+}
+
+static void
+remove_test_conversation(conversation_t *conv)
+{
+	conversation_set_port2(conv, 1);
+	g_assert(!(conv->options & NO_PORT2));
+}
+
+/*
+ * The slot a key hashes to in a table of TEST_TABLE_SLOTS slots; this
+ * repeats conversation_hash_no_addr2_or_port2(), so that the tests can
+ * pick keys that collide or sit at the end of the table.  If the hash
+ * function changes the tests still pass, they just don't exercise the
+ * wraparound any more.
+ */
+static guint
+home_slot(guint32 port1)
+{
+	address port_addr;
+	guint hash_val = 0;
+
+	SET_ADDRESS(&port_addr, AT_NONE, 4, &port1);
+	hash_val = add_address_to_hash(hash_val, &addr1);
+	hash_val = add_address_to_hash(hash_val, &port_addr);
+	hash_val += ( hash_val << 3 );
+	hash_val ^= ( hash_val >> 11 );
+	hash_val += ( hash_val << 15 );
+
+	return hash_val & (TEST_TABLE_SLOTS - 1);
+}
+
+/* Find count ports, above *port, that hash to slot */
+static void
+ports_for_slot(guint slot, guint32 *port, guint32 *ports, guint count)
+{
+	guint i;
+
+	for (i = 0; i < count; i++) {
+		do {
+			(*port)++;
+			g_assert(*port != 0);
+		} while (home_slot(*port) != slot);
+		ports[i] = *port;
+	}
+}
+
+#define WRAP_CONVS	9
+
+/*
+ * Fill the last two slots and the first few, so that probes wrap
+ * around, then remove entries one at a time, in an order that has
+ * the backward shift move entries across the end of the table and
+ * leave others in place, and check that everything still in the
+ * table can be found after each removal.
+ */
+static void
+conversation_test_wraparound(void)
+{
+	/* Home slots, in insertion order */
+	static const guint homes[WRAP_CONVS] = { 254, 254, 255, 255, 255, 0, 0, 1, 3 };
+	/* Indices into homes[], in removal order */
+	static const guint removals[WRAP_CONVS] = { 1, 3, 5, 0, 8, 6, 2, 7, 4 };
+	conversation_t *convs[WRAP_CONVS];
+	gboolean removed[WRAP_CONVS];
+	guint32 ports[WRAP_CONVS];
+	guint32 port = 0;
+	guint i, j;
+
+	reset_conversations();
+
+	for (i = 0; i < WRAP_CONVS; i++) {
+		ports_for_slot(homes[i], &port, &ports[i], 1);
+		convs[i] = new_test_conversation(i + 1, ports[i]);
+		removed[i] = FALSE;
+	}
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, WRAP_CONVS);
+
+	for (i = 0; i < WRAP_CONVS; i++)
+		g_assert(find_test_conversation(100, ports[i]) == convs[i]);
+
+	for (i = 0; i < WRAP_CONVS; i++) {
+		remove_test_conversation(convs[removals[i]]);
+		removed[removals[i]] = TRUE;
+		g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, WRAP_CONVS - i - 1);
+
+		for (j = 0; j < WRAP_CONVS; j++) {
+			if (removed[j])
+				g_assert(find_test_conversation(100, ports[j]) == NULL);
+			else
+				g_assert(find_test_conversation(100, ports[j]) == convs[j]);
+		}
+	}
+
+	/* The emptied slots can be used again */
+	for (i = 0; i < WRAP_CONVS; i++)
+		convs[i] = new_test_conversation(200, ports[i]);
+	for (i = 0; i < WRAP_CONVS; i++)
+		g_assert(find_test_conversation(300, ports[i]) == convs[i]);
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, WRAP_CONVS);
+}
+
+/*
+ * A whole run of entries with the same home slot, at the end of the
+ * table; removing the first has to pull each of the others back by one
+ * slot, across the end of the table.
+ */
+static void
+conversation_test_collisions(void)
+{
+	conversation_t *convs[6];
+	guint32 ports[6];
+	guint32 port = 0;
+	guint i, j;
+
+	reset_conversations();
+
+	ports_for_slot(TEST_TABLE_SLOTS - 2, &port, ports, 6);
+	for (i = 0; i < 6; i++)
+		convs[i] = new_test_conversation(1, ports[i]);
+
+	for (i = 0; i < 6; i++) {
+		remove_test_conversation(convs[i]);
+		for (j = i + 1; j < 6; j++)
+			g_assert(find_test_conversation(1, ports[j]) == convs[j]);
+	}
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, 0);
+}
+
+static void
+count_conversation(gpointer key _U_, gpointer value, gpointer user_data)
+{
+	const conversation_t *conv = (const conversation_t *)value;
+	guint *count = (guint *)user_data;
+
+	g_assert(conv->options & NO_PORT2);
+	(*count)++;
+}
+
+#define RESIZE_CONVS	2000
+
+/*
+ * Enough keys to double the table several times; everything has to be
+ * found again in its new slot, before and after removing some.
+ */
+static void
+conversation_test_resize(void)
+{
+	conversation_t **convs = g_new(conversation_t *, RESIZE_CONVS);
+	guint32 port;
+	guint count;
+
+	reset_conversations();
+
+	for (port = 0; port < RESIZE_CONVS; port++) {
+		convs[port] = new_test_conversation(1, port);
+		g_assert(find_test_conversation(1, port) == convs[port]);
+		/* Check an earlier one, which may have moved in a resize */
+		g_assert(find_test_conversation(1, port / 2) == convs[port / 2]);
+	}
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, RESIZE_CONVS);
+
+	for (port = 0; port < RESIZE_CONVS; port++)
+		g_assert(find_test_conversation(1, port) == convs[port]);
+
+	for (port = 0; port < RESIZE_CONVS; port += 3)
+		remove_test_conversation(convs[port]);
+
+	count = 0;
+	conversation_table_foreach(TEST_TABLE, count_conversation, &count);
+	g_assert_cmpuint(count, ==, RESIZE_CONVS - (RESIZE_CONVS + 2) / 3);
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, count);
+
+	for (port = 0; port < RESIZE_CONVS; port++) {
+		if (port % 3 == 0)
+			g_assert(find_test_conversation(1, port) == NULL);
+		else
+			g_assert(find_test_conversation(1, port) == convs[port]);
+	}
+
+	g_free(convs);
+}
+
+/*
+ * Several conversations with the same key share a slot, ordered by
+ * setup frame, and the slot stays until the last of them goes.
+ */
+static void
+conversation_test_chain(void)
+{
+	conversation_t *conv10, *conv20, *conv30;
+
+	reset_conversations();
+
+	conv10 = new_test_conversation(10, 5000);
+	conv30 = new_test_conversation(30, 5000);
+	conv20 = new_test_conversation(20, 5000);
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, 1);
+
+	g_assert(find_test_conversation(5, 5000) == NULL);
+	g_assert(find_test_conversation(15, 5000) == conv10);
+	g_assert(find_test_conversation(25, 5000) == conv20);
+	g_assert(find_test_conversation(35, 5000) == conv30);
+
+	/* Remove the head of the chain */
+	remove_test_conversation(conv10);
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, 1);
+	g_assert(find_test_conversation(15, 5000) == NULL);
+	g_assert(find_test_conversation(25, 5000) == conv20);
+
+	/* Remove the tail */
+	remove_test_conversation(conv30);
+	g_assert(find_test_conversation(35, 5000) == conv20);
+
+	remove_test_conversation(conv20);
+	g_assert_cmpuint(conversation_table_size(TEST_TABLE), ==, 0);
+	g_assert(find_test_conversation(35, 5000) == NULL);
+}
+
+/*
+ * Adding protocol data again for the same protocol hides the earlier
+ * data, even once the array has outgrown the conversation; deleting it
+ * takes all of that protocol's data away.
+ */
+static void
+conversation_test_proto_data(void)
+{
+	conversation_t *conv;
+	int a, b, c, d;
+	int proto;
+
+	reset_conversations();
+
+	conv = new_test_conversation(1, 6000);
+
+	conversation_add_proto_data(conv, 7, &a);
+	g_assert(conversation_get_proto_data(conv, 7) == &a);
+	conversation_add_proto_data(conv, 7, &b);
+	g_assert(conversation_get_proto_data(conv, 7) == &b);
+	g_assert(conversation_get_proto_data(conv, 3) == NULL);
+
+	/* Grow the array past what's kept in the conversation */
+	for (proto = 1; proto <= 20; proto++) {
+		if (proto != 7)
+			conversation_add_proto_data(conv, proto, &c);
+	}
+	conversation_add_proto_data(conv, 7, &d);
+	g_assert(conversation_get_proto_data(conv, 7) == &d);
+	g_assert(conversation_get_proto_data(conv, 3) == &c);
+
+	conversation_delete_proto_data(conv, 7);
+	g_assert(conversation_get_proto_data(conv, 7) == NULL);
+	g_assert(conversation_get_proto_data(conv, 3) == &c);
+}
+
+int
+main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/conversation/table/wraparound", conversation_test_wraparound);
+	g_test_add_func("/conversation/table/collisions", conversation_test_collisions);
+	g_test_add_func("/conversation/table/resize", conversation_test_resize);
+	g_test_add_func("/conversation/table/chain", conversation_test_chain);
+	g_test_add_func("/conversation/proto_data", conversation_test_proto_data);
+
+	emem_init();
+	SET_ADDRESS(&addr1, AT_IPv4, 4, addr1_data);
+	SET_ADDRESS(&other, AT_IPv4, 4, other_data);
+	conversation_init();
+
+	ret = g_test_run();
+
+	conversation_cleanup();
+
+	return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
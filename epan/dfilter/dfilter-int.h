@@ -40,6 +40,24 @@ struct epan_dfilter {
 	GPtrArray	*deprecated;
 };
 
+/* Results of the tests shared by the filters of a group */
+#define DFVM_TEST_UNKNOWN	0
+#define DFVM_TEST_FALSE		1
+#define DFVM_TEST_TRUE		2
+
+/* Passed back to user */
+struct epan_dfilter_group {
+	dfilter_t	**dfilters;
+	guint		num_dfilters;
+	int		**insn_tests;	/* per filter and instruction, the shared test, or -1 */
+	int		**reg_fields;	/* per filter and register, the shared field, or -1 */
+	guint		num_fields;
+	GList		**field_values;	/* per shared field, the fvalues in the tree */
+	gboolean	*field_loaded;
+	guint		num_tests;
+	guint8		*test_results;	/* per shared test, DFVM_TEST_xxx */
+};
+
 typedef struct {
 	/* Syntax Tree stuff */
 	stnode_t	*st_root;
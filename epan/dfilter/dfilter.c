@@ -380,6 +380,24 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+dfilter_group_t *
+dfilter_group_new(dfilter_t **dfs, guint num_dfs)
+{
+	return dfvm_group_new(dfs, num_dfs);
+}
+
+void
+dfilter_group_free(dfilter_group_t *group)
+{
+	dfvm_group_free(group);
+}
+
+int
+dfilter_group_apply_edt(dfilter_group_t *group, epan_dissect_t* edt)
+{
+	return dfvm_group_apply(group, edt->tree);
+}
+
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
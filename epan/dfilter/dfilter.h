@@ -27,6 +27,9 @@
 /* Passed back to user */
 typedef struct epan_dfilter dfilter_t;
 
+/* A list of dfilters applied to the same packets, see dfilter_group_new() */
+typedef struct epan_dfilter_group dfilter_group_t;
+
 #include <epan/proto.h>
 
 #ifdef __cplusplus
@@ -86,6 +89,28 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Creates a group of compiled dfilters that are applied to a packet one
+ * after the other until one of them matches, such as the coloring rules.
+ * Each field is read from the tree only once for the whole group, and a
+ * test that appears in several of the filters is only done once.
+ *
+ * NULL entries in dfs never match.  The dfilters are not copied; they
+ * must not be freed before the group. */
+WS_DLL_PUBLIC
+dfilter_group_t *
+dfilter_group_new(dfilter_t **dfs, guint num_dfs);
+
+/* Frees a group; this doesn't free the dfilters in it. */
+WS_DLL_PUBLIC
+void
+dfilter_group_free(dfilter_group_t *group);
+
+/* Apply the dfilters of a group in order, returning the index of the
+ * first one that matches, or -1 if none does. */
+WS_DLL_PUBLIC
+int
+dfilter_group_apply_edt(dfilter_group_t *group, struct epan_dissect *edt);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
@@ -24,6 +24,8 @@
 
 #include <ftypes/ftypes-int.h>
 
+#include <string.h>
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
 {
@@ -85,6 +87,48 @@ dfvm_value_new(dfvm_value_type_t type)
 }
 
 
+static const char *
+field_cmp_name(dfvm_opcode_t op)
+{
+	switch (op) {
+		case FIELD_CMP_UINT:
+			return "FIELD_CMP_UINT";
+		case FIELD_CMP_SINT:
+			return "FIELD_CMP_SINT";
+		case FIELD_CMP_BOOLEAN:
+			return "FIELD_CMP_BOOLEAN";
+		case FIELD_CMP_IPV4:
+			return "FIELD_CMP_IPV4";
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
+static const char *
+relation_name(dfvm_opcode_t relation)
+{
+	switch (relation) {
+		case ANY_EQ:
+			return "==";
+		case ANY_NE:
+			return "!=";
+		case ANY_GT:
+			return ">";
+		case ANY_GE:
+			return ">=";
+		case ANY_LT:
+			return "<";
+		case ANY_LE:
+			return "<=";
+		case ANY_BITWISE_AND:
+			return "&";
+		default:
+			g_assert_not_reached();
+			return NULL;
+	}
+}
+
 void
 dfvm_dump(FILE *f, dfilter_t *df)
 {
@@ -134,6 +178,10 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case RETURN:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_BOOLEAN:
+			case FIELD_CMP_IPV4:
 			default:
 				g_assert_not_reached();
 				break;
@@ -282,6 +330,21 @@ dfvm_dump(FILE *f, dfilter_t *df)
 						id, arg1->value.numeric);
 				break;
 
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_BOOLEAN:
+			case FIELD_CMP_IPV4:
+				value_str = fvalue_to_string_repr(arg3->value.fvalue,
+					FTREPR_DFILTER, NULL);
+				fprintf(f, "%05d %s\t%s %s %s <%s>\n",
+					id, field_cmp_name(insn->op),
+					arg1->value.hfinfo->abbrev,
+					relation_name((dfvm_opcode_t)arg2->value.numeric),
+					value_str ? value_str : "?",
+					fvalue_type_name(arg3->value.fvalue));
+				g_free(value_str);
+				break;
+
 			default:
 				g_assert_not_reached();
 				break;
@@ -289,28 +352,15 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	}
 }
 
-/* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
-static gboolean
-read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
+/* Returns the list of fvalues of a field (and the fields with the same
+ * name) in the proto_tree, or NULL if there aren't any. */
+static GList *
+read_field_values(proto_tree *tree, header_field_info *hfinfo)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
 	int		i, len;
 	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
-
-	/* Already loaded in this run of the dfilter? */
-	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
-	}
-
-	df->attempted_load[reg] = TRUE;
 
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
@@ -318,9 +368,6 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 			hfinfo = hfinfo->same_name_next;
 			continue;
 		}
-		else {
-			found_something = TRUE;
-		}
 
 		len = finfos->len;
 		for (i = 0; i < len; i++) {
@@ -331,12 +378,43 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
+	return fvalues;
+}
+
+/* Reads a field from the proto_tree and loads the fvalues into a register,
+ * if that field has not already been read.  If the filter is part of a
+ * group, the field is read once for the whole group. */
+static gboolean
+read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg,
+		dfilter_group_t *group, const int *reg_fields)
+{
+	int		slot;
+
+	/* Already loaded in this run of the dfilter? */
+	if (df->attempted_load[reg]) {
+		if (df->registers[reg]) {
+			return TRUE;
+		}
+		else {
+			return FALSE;
+		}
 	}
 
-	df->registers[reg] = fvalues;
-	return TRUE;
+	df->attempted_load[reg] = TRUE;
+
+	if (reg_fields && reg_fields[reg] >= 0) {
+		slot = reg_fields[reg];
+		if (!group->field_loaded[slot]) {
+			group->field_values[slot] = read_field_values(tree, hfinfo);
+			group->field_loaded[slot] = TRUE;
+		}
+		df->registers[reg] = group->field_values[slot];
+	}
+	else {
+		df->registers[reg] = read_field_values(tree, hfinfo);
+	}
+
+	return df->registers[reg] != NULL;
 }
 
 
@@ -370,17 +448,135 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 }
 
 
+/* Compares two integer values as done by the cmp functions of the
+ * integer ftypes; all integers are widened to 64 bits. */
+static gboolean
+scalar_test(dfvm_opcode_t relation, gboolean is_signed, guint64 a, guint64 b)
+{
+	switch (relation) {
+		case ANY_EQ:
+			return a == b;
+		case ANY_NE:
+			return a != b;
+		case ANY_GT:
+			return is_signed ? (gint64)a > (gint64)b : a > b;
+		case ANY_GE:
+			return is_signed ? (gint64)a >= (gint64)b : a >= b;
+		case ANY_LT:
+			return is_signed ? (gint64)a < (gint64)b : a < b;
+		case ANY_LE:
+			return is_signed ? (gint64)a <= (gint64)b : a <= b;
+		case ANY_BITWISE_AND:
+			return (a & b) != 0;
+		default:
+			g_assert_not_reached();
+			return FALSE;
+	}
+}
+
+static guint64
+scalar_value(const fvalue_t *fv, gboolean is_signed)
+{
+	switch (fvalue_type_ftenum((fvalue_t *)fv)) {
+		case FT_UINT64:
+		case FT_INT64:
+			return fv->value.integer64;
+		default:
+			return is_signed ? (guint64)(gint64)fv->value.sinteger :
+				(guint64)fv->value.uinteger;
+	}
+}
+
+static gboolean
+ipv4_test(dfvm_opcode_t relation, const ipv4_addr *a, const ipv4_addr *b)
+{
+	switch (relation) {
+		case ANY_EQ:
+			return ipv4_addr_eq(a, b);
+		case ANY_NE:
+			return ipv4_addr_ne(a, b);
+		case ANY_GT:
+			return ipv4_addr_gt(a, b);
+		case ANY_GE:
+			return ipv4_addr_ge(a, b);
+		case ANY_LT:
+			return ipv4_addr_lt(a, b);
+		case ANY_LE:
+			return ipv4_addr_le(a, b);
+		case ANY_BITWISE_AND:
+			return ((a->addr & a->nmask) & (b->addr & b->nmask)) != 0;
+		default:
+			g_assert_not_reached();
+			return FALSE;
+	}
+}
+
+/* Compares every occurrence of a field (and the fields with the same
+ * name) in the proto_tree with a constant, straight from the field_infos,
+ * for the FIELD_CMP_xxx instructions.  Like READ_TREE followed by an
+ * ANY_xxx test, but without building a list of the values. */
+static gboolean
+field_cmp(proto_tree *tree, dfvm_opcode_t op, header_field_info *hfinfo,
+		dfvm_opcode_t relation, const fvalue_t *fv)
+{
+	GPtrArray	*finfos;
+	field_info	*finfo;
+	guint		i;
+	gboolean	is_signed = (op == FIELD_CMP_SINT);
+	guint64		value = 0;
+
+	if (op == FIELD_CMP_UINT || op == FIELD_CMP_SINT)
+		value = scalar_value(fv, is_signed);
+
+	for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
+		if (finfos == NULL)
+			continue;
+
+		for (i = 0; i < finfos->len; i++) {
+			finfo = (field_info *)g_ptr_array_index(finfos, i);
+			switch (op) {
+				case FIELD_CMP_UINT:
+				case FIELD_CMP_SINT:
+					if (scalar_test(relation, is_signed,
+					    scalar_value(&finfo->value, is_signed), value))
+						return TRUE;
+					break;
+				case FIELD_CMP_BOOLEAN:
+					if ((finfo->value.value.uinteger != 0) ==
+					    (fv->value.uinteger != 0)) {
+						if (relation == ANY_EQ)
+							return TRUE;
+					}
+					else if (relation == ANY_NE)
+						return TRUE;
+					break;
+				case FIELD_CMP_IPV4:
+					if (ipv4_test(relation, &finfo->value.value.ipv4,
+					    &fv->value.ipv4))
+						return TRUE;
+					break;
+				default:
+					g_assert_not_reached();
+					break;
+			}
+		}
+	}
+	return FALSE;
+}
+
 /* Free the list nodes w/o freeing the memory that each
- * list node points to. */
+ * list node points to.  Lists shared by a group belong to the group. */
 static void
-free_register_overhead(dfilter_t* df)
+free_register_overhead(dfilter_t* df, const int *reg_fields)
 {
 	guint i;
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
 		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
+			if (!reg_fields || reg_fields[i] < 0)
+				g_list_free(df->registers[i]);
 			df->registers[i] = NULL;
 		}
 	}
@@ -415,8 +611,12 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 
-gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+/* Runs the filter program.  If group is not NULL, the filter is filter
+ * number idx of the group, and shares field values and test results
+ * with the other filters of the group. */
+static gboolean
+dfvm_apply_internal(dfilter_t *df, proto_tree *tree, dfilter_group_t *group,
+		guint idx)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -428,9 +628,17 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	header_field_info	*hfinfo;
 	GList		*param1;
 	GList		*param2;
+	const int	*insn_tests = NULL;
+	const int	*reg_fields = NULL;
+	int		test;
 
 	g_assert(tree);
 
+	if (group) {
+		insn_tests = group->insn_tests[idx];
+		reg_fields = group->reg_fields[idx];
+	}
+
 	length = df->insns->len;
 
 	for (id = 0; id < length; id++) {
@@ -440,6 +648,13 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 		arg1 = insn->arg1;
 		arg2 = insn->arg2;
 
+		/* Has another filter of the group done this test already? */
+		test = insn_tests ? insn_tests[id] : -1;
+		if (test >= 0 && group->test_results[test] != DFVM_TEST_UNKNOWN) {
+			accum = (group->test_results[test] == DFVM_TEST_TRUE);
+			continue;
+		}
+
 		switch (insn->op) {
 			case CHECK_EXISTS:
 				hfinfo = arg1->value.hfinfo;
@@ -457,7 +672,8 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 			case READ_TREE:
 				accum = read_tree(df, tree,
-						arg1->value.hfinfo, arg2->value.numeric);
+						arg1->value.hfinfo, arg2->value.numeric,
+						group, reg_fields);
 				break;
 
 			case CALL_FUNCTION:
@@ -527,12 +743,21 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_BOOLEAN:
+			case FIELD_CMP_IPV4:
+				accum = field_cmp(tree, insn->op, arg1->value.hfinfo,
+						(dfvm_opcode_t)arg2->value.numeric,
+						insn->arg3->value.fvalue);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
 
 			case RETURN:
-				free_register_overhead(df);
+				free_register_overhead(df, reg_fields);
 				return accum;
 
 			case IF_TRUE_GOTO:
@@ -561,12 +786,296 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				g_assert_not_reached();
 				break;
 		}
+
+		if (test >= 0) {
+			group->test_results[test] = accum ? DFVM_TEST_TRUE : DFVM_TEST_FALSE;
+		}
 	}
 
 	g_assert_not_reached();
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_apply_internal(df, tree, NULL, 0);
+}
+
+/* Returns a string that identifies a constant, or NULL if its string
+ * representation doesn't identify it (e.g. floating point values). */
+static gchar *
+dfvm_group_const_key(fvalue_t *fv)
+{
+	ftenum_t	ftype = fvalue_type_ftenum(fv);
+	char		*value_str;
+	gchar		*key;
+
+	switch (ftype) {
+		case FT_BOOLEAN:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_UINT64:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_INT64:
+		case FT_FRAMENUM:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_STRINGZPAD:
+		case FT_UINT_STRING:
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_IPv4:
+		case FT_IPv6:
+		case FT_IPXNET:
+		case FT_PCRE:
+		case FT_GUID:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_EUI64:
+			break;
+		default:
+			return NULL;
+	}
+
+	value_str = fvalue_to_string_repr(fv, FTREPR_DFILTER, NULL);
+	if (!value_str)
+		return NULL;
+
+	/* The address representations leave out the netmask/prefix. */
+	if (ftype == FT_IPv4)
+		key = g_strdup_printf("c%d:%s/%08x", ftype, value_str, fv->value.ipv4.nmask);
+	else if (ftype == FT_IPv6)
+		key = g_strdup_printf("c%d:%s/%u", ftype, value_str, fv->value.ipv6.prefix);
+	else
+		key = g_strdup_printf("c%d:%s", ftype, value_str);
+	g_free(value_str);
+	return key;
+}
+
+/* Describes where the value in a register comes from, so that tests in
+ * different filters can be recognized as being the same test: "f<n>" for
+ * field slot n of the group, "c<type>:<value>" for a constant. */
+static gchar **
+dfvm_group_reg_sources(dfilter_t *df)
+{
+	gchar		**sources;
+	dfvm_insn_t	*insn;
+	guint		id;
+
+	sources = g_new0(gchar *, df->max_registers);
+	for (id = 0; id < df->consts->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, id);
+		if (insn->op != PUT_FVALUE)
+			continue;
+		sources[insn->arg2->value.numeric] =
+			dfvm_group_const_key(insn->arg1->value.fvalue);
+	}
+	return sources;
+}
+
+static int
+dfvm_group_slot(GHashTable *slots, gchar *key, guint *num_slots)
+{
+	gpointer	value;
+
+	if (g_hash_table_lookup_extended(slots, key, NULL, &value)) {
+		g_free(key);
+		return GPOINTER_TO_INT(value);
+	}
+	g_hash_table_insert(slots, key, GINT_TO_POINTER(*num_slots));
+	return (*num_slots)++;
+}
+
+static void
+dfvm_group_analyze(dfilter_group_t *group, guint idx, GHashTable *field_slots,
+		GHashTable *test_slots)
+{
+	dfilter_t	*df = group->dfilters[idx];
+	gchar		**sources;
+	dfvm_insn_t	*insn;
+	guint		id, reg;
+	int		slot;
+	gchar		*key, *const_key;
+
+	group->insn_tests[idx] = g_new(int, df->insns->len);
+	group->reg_fields[idx] = g_new(int, df->max_registers);
+	for (id = 0; id < df->insns->len; id++)
+		group->insn_tests[idx][id] = -1;
+	for (reg = 0; reg < df->max_registers; reg++)
+		group->reg_fields[idx][reg] = -1;
+
+	sources = dfvm_group_reg_sources(df);
+
+	for (id = 0; id < df->insns->len; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+
+		switch (insn->op) {
+			case READ_TREE:
+				slot = GPOINTER_TO_INT(g_hash_table_lookup(field_slots,
+						insn->arg1->value.hfinfo)) - 1;
+				if (slot < 0) {
+					slot = group->num_fields++;
+					g_hash_table_insert(field_slots,
+							insn->arg1->value.hfinfo,
+							GINT_TO_POINTER(slot + 1));
+				}
+				reg = insn->arg2->value.numeric;
+				group->reg_fields[idx][reg] = slot;
+				g_free(sources[reg]);
+				sources[reg] = g_strdup_printf("f%d", slot);
+				break;
+
+			case CALL_FUNCTION:
+			case MK_RANGE:
+				/* A derived value; not shared. */
+				reg = insn->arg2->value.numeric;
+				g_free(sources[reg]);
+				sources[reg] = NULL;
+				break;
+
+			case CHECK_EXISTS:
+				key = g_strdup_printf("%d|%s", insn->op,
+						insn->arg1->value.hfinfo->abbrev);
+				group->insn_tests[idx][id] = dfvm_group_slot(test_slots,
+						key, &group->num_tests);
+				break;
+
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_BOOLEAN:
+			case FIELD_CMP_IPV4:
+				const_key = dfvm_group_const_key(insn->arg3->value.fvalue);
+				if (const_key) {
+					key = g_strdup_printf("%d|%u|f%s|%s", insn->op,
+							insn->arg2->value.numeric,
+							insn->arg1->value.hfinfo->abbrev,
+							const_key);
+					group->insn_tests[idx][id] = dfvm_group_slot(test_slots,
+							key, &group->num_tests);
+					g_free(const_key);
+				}
+				break;
+
+			case ANY_EQ:
+			case ANY_NE:
+			case ANY_GT:
+			case ANY_GE:
+			case ANY_LT:
+			case ANY_LE:
+			case ANY_BITWISE_AND:
+			case ANY_CONTAINS:
+			case ANY_MATCHES:
+				if (sources[insn->arg1->value.numeric] &&
+				    sources[insn->arg2->value.numeric]) {
+					key = g_strdup_printf("%d|%s|%s", insn->op,
+							sources[insn->arg1->value.numeric],
+							sources[insn->arg2->value.numeric]);
+					group->insn_tests[idx][id] = dfvm_group_slot(test_slots,
+							key, &group->num_tests);
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	for (reg = 0; reg < df->max_registers; reg++)
+		g_free(sources[reg]);
+	g_free(sources);
+}
+
+dfilter_group_t *
+dfvm_group_new(dfilter_t **dfs, guint num_dfs)
+{
+	dfilter_group_t	*group;
+	GHashTable	*field_slots, *test_slots;
+	guint		i;
+
+	group = g_new0(dfilter_group_t, 1);
+	group->num_dfilters = num_dfs;
+	group->dfilters = (dfilter_t **)g_memdup(dfs, num_dfs * sizeof(dfilter_t *));
+	group->insn_tests = g_new0(int *, num_dfs);
+	group->reg_fields = g_new0(int *, num_dfs);
+
+	field_slots = g_hash_table_new(g_direct_hash, g_direct_equal);
+	test_slots = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; i < num_dfs; i++) {
+		if (dfs[i])
+			dfvm_group_analyze(group, i, field_slots, test_slots);
+	}
+
+	g_hash_table_destroy(field_slots);
+	g_hash_table_destroy(test_slots);
+
+	group->field_values = g_new0(GList *, group->num_fields);
+	group->field_loaded = g_new0(gboolean, group->num_fields);
+	group->test_results = g_new0(guint8, group->num_tests);
+
+	return group;
+}
+
+/* Forget the field values and test results of the previous packet. */
+static void
+dfvm_group_reset(dfilter_group_t *group)
+{
+	guint i;
+
+	for (i = 0; i < group->num_fields; i++) {
+		if (group->field_loaded[i]) {
+			g_list_free(group->field_values[i]);
+			group->field_values[i] = NULL;
+			group->field_loaded[i] = FALSE;
+		}
+	}
+	memset(group->test_results, DFVM_TEST_UNKNOWN, group->num_tests);
+}
+
+void
+dfvm_group_free(dfilter_group_t *group)
+{
+	guint i;
+
+	dfvm_group_reset(group);
+	for (i = 0; i < group->num_dfilters; i++) {
+		g_free(group->insn_tests[i]);
+		g_free(group->reg_fields[i]);
+	}
+	g_free(group->insn_tests);
+	g_free(group->reg_fields);
+	g_free(group->dfilters);
+	g_free(group->field_values);
+	g_free(group->field_loaded);
+	g_free(group->test_results);
+	g_free(group);
+}
+
+int
+dfvm_group_apply(dfilter_group_t *group, proto_tree *tree)
+{
+	guint	i;
+	int	match = -1;
+
+	for (i = 0; i < group->num_dfilters; i++) {
+		if (group->dfilters[i] &&
+		    dfvm_apply_internal(group->dfilters[i], tree, group, i)) {
+			match = i;
+			break;
+		}
+	}
+
+	dfvm_group_reset(group);
+	return match;
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -605,6 +1114,10 @@ dfvm_init_const(dfilter_t *df)
 			case RETURN:
 			case IF_TRUE_GOTO:
 			case IF_FALSE_GOTO:
+			case FIELD_CMP_UINT:
+			case FIELD_CMP_SINT:
+			case FIELD_CMP_BOOLEAN:
+			case FIELD_CMP_IPV4:
 			default:
 				g_assert_not_reached();
 				break;
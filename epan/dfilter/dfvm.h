@@ -72,7 +72,11 @@ typedef enum {
 	ANY_CONTAINS,
 	ANY_MATCHES,
 	MK_RANGE,
-    CALL_FUNCTION
+    CALL_FUNCTION,
+	FIELD_CMP_UINT,
+	FIELD_CMP_SINT,
+	FIELD_CMP_BOOLEAN,
+	FIELD_CMP_IPV4
 
 } dfvm_opcode_t;
 
@@ -103,4 +107,13 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+dfilter_group_t *
+dfvm_group_new(dfilter_t **dfs, guint num_dfs);
+
+void
+dfvm_group_free(dfilter_group_t *group);
+
+int
+dfvm_group_apply(dfilter_group_t *group, proto_tree *tree);
+
 #endif
@@ -244,6 +244,118 @@ dfw_append_function(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
 }
 
 
+/* Returns the FIELD_CMP_xxx opcode for comparing the field with a constant
+ * of the given type without loading the field into a register, or RETURN
+ * if the field (or one with the same name) isn't of a type it handles. */
+static dfvm_opcode_t
+field_cmp_opcode(header_field_info *hfinfo, ftenum_t const_type)
+{
+	dfvm_opcode_t	op = RETURN, this_op;
+
+	for (; hfinfo; hfinfo = hfinfo->same_name_next) {
+		switch (hfinfo->type) {
+			case FT_UINT8:
+			case FT_UINT16:
+			case FT_UINT24:
+			case FT_UINT32:
+			case FT_UINT64:
+			case FT_FRAMENUM:
+			case FT_IPXNET:
+				this_op = FIELD_CMP_UINT;
+				break;
+			case FT_INT8:
+			case FT_INT16:
+			case FT_INT24:
+			case FT_INT32:
+			case FT_INT64:
+				this_op = FIELD_CMP_SINT;
+				break;
+			case FT_BOOLEAN:
+				this_op = FIELD_CMP_BOOLEAN;
+				break;
+			case FT_IPv4:
+				this_op = FIELD_CMP_IPV4;
+				break;
+			default:
+				return RETURN;
+		}
+		/* 32 and 64 bit values are held in different members of the fvalue */
+		if ((hfinfo->type == FT_UINT64 || hfinfo->type == FT_INT64) !=
+		    (const_type == FT_UINT64 || const_type == FT_INT64))
+			return RETURN;
+		if (op != RETURN && op != this_op)
+			return RETURN;
+		op = this_op;
+	}
+	return op;
+}
+
+/* A relation between a field and a constant of an integer, boolean or IPv4
+ * type is done with one instruction that reads the values straight from
+ * the field_infos in the tree.  Returns FALSE if that's not possible. */
+static gboolean
+gen_field_cmp(dfwork_t *dfw, dfvm_opcode_t relation, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	header_field_info	*hfinfo;
+	fvalue_t		*fv;
+	dfvm_opcode_t		op;
+	dfvm_insn_t		*insn;
+	dfvm_value_t		*val;
+
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD ||
+	    stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return FALSE;
+
+	switch (relation) {
+		case ANY_EQ:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+			break;
+		default:
+			return FALSE;
+	}
+
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	fv = (fvalue_t *)stnode_data(st_arg2);
+
+	/* Rewind to find the first field of this name. */
+	while (hfinfo->same_name_prev_id != -1) {
+		hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+	}
+
+	op = field_cmp_opcode(hfinfo, fvalue_type_ftenum(fv));
+	if (op == RETURN)
+		return FALSE;
+	if (op == FIELD_CMP_BOOLEAN && relation != ANY_EQ && relation != ANY_NE)
+		return FALSE;
+
+	insn = dfvm_insn_new(op);
+	val = dfvm_value_new(HFINFO);
+	val->value.hfinfo = hfinfo;
+	insn->arg1 = val;
+	val = dfvm_value_new(INTEGER);
+	val->value.numeric = relation;
+	insn->arg2 = val;
+	val = dfvm_value_new(FVALUE);
+	val->value.fvalue = fv;
+	insn->arg3 = val;
+	dfw_append_insn(dfw, insn);
+
+	/* Record the FIELD_ID in hash of interesting fields. */
+	while (hfinfo) {
+		g_hash_table_insert(dfw->interesting_fields,
+			GINT_TO_POINTER(hfinfo->id),
+			GUINT_TO_POINTER(TRUE));
+		hfinfo = hfinfo->same_name_next;
+	}
+
+	return TRUE;
+}
+
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
@@ -252,6 +364,9 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
 	int		reg1 = -1, reg2 = -1;
 
+	if (gen_field_cmp(dfw, op, st_arg1, st_arg2))
+		return;
+
     /* Create code for the LHS and RHS of the relation */
     reg1 = gen_entity(dfw, st_arg1, &jmp1);
     reg2 = gen_entity(dfw, st_arg2, &jmp2);
@@ -96,6 +96,7 @@ dissect_file_record(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 	proto_tree  *volatile tree;
 	proto_item  *item;
 	const gchar *cap_plurality, *frame_plurality;
+	const color_filter_t *color_filter;
 
 	tree=parent_tree;
 
@@ -154,7 +155,7 @@ dissect_file_record(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 
 		if(pinfo->fd->pfd != 0){
 			proto_item *ppd_item;
-			guint num_entries = g_slist_length(pinfo->fd->pfd);
+			guint num_entries = p_get_proto_data_count(wmem_file_scope(), pinfo);
 			guint i;
 			ppd_item = proto_tree_add_uint(fh_tree, hf_file_num_p_prot_data, tvb, 0, 0, num_entries);
 			PROTO_ITEM_SET_GENERATED(ppd_item);
@@ -172,8 +173,8 @@ dissect_file_record(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 		}
 #endif
 
-		if(pinfo->fd->color_filter != NULL) {
-			const color_filter_t *color_filter = (const color_filter_t *)pinfo->fd->color_filter;
+		color_filter = (const color_filter_t *)epan_get_color_filter(pinfo->epan, pinfo->fd);
+		if(color_filter != NULL) {
 			item = proto_tree_add_string(fh_tree, hf_file_color_filter_name, tvb,
 						     0, 0, color_filter->filter_name);
 			PROTO_ITEM_SET_GENERATED(item);
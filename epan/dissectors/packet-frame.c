@@ -180,6 +180,8 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 	proto_tree  *comments_tree;
 	proto_item  *item;
 	const gchar *cap_plurality, *frame_plurality;
+	nstime_t     shift_offset;
+	const color_filter_t *color_filter;
 
 	tree=parent_tree;
 
@@ -352,8 +354,9 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 								  " the valid range is 0-1000000000",
 								  (long) pinfo->fd->abs_ts.nsecs);
 			}
+			epan_get_frame_shift_offset(pinfo->epan, pinfo->fd->num, &shift_offset);
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, &shift_offset);
 			PROTO_ITEM_SET_GENERATED(item);
 
 			if(generate_epoch_time) {
@@ -441,7 +444,7 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 
 		if(pinfo->fd->pfd != 0){
 			proto_item *ppd_item;
-			guint num_entries = g_slist_length(pinfo->fd->pfd);
+			guint num_entries = p_get_proto_data_count(wmem_file_scope(), pinfo);
 			guint i;
 			ppd_item = proto_tree_add_uint(fh_tree, hf_frame_num_p_prot_data, tvb, 0, 0, num_entries);
 			PROTO_ITEM_SET_GENERATED(ppd_item);
@@ -468,8 +471,8 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 						    pinfo->fd->file_off, pinfo->fd->file_off);
 		}
 
-		if(pinfo->fd->color_filter != NULL) {
-			const color_filter_t *color_filter = (const color_filter_t *)pinfo->fd->color_filter;
+		color_filter = (const color_filter_t *)epan_get_color_filter(pinfo->epan, pinfo->fd);
+		if(color_filter != NULL) {
 			item = proto_tree_add_string(fh_tree, hf_frame_color_filter_name, tvb,
 						     0, 0, color_filter->filter_name);
 			PROTO_ITEM_SET_GENERATED(item);
@@ -73,6 +73,10 @@ static gint exported_pdu_tap = -1;
 static dissector_handle_t sigcomp_handle;
 static dissector_handle_t sip_diag_handle;
 
+/* Delimiter sets searched for on every SIP line, compiled at registration */
+static ws_mempbrk_pattern pbrk_comma_semi;
+static ws_mempbrk_pattern pbrk_whitespace;
+
 /* Initialize the protocol and registered fields */
 static gint proto_sip                     = -1;
 static gint proto_raw_sip                 = -1;
@@ -1484,7 +1488,7 @@ display_sip_uri (tvbuff_t *tvb, proto_tree *sip_element_tree, uri_offset_info* u
         /* Put the contact parameters in the tree */
 
         while (current_offset < uri_offsets->name_addr_end) {
-            queried_offset = tvb_pbrk_guint8(tvb, current_offset, uri_offsets->name_addr_end - current_offset, ",;", &c);
+            queried_offset = tvb_ws_mempbrk_pattern_guint8(tvb, current_offset, uri_offsets->name_addr_end - current_offset, &pbrk_comma_semi, &c);
 
             if (queried_offset == -1) {
                 /* Reached line end */
@@ -1614,7 +1618,7 @@ dissect_sip_contact_item(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, gi
                 /* We have an opening quote but no closing quote. */
                 current_offset = line_end_offset;
             } else {
-                current_offset = tvb_pbrk_guint8(tvb, queried_offset+1, line_end_offset - queried_offset, ",;", &c);
+                current_offset = tvb_ws_mempbrk_pattern_guint8(tvb, queried_offset+1, line_end_offset - queried_offset, &pbrk_comma_semi, &c);
                 if(current_offset==-1){
                     /* Last parameter, line end */
                     current_offset = line_end_offset;
@@ -3246,7 +3250,7 @@ dissect_sip_common(tvbuff_t *tvb, int offset, int remaining_length, packet_info
                             if (hf_index != POS_AUTHENTICATION_INFO)
                             {
                                 /* The first time comma_offset is "start of parameters" */
-                                comma_offset = tvb_pbrk_guint8(tvb, value_offset, line_end_offset - value_offset, " \t\r\n", NULL);
+                                comma_offset = tvb_ws_mempbrk_pattern_guint8(tvb, value_offset, line_end_offset - value_offset, &pbrk_whitespace, NULL);
                                 proto_tree_add_item(sip_element_tree, hf_sip_auth_scheme,
                                                     tvb, value_offset, comma_offset - value_offset,
                                                     ENC_UTF_8|ENC_NA);
@@ -5637,6 +5641,9 @@ void proto_register_sip(void)
     /* Register raw_sip field(s) */
     proto_register_field_array(proto_raw_sip, raw_hf, array_length(raw_hf));
 
+    ws_mempbrk_compile(&pbrk_comma_semi, ",;");
+    ws_mempbrk_compile(&pbrk_whitespace, " \t\r\n");
+
     sip_module = prefs_register_protocol(proto_sip, proto_reg_handoff_sip);
     range_convert_str(&global_sip_tcp_port_range, DEFAULT_SIP_PORT_RANGE, MAX_UDP_PORT);
 
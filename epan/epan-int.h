@@ -29,8 +29,10 @@ struct epan_session {
 	void *data;
 
 	const nstime_t *(*get_frame_ts)(void *data, guint32 frame_num);
+	void (*get_frame_shift_offset)(void *data, guint32 frame_num, nstime_t *offset);
 	const char *(*get_interface_name)(void *data, guint32 interface_id);
 	const char *(*get_user_comment)(void *data, const frame_data *fd);
+	const void *(*get_color_filter)(void *data, const frame_data *fd);
 };
 
 #endif
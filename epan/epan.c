@@ -106,6 +106,7 @@ epan_init(void (*register_all_protocols_func)(register_cb cb, gpointer client_da
         addr_resolv_init();
 
 	except_init();
+	tvbuff_init();
 #ifdef HAVE_LIBGCRYPT
 	/* initialize libgcrypt (beware, it won't be thread-safe) */
 	gcry_check_version(NULL);
@@ -158,7 +159,7 @@ epan_cleanup(void)
 epan_t *
 epan_new(void)
 {
-	epan_t *session = g_slice_new(epan_t);
+	epan_t *session = g_slice_new0(epan_t);
 
 	/* XXX, it should take session as param */
 	init_dissection();
@@ -184,6 +185,24 @@ epan_get_interface_name(const epan_t *session, guint32 interface_id)
 	return NULL;
 }
 
+void
+epan_get_frame_shift_offset(const epan_t *session, guint32 frame_num, nstime_t *offset)
+{
+	if (session->get_frame_shift_offset)
+		session->get_frame_shift_offset(session->data, frame_num, offset);
+	else
+		nstime_set_zero(offset);
+}
+
+const void *
+epan_get_color_filter(const epan_t *session, const frame_data *fd)
+{
+	if (session->get_color_filter)
+		return session->get_color_filter(session->data, fd);
+
+	return NULL;
+}
+
 const nstime_t *
 epan_get_frame_ts(const epan_t *session, guint32 frame_num)
 {
@@ -285,7 +304,6 @@ epan_dissect_reset(epan_dissect_t *edt)
 
 	g_assert(edt);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
@@ -389,7 +407,6 @@ epan_dissect_cleanup(epan_dissect_t* edt)
 {
 	g_assert(edt);
 
-	g_slist_free(edt->pi.proto_data);
 	g_slist_free(edt->pi.dependent_frames);
 
 	/* Free the data sources list. */
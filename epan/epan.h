@@ -138,6 +138,11 @@ const char *epan_get_interface_name(const epan_t *session, guint32 interface_id)
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, guint32 frame_num);
 
+void epan_get_frame_shift_offset(const epan_t *session, guint32 frame_num, nstime_t *offset);
+
+/** The color filter object the frame was colored with, or NULL */
+const void *epan_get_color_filter(const epan_t *session, const frame_data *fd);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
 WS_DLL_PUBLIC const gchar*
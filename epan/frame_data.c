@@ -23,6 +23,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/epan.h>
@@ -43,71 +45,109 @@ typedef struct _frame_proto_data {
   void *proto_data;
 } frame_proto_data;
 
-/* XXX - I declared this static, because it only seems to be used by
- * p_get_proto_data and p_add_proto_data
- */
-static gint
-p_compare(gconstpointer a, gconstpointer b)
+/* The protocol data for a frame, or a packet, is a single array of
+   items sorted by protocol and key and allocated in the same scope as
+   the data, so there's no separately allocated node for each item and
+   an item is found with a binary search. */
+struct _frame_proto_data_store {
+  guint count;
+  guint size;
+  frame_proto_data items[1];      /* actually "size" of them */
+};
+
+/* Number of items the array has room for when it's first allocated */
+#define PROTO_DATA_STORE_INITIAL_SIZE 4
+
+static frame_proto_data_store **
+p_get_proto_data_store(wmem_allocator_t *scope, struct _packet_info* pinfo)
 {
-  const frame_proto_data *ap = (const frame_proto_data *)a;
-  const frame_proto_data *bp = (const frame_proto_data *)b;
-
-  if (ap -> proto > bp -> proto){
-    return 1;
-  }else if (ap -> proto == bp -> proto){
-    if (ap -> key > bp -> key){
-      return 1;
-    }else if (ap -> key == bp -> key){
-      return 0;
+  if (scope == pinfo->pool) {
+    return &pinfo->proto_data;
+  } else {
+    return &pinfo->fd->pfd;
+  }
+}
+
+/* Returns the index of the first item for proto and key, or of where it
+   would go. */
+static guint
+p_search_proto_data(const frame_proto_data_store *store, int proto, guint32 key)
+{
+  guint lo = 0, hi = store->count, mid;
+  const frame_proto_data *p1;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    p1 = &store->items[mid];
+    if (p1->proto < proto || (p1->proto == proto &&
+        p1->key < key)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
-    return -1;
-  }else{
-    return -1;
   }
+  return lo;
+}
+
+static frame_proto_data *
+p_find_proto_data(const frame_proto_data_store *store, int proto, guint32 key)
+{
+  guint i;
+
+  if (!store)
+    return NULL;
+
+  i = p_search_proto_data(store, proto, key);
+  if (i < store->count && store->items[i].proto == proto && store->items[i].key == key)
+    return (frame_proto_data *)&store->items[i];
+
+  return NULL;
 }
 
 void
 p_add_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data)
 {
-  frame_proto_data *p1;
-  GSList** proto_list;
+  frame_proto_data_store **storep = p_get_proto_data_store(scope, pinfo);
+  frame_proto_data_store  *store = *storep;
+  guint i;
 
-  if (scope == pinfo->pool) {
-    p1 = (frame_proto_data *)wmem_alloc(scope, sizeof(frame_proto_data));
-    proto_list = &pinfo->proto_data;
-  } else {
-    p1 = (frame_proto_data *)wmem_alloc(wmem_file_scope(), sizeof(frame_proto_data));
-    proto_list = &pinfo->fd->pfd;
+  if (scope != pinfo->pool) {
+    scope = wmem_file_scope();
   }
 
-  p1->proto = proto;
-  p1->key = key;
-  p1->proto_data = proto_data;
+  if (!store) {
+    store = (frame_proto_data_store *)wmem_alloc(scope,
+        sizeof(frame_proto_data_store) +
+        (PROTO_DATA_STORE_INITIAL_SIZE - 1) * sizeof(frame_proto_data));
+    store->count = 0;
+    store->size = PROTO_DATA_STORE_INITIAL_SIZE;
+    *storep = store;
+  } else if (store->count == store->size) {
+    store->size *= 2;
+    store = (frame_proto_data_store *)wmem_realloc(scope, store,
+        sizeof(frame_proto_data_store) +
+        (store->size - 1) * sizeof(frame_proto_data));
+    *storep = store;
+  }
 
-  /* Add it to the GSLIST */
-  *proto_list = g_slist_insert_sorted(*proto_list,
-                    (gpointer *)p1,
-                    p_compare);
+  /* Add it before any items with the same protocol and key, so that the
+     most recently added one is found first */
+  i = p_search_proto_data(store, proto, key);
+  memmove(&store->items[i + 1], &store->items[i],
+      (store->count - i) * sizeof(frame_proto_data));
+  store->items[i].proto = proto;
+  store->items[i].key = key;
+  store->items[i].proto_data = proto_data;
+  store->count++;
 }
 
 void *
 p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  frame_proto_data  temp, *p1;
-  GSList           *item;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->proto_data, (gpointer *)&temp, p_compare);
-  } else {
-    item = g_slist_find_custom(pinfo->fd->pfd, (gpointer *)&temp, p_compare);
-  }
+  frame_proto_data *p1;
 
-  if (item) {
-    p1 = (frame_proto_data *)item->data;
+  p1 = p_find_proto_data(*p_get_proto_data_store(scope, pinfo), proto, key);
+  if (p1) {
     return p1->proto_data;
   }
 
@@ -118,37 +158,34 @@ p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void
 p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key)
 {
-  frame_proto_data  temp;
-  GSList           *item;
-  GSList** proto_list;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    item = g_slist_find_custom(pinfo->fd->pfd, (gpointer *)&temp, p_compare);
-    proto_list = &pinfo->proto_data;
-  } else {
-    item = g_slist_find_custom(pinfo->fd->pfd, (gpointer *)&temp, p_compare);
-    proto_list = &pinfo->fd->pfd;
+  frame_proto_data_store *store = *p_get_proto_data_store(scope, pinfo);
+  frame_proto_data       *p1;
+  guint i;
+
+  p1 = p_find_proto_data(store, proto, key);
+  if (p1) {
+    i = (guint)(p1 - store->items);
+    memmove(p1, p1 + 1, (store->count - i - 1) * sizeof(frame_proto_data));
+    store->count--;
   }
 
-  if (item) {
-    *proto_list = g_slist_remove(*proto_list, item->data);
-  }
+}
+
+guint
+p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo)
+{
+  frame_proto_data_store *store = *p_get_proto_data_store(scope, pinfo);
 
+  return store ? store->count : 0;
 }
 
 gchar *
 p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index){
-  frame_proto_data  *temp;
+  frame_proto_data_store *store = *p_get_proto_data_store(scope, pinfo);
+  frame_proto_data       *temp;
 
-  if (scope == pinfo->pool) {
-    temp = (frame_proto_data*)g_slist_nth_data(pinfo->proto_data, pfd_index);
-  } else {
-    temp = (frame_proto_data*)g_slist_nth_data(pinfo->fd->pfd, pfd_index);
-  }
+  DISSECTOR_ASSERT(store && pfd_index < store->count);
+  temp = &store->items[pfd_index];
 
   return ep_strdup_printf("[%s, key %u]",proto_get_protocol_name(temp->proto), temp->key);
 }
@@ -309,11 +346,9 @@ frame_data_init(frame_data *fdata, guint32 num,
   fdata->flags.has_ts = (phdr->presence_flags & WTAP_HAS_TS) ? 1 : 0;
   fdata->flags.has_phdr_comment = (phdr->opt_comment != NULL);
   fdata->flags.has_user_comment = 0;
-  fdata->color_filter = NULL;
+  fdata->color_filter_index = 0;
   fdata->abs_ts.secs = phdr->ts.secs;
   fdata->abs_ts.nsecs = phdr->ts.nsecs;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
   fdata->frame_ref_num = 0;
   fdata->prev_dis_num = 0;
 }
@@ -373,19 +408,15 @@ frame_data_reset(frame_data *fdata)
 {
   fdata->flags.visited = 0;
 
-  if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
-    fdata->pfd = NULL;
-  }
+  /* The proto data is file scoped */
+  fdata->pfd = NULL;
 }
 
 void
 frame_data_destroy(frame_data *fdata)
 {
-  if (fdata->pfd) {
-    g_slist_free(fdata->pfd);
-    fdata->pfd = NULL;
-  }
+  /* The proto data is file scoped */
+  fdata->pfd = NULL;
 }
 
 /*
@@ -53,11 +53,16 @@ typedef enum {
   PACKET_CHAR_ENC_CHAR_EBCDIC    = 1  /* EBCDIC */
 } packet_char_enc;
 
+/** Protocol data attached to a frame or packet with p_add_proto_data() */
+typedef struct _frame_proto_data_store frame_proto_data_store;
+
 /** The frame number is the ordinal number of the frame in the capture, so
    it's 1-origin.  In various contexts, 0 as a frame number means "frame
-   number unknown". */
+   number unknown".
+
+   One of these is kept for every frame, so keep it packed. */
 typedef struct _frame_data {
-  GSList      *pfd;          /**< Per frame proto data */
+  frame_proto_data_store *pfd; /**< Per frame proto data */
   guint32      num;          /**< Frame number */
   guint32      pkt_len;      /**< Packet length */
   guint32      cap_len;      /**< Amount actually captured */
@@ -66,22 +71,21 @@ typedef struct _frame_data {
   guint16      subnum;       /**< subframe number, for protocols that require this */
   gint16       lnk_t;        /**< Per-packet encapsulation/data-link type */
   struct {
-    unsigned int passed_dfilter : 1; /**< 1 = display, 0 = no display */
-    unsigned int dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
-    unsigned int encoding       : 1; /**< Character encoding (ASCII, EBCDIC...) */
-    unsigned int visited        : 1; /**< Has this packet been visited yet? 1=Yes,0=No*/
-    unsigned int marked         : 1; /**< 1 = marked by user, 0 = normal */
-    unsigned int ref_time       : 1; /**< 1 = marked as a reference time frame, 0 = normal */
-    unsigned int ignored        : 1; /**< 1 = ignore this frame, 0 = normal */
-    unsigned int has_ts         : 1; /**< 1 = has time stamp, 0 = no time stamp */
-    unsigned int has_phdr_comment : 1; /** 1 = there's comment for this packet */
-    unsigned int has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
+    guint16 passed_dfilter : 1; /**< 1 = display, 0 = no display */
+    guint16 dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
+    guint16 encoding       : 1; /**< Character encoding (ASCII, EBCDIC...) */
+    guint16 visited        : 1; /**< Has this packet been visited yet? 1=Yes,0=No*/
+    guint16 marked         : 1; /**< 1 = marked by user, 0 = normal */
+    guint16 ref_time       : 1; /**< 1 = marked as a reference time frame, 0 = normal */
+    guint16 ignored        : 1; /**< 1 = ignore this frame, 0 = normal */
+    guint16 has_ts         : 1; /**< 1 = has time stamp, 0 = no time stamp */
+    guint16 has_phdr_comment : 1; /** 1 = there's comment for this packet */
+    guint16 has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
   } flags;
 
-  const void *color_filter;  /**< Per-packet matching color_filter_t object */
+  guint16      color_filter_index; /**< Per-packet matching color_filter_t object, see frame_data_sequence_get_color_filter() */
 
   nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
   guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
   guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
 } frame_data;
@@ -90,6 +94,7 @@ typedef struct _frame_data {
 WS_DLL_PUBLIC void p_add_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key, void *proto_data);
 WS_DLL_PUBLIC void *p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key);
 WS_DLL_PUBLIC void p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, guint32 key);
+WS_DLL_PUBLIC guint p_get_proto_data_count(wmem_allocator_t *scope, struct _packet_info* pinfo);
 gchar *p_get_proto_name_and_key(wmem_allocator_t *scope, struct _packet_info* pinfo, guint pfd_index);
 
 /** compare two frame_datas */
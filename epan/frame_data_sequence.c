@@ -37,6 +37,14 @@
  *
  * As frame numbers are 32 bits, and as 1024 is 2^10, that gives us
  * up to 4 levels of tree.
+ *
+ * Fields that most captures never use are kept out of the frame_data
+ * structure, in side tables that are only allocated when something
+ * sets them; the time shift offsets are such a table.
+ *
+ * The color filter objects that frames were colored with are kept here
+ * too, so that a frame only needs a small index into them; they belong
+ * to the capture, and go away with its frames.
  */
 #define LOG2_NODES_PER_LEVEL	10
 #define NODES_PER_LEVEL		(1<<LOG2_NODES_PER_LEVEL)
@@ -44,6 +52,10 @@
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
   void        *ptree_root;      /* Pointer to the root node */
+  GArray      *shift_offsets;   /* nstime_t per frame, NULL if no frame has been time shifted */
+  GPtrArray   *color_filters;   /* color filter objects by index, [0] is none; NULL if none set */
+  GHashTable  *color_filter_indexes; /* color filter object -> index */
+  gboolean     color_filters_full; /* TRUE once we've run out of indexes */
 };
 
 /*
@@ -67,6 +79,10 @@ new_frame_data_sequence(void)
 	fds = (frame_data_sequence *)g_malloc(sizeof *fds);
 	fds->count = 0;
 	fds->ptree_root = NULL;
+	fds->shift_offsets = NULL;
+	fds->color_filters = NULL;
+	fds->color_filter_indexes = NULL;
+	fds->color_filters_full = FALSE;
 	return fds;
 }
 
@@ -305,10 +321,96 @@ free_frame_data_sequence(frame_data_sequence *fds)
     free_frame_data_array(fds->ptree_root, fds->count, levels, TRUE);
   }
 
+  if (fds->shift_offsets != NULL) {
+    g_array_free(fds->shift_offsets, TRUE);
+  }
+
+  if (fds->color_filters != NULL) {
+    g_ptr_array_free(fds->color_filters, TRUE);
+    g_hash_table_destroy(fds->color_filter_indexes);
+  }
+
   /* free the header struct */
   g_free(fds);
 }
 
+void
+frame_data_sequence_get_shift_offset(frame_data_sequence *fds, guint32 num,
+                                     nstime_t *offset)
+{
+  if (fds->shift_offsets == NULL || num == 0 || num > fds->shift_offsets->len) {
+    nstime_set_zero(offset);
+    return;
+  }
+  *offset = g_array_index(fds->shift_offsets, nstime_t, num - 1);
+}
+
+void
+frame_data_sequence_set_shift_offset(frame_data_sequence *fds, guint32 num,
+                                     const nstime_t *offset)
+{
+  if (num == 0)
+    return;
+
+  if (fds->shift_offsets == NULL || num > fds->shift_offsets->len) {
+    /* Unset entries are zero, so don't grow the table just to store one. */
+    if (offset->secs == 0 && offset->nsecs == 0)
+      return;
+    if (fds->shift_offsets == NULL)
+      fds->shift_offsets = g_array_sized_new(FALSE, TRUE, sizeof(nstime_t), fds->count);
+    g_array_set_size(fds->shift_offsets, MAX(num, fds->count));
+  }
+  g_array_index(fds->shift_offsets, nstime_t, num - 1) = *offset;
+}
+
+void
+frame_data_sequence_set_color_filter(frame_data_sequence *fds,
+                                     frame_data *fdata,
+                                     const void *color_filter)
+{
+  gpointer index;
+
+  if (color_filter == NULL) {
+    fdata->color_filter_index = 0;
+    return;
+  }
+
+  if (fds->color_filters == NULL) {
+    fds->color_filters = g_ptr_array_new();
+    g_ptr_array_add(fds->color_filters, NULL);
+    fds->color_filter_indexes = g_hash_table_new(g_direct_hash, g_direct_equal);
+  }
+
+  index = g_hash_table_lookup(fds->color_filter_indexes, color_filter);
+  if (index == NULL) {
+    if (fds->color_filters->len > G_MAXUINT16) {
+      /* Only reloading the coloring rules thousands of times without
+         closing the file gets here. */
+      if (!fds->color_filters_full) {
+        g_warning("Too many coloring rules have been used for this file; "
+                  "packets colored with new ones are left uncolored.");
+        fds->color_filters_full = TRUE;
+      }
+      fdata->color_filter_index = 0;
+      return;
+    }
+    index = GUINT_TO_POINTER(fds->color_filters->len);
+    g_ptr_array_add(fds->color_filters, (gpointer)color_filter);
+    g_hash_table_insert(fds->color_filter_indexes, (gpointer)color_filter, index);
+  }
+  fdata->color_filter_index = (guint16)GPOINTER_TO_UINT(index);
+}
+
+const void *
+frame_data_sequence_get_color_filter(frame_data_sequence *fds,
+                                     const frame_data *fdata)
+{
+  if (fdata->color_filter_index == 0 || fds->color_filters == NULL ||
+      fdata->color_filter_index >= fds->color_filters->len)
+    return NULL;
+  return g_ptr_array_index(fds->color_filters, fdata->color_filter_index);
+}
+
 void
 find_and_mark_frame_depended_upon(gpointer data, gpointer user_data)
 {
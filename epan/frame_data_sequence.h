@@ -45,6 +45,26 @@ WS_DLL_PUBLIC frame_data *frame_data_sequence_find(frame_data_sequence *fds,
  */
 WS_DLL_PUBLIC void free_frame_data_sequence(frame_data_sequence *fds);
 
+/*
+ * Get or set how much the time stamp of the specified frame has been
+ * shifted.  Frames that have never been shifted have a zero offset.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_get_shift_offset(frame_data_sequence *fds,
+    guint32 num, nstime_t *offset);
+WS_DLL_PUBLIC void frame_data_sequence_set_shift_offset(frame_data_sequence *fds,
+    guint32 num, const nstime_t *offset);
+
+/*
+ * Set or get the color filter object (a color_filter_t) that the
+ * specified frame was colored with, or NULL if it's not colored.  The
+ * frame_data_sequence only keeps pointers to the objects, so the
+ * caller has to keep them alive for as long as the frame_data_sequence.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_set_color_filter(frame_data_sequence *fds,
+    frame_data *fdata, const void *color_filter);
+WS_DLL_PUBLIC const void *frame_data_sequence_get_color_filter(frame_data_sequence *fds,
+    const frame_data *fdata);
+
 WS_DLL_PUBLIC void find_and_mark_frame_depended_upon(gpointer data, gpointer user_data);
 
 
@@ -319,26 +319,44 @@ void
 add_new_data_source(packet_info *pinfo, tvbuff_t *tvb, const char *name)
 {
 	struct data_source *src;
+	GSList *link;
 
-	src = g_slice_new(struct data_source);
+	/*
+	 * The data sources, and the list links, live as long as the
+	 * packet's pool, so that nothing needs to be allocated or freed
+	 * per packet outside it; the list is never handed to the
+	 * g_slist_ routines that allocate or free links.
+	 */
+	src = wmem_new(pinfo->pool, struct data_source);
 	src->tvb = tvb;
-	src->name = g_strdup(name);
+	src->name = wmem_strdup(pinfo->pool, name);
+
+	link = wmem_new(pinfo->pool, GSList);
+	link->data = src;
+	link->next = NULL;
 	/* This could end up slow, but we should never have that many data
 	 * sources so it probably doesn't matter */
-	pinfo->data_src = g_slist_append(pinfo->data_src, src);
+	if (pinfo->data_src == NULL)
+		pinfo->data_src = link;
+	else
+		g_slist_last(pinfo->data_src)->next = link;
 }
 
 void
 remove_last_data_source(packet_info *pinfo)
 {
-	struct data_source *src;
-	GSList *last;
+	GSList *l;
 
-	last = g_slist_last(pinfo->data_src);
-	src = (struct data_source *)last->data;
-	pinfo->data_src = g_slist_delete_link(pinfo->data_src, last);
-	g_free(src->name);
-	g_slice_free(struct data_source, src);
+	if (pinfo->data_src == NULL)
+		return;
+	if (pinfo->data_src->next == NULL) {
+		pinfo->data_src = NULL;
+		return;
+	}
+	/* unlink it; the pool frees it */
+	for (l = pinfo->data_src; l->next->next != NULL; l = l->next)
+		;
+	l->next = NULL;
 }
 
 const char*
@@ -362,18 +380,8 @@ get_data_source_tvb(const struct data_source *src)
 void
 free_data_sources(packet_info *pinfo)
 {
-	if (pinfo->data_src) {
-		GSList *l;
-
-		for (l = pinfo->data_src; l; l = l->next) {
-			struct data_source *src = (struct data_source *)l->data;
-
-			g_free(src->name);
-			g_slice_free(struct data_source, src);
-		}
-		g_slist_free(pinfo->data_src);
-		pinfo->data_src = NULL;
-	}
+	/* Everything's in pinfo->pool, which is freed with the packet */
+	pinfo->data_src = NULL;
 }
 
 void
@@ -53,7 +53,7 @@ typedef struct _packet_info {
   union wtap_pseudo_header *pseudo_header;
   int file_type_subtype;            /**< Capture file type/subtype */
   struct wtap_pkthdr *phdr;         /**< Record metadata */
-  GSList *data_src;                 /**< Frame data sources */
+  GSList *data_src;                 /**< Frame data sources; in pool, so don't g_slist_free() it */
   address dl_src;                   /**< link-layer source address */
   address dl_dst;                   /**< link-layer destination address */
   address net_src;                  /**< network-layer source address */
@@ -170,7 +170,7 @@ typedef struct _packet_info {
 
   int link_dir;                 /**< 3GPP messages are sometime different UP link(UL) or Downlink(DL) */
 
-  GSList* proto_data;          /**< Per packet proto data */
+  frame_proto_data_store *proto_data; /**< Per packet proto data */
 
   GSList* dependent_frames;     /**< A list of frames which this one depends on */
 
@@ -2250,6 +2250,22 @@ prefs_register_modules(void)
                                    "Wrap to beginning/end of file during search?",
                                    &prefs.gui_find_wrap);
 
+    prefs_register_bool_preference(gui_module, "frame_index",
+                                   "Keep a frame index next to capture files",
+                                   "Write an index of the packets next to each capture file that is read "
+                                   "and use it to open the file again without reading every packet. "
+                                   "Packets are then only dissected when they are displayed, so "
+                                   "information that dissectors gather on the first pass may be "
+                                   "incomplete until the whole file has been displayed.",
+                                   &prefs.gui_frame_index);
+
+    prefs_register_bool_preference(gui_module, "seek_index",
+                                   "Keep a seek index next to compressed capture files",
+                                   "Once a compressed capture file has been read all the way through, "
+                                   "write the points found for seeking in it to a file next to it, "
+                                   "so that packets can be reached quickly the next time it is opened.",
+                                   &prefs.gui_seek_index);
+
     prefs_register_bool_preference(gui_module, "use_pref_save",
                                    "Settings dialogs use a save button",
                                    "Settings dialogs use a save button?",
@@ -2956,6 +2972,8 @@ pre_init_prefs(void)
   prefs.gui_fileopen_preview       = 3;
   prefs.gui_ask_unsaved            = TRUE;
   prefs.gui_find_wrap              = TRUE;
+  prefs.gui_frame_index            = FALSE;
+  prefs.gui_seek_index             = FALSE;
   prefs.gui_use_pref_save          = FALSE;
   prefs.gui_update_enabled         = TRUE;
   prefs.gui_update_channel         = UPDATE_CHANNEL_STABLE;
@@ -171,6 +171,8 @@ typedef struct _e_prefs {
   guint        gui_fileopen_preview;
   gboolean     gui_ask_unsaved;
   gboolean     gui_find_wrap;
+  gboolean     gui_frame_index;
+  gboolean     gui_seek_index;
   gboolean     gui_use_pref_save;
   gchar       *gui_webbrowser;
   gchar       *gui_window_title;
@@ -333,6 +333,13 @@ typedef struct _gpa_hfinfo_t {
 
 static gpa_hfinfo_t gpa_hfinfo;
 
+/* A tree root, with its tree_data_t, kept by proto_tree_free() so that
+ * proto_tree_create_root() needn't allocate one; a tree is commonly
+ * created and freed for every packet. */
+static proto_tree *tree_root_cache = NULL;
+
+static void tree_data_free(tree_data_t *tree_data);
+
 /* Hash table of abbreviations and IDs */
 static GHashTable *gpa_name_map = NULL;
 static header_field_info *same_name_hfinfo;
@@ -530,6 +537,12 @@ proto_init(void (register_all_protocols_func)(register_cb cb, gpointer client_da
 void
 proto_cleanup(void)
 {
+	if (tree_root_cache) {
+		tree_data_free(PTREE_DATA(tree_root_cache));
+		g_slice_free(proto_tree, tree_root_cache);
+		tree_root_cache = NULL;
+	}
+
 	/* Free the abbrev/ID GTree */
 	if (gpa_name_map) {
 		g_hash_table_destroy(gpa_name_map);
@@ -656,10 +669,8 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+unreference_hfid(const int hfid)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = (gint)(long)key;
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -675,8 +686,92 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		}
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
+}
+
+/* The slot in tree_data->interesting_fields of a field primed for the tree,
+ * or NULL if it isn't primed */
+static inline interesting_field_t *
+tree_data_interesting_field(const tree_data_t *tree_data, const int hfid)
+{
+	guint32 slot;
+
+	if ((guint)hfid >= tree_data->interesting_index_size)
+		return NULL;
+	slot = tree_data->interesting_index[hfid];
+	return slot ? &tree_data->interesting_fields[slot - 1] : NULL;
+}
+
+static void
+tree_data_prime_hfid(tree_data_t *tree_data, const int hfid)
+{
+	interesting_field_t *field;
+
+	if ((guint)hfid >= tree_data->interesting_index_size) {
+		guint size = ((guint)hfid + 256) & ~255U;
+
+		tree_data->interesting_index = (guint32 *)g_realloc(tree_data->interesting_index,
+			size * sizeof(guint32));
+		memset(tree_data->interesting_index + tree_data->interesting_index_size, 0,
+			(size - tree_data->interesting_index_size) * sizeof(guint32));
+		tree_data->interesting_index_size = size;
+	} else if (tree_data->interesting_index[hfid] != 0)
+		return;
+
+	if (tree_data->num_interesting_fields == tree_data->interesting_fields_size) {
+		guint size = tree_data->interesting_fields_size ? tree_data->interesting_fields_size * 2 : 16;
+
+		tree_data->interesting_fields = g_renew(interesting_field_t,
+			tree_data->interesting_fields, size);
+		memset(tree_data->interesting_fields + tree_data->interesting_fields_size, 0,
+			(size - tree_data->interesting_fields_size) * sizeof(interesting_field_t));
+		tree_data->interesting_fields_size = size;
+	}
+
+	/* Slots left over from an earlier filter keep their (empty) array */
+	field = &tree_data->interesting_fields[tree_data->num_interesting_fields++];
+	field->hfid = hfid;
+	if (field->finfos == NULL)
+		field->finfos = g_ptr_array_sized_new(4);
+	tree_data->interesting_index[hfid] = tree_data->num_interesting_fields;
+}
+
+/* Empty the lists of instances of the interesting fields */
+static void
+tree_data_truncate_interesting(tree_data_t *tree_data)
+{
+	guint i;
+
+	for (i = 0; i < tree_data->num_interesting_fields; i++)
+		g_ptr_array_set_size(tree_data->interesting_fields[i].finfos, 0);
+}
+
+/* No longer reference the fields primed for a tree */
+static void
+tree_data_unprime(tree_data_t *tree_data)
+{
+	guint i;
 
-	g_ptr_array_free(ptrs, TRUE);
+	tree_data_truncate_interesting(tree_data);
+	for (i = 0; i < tree_data->num_interesting_fields; i++) {
+		unreference_hfid(tree_data->interesting_fields[i].hfid);
+		tree_data->interesting_index[tree_data->interesting_fields[i].hfid] = 0;
+	}
+	tree_data->num_interesting_fields = 0;
+}
+
+static void
+tree_data_free(tree_data_t *tree_data)
+{
+	guint i;
+
+	for (i = 0; i < tree_data->interesting_fields_size; i++) {
+		if (tree_data->interesting_fields[i].finfos)
+			g_ptr_array_free(tree_data->interesting_fields[i].finfos, TRUE);
+	}
+	g_free(tree_data->interesting_fields);
+	g_free(tree_data->interesting_index);
+
+	g_slice_free(tree_data_t, tree_data);
 }
 
 static void
@@ -696,17 +791,9 @@ proto_tree_reset(proto_tree *tree)
 
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
-	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
-
-		tree_data->interesting_hfids = NULL;
-	}
+	/* Empty the lists of interesting fields; the lists, and which fields
+	   are primed, are kept for the next packet. */
+	tree_data_truncate_interesting(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
@@ -722,17 +809,16 @@ proto_tree_free(proto_tree *tree)
 
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
-	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
+	tree_data_unprime(tree_data);
 
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+	/* Keep one tree around for the next proto_tree_create_root() */
+	if (tree_root_cache == NULL) {
+		tree_root_cache = tree;
+		return;
 	}
 
-	g_slice_free(tree_data_t, tree_data);
+	/* free tree data */
+	tree_data_free(tree_data);
 
 	g_slice_free(proto_tree, tree);
 }
@@ -1457,23 +1543,10 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		GPtrArray *ptrs = NULL;
-
-		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
-		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
-			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
-		}
+		interesting_field_t *field = tree_data_interesting_field(tree_data, hfinfo->id);
 
-		g_ptr_array_add(ptrs, fi);
+		if (field)
+			g_ptr_array_add(field->finfos, fi);
 	}
 }
 
@@ -4581,19 +4654,30 @@ proto_tree_create_root(packet_info *pinfo)
 {
 	proto_node *pnode;
 
+	if (tree_root_cache != NULL) {
+		/* Reuse the last tree freed; nothing's primed for it */
+		pnode = tree_root_cache;
+		tree_root_cache = NULL;
+	} else {
+		pnode = g_slice_new(proto_tree);
+		pnode->tree_data = g_slice_new(tree_data_t);
+
+		/* Don't initialize the tree_data_t. Wait until we know we need it */
+		pnode->tree_data->interesting_index = NULL;
+		pnode->tree_data->interesting_index_size = 0;
+		pnode->tree_data->interesting_fields = NULL;
+		pnode->tree_data->interesting_fields_size = 0;
+		pnode->tree_data->num_interesting_fields = 0;
+	}
+
 	/* Initialize the proto_node */
-	pnode = g_slice_new(proto_tree);
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = NULL;
 	PNODE_FINFO(pnode) = NULL;
-	pnode->tree_data = g_slice_new(tree_data_t);
 
 	/* Make sure we can access pinfo everywhere */
 	pnode->tree_data->pinfo = pinfo;
 
-	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
-
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
 	 * but for some reason the default 'visible' is not
@@ -4613,11 +4697,18 @@ proto_tree_create_root(packet_info *pinfo)
 /* "prime" a proto_tree with a single hfid that a dfilter
  * is interested in. */
 void
-proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
+proto_tree_prime_hfid(proto_tree *tree, const gint hfid)
 {
 	header_field_info *hfinfo;
+	tree_data_t       *tree_data = tree ? PTREE_DATA(tree) : NULL;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+
+	/* Nothing to do if it's still primed from an earlier packet */
+	if (tree_data != NULL && hfinfo->ref_type == HF_REF_TYPE_DIRECT &&
+	    tree_data_interesting_field(tree_data, hfid) != NULL)
+		return;
+
 	/* this field is referenced by a filter so increase the refcount.
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
@@ -4636,6 +4727,9 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 		if (parent_hfinfo->ref_type != HF_REF_TYPE_DIRECT)
 			parent_hfinfo->ref_type = HF_REF_TYPE_INDIRECT;
 	}
+
+	if (tree_data != NULL)
+		tree_data_prime_hfid(tree_data, hfid);
 }
 
 proto_tree *
@@ -6550,14 +6644,16 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	interesting_field_t *field;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	/* The list is kept, empty, once the field no longer appears */
+	field = tree_data_interesting_field(PTREE_DATA(tree), id);
+	if (field == NULL || field->finfos->len == 0)
 		return NULL;
+	return field->finfos;
 }
 
 gboolean
@@ -6566,7 +6662,7 @@ proto_tracking_interesting_fields(const proto_tree *tree)
 	if (!tree)
 		return FALSE;
 
-	return (PTREE_DATA(tree)->interesting_hfids != NULL);
+	return (PTREE_DATA(tree)->num_interesting_fields != 0);
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -546,10 +546,20 @@ typedef struct
 #define FI_GET_BITS_OFFSET(fi) (FI_GET_FLAG(fi, FI_BITS_OFFSET(7)) >> 5)
 #define FI_GET_BITS_SIZE(fi)   (FI_GET_FLAG(fi, FI_BITS_SIZE(63)) >> 8)
 
+/** A field primed for a protocol tree, and its instances in the packet */
+typedef struct {
+    int          hfid;
+    GPtrArray   *finfos;            /**< this packet's field_infos for hfid */
+} interesting_field_t;
+
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    guint32     *interesting_index;       /**< hf id -> 1 + index into interesting_fields, 0 if not primed */
+    guint        interesting_index_size;  /**< entries in interesting_index */
+    interesting_field_t *interesting_fields; /**< the fields primed for this tree */
+    guint        interesting_fields_size; /**< entries allocated in interesting_fields */
+    guint        num_interesting_fields;  /**< entries used in interesting_fields */
     gboolean     visible;
     gboolean     fake_protocols;
     gint         count;
@@ -784,6 +794,9 @@ WS_DLL_PUBLIC int proto_item_get_len(const proto_item *ti);
  @return the new tree root */
 extern proto_tree* proto_tree_create_root(struct _packet_info *pinfo);
 
+/** Clears a proto_tree for the next packet.  Fields primed with
+ proto_tree_prime_hfid() stay primed.
+ @param tree the tree to reset */
 void proto_tree_reset(proto_tree *tree);
 
 /** Clear memory for entry proto_tree. Clears proto_tree struct also.
@@ -806,10 +819,12 @@ proto_tree_set_visible(proto_tree *tree, gboolean visible);
 extern void
 proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 
-/** Mark a field/protocol ID as "interesting".
- @param tree the tree to be set (currently ignored)
- @param hfid the interesting field id
- @todo what *does* interesting mean? */
+/** Mark a field/protocol ID as "interesting", i.e. referenced by a filter,
+ so that proto_get_finfo_ptr_array() can find its instances in the tree.
+ The field stays primed across proto_tree_reset(), so priming the same
+ field again for the next packet is cheap.
+ @param tree the tree to be set (may be NULL)
+ @param hfid the interesting field id */
 extern void
 proto_tree_prime_hfid(proto_tree *tree, const int hfid);
 
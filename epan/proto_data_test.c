@@ -0,0 +1,214 @@
+/* proto_data_test.c
+ * Tests for the per-frame and per-packet protocol data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/packet_info.h>
+#include <epan/frame_data.h>
+#include <epan/wmem/wmem.h>
+
+static frame_data fd;
+static packet_info pinfo;
+
+static void
+reset_proto_data(void)
+{
+	fd.pfd = NULL;
+	pinfo.proto_data = NULL;
+	wmem_free_all(wmem_file_scope());
+	wmem_free_all(pinfo.pool);
+}
+
+/* Distinct, non-NULL data for each (proto, key) */
+#define TEST_DATA(proto, key)	GUINT_TO_POINTER(((guint)(proto) << 16) + (key) + 1)
+
+#define NUM_ITEMS	12
+
+/* Unsorted on purpose; keys include both ends of the range */
+static const int item_protos[NUM_ITEMS] = { 7, 3, 7, 1, 3, 12, 1, 7, 3, 12, 1, 0 };
+static const guint32 item_keys[NUM_ITEMS] = { 0, 5, G_MAXUINT32, 2, 0, 1, 0, 4, G_MAXUINT32, 0, 1, 0 };
+
+/*
+ * Check that exactly the items flagged in present are there, and that
+ * a key next to each of them isn't.
+ */
+static void
+check_items(wmem_allocator_t *scope, const gboolean *present)
+{
+	guint i, count = 0;
+
+	for (i = 0; i < NUM_ITEMS; i++) {
+		int proto = item_protos[i];
+		guint32 key = item_keys[i];
+
+		if (present[i]) {
+			g_assert(p_get_proto_data(scope, &pinfo, proto, key) == TEST_DATA(proto, key));
+			count++;
+		} else {
+			g_assert(p_get_proto_data(scope, &pinfo, proto, key) == NULL);
+		}
+		g_assert(p_get_proto_data(scope, &pinfo, proto, key == 0 ? 3 : 6) == NULL);
+	}
+	g_assert(p_get_proto_data(scope, &pinfo, 2, 0) == NULL);
+	g_assert(p_get_proto_data(scope, &pinfo, 13, 0) == NULL);
+	g_assert_cmpuint(p_get_proto_data_count(scope, &pinfo), ==, count);
+}
+
+/*
+ * Add all the items in one order, then remove them in another, checking
+ * everything after each step; the items are kept sorted by protocol and
+ * key, so every insertion and removal point is exercised.
+ */
+static void
+run_ordering(wmem_allocator_t *scope, guint add_stride, guint remove_stride)
+{
+	gboolean present[NUM_ITEMS];
+	guint i, n;
+
+	reset_proto_data();
+	memset(present, 0, sizeof present);
+	check_items(scope, present);
+
+	for (i = 0, n = 0; i < NUM_ITEMS; i++, n = (n + add_stride) % NUM_ITEMS) {
+		p_add_proto_data(scope, &pinfo, item_protos[n], item_keys[n],
+		    TEST_DATA(item_protos[n], item_keys[n]));
+		present[n] = TRUE;
+		check_items(scope, present);
+	}
+
+	for (i = 0, n = NUM_ITEMS - 1; i < NUM_ITEMS; i++, n = (n + remove_stride) % NUM_ITEMS) {
+		p_remove_proto_data(scope, &pinfo, item_protos[n], item_keys[n]);
+		present[n] = FALSE;
+		check_items(scope, present);
+	}
+}
+
+static void
+proto_data_test_orderings(void)
+{
+	/* Strides coprime to NUM_ITEMS visit every item once */
+	static const guint strides[] = { 1, 5, 7, 11 };
+	guint a, r;
+
+	for (a = 0; a < G_N_ELEMENTS(strides); a++) {
+		for (r = 0; r < G_N_ELEMENTS(strides); r++) {
+			run_ordering(wmem_file_scope(), strides[a], strides[r]);
+			run_ordering(pinfo.pool, strides[a], strides[r]);
+		}
+	}
+}
+
+/* The item added last for a protocol and key hides the earlier ones */
+static void
+proto_data_test_duplicates(void)
+{
+	int a, b, c;
+
+	reset_proto_data();
+
+	p_add_proto_data(wmem_file_scope(), &pinfo, 5, 1, &a);
+	p_add_proto_data(wmem_file_scope(), &pinfo, 5, 2, &c);
+	p_add_proto_data(wmem_file_scope(), &pinfo, 5, 1, &b);
+	g_assert_cmpuint(p_get_proto_data_count(wmem_file_scope(), &pinfo), ==, 3);
+
+	g_assert(p_get_proto_data(wmem_file_scope(), &pinfo, 5, 1) == &b);
+	p_remove_proto_data(wmem_file_scope(), &pinfo, 5, 1);
+	g_assert(p_get_proto_data(wmem_file_scope(), &pinfo, 5, 1) == &a);
+	p_remove_proto_data(wmem_file_scope(), &pinfo, 5, 1);
+	g_assert(p_get_proto_data(wmem_file_scope(), &pinfo, 5, 1) == NULL);
+
+	/* Removing what isn't there does nothing */
+	p_remove_proto_data(wmem_file_scope(), &pinfo, 5, 1);
+	g_assert(p_get_proto_data(wmem_file_scope(), &pinfo, 5, 2) == &c);
+	g_assert_cmpuint(p_get_proto_data_count(wmem_file_scope(), &pinfo), ==, 1);
+}
+
+/* Frame and packet data are kept apart, and the arrays grow as needed */
+static void
+proto_data_test_scopes(void)
+{
+	guint32 key;
+
+	reset_proto_data();
+
+	for (key = 0; key < 100; key++) {
+		p_add_proto_data(wmem_file_scope(), &pinfo, 1, key, TEST_DATA(1, key));
+		p_add_proto_data(pinfo.pool, &pinfo, 1, key, TEST_DATA(2, key));
+	}
+	g_assert_cmpuint(p_get_proto_data_count(wmem_file_scope(), &pinfo), ==, 100);
+	g_assert_cmpuint(p_get_proto_data_count(pinfo.pool, &pinfo), ==, 100);
+
+	for (key = 0; key < 100; key += 2)
+		p_remove_proto_data(pinfo.pool, &pinfo, 1, key);
+
+	for (key = 0; key < 100; key++) {
+		g_assert(p_get_proto_data(wmem_file_scope(), &pinfo, 1, key) == TEST_DATA(1, key));
+		if (key % 2 == 0)
+			g_assert(p_get_proto_data(pinfo.pool, &pinfo, 1, key) == NULL);
+		else
+			g_assert(p_get_proto_data(pinfo.pool, &pinfo, 1, key) == TEST_DATA(2, key));
+	}
+	g_assert_cmpuint(p_get_proto_data_count(pinfo.pool, &pinfo), ==, 50);
+
+	/* Any scope other than the packet's means the frame's data */
+	g_assert(p_get_proto_data(wmem_packet_scope(), &pinfo, 1, 0) == TEST_DATA(1, 0));
+}
+
+int
+main(int argc, char **argv)
+{
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/proto_data/orderings", proto_data_test_orderings);
+	g_test_add_func("/proto_data/duplicates", proto_data_test_duplicates);
+	g_test_add_func("/proto_data/scopes", proto_data_test_scopes);
+
+	wmem_init();
+	pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+	pinfo.fd = &fd;
+
+	ret = g_test_run();
+
+	wmem_destroy_allocator(pinfo.pool);
+	wmem_cleanup();
+
+	return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
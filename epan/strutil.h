@@ -225,7 +225,8 @@ gchar*     xml_escape(const gchar *unescaped);
 
 /**
  * Return the first occurrence of needle in haystack.
- * Algorithm copied from GNU's glibc 2.3.2 memcmp()
+ * Uses ws_memmem(), which compares several positions at once where the
+ * CPU allows it.
  *
  * @param haystack The data to search
  * @param haystack_len The length of the search data
@@ -62,19 +62,54 @@ typedef struct _tap_packet_t {
 static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
 static guint tap_packet_index;
 
+/*
+ * Listeners with the same filter string share one compiled filter, so
+ * that it's only applied once to each dissected packet no matter how
+ * many of them use it.
+ */
+typedef struct _tap_filter_t {
+	struct _tap_filter_t *next;
+	char *fstring;
+	dfilter_t *code;
+	guint refcount;
+	guint generation;	/* tap_filter_generation when last applied */
+	gboolean passed;	/* result of that */
+} tap_filter_t;
+static tap_filter_t *tap_filter_list=NULL;
+static guint tap_filter_generation;
+
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
+	struct _tap_listener_t *next_for_tap;	/* next one on the same tap */
 	int tap_id;
 	gboolean needs_redraw;
+	gboolean pending;	/* hasn't seen the packets tapped so far */
+	gboolean retapping;	/* being passed them again */
 	guint flags;
-	dfilter_t *code;
+	tap_filter_t *filter;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
 	tap_draw_cb draw;
+	guint32 packet_calls;	/* times packet() was called ... */
+	gdouble packet_time;	/* ... and the seconds spent in it */
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/*
+ * The listeners attached to each tap, indexed by tap id, in the same
+ * order as they appear in tap_listener_queue.
+ */
+static tap_listener_t **tap_listeners_by_id=NULL;
+static int tap_listeners_by_id_size=0;
+
+/* Non-NULL while the time spent in the packet callbacks is being measured */
+static GTimer *tap_timer=NULL;
+
+/* Set while only pending tap listeners are being retapped */
+static gboolean tapping_pending_only=FALSE;
+#define TAP_LISTENER_IS_TAPPING(tl) (!tapping_pending_only || (tl)->retapping)
+
 #ifdef HAVE_PLUGINS
 
 #include <gmodule.h>
@@ -270,8 +305,8 @@ void tap_build_interesting (epan_dissect_t *edt)
 	/* loop over all tap listeners and build the list of all
 	   interesting hf_fields */
 	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
-			epan_dissect_prime_dfilter(edt, tl->code);
+		if(tl->filter && TAP_LISTENER_IS_TAPPING(tl)){
+			epan_dissect_prime_dfilter(edt, tl->filter->code);
 		}
 	}
 }
@@ -317,20 +352,41 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
-	/* loop over all tap listeners and call the listener callback
-	   for all packets that match the filter. */
+	/* A filter gives the same answer for every packet tapped from
+	   this dissection, so each one is applied at most once here. */
+	tap_filter_generation++;
+
+	/* loop over all tapped packets and call the listener callback
+	   of each of the tap's listeners whose filter matches. */
 	for(i=0;i<tap_packet_index;i++){
-		for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
-			if(tp->tap_id==tl->tap_id){
-				gboolean passed=TRUE;
-				if(tl->code){
-					passed=dfilter_apply_edt(tl->code, edt);
+		tp=&tap_packet_array[i];
+		if(tp->tap_id<=0 || tp->tap_id>=tap_listeners_by_id_size){
+			continue;
+		}
+		for(tl=tap_listeners_by_id[tp->tap_id];tl;tl=tl->next_for_tap){
+			if(!TAP_LISTENER_IS_TAPPING(tl) || !tl->packet){
+				continue;
+			}
+			if(tl->filter){
+				tap_filter_t *tf=tl->filter;
+
+				if(tf->generation!=tap_filter_generation){
+					tf->passed=dfilter_apply_edt(tf->code, edt);
+					tf->generation=tap_filter_generation;
 				}
-				if(passed && tl->packet){
-					tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+				if(!tf->passed){
+					continue;
 				}
 			}
+			if(tap_timer){
+				gdouble start=g_timer_elapsed(tap_timer, NULL);
+
+				tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+				tl->packet_time+=g_timer_elapsed(tap_timer, NULL)-start;
+				tl->packet_calls++;
+			} else {
+				tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+			}
 		}
 	}
 }
@@ -392,10 +448,79 @@ reset_tap_listeners(void)
 			tl->reset(tl->tapdata);
 		}
 		tl->needs_redraw=TRUE;
+		tl->pending=FALSE;
+		tl->packet_calls=0;
+		tl->packet_time=0.0;
 	}
 
 }
 
+/* This function marks a tap listener, or all of them if tapdata is NULL,
+   as needing to see all the packets again.
+*/
+void
+set_tap_listener_pending(void *tapdata)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(!tapdata || tl->tapdata==tapdata){
+			tl->pending=TRUE;
+		}
+	}
+}
+
+gboolean
+have_pending_tap_listeners(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->pending)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* This function is called before retapping the packets for only the
+   pending tap listeners; listeners marked pending while that's being done
+   are left for the next retap.
+*/
+void
+reset_pending_tap_listeners(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		tl->retapping=tl->pending;
+		if(tl->retapping){
+			tl->pending=FALSE;
+			if(tl->reset){
+				tl->reset(tl->tapdata);
+			}
+			tl->needs_redraw=TRUE;
+			tl->packet_calls=0;
+			tl->packet_time=0.0;
+		}
+	}
+	tapping_pending_only=TRUE;
+}
+
+void
+finish_pending_tap_listeners(gboolean retapped)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->retapping){
+			if(!retapped)
+				tl->pending=TRUE;
+			tl->retapping=FALSE;
+		}
+	}
+	tapping_pending_only=FALSE;
+}
+
 
 /* This function is called when we need to redraw all tap listeners, for example
    when we open/start a new capture or if we need to rescan the packet list.
@@ -419,6 +544,48 @@ draw_tap_listeners(gboolean draw_all)
 	}
 }
 
+/* This function turns measuring the time spent in each tap listener's
+   packet callback on or off.  The counts are cleared whenever the
+   listener is reset.
+*/
+void
+set_tap_listener_timing(gboolean enable)
+{
+	if(enable && !tap_timer){
+		tap_timer=g_timer_new();
+	} else if(!enable && tap_timer){
+		g_timer_destroy(tap_timer);
+		tap_timer=NULL;
+	}
+}
+
+/* This function calls func for every tap listener, in the order they
+   were registered, with the number of times its packet callback was
+   called and the total time in seconds spent in it.
+*/
+void
+foreach_tap_listener_timing(tap_listener_timing_cb func, void *user_data)
+{
+	tap_listener_t *tl;
+	tap_dissector_t *td;
+	GSList *listeners=NULL, *l;
+	int i;
+
+	/* tap_listener_queue has the most recently registered one first */
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		listeners=g_slist_prepend(listeners, tl);
+	}
+
+	for(l=listeners;l;l=l->next){
+		tl=(tap_listener_t *)l->data;
+		for(i=1,td=tap_dissector_list;td && i<tl->tap_id;i++,td=td->next)
+			;
+		func(td ? td->name : "", tl->filter ? tl->filter->fstring : NULL,
+		    tl->tapdata, tl->packet_calls, tl->packet_time, user_data);
+	}
+	g_slist_free(listeners);
+}
+
 /* Gets a GList of the tap names. The content of the list
    is owned by the tap table and should not be modified or freed.
    Use g_list_free() when done using the list. */
@@ -459,6 +626,70 @@ find_tap_id(const char *name)
 	return 0;
 }
 
+/* Looks up the shared filter for fstring, compiling it if no other
+   listener is using it yet.  *filterp is set to NULL if the filter is
+   empty.  Returns FALSE if fstring can't be compiled.
+*/
+static gboolean
+tap_filter_get(const char *fstring, tap_filter_t **filterp)
+{
+	tap_filter_t *tf;
+	dfilter_t *code=NULL;
+
+	*filterp=NULL;
+	if(!fstring){
+		return TRUE;
+	}
+
+	for(tf=tap_filter_list;tf;tf=tf->next){
+		if(!strcmp(tf->fstring, fstring)){
+			tf->refcount++;
+			*filterp=tf;
+			return TRUE;
+		}
+	}
+
+	if(!dfilter_compile(fstring, &code)){
+		return FALSE;
+	}
+	if(!code){
+		/* empty filter, matches everything */
+		return TRUE;
+	}
+
+	tf=g_new(tap_filter_t, 1);
+	tf->fstring=g_strdup(fstring);
+	tf->code=code;
+	tf->refcount=1;
+	/* not applied yet, even if it's added while taps are being run */
+	tf->generation=tap_filter_generation-1;
+	tf->passed=FALSE;
+	tf->next=tap_filter_list;
+	tap_filter_list=tf;
+	*filterp=tf;
+	return TRUE;
+}
+
+static void
+tap_filter_release(tap_filter_t *filter)
+{
+	tap_filter_t **tfp;
+
+	if(!filter || --filter->refcount){
+		return;
+	}
+
+	for(tfp=&tap_filter_list;*tfp;tfp=&(*tfp)->next){
+		if(*tfp==filter){
+			*tfp=filter->next;
+			break;
+		}
+	}
+	dfilter_free(filter->code);
+	g_free(filter->fstring);
+	g_free(filter);
+}
+
 /* this function attaches the tap_listener to the named tap.
  * function returns :
  *     NULL: ok.
@@ -481,18 +712,17 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 
 	tl=(tap_listener_t *)g_malloc(sizeof(tap_listener_t));
-	tl->code=NULL;
 	tl->needs_redraw=TRUE;
+	tl->pending=TRUE;
+	tl->retapping=FALSE;
 	tl->flags=flags;
-	if(fstring){
-		if(!dfilter_compile(fstring, &tl->code)){
-			error_string = g_string_new("");
-			g_string_printf(error_string,
-			    "Filter \"%s\" is invalid - %s",
-			    fstring, dfilter_error_msg);
-			g_free(tl);
-			return error_string;
-		}
+	if(!tap_filter_get(fstring, &tl->filter)){
+		error_string = g_string_new("");
+		g_string_printf(error_string,
+		    "Filter \"%s\" is invalid - %s",
+		    fstring, dfilter_error_msg);
+		g_free(tl);
+		return error_string;
 	}
 
 	tl->tap_id=tap_id;
@@ -500,10 +730,24 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->reset=reset;
 	tl->packet=packet;
 	tl->draw=draw;
+	tl->packet_calls=0;
+	tl->packet_time=0.0;
 	tl->next=(tap_listener_t *)tap_listener_queue;
 
 	tap_listener_queue=tl;
 
+	if(tap_id>=tap_listeners_by_id_size){
+		int new_size=tap_id+16;
+
+		tap_listeners_by_id=(tap_listener_t **)g_realloc(tap_listeners_by_id,
+		    new_size*sizeof(tap_listener_t *));
+		memset(&tap_listeners_by_id[tap_listeners_by_id_size], 0,
+		    (new_size-tap_listeners_by_id_size)*sizeof(tap_listener_t *));
+		tap_listeners_by_id_size=new_size;
+	}
+	tl->next_for_tap=tap_listeners_by_id[tap_id];
+	tap_listeners_by_id[tap_id]=tl;
+
 	return NULL;
 }
 
@@ -532,19 +776,16 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
-		if(tl->code){
-			dfilter_free(tl->code);
-			tl->code=NULL;
-		}
+		tap_filter_release(tl->filter);
+		tl->filter=NULL;
 		tl->needs_redraw=TRUE;
-		if(fstring){
-			if(!dfilter_compile(fstring, &tl->code)){
-				error_string = g_string_new("");
-				g_string_printf(error_string,
-						 "Filter \"%s\" is invalid - %s",
-						 fstring, dfilter_error_msg);
-				return error_string;
-			}
+		tl->pending=TRUE;
+		if(!tap_filter_get(fstring, &tl->filter)){
+			error_string = g_string_new("");
+			g_string_printf(error_string,
+					 "Filter \"%s\" is invalid - %s",
+					 fstring, dfilter_error_msg);
+			return error_string;
 		}
 	}
 
@@ -577,9 +818,15 @@ remove_tap_listener(void *tapdata)
 	}
 
 	if(tl){
-		if(tl->code){
-			dfilter_free(tl->code);
+		tap_listener_t **tlp;
+
+		for(tlp=&tap_listeners_by_id[tl->tap_id];*tlp;tlp=&(*tlp)->next_for_tap){
+			if(*tlp==tl){
+				*tlp=tl->next_for_tap;
+				break;
+			}
 		}
+		tap_filter_release(tl->filter);
 		g_free(tl);
 	}
 
@@ -610,16 +857,10 @@ tap_listeners_require_dissection(void)
 gboolean
 have_tap_listener(int tap_id)
 {
-	volatile tap_listener_t *tap_queue = tap_listener_queue;
-
-	while(tap_queue) {
-		if(tap_queue->tap_id == tap_id)
-			return TRUE;
-
-		tap_queue = tap_queue->next;
-	}
+	if(tap_id <= 0 || tap_id >= tap_listeners_by_id_size)
+		return FALSE;
 
-	return FALSE;
+	return tap_listeners_by_id[tap_id] != NULL;
 }
 
 /*
@@ -631,7 +872,7 @@ have_filtering_tap_listeners(void)
 	tap_listener_t *tl;
 
 	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-		if(tl->code)
+		if(tl->filter && TAP_LISTENER_IS_TAPPING(tl))
 			return TRUE;
 	}
 	return FALSE;
@@ -649,7 +890,8 @@ union_of_tap_listener_flags(void)
 	guint flags = 0;
 
 	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-		flags|=tl->flags;
+		if(TAP_LISTENER_IS_TAPPING(tl))
+			flags|=tl->flags;
 	}
 	return flags;
 }
@@ -33,6 +33,8 @@ extern "C" {
 typedef void (*tap_reset_cb)(void *tapdata);
 typedef gboolean (*tap_packet_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data);
 typedef void (*tap_draw_cb)(void *tapdata);
+typedef void (*tap_listener_timing_cb)(const char *tapname, const char *fstring,
+    void *tapdata, guint32 packet_calls, gdouble packet_time, void *user_data);
 
 /**
  * Flags to indicate what a tap listener's packet routine requires.
@@ -136,6 +138,42 @@ WS_DLL_PUBLIC void reset_tap_listeners(void);
  */
 WS_DLL_PUBLIC void draw_tap_listeners(gboolean draw_all);
 
+/** Mark a tap listener as pending, i.e. as not having seen the packets
+ * tapped so far, for example because its parameters have changed.
+ * Registering a tap listener, or changing its filter, also does this.
+ * If tapdata is NULL, all tap listeners are marked.
+ */
+WS_DLL_PUBLIC void set_tap_listener_pending(void *tapdata);
+
+/** Return TRUE if we have any pending tap listeners, FALSE otherwise. */
+WS_DLL_PUBLIC gboolean have_pending_tap_listeners(void);
+
+/** Reset only the pending tap listeners, mark them as no longer pending,
+ * and until finish_pending_tap_listeners() is called, pass tapped packets
+ * only to them.  This lets the packets be retapped for listeners that have been
+ * added, or changed, without resetting and refeeding all the others.
+ */
+WS_DLL_PUBLIC void reset_pending_tap_listeners(void);
+
+/** Pass tapped packets to all tap listeners again.  If retapped is FALSE,
+ * the listeners reset by reset_pending_tap_listeners() haven't seen all
+ * the packets and are pending again.  Listeners marked pending after
+ * reset_pending_tap_listeners() stay pending either way.
+ */
+WS_DLL_PUBLIC void finish_pending_tap_listeners(gboolean retapped);
+
+/** Turn measuring the time spent in each tap listener's packet callback
+ * on or off.  A listener's counts are cleared whenever it's reset.
+ */
+WS_DLL_PUBLIC void set_tap_listener_timing(gboolean enable);
+
+/** Call func for every tap listener, in the order they were registered,
+ * with its tap name, its filter string (NULL if it has none), the number
+ * of times its packet callback has been called and the total time in
+ * seconds spent in it while timing was on.
+ */
+WS_DLL_PUBLIC void foreach_tap_listener_timing(tap_listener_timing_cb func, void *user_data);
+
 /** this function attaches the tap_listener to the named tap.
  * function returns :
  *     NULL: ok.
@@ -28,10 +28,13 @@
 
 #include "tvbuff.h"
 #include "exceptions.h"
+#include "strutil.h"
 #include "wsutil/pint.h"
 
 gboolean failed = FALSE;
 
+static ws_mempbrk_pattern pbrk_test_lf;
+
 /* Tests a tvbuff against the expected pattern/length.
  * Returns TRUE if all tests succeeed, FALSE if any test fails */
 gboolean
@@ -278,6 +281,38 @@ test(tvbuff_t *tvb, const gchar* name,
 	}
 	g_free(ptr);
 
+	/* Search for a set of bytes taken from the data, checking
+	 * tvb_ws_mempbrk_pattern_guint8() against a plain scan */
+	if (length >= 2) {
+		ws_mempbrk_pattern pattern;
+		gchar		   needles[3];
+		gint		   expected_offset = -1;
+		gint		   found_offset;
+		guchar		   found_needle = 0;
+
+		needles[0] = expected_data[length - 1] ? expected_data[length - 1] : 1;
+		needles[1] = expected_data[length / 2] ? expected_data[length / 2] : 1;
+		needles[2] = '\0';
+		ws_mempbrk_compile(&pattern, needles);
+
+		for (i = 0; i < length; i++) {
+			if (expected_data[i] == (guint8)needles[0] ||
+			    expected_data[i] == (guint8)needles[1]) {
+				expected_offset = i;
+				break;
+			}
+		}
+
+		found_offset = tvb_ws_mempbrk_pattern_guint8(tvb, 0, -1, &pattern, &found_needle);
+		if (found_offset != expected_offset ||
+		    (found_offset != -1 && found_needle != expected_data[found_offset])) {
+			printf("13: Failed TVB=%s pbrk found offset %d, expected %d\n",
+					name, found_offset, expected_offset);
+			failed = TRUE;
+			return FALSE;
+		}
+	}
+
 
 	printf("Passed TVB=%s\n", name);
 
@@ -494,6 +529,145 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* The vector search paths look at 16 or 32 bytes at a time, so check
+ * every match position, including the last byte and matches straddling
+ * a block boundary, for buffer lengths around those block sizes. */
+#define SEARCH_TEST_MAX_LENGTH 100
+
+static gboolean
+search_test_pbrk(const gchar *name, const gchar *needles, guchar needle)
+{
+	guint8		    data[SEARCH_TEST_MAX_LENGTH];
+	ws_mempbrk_pattern  pattern;
+	const guint8	   *result;
+	guchar		    found_needle;
+	guint		    length, pos;
+
+	ws_mempbrk_compile(&pattern, needles);
+	for (length = 1; length <= SEARCH_TEST_MAX_LENGTH; length++) {
+		memset(data, 'x', length);
+		if (ws_mempbrk_exec(data, length, &pattern, NULL) != NULL) {
+			printf("Failed pbrk %s: false match, length %u\n",
+					name, length);
+			failed = TRUE;
+			return FALSE;
+		}
+		for (pos = 0; pos < length; pos++) {
+			memset(data, 'x', length);
+			data[pos] = needle;
+			found_needle = 0;
+			result = ws_mempbrk_exec(data, length, &pattern, &found_needle);
+			if (result != &data[pos] || found_needle != needle) {
+				printf("Failed pbrk %s: length %u, match at %u, found %d\n",
+						name, length, pos,
+						result ? (int)(result - data) : -1);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+static gboolean
+search_test_memmem(const gchar *name, const gchar *needle)
+{
+	guint8		    data[SEARCH_TEST_MAX_LENGTH];
+	const guint8	   *result;
+	size_t		    needle_len = strlen(needle);
+	guint		    length, pos;
+
+	for (length = 1; length <= SEARCH_TEST_MAX_LENGTH; length++) {
+		memset(data, 'x', length);
+		if (ws_memmem(data, length, (const guint8 *)needle, needle_len) != NULL) {
+			printf("Failed memmem %s: false match, length %u\n",
+					name, length);
+			failed = TRUE;
+			return FALSE;
+		}
+		for (pos = 0; pos < length; pos++) {
+			memset(data, 'x', length);
+			if (pos + needle_len <= length) {
+				/* A whole needle, perhaps ending at the last byte */
+				memcpy(&data[pos], needle, needle_len);
+				result = ws_memmem(data, length, (const guint8 *)needle, needle_len);
+				if (result != &data[pos]) {
+					printf("Failed memmem %s: length %u, match at %u, found %d\n",
+							name, length, pos,
+							result ? (int)(result - data) : -1);
+					failed = TRUE;
+					return FALSE;
+				}
+			} else {
+				/* The start of a needle cut off by the end of the data */
+				memcpy(&data[pos], needle, length - pos);
+				result = ws_memmem(data, length, (const guint8 *)needle, needle_len);
+				if (result != NULL) {
+					printf("Failed memmem %s: length %u, partial needle at %u matched\n",
+							name, length, pos);
+					failed = TRUE;
+					return FALSE;
+				}
+			}
+		}
+	}
+	return TRUE;
+}
+
+static void
+run_search_tests(void)
+{
+	static const guint8 line[] = "abc\r\ndef\"g\r\nh\"\n";
+	tvbuff_t   *tvb;
+	gint	    next_offset;
+	gint	    linelen;
+
+	printf("Testing searches\n");
+
+	/* memchr() path, vector path and lookup table path */
+	if (!search_test_pbrk("single needle", "\n", '\n') ||
+	    !search_test_pbrk("three needles", "\r\n\"", '"') ||
+	    !search_test_pbrk("many needles", "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 'Q'))
+		return;
+
+	if (!search_test_memmem("one byte", "e") ||
+	    !search_test_memmem("two bytes", "en") ||
+	    !search_test_memmem("repeated byte", "xxy") ||
+	    !search_test_memmem("long needle", "0123456789abcdefghijklmnopqrstuvwxyz"))
+		return;
+
+	/* No match */
+	if (epan_memmem(line, (guint)sizeof line - 1, (const guint8 *)"zz", 2) != NULL) {
+		printf("Failed epan_memmem: false match\n");
+		failed = TRUE;
+		return;
+	}
+
+	/* Line ends, quoted and not, the last at the end of the data */
+	tvb = tvb_new_real_data(line, (guint)sizeof line - 1, (gint)sizeof line - 1);
+	linelen = tvb_find_line_end(tvb, 0, -1, &next_offset, FALSE);
+	if (linelen != 3 || next_offset != 5) {
+		printf("Failed tvb_find_line_end: length %d, next offset %d\n",
+				linelen, next_offset);
+		failed = TRUE;
+	}
+	linelen = tvb_find_line_end_unquoted(tvb, 5, -1, &next_offset);
+	if (linelen != 9 || next_offset != 15) {
+		printf("Failed tvb_find_line_end_unquoted: length %d, next offset %d\n",
+				linelen, next_offset);
+		failed = TRUE;
+	}
+	if (tvb_ws_mempbrk_pattern_guint8(tvb, 12, -1, &pbrk_test_lf, NULL) != 14 ||
+	    tvb_ws_mempbrk_pattern_guint8(tvb, 0, 3, &pbrk_test_lf, NULL) != -1) {
+		printf("Failed tvb_ws_mempbrk_pattern_guint8 at end of data\n");
+		failed = TRUE;
+	}
+	tvb_free(tvb);
+
+	if (!failed)
+		printf("Passed searches\n");
+}
+
 /* Note: valgrind can be used to check for tvbuff memory leaks */
 int
 main(void)
@@ -503,7 +677,10 @@ main(void)
 	g_setenv("G_SLICE", "always-malloc", 1);
 
 	except_init();
+	tvbuff_init();
+	ws_mempbrk_compile(&pbrk_test_lf, "\n");
 	run_tests();
+	run_search_tests();
 	except_deinit();
 	exit(failed?1:0);
 }
@@ -64,6 +64,10 @@
 #endif
  /*#endif*/
 
+/* Needle sets for the line-end searches, compiled in tvbuff_init() */
+static ws_mempbrk_pattern pbrk_crlf;
+static ws_mempbrk_pattern pbrk_crlf_dquote;
+
 static guint64
 _tvb_get_bits64(tvbuff_t *tvb, guint bit_offset, const gint total_no_of_bits);
 
@@ -739,30 +743,13 @@ fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length)
 	return NULL;
 }
 
-static inline const guint8*
-guint8_pbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles, guchar *found_needle)
+void
+tvbuff_init(void)
 {
-	gchar         tmp[256] = { 0 };
-	const guint8 *haystack_end;
-
-	while (*needles)
-		tmp[*needles++] = 1;
-
-	haystack_end = haystack + haystacklen;
-	while (haystack < haystack_end) {
-		if (tmp[*haystack]) {
-			if (found_needle)
-				*found_needle = *haystack;
-			return haystack;
-		}
-		haystack++;
-	}
-
-	return NULL;
+	ws_mempbrk_compile(&pbrk_crlf, "\r\n");
+	ws_mempbrk_compile(&pbrk_crlf_dquote, "\r\n\"");
 }
 
-
-
 /************** ACCESSORS **************/
 
 void *
@@ -1800,14 +1787,14 @@ tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 }
 
 static inline gint
-tvb_pbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+tvb_ws_mempbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
 {
 	const guint8 *ptr;
 	const guint8 *result;
 
 	ptr = ensure_contiguous(tvb, abs_offset, limit); /* tvb_get_ptr */
 
-	result = guint8_pbrk(ptr, limit, needles, found_needle);
+	result = ws_mempbrk_exec(ptr, limit, pattern, found_needle);
 	if (!result)
 		return -1;
 
@@ -1822,7 +1809,7 @@ tvb_pbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const guin
  * in that case, -1 will be returned if the boundary is reached before
  * finding needle. */
 gint
-tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const guint8 *needles, guchar *found_needle)
+tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const ws_mempbrk_pattern* pattern, guchar *found_needle)
 {
 	const guint8 *result;
 	guint	      abs_offset;
@@ -1851,7 +1838,7 @@ tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 
 	/* If we have real data, perform our search now. */
 	if (tvb->real_data) {
-		result = guint8_pbrk(tvb->real_data + abs_offset, limit, needles, found_needle);
+		result = ws_mempbrk_exec(tvb->real_data + abs_offset, limit, pattern, found_needle);
 		if (result == NULL) {
 			return -1;
 		}
@@ -1860,10 +1847,22 @@ tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 		}
 	}
 
-	if (tvb->ops->tvb_pbrk_guint8)
-		return tvb->ops->tvb_pbrk_guint8(tvb, abs_offset, limit, needles, found_needle);
+	if (tvb->ops->tvb_ws_mempbrk_pattern_guint8)
+		return tvb->ops->tvb_ws_mempbrk_pattern_guint8(tvb, abs_offset, limit, pattern, found_needle);
+
+	return tvb_ws_mempbrk_guint8_generic(tvb, abs_offset, limit, pattern, found_needle);
+}
+
+/* As tvb_ws_mempbrk_pattern_guint8(), but compiles the needles on every
+ * call; callers that search for the same needles repeatedly should
+ * compile a pattern once instead. */
+gint
+tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const guint8 *needles, guchar *found_needle)
+{
+	ws_mempbrk_pattern pattern;
 
-	return tvb_pbrk_guint8_generic(tvb, abs_offset, limit, needles, found_needle);
+	ws_mempbrk_compile(&pattern, (const gchar *)needles);
+	return tvb_ws_mempbrk_pattern_guint8(tvb, offset, maxlength, &pattern, found_needle);
 }
 
 /* Find size of stringz (NUL-terminated string) by looking for terminating
@@ -2989,7 +2988,7 @@ tvb_find_line_end(tvbuff_t *tvb, const gint offset, int len, gint *next_offset,
 	/*
 	 * Look either for a CR or an LF.
 	 */
-	eol_offset = tvb_pbrk_guint8(tvb, offset, len, "\r\n", &found_needle);
+	eol_offset = tvb_ws_mempbrk_pattern_guint8(tvb, offset, len, &pbrk_crlf, &found_needle);
 	if (eol_offset == -1) {
 		/*
 		 * No CR or LF - line is presumably continued in next packet.
@@ -3120,7 +3119,7 @@ tvb_find_line_end_unquoted(tvbuff_t *tvb, const gint offset, int len, gint *next
 			/*
 			 * Look either for a CR, an LF, or a '"'.
 			 */
-			char_offset = tvb_pbrk_guint8(tvb, cur_offset, len, "\r\n\"", &c);
+			char_offset = tvb_ws_mempbrk_pattern_guint8(tvb, cur_offset, len, &pbrk_crlf_dquote, &c);
 		}
 		if (char_offset == -1) {
 			/*
@@ -36,6 +36,7 @@
 #include <glib.h>
 #include <epan/guid-utils.h>
 #include <epan/wmem/wmem.h>
+#include <wsutil/ws_mempbrk.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -113,6 +114,9 @@ struct nstime_t;   /* nstime.h */
 
 typedef void (*tvbuff_free_cb_t)(void*);
 
+/** Set up the tvbuff routines' static data; called from epan_init(). */
+WS_DLL_PUBLIC void tvbuff_init(void);
+
 /** Extracts 'number of bits' starting at 'bit offset'.
  * Returns a pointer to a newly initialized g_malloc'd REAL_DATA
  * tvbuff with the bits octet aligned.
@@ -495,6 +499,17 @@ WS_DLL_PUBLIC gint tvb_find_guint8(tvbuff_t *tvb, const gint offset,
 WS_DLL_PUBLIC gint tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset,
     const gint maxlength, const guint8 *needles, guchar *found_needle);
 
+/** Find first occurrence of any of the pattern chars in tvbuff, starting at offset.
+ * Searches at most maxlength number of bytes. Returns the offset of the
+ * found needle, or -1 if not found and the found needle.
+ * Will not throw an exception, even if
+ * maxlength exceeds boundary of tvbuff; in that case, -1 will be returned if
+ * the boundary is reached before finding needle.
+ * The pattern is compiled with ws_mempbrk_compile(); compile it once and
+ * reuse it rather than calling tvb_pbrk_guint8() in a hot path. */
+WS_DLL_PUBLIC gint tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset,
+    const gint maxlength, const ws_mempbrk_pattern* pattern, guchar *found_needle);
+
 /** Find size of stringz (NUL-terminated string) by looking for terminating
  * NUL.  The size of the string includes the terminating NUL.
  *
@@ -222,7 +222,7 @@ WSLUA_CONSTRUCTOR Dumper_new(lua_State* L) {
 
     filename = cross_plat_fname(fname);
 
-    d = wtap_dump_open(filename, filetype, encap, 0, FALSE, &err);
+    d = wtap_dump_open(filename, filetype, encap, 0, WTAP_UNCOMPRESSED, &err);
 
     if (! d ) {
         /* WSLUA_ERROR("Error while opening file for writing"); */
@@ -371,7 +371,7 @@ WSLUA_METHOD Dumper_new_for_current(lua_State* L) {
 
     encap = lua_pinfo->fd->lnk_t;
 
-    d = wtap_dump_open(filename, filetype, encap, 0, FALSE, &err);
+    d = wtap_dump_open(filename, filetype, encap, 0, WTAP_UNCOMPRESSED, &err);
 
     if (! d ) {
         switch (err) {
@@ -42,6 +42,7 @@
 #include <wsutil/tempfile.h>
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
+#include <wsutil/aho_corasick.h>
 
 #include <wiretap/merge.h>
 
@@ -68,6 +69,7 @@
 #include "cfile.h"
 #include "file.h"
 #include "fileset.h"
+#include "frame_index.h"
 #include "frame_tvbuff.h"
 
 #include "ui/alert_box.h"
@@ -109,6 +111,7 @@ gboolean auto_scroll_live;
 
 static void cf_reset_state(capture_file *cf);
 
+static void cf_read_frame_index(capture_file *cf, frame_index_t *fidx);
 static int read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
     column_info *cinfo, gint64 offset);
 
@@ -124,13 +127,7 @@ static match_result match_protocol_tree(capture_file *cf, frame_data *fdata,
 static void match_subtree_text(proto_node *node, gpointer data);
 static match_result match_summary_line(capture_file *cf, frame_data *fdata,
     void *criterion);
-static match_result match_narrow_and_wide(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_narrow(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_wide(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_binary(capture_file *cf, frame_data *fdata,
+static match_result match_bytes(capture_file *cf, frame_data *fdata,
     void *criterion);
 static match_result match_dfilter(capture_file *cf, frame_data *fdata,
     void *criterion);
@@ -312,6 +309,17 @@ ws_get_frame_ts(void *data, guint32 frame_num)
   return NULL;
 }
 
+static void
+ws_get_frame_shift_offset(void *data, guint32 frame_num, nstime_t *offset)
+{
+  capture_file *cf = (capture_file *) data;
+
+  if (cf->frames)
+    frame_data_sequence_get_shift_offset(cf->frames, frame_num, offset);
+  else
+    nstime_set_zero(offset);
+}
+
 static const char *
 ws_get_user_comment(void *data, const frame_data *fd)
 {
@@ -320,6 +328,17 @@ ws_get_user_comment(void *data, const frame_data *fd)
   return cf_get_user_packet_comment(cf, fd);
 }
 
+static const void *
+ws_get_color_filter(void *data, const frame_data *fd)
+{
+  capture_file *cf = (capture_file *) data;
+
+  if (cf->frames)
+    return frame_data_sequence_get_color_filter(cf->frames, fd);
+
+  return NULL;
+}
+
 static epan_t *
 ws_epan_new(capture_file *cf)
 {
@@ -327,8 +346,10 @@ ws_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = ws_get_frame_ts;
+  epan->get_frame_shift_offset = ws_get_frame_shift_offset;
   epan->get_interface_name = cap_file_get_interface_name;
   epan->get_user_comment = ws_get_user_comment;
+  epan->get_color_filter = ws_get_color_filter;
 
   return epan;
 }
@@ -342,6 +363,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   wth = wtap_open_offline(fname, type, err, &err_info, TRUE);
   if (wth == NULL)
     goto fail;
+  wtap_set_save_seek_index(wth, prefs.gui_seek_index);
 
   /* The open succeeded.  Close whatever capture file we had open,
      and fill in the information for this file. */
@@ -586,6 +608,7 @@ cf_read(capture_file *cf, gboolean reloading)
   volatile gboolean    create_proto_tree;
   guint                tap_flags;
   gboolean             compiled;
+  frame_index_t       *fidx           = NULL;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -601,6 +624,14 @@ cf_read(capture_file *cf, gboolean reloading)
 
   reset_tap_listeners();
 
+  /* If nothing needs the packets dissected as they're read, a frame
+     index written the last time the file was read can stand in for
+     the sequential pass. */
+  if (prefs.gui_frame_index && dfcode == NULL && cf->rfcode == NULL &&
+      !cf->is_tempfile && tap_flags == 0 &&
+      !have_filtering_tap_listeners() && !tap_listeners_require_dissection())
+    fidx = frame_index_open(cf->filename, cf->wth);
+
   name_ptr = g_filename_display_basename(cf->filename);
 
   if (reloading)
@@ -653,7 +684,12 @@ cf_read(capture_file *cf, gboolean reloading)
     }else
       progbar_quantum = 0;
 
-    while ((wtap_read(cf->wth, &err, &err_info, &data_offset))) {
+    if (fidx != NULL) {
+      err = 0;
+      cf_read_frame_index(cf, fidx);
+    }
+
+    while (fidx == NULL && (wtap_read(cf->wth, &err, &err_info, &data_offset))) {
       if (size >= 0) {
         count++;
         file_pos = wtap_read_so_far(cf->wth);
@@ -751,7 +787,18 @@ cf_read(capture_file *cf, gboolean reloading)
      we've looked at all the packets, as we don't know until then whether
      there's more than one type (and thus whether it's
      WTAP_ENCAP_PER_PACKET). */
-  cf->lnk_t = wtap_file_encap(cf->wth);
+  if (fidx != NULL) {
+    cf->lnk_t = frame_index_file_encap(fidx);
+    frame_index_close(fidx);
+  } else {
+    cf->lnk_t = wtap_file_encap(cf->wth);
+
+    /* Remember what we found so the next read of this file can skip
+       the sequential pass. */
+    if (prefs.gui_frame_index && err == 0 && !stop_flag &&
+        cf->rfcode == NULL && !cf->is_tempfile)
+      frame_index_write(cf->filename, cf->wth, cf->frames, cf->count, cf->lnk_t);
+  }
 
   cf->current_frame = frame_data_sequence_find(cf->frames, cf->first_displayed);
   cf->current_row = 0;
@@ -1187,9 +1234,13 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   } else
     fdata->flags.passed_dfilter = 1;
 
-  if (fdata->flags.passed_dfilter || fdata->flags.ref_time)
+  if (fdata->flags.passed_dfilter || fdata->flags.ref_time) {
     cf->displayed_count++;
 
+    /* Before the packet list sees the frame, as it might sort by it */
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+  }
+
   if (add_to_packet_list) {
     /* We fill the needed columns from new_packet_list */
       row = packet_list_append(cinfo, fdata);
@@ -1197,7 +1248,6 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
 
   if (fdata->flags.passed_dfilter || fdata->flags.ref_time)
   {
-    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
     cf->prev_dis = fdata;
 
     /* If we haven't yet seen the first frame, this is it.
@@ -1281,6 +1331,47 @@ read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
   return row;
 }
 
+/* Add the frames listed in a frame index to the packet list without
+   reading or dissecting them; they'll be dissected when displayed. */
+static void
+cf_read_frame_index(capture_file *cf, frame_index_t *fidx)
+{
+  struct wtap_pkthdr phdr;
+  frame_data         fdlocal;
+  frame_data        *fdata;
+  gint64             offset;
+  guint32            framenum;
+  guint32            count = frame_index_count(fidx);
+
+  for (framenum = 1; framenum <= count; framenum++) {
+    frame_index_get(fidx, framenum, &phdr, &offset);
+    cf_add_encapsulation_type(cf, phdr.pkt_encap);
+
+    frame_data_init(&fdlocal, framenum, &phdr, offset, cf->cum_bytes);
+    fdata = frame_data_sequence_add(cf->frames, &fdlocal);
+
+    cf->count++;
+    if (fdata->flags.has_phdr_comment)
+      cf->packet_comment_count++;
+    cf->f_datalen = offset + fdlocal.cap_len;
+
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->ref, cf->prev_dis);
+    cf->prev_cap = fdata;
+
+    /* There's no display filter, so every frame is displayed. */
+    fdata->flags.passed_dfilter = 1;
+    cf->displayed_count++;
+    packet_list_append(NULL, fdata);
+
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+}
+
 cf_status_t
 cf_merge_files(char **out_filenamep, int in_file_count,
                char *const *in_filenames, int file_type, gboolean do_append)
@@ -1413,7 +1504,7 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     pdh = wtap_dump_fdopen_ng(out_fd, file_type,
                               selected_frame_type,
                               merge_max_snapshot_length(in_file_count, in_files),
-                              FALSE /* compressed */, shb_hdr, idb_inf /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
+                              WTAP_UNCOMPRESSED, shb_hdr, idb_inf /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
 
     if (pdh == NULL) {
       ws_close(out_fd);
@@ -1429,7 +1520,7 @@ cf_merge_files(char **out_filenamep, int in_file_count,
     pdh = wtap_dump_fdopen(out_fd, file_type,
                            selected_frame_type,
                            merge_max_snapshot_length(in_file_count, in_files),
-                           FALSE /* compressed */, &open_err);
+                           WTAP_UNCOMPRESSED, &open_err);
     if (pdh == NULL) {
       ws_close(out_fd);
       merge_close_in_files(in_file_count, in_files);
@@ -1798,6 +1889,17 @@ cf_read_record_r(capture_file *cf, const frame_data *fdata,
     g_free(display_basename);
     return FALSE;
   }
+
+  /* The frame list may have come from a frame index; don't dissect a
+     packet that isn't the one the frame list describes. */
+  if (phdr->caplen != fdata->cap_len) {
+    display_basename = g_filename_display_basename(cf->filename);
+    simple_error_message_box(
+               "Packet %u in the file \"%s\" is %u bytes long, but %u bytes were expected.",
+               fdata->num, display_basename, phdr->caplen, fdata->cap_len);
+    g_free(display_basename);
+    return FALSE;
+  }
   return TRUE;
 }
 
@@ -2368,8 +2470,13 @@ retap_packet(capture_file *cf, frame_data *fdata,
   return TRUE;
 }
 
-cf_read_status_t
-cf_retap_packets(capture_file *cf)
+/* Set while the pending tap listeners are being retapped.  The progress
+   dialog runs the event loop, so a dialog opened during that pass can ask
+   for another one before it's done. */
+static gboolean retapping_pending = FALSE;
+
+static cf_read_status_t
+retap_packets(capture_file *cf, gboolean pending_only)
 {
   packet_range_t        range;
   retap_callback_args_t callback_args;
@@ -2382,7 +2489,25 @@ cf_retap_packets(capture_file *cf)
   if (cf == NULL) {
     return CF_READ_ABORTED;
   }
-  
+
+  if (pending_only) {
+    /* Don't reset the listeners of a pass that's still running; anything
+       marked pending since it started is left for the next retap. */
+    if (retapping_pending) {
+      return CF_READ_ABORTED;
+    }
+
+    /* Nothing to do if every tap listener has seen all the packets. */
+    if (!have_pending_tap_listeners()) {
+      return CF_READ_OK;
+    }
+
+    /* Reset only the pending tap listeners, and pass the packets only
+       to them; the flags and filters below are theirs. */
+    reset_pending_tap_listeners();
+    retapping_pending = TRUE;
+  }
+
   /* Do we have any tap listeners with filters? */
   filtering_tap_listeners = have_filtering_tap_listeners();
 
@@ -2397,7 +2522,9 @@ cf_retap_packets(capture_file *cf)
   callback_args.cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
 
   /* Reset the tap listeners. */
-  reset_tap_listeners();
+  if (!pending_only) {
+    reset_tap_listeners();
+  }
 
   epan_dissect_init(&callback_args.edt, cf->epan, construct_protocol_tree, FALSE);
 
@@ -2412,6 +2539,11 @@ cf_retap_packets(capture_file *cf)
 
   epan_dissect_cleanup(&callback_args.edt);
 
+  if (pending_only) {
+    finish_pending_tap_listeners(ret == PSP_FINISHED);
+    retapping_pending = FALSE;
+  }
+
   switch (ret) {
   case PSP_FINISHED:
     /* Completed successfully. */
@@ -2431,6 +2563,18 @@ cf_retap_packets(capture_file *cf)
   return CF_READ_OK;
 }
 
+cf_read_status_t
+cf_retap_packets(capture_file *cf)
+{
+  return retap_packets(cf, FALSE);
+}
+
+cf_read_status_t
+cf_retap_pending_packets(capture_file *cf)
+{
+  return retap_packets(cf, TRUE);
+}
+
 typedef struct {
   print_args_t *print_args;
   gboolean      print_header_line;
@@ -3245,160 +3389,67 @@ match_summary_line(capture_file *cf, frame_data *fdata, void *criterion)
   return result;
 }
 
-typedef struct {
-    const guint8 *data;
-    size_t        data_len;
-} cbs_t;    /* "Counted byte string" */
-
-
 /*
- * The current match_* routines only support ASCII case insensitivity and don't
- * convert UTF-8 inputs to UTF-16 for matching.
+ * All string and hex searches compile the search string into one
+ * Aho-Corasick automaton (for "narrow & wide", with both the ASCII and
+ * the UTF-16LE form as patterns) and look at each byte of each frame
+ * once.
  *
- * We could modify them to use the GLib Unicode routines or the International
- * Components for Unicode library but it's not apparent that we could do so
- * without consuming a lot more CPU and memory or that searching would be
- * significantly better.
+ * Case insensitivity only covers ASCII, and the UTF-16LE form is only
+ * correct for ASCII search strings; UTF-8 input isn't converted to
+ * UTF-16.  We could use the GLib Unicode routines or the International
+ * Components for Unicode library for that, but it's not apparent that
+ * searching would be significantly better.
  */
 
 gboolean
 cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
                     search_direction dir)
 {
-  cbs_t info;
-
-  info.data = string;
-  info.data_len = string_size;
+  ac_automaton *ac;
+  gboolean      result;
 
   /* String or hex search? */
   if (cf->string) {
+    ac = ac_automaton_new(cf->case_type);
+
     /* String search - what type of string? */
     switch (cf->scs_type) {
 
     case SCS_NARROW_AND_WIDE:
-      return find_packet(cf, match_narrow_and_wide, &info, dir);
+      ac_automaton_add_pattern(ac, string, string_size);
+      ac_automaton_add_pattern_utf16le(ac, string, string_size);
+      break;
 
     case SCS_NARROW:
-      return find_packet(cf, match_narrow, &info, dir);
+      ac_automaton_add_pattern(ac, string, string_size);
+      break;
 
     case SCS_WIDE:
-      return find_packet(cf, match_wide, &info, dir);
+      ac_automaton_add_pattern_utf16le(ac, string, string_size);
+      break;
 
     default:
       g_assert_not_reached();
+      ac_automaton_free(ac);
       return FALSE;
     }
-  } else
-    return find_packet(cf, match_binary, &info, dir);
-}
-
-static match_result
-match_narrow_and_wide(capture_file *cf, frame_data *fdata, void *criterion)
-{
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
-
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
-
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = buffer_start_ptr(&cf->buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = toupper(c_char);
-    if (c_char != '\0') {
-      if (c_char == ascii_text[c_match]) {
-        c_match += 1;
-        if (c_match == textlen) {
-          result = MR_MATCHED;
-          cf->search_pos = i; /* Save the position of the last character
-                                 for highlighting the field. */
-          break;
-        }
-      }
-      else {
-        g_assert(i>=c_match);
-        i -= (guint32)c_match;
-        c_match = 0;
-      }
-    }
-    i += 1;
-  }
-  return result;
-}
-
-static match_result
-match_narrow(capture_file *cf, frame_data *fdata, void *criterion)
-{
-  guint8       *pd;
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
-
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
-
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = buffer_start_ptr(&cf->buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
-      }
-    }
-    else {
-      g_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
+  } else {
+    ac = ac_automaton_new(FALSE);
+    ac_automaton_add_pattern(ac, string, string_size);
   }
+  ac_automaton_compile(ac);
 
+  result = find_packet(cf, match_bytes, ac, dir);
+  ac_automaton_free(ac);
   return result;
 }
 
 static match_result
-match_wide(capture_file *cf, frame_data *fdata, void *criterion)
+match_bytes(capture_file *cf, frame_data *fdata, void *criterion)
 {
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
+  ac_automaton *ac = (ac_automaton *)criterion;
+  size_t        match_end;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata)) {
@@ -3406,74 +3457,13 @@ match_wide(capture_file *cf, frame_data *fdata, void *criterion)
     return MR_ERROR;
   }
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = buffer_start_ptr(&cf->buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
-      }
-      i += 1;
-    }
-    else {
-      g_assert(i>=(c_match*2));
-      i -= (guint32)c_match*2;
-      c_match = 0;
-    }
-    i += 1;
-  }
-  return result;
-}
-
-static match_result
-match_binary(capture_file *cf, frame_data *fdata, void *criterion)
-{
-  cbs_t        *info        = (cbs_t *)criterion;
-  const guint8 *binary_data = info->data;
-  size_t        datalen     = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  size_t        c_match     = 0;
-
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
+  if (!ac_automaton_search(ac, buffer_start_ptr(&cf->buf), fdata->cap_len,
+                           &match_end, NULL))
+    return MR_NOTMATCHED;
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = buffer_start_ptr(&cf->buf);
-  i = 0;
-  while (i < buf_len) {
-    if (pd[i] == binary_data[c_match]) {
-      c_match += 1;
-      if (c_match == datalen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
-      }
-    }
-    else {
-      g_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
-  }
-  return result;
+  cf->search_pos = (guint32)match_end; /* Save the position of the last character
+                                           for highlighting the field. */
+  return MR_MATCHED;
 }
 
 gboolean
@@ -4674,10 +4664,12 @@ cf_save_records(capture_file *cf, const char *fname, guint save_format,
          from which we're reading the packets that we're writing!) */
       fname_new = g_strdup_printf("%s~", fname);
       pdh = wtap_dump_open_ng(fname_new, save_format, encap, cf->snap,
-                              compressed, shb_hdr, idb_inf, &err);
+                              compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
+                              shb_hdr, idb_inf, &err);
     } else {
       pdh = wtap_dump_open_ng(fname, save_format, encap, cf->snap,
-                              compressed, shb_hdr, idb_inf, &err);
+                              compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
+                              shb_hdr, idb_inf, &err);
     }
     g_free(idb_inf);
     idb_inf = NULL;
@@ -4903,10 +4895,12 @@ cf_export_specified_packets(capture_file *cf, const char *fname,
        from which we're reading the packets that we're writing!) */
     fname_new = g_strdup_printf("%s~", fname);
     pdh = wtap_dump_open_ng(fname_new, save_format, encap, cf->snap,
-                            compressed, shb_hdr, idb_inf, &err);
+                            compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
+                            shb_hdr, idb_inf, &err);
   } else {
     pdh = wtap_dump_open_ng(fname, save_format, encap, cf->snap,
-                            compressed, shb_hdr, idb_inf, &err);
+                            compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED,
+                            shb_hdr, idb_inf, &err);
   }
   g_free(idb_inf);
   idb_inf = NULL;
@@ -388,6 +388,18 @@ void cf_redissect_packets(capture_file *cf);
  */
 cf_read_status_t cf_retap_packets(capture_file *cf);
 
+/**
+ * Rescan all packets and run the taps only for the tap listeners that
+ * haven't seen them yet, i.e. that have been added or changed since the
+ * packets were last tapped; the other tap listeners are left alone.
+ * If such a rescan is already running, nothing is done and
+ * CF_READ_ABORTED is returned; the listeners stay pending.
+ *
+ * @param cf the capture file
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_retap_pending_packets(capture_file *cf);
+
 /**
  * Adjust timestamp precision if auto is selected.
  *
@@ -65,6 +65,36 @@ typedef struct _fileset {
 /* this is the fileset's global data */
 static fileset set = { NULL, NULL};
 
+/* Suffixes of compressed files; dumpcap --compress adds .zst or .lz4 to
+   the completed files of a ring buffer, so a set can contain both */
+static const char * const compressed_suffixes[] = { ".gz", ".zst", ".lz4" };
+
+/* cut off the compression suffix, if any, and return the (optional) file
+   extension of what's left, or the end of the name if there's none */
+static char *
+fileset_strip_suffix(char *fname)
+{
+    size_t      len = strlen(fname);
+    size_t      slen;
+    char        *pfx;
+    guint       i;
+
+
+    for (i = 0; i < G_N_ELEMENTS(compressed_suffixes); i++) {
+        slen = strlen(compressed_suffixes[i]);
+        if (len > slen &&
+            g_ascii_strcasecmp(fname + len - slen, compressed_suffixes[i]) == 0) {
+            fname[len - slen] = '\0';
+            break;
+        }
+    }
+
+    pfx = strrchr(fname, '.');
+    if(pfx == NULL) {  /* suffix is optional */
+        pfx = fname + strlen(fname);
+    }
+    return pfx;
+}
 
 /* is this a probable file of a file set (does the naming pattern match)? */
 gboolean
@@ -79,11 +109,8 @@ fileset_filename_match_pattern(const char *fname)
     /* d:\dir1\test_00001_20050418010750.cap */
     filename = g_strdup(get_basename(fname));
 
-    /* test_00001_20050418010750.cap */
-    pfx = strrchr(filename, '.');
-    if(pfx == NULL) {  /* suffix is optional */
-        pfx = filename + strlen(filename);
-    }
+    /* test_00001_20050418010750.cap (.zst) */
+    pfx = fileset_strip_suffix(filename);
     /* test_00001_20050418010750 */
     *pfx = '\0';
 
@@ -140,13 +167,11 @@ fileset_is_file_in_set(const char *fname1, const char *fname2)
     dup_f1 = g_strdup(fname1);
     dup_f2 = g_strdup(fname2);
 
-    pfx1 = strrchr(dup_f1, '.');
-    pfx2 = strrchr(dup_f2, '.');
-    /* suffix is optional */
-    if (!pfx1) pfx1 = dup_f1 + strlen(dup_f1);
-    if (!pfx2) pfx2 = dup_f2 + strlen(dup_f2);
+    pfx1 = fileset_strip_suffix(dup_f1);
+    pfx2 = fileset_strip_suffix(dup_f2);
 
-    /* the optional suffix (file extension) must be equal */
+    /* the optional suffix (file extension) must be equal; whether the
+       file is compressed doesn't matter */
     if(strcmp(pfx1, pfx2) != 0) {
         g_free(dup_f1);
         g_free(dup_f2);
@@ -0,0 +1,397 @@
+/* frame_index.c
+ * Routines for the on-disk frame index kept next to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/crc32.h>
+
+#include <epan/frame_data.h>
+
+#include "frame_index.h"
+
+#define FRAME_INDEX_SUFFIX      ".wsidx"
+#define FRAME_INDEX_MAGIC       "WSFIDX\0\2"
+#define FRAME_INDEX_BYTE_ORDER  0x1a2b3c4d
+
+/* Number of leading bytes of the capture file covered by the checksum */
+#define FRAME_INDEX_CRC_LEN     65536
+
+#if GLIB_CHECK_VERSION(2,22,0)
+#define frame_index_unmap(mapped) g_mapped_file_unref(mapped)
+#else
+#define frame_index_unmap(mapped) g_mapped_file_free(mapped)
+#endif
+
+#define FRAME_INDEX_HAS_TS      0x0001
+#define FRAME_INDEX_HAS_COMMENT 0x0002
+
+/*
+ * The index is written in host byte order; an index written on a
+ * machine with the other byte order fails the byte_order check and
+ * is simply ignored.
+ */
+typedef struct {
+    char     magic[8];
+    guint32  byte_order;
+    guint32  rec_size;
+    gint64   file_size;         /* size of the capture file */
+    gint64   file_mtime;        /* modification time of the capture file */
+    guint32  file_crc;          /* CRC of the first FRAME_INDEX_CRC_LEN bytes */
+    gint32   file_type_subtype;
+    gint32   file_encap;
+    guint32  if_count;          /* number of interfaces in the capture file */
+    guint32  count;             /* number of frame_index_rec_t that follow */
+} frame_index_hdr_t;
+
+typedef struct {
+    gint64   file_off;
+    gint64   secs;
+    gint32   nsecs;
+    guint32  pkt_len;
+    guint32  cap_len;
+    gint16   lnk_t;
+    guint16  flags;
+} frame_index_rec_t;
+
+struct _frame_index {
+    GMappedFile             *mapped;
+    const frame_index_hdr_t *hdr;
+    const frame_index_rec_t *recs;
+};
+
+/*
+ * Only file types whose random-access read path needs no state from the
+ * sequential pass, other than what's read when the file is opened, can
+ * be indexed.  For pcap-ng that's the Interface Description Blocks in
+ * front of the first packet; the index records how many interfaces the
+ * file has, so it isn't used if there are any further on.  Name
+ * resolution and interface statistics blocks are usually at the end of
+ * the file, after the last packet, and are read from there.
+ */
+static gboolean
+frame_index_supported(wtap *wth)
+{
+    switch (wtap_file_type_subtype(wth)) {
+
+    case WTAP_FILE_TYPE_SUBTYPE_PCAPNG:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_AIX:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS991029:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990417:
+    case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990915:
+        return !wtap_iscompressed(wth);
+
+    default:
+        return FALSE;
+    }
+}
+
+/*
+ * Fill in the fields of the header that identify the capture file.
+ */
+static gboolean
+frame_index_identify(const char *capture_filename, wtap *wth,
+                     frame_index_hdr_t *hdr)
+{
+    ws_statb64                   statb;
+    wtapng_iface_descriptions_t *idb_info;
+    guint8                      *buf;
+    int                          fd;
+    int                          nread;
+
+    if (ws_stat64(capture_filename, &statb) != 0)
+        return FALSE;
+
+    fd = ws_open(capture_filename, O_RDONLY|O_BINARY, 0000 /* no creation so don't matter */);
+    if (fd == -1)
+        return FALSE;
+    buf = (guint8 *)g_malloc(FRAME_INDEX_CRC_LEN);
+    nread = (int)ws_read(fd, buf, FRAME_INDEX_CRC_LEN);
+    ws_close(fd);
+    if (nread < 0) {
+        g_free(buf);
+        return FALSE;
+    }
+
+    memset(hdr, 0, sizeof *hdr);
+    memcpy(hdr->magic, FRAME_INDEX_MAGIC, sizeof hdr->magic);
+    hdr->byte_order = FRAME_INDEX_BYTE_ORDER;
+    hdr->rec_size = (guint32)sizeof(frame_index_rec_t);
+    hdr->file_size = (gint64)statb.st_size;
+    hdr->file_mtime = (gint64)statb.st_mtime;
+    hdr->file_crc = crc32_ccitt_seed(buf, nread, 0xFFFFFFFF);
+    hdr->file_type_subtype = wtap_file_type_subtype(wth);
+    idb_info = wtap_file_get_idb_info(wth);
+    hdr->if_count = idb_info->interface_data->len;
+    g_free(idb_info);
+    g_free(buf);
+    return TRUE;
+}
+
+/*
+ * Check that every record could be a frame of the capture file, so that
+ * a stale or made-up index can't have frames read with lengths other
+ * than the file's.
+ */
+static gboolean
+frame_index_check_recs(const frame_index_hdr_t *hdr,
+                       const frame_index_rec_t *recs)
+{
+    const frame_index_rec_t *rec;
+    gint64                   prev_off = -1;
+    guint32                  i;
+
+    for (i = 0; i < hdr->count; i++) {
+        rec = &recs[i];
+        if (rec->file_off <= prev_off ||
+            rec->cap_len > rec->pkt_len ||
+            rec->cap_len > WTAP_MAX_PACKET_SIZE ||
+            rec->file_off + rec->cap_len > hdr->file_size ||
+            rec->nsecs < 0 || rec->nsecs >= 1000000000 ||
+            rec->lnk_t < 0 || rec->lnk_t >= wtap_get_num_encap_types())
+            return FALSE;
+        prev_off = rec->file_off;
+    }
+    return TRUE;
+}
+
+/*
+ * Read the last packet, which has to be the index's last frame, and
+ * everything after it, as the sequential pass would have, leaving the
+ * sequential read at the end of the file.  If the packet isn't the
+ * last frame, the sequential read is put back where it was.
+ */
+static gboolean
+frame_index_read_tail(const frame_index_hdr_t *hdr,
+                      const frame_index_rec_t *recs, wtap *wth)
+{
+    const frame_index_rec_t *last = &recs[hdr->count - 1];
+    struct wtap_pkthdr      *phdr;
+    gint64                   start;
+    gint64                   data_offset;
+    int                      err;
+    gchar                   *err_info = NULL;
+
+    start = wtap_tell_sequential(wth);
+    if (!wtap_seek_sequential(wth, last->file_off, &err))
+        return FALSE;
+    if (!wtap_read(wth, &err, &err_info, &data_offset))
+        goto restore;
+    phdr = wtap_phdr(wth);
+    if (data_offset != last->file_off || phdr->caplen != last->cap_len ||
+        phdr->len != last->pkt_len)
+        goto restore;
+
+    /* there shouldn't be any more packets, but there may be other
+       blocks, which are read on the way to the end of the file */
+    if (wtap_read(wth, &err, &err_info, &data_offset) || err != 0) {
+        g_free(err_info);
+        return FALSE;
+    }
+    return TRUE;
+
+restore:
+    g_free(err_info);
+    wtap_seek_sequential(wth, start, &err);
+    return FALSE;
+}
+
+frame_index_t *
+frame_index_open(const char *capture_filename, wtap *wth)
+{
+    frame_index_hdr_t        expected;
+    const frame_index_hdr_t *hdr;
+    GMappedFile             *mapped;
+    gchar                   *index_filename;
+    gsize                    len;
+    frame_index_t           *idx;
+
+    if (!frame_index_supported(wth))
+        return NULL;
+    if (!frame_index_identify(capture_filename, wth, &expected))
+        return NULL;
+
+    index_filename = g_strconcat(capture_filename, FRAME_INDEX_SUFFIX, NULL);
+    mapped = g_mapped_file_new(index_filename, FALSE, NULL);
+    g_free(index_filename);
+    if (mapped == NULL)
+        return NULL;
+
+    len = g_mapped_file_get_length(mapped);
+    hdr = (const frame_index_hdr_t *)g_mapped_file_get_contents(mapped);
+    if (len < sizeof *hdr ||
+        memcmp(hdr->magic, expected.magic, sizeof hdr->magic) != 0 ||
+        hdr->byte_order != expected.byte_order ||
+        hdr->rec_size != expected.rec_size ||
+        hdr->file_size != expected.file_size ||
+        hdr->file_mtime != expected.file_mtime ||
+        hdr->file_crc != expected.file_crc ||
+        hdr->file_type_subtype != expected.file_type_subtype ||
+        hdr->if_count != expected.if_count ||
+        (len - sizeof *hdr) / sizeof(frame_index_rec_t) != hdr->count ||
+        (len - sizeof *hdr) % sizeof(frame_index_rec_t) != 0 ||
+        hdr->count == 0 ||
+        !frame_index_check_recs(hdr, (const frame_index_rec_t *)(hdr + 1)) ||
+        !frame_index_read_tail(hdr, (const frame_index_rec_t *)(hdr + 1), wth)) {
+        frame_index_unmap(mapped);
+        return NULL;
+    }
+
+    idx = g_new(frame_index_t, 1);
+    idx->mapped = mapped;
+    idx->hdr = hdr;
+    idx->recs = (const frame_index_rec_t *)(hdr + 1);
+    return idx;
+}
+
+guint32
+frame_index_count(const frame_index_t *idx)
+{
+    return idx->hdr->count;
+}
+
+int
+frame_index_file_encap(const frame_index_t *idx)
+{
+    return idx->hdr->file_encap;
+}
+
+void
+frame_index_get(const frame_index_t *idx, guint32 num,
+                struct wtap_pkthdr *phdr, gint64 *offset)
+{
+    const frame_index_rec_t *rec;
+
+    g_assert(num >= 1 && num <= idx->hdr->count);
+    rec = &idx->recs[num - 1];
+
+    memset(phdr, 0, sizeof *phdr);
+    phdr->rec_type = REC_TYPE_PACKET;
+    phdr->presence_flags = (rec->flags & FRAME_INDEX_HAS_TS) ? WTAP_HAS_TS : 0;
+    phdr->ts.secs = (time_t)rec->secs;
+    phdr->ts.nsecs = rec->nsecs;
+    phdr->caplen = rec->cap_len;
+    phdr->len = rec->pkt_len;
+    phdr->pkt_encap = rec->lnk_t;
+    /* frame_data_init() only checks this against NULL */
+    phdr->opt_comment = (rec->flags & FRAME_INDEX_HAS_COMMENT) ? (gchar *)"" : NULL;
+    *offset = rec->file_off;
+}
+
+void
+frame_index_close(frame_index_t *idx)
+{
+    frame_index_unmap(idx->mapped);
+    g_free(idx);
+}
+
+gboolean
+frame_index_write(const char *capture_filename, wtap *wth,
+                  frame_data_sequence *frames, guint32 count, int file_encap)
+{
+    frame_index_hdr_t  hdr;
+    frame_index_rec_t  rec;
+    frame_data        *fdata;
+    gchar             *index_filename;
+    gchar             *tmp_filename;
+    FILE              *fh;
+    guint32            num;
+    gboolean           ok;
+
+    if (count == 0 || !frame_index_supported(wth))
+        return FALSE;
+    if (!frame_index_identify(capture_filename, wth, &hdr))
+        return FALSE;
+    hdr.file_encap = file_encap;
+    hdr.count = count;
+
+    index_filename = g_strconcat(capture_filename, FRAME_INDEX_SUFFIX, NULL);
+    tmp_filename = g_strconcat(index_filename, ".tmp", NULL);
+    fh = ws_fopen(tmp_filename, "wb");
+    if (fh == NULL) {
+        g_free(tmp_filename);
+        g_free(index_filename);
+        return FALSE;
+    }
+
+    ok = fwrite(&hdr, sizeof hdr, 1, fh) == 1;
+    memset(&rec, 0, sizeof rec);
+    for (num = 1; ok && num <= count; num++) {
+        fdata = frame_data_sequence_find(frames, num);
+        if (fdata == NULL) {
+            ok = FALSE;
+            break;
+        }
+        rec.file_off = fdata->file_off;
+        rec.secs = (gint64)fdata->abs_ts.secs;
+        rec.nsecs = fdata->abs_ts.nsecs;
+        rec.pkt_len = fdata->pkt_len;
+        rec.cap_len = fdata->cap_len;
+        rec.lnk_t = fdata->lnk_t;
+        rec.flags = (fdata->flags.has_ts ? FRAME_INDEX_HAS_TS : 0) |
+                    (fdata->flags.has_phdr_comment ? FRAME_INDEX_HAS_COMMENT : 0);
+        ok = fwrite(&rec, sizeof rec, 1, fh) == 1;
+    }
+    if (fclose(fh) != 0)
+        ok = FALSE;
+
+    if (ok) {
+        /* rename() won't replace an existing file on Windows */
+        ws_unlink(index_filename);
+        ok = ws_rename(tmp_filename, index_filename) == 0;
+    }
+    if (!ok)
+        ws_unlink(tmp_filename);
+
+    g_free(tmp_filename);
+    g_free(index_filename);
+    return ok;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,112 @@
+/* frame_index.h
+ * Definitions for the on-disk frame index kept next to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include <epan/frame_data_sequence.h>
+#include <wiretap/wtap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A frame index is a sidecar file, "<capture file>.wsidx", holding the
+ * per-frame fields that the first pass over a capture file computes
+ * (file offset, time stamp, lengths and encapsulation).  Reopening a
+ * file with a valid index lets the packet list be built without reading
+ * and dissecting every packet; the index is rejected if the capture
+ * file's size, modification time or leading bytes have changed, or if
+ * any of its records doesn't fit the file.
+ *
+ * For pcap-ng files, blocks other than packets that come between the
+ * first and the last packet (name resolution, for example) are not
+ * read when the index is used.
+ */
+typedef struct _frame_index frame_index_t;
+
+/** Open the index for the given capture file.
+ *
+ * @param capture_filename the name of the capture file
+ * @param wth the capture file, already opened; if the index is used, the
+ * sequential read is left at the end of the file
+ * @return the index, or NULL if there is none or it doesn't match the file
+ */
+extern frame_index_t *frame_index_open(const char *capture_filename, wtap *wth);
+
+/** The number of frames in the index. */
+extern guint32 frame_index_count(const frame_index_t *idx);
+
+/** The file-level encapsulation type recorded in the index. */
+extern int frame_index_file_encap(const frame_index_t *idx);
+
+/** Fill in the packet header and file offset of a frame.
+ *
+ * Only the fields that frame_data_init() looks at are set; the
+ * comment pointer is set to a non-NULL value if the frame has a
+ * comment, but it isn't the comment text.
+ *
+ * @param idx the index
+ * @param num the frame number, 1-origin
+ * @param phdr the packet header to fill in
+ * @param offset set to the frame's offset in the capture file
+ */
+extern void frame_index_get(const frame_index_t *idx, guint32 num,
+                            struct wtap_pkthdr *phdr, gint64 *offset);
+
+/** Close an index returned by frame_index_open(). */
+extern void frame_index_close(frame_index_t *idx);
+
+/** Write an index for a capture file that has been read in full.
+ *
+ * Failures are not reported; the index is only an accelerator.
+ *
+ * @param capture_filename the name of the capture file
+ * @param wth the capture file
+ * @param frames the frames read from the capture file
+ * @param count the number of frames
+ * @param file_encap the file-level encapsulation type
+ * @return TRUE if the index was written
+ */
+extern gboolean frame_index_write(const char *capture_filename, wtap *wth,
+                                  frame_data_sequence *frames, guint32 count,
+                                  int file_encap);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
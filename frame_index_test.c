@@ -0,0 +1,326 @@
+/* frame_index_test.c
+ * Tests for the on-disk frame index kept next to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+#include <epan/frame_data.h>
+#include <epan/frame_data_sequence.h>
+
+#include "frame_index.h"
+
+#define NUM_PACKETS     300
+#define SNAPLEN         1500
+
+/*
+ * Layout of the index records, which follow the header at the end of
+ * the index file: file offset, seconds, nanoseconds, packet length,
+ * captured length, encapsulation and flags.
+ */
+#define REC_SIZE        32
+#define REC_FILE_OFF    0
+#define REC_CAP_LEN     24
+
+/* Packets have different lengths, and some are cut short */
+static guint32
+packet_len(guint n)
+{
+    return 60 + (n * 37) % 2000;
+}
+
+static gchar *
+write_capture(int file_type_subtype)
+{
+    struct wtap_pkthdr phdr;
+    wtap_dumper *wdh;
+    guint8 data[SNAPLEN];
+    gchar *path;
+    guint n, i;
+    int fd;
+    int err;
+
+    fd = g_file_open_tmp("frame_index_testXXXXXX", &path, NULL);
+    g_assert(fd != -1);
+    ws_close(fd);
+
+    wdh = wtap_dump_open(path, file_type_subtype, WTAP_ENCAP_ETHERNET,
+                         SNAPLEN, WTAP_UNCOMPRESSED, &err);
+    g_assert(wdh != NULL);
+
+    memset(&phdr, 0, sizeof phdr);
+    phdr.rec_type = REC_TYPE_PACKET;
+    phdr.presence_flags = WTAP_HAS_TS;
+    phdr.pkt_encap = WTAP_ENCAP_ETHERNET;
+    for (n = 0; n < NUM_PACKETS; n++) {
+        phdr.ts.secs = 1000000000 + n;
+        phdr.ts.nsecs = n * 1000;
+        phdr.len = packet_len(n);
+        phdr.caplen = MIN(phdr.len, SNAPLEN);
+        for (i = 0; i < phdr.caplen; i++)
+            data[i] = (guint8)(n + i);
+        g_assert(wtap_dump(wdh, &phdr, data, &err));
+    }
+    g_assert(wtap_dump_close(wdh, &err));
+
+    return path;
+}
+
+static wtap *
+open_capture(const gchar *path)
+{
+    wtap *wth;
+    int err;
+    gchar *err_info;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    g_assert(wth != NULL);
+    return wth;
+}
+
+/* Read the whole file, as the first pass over it does */
+static frame_data_sequence *
+read_frames(wtap *wth)
+{
+    frame_data_sequence *frames = new_frame_data_sequence();
+    frame_data fdlocal;
+    guint32 num = 0;
+    guint32 cum_bytes = 0;
+    gint64 data_offset;
+    int err;
+    gchar *err_info = NULL;
+
+    while (wtap_read(wth, &err, &err_info, &data_offset)) {
+        num++;
+        frame_data_init(&fdlocal, num, wtap_phdr(wth), data_offset, cum_bytes);
+        cum_bytes = fdlocal.cum_bytes;
+        frame_data_sequence_add(frames, &fdlocal);
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(num, ==, NUM_PACKETS);
+    return frames;
+}
+
+static gchar *
+write_index(const gchar *path)
+{
+    frame_data_sequence *frames;
+    wtap *wth;
+
+    wth = open_capture(path);
+    frames = read_frames(wth);
+    g_assert(frame_index_write(path, wth, frames, NUM_PACKETS,
+                               wtap_file_encap(wth)));
+    free_frame_data_sequence(frames);
+    wtap_close(wth);
+
+    return g_strconcat(path, ".wsidx", NULL);
+}
+
+/*
+ * The frames built from the index have to be the ones a sequential
+ * read finds, and the packets have to be readable at their offsets.
+ */
+static void
+check_index(const gchar *path)
+{
+    frame_data_sequence *frames;
+    frame_index_t *fidx;
+    frame_data fdlocal;
+    frame_data *fdata;
+    struct wtap_pkthdr phdr;
+    struct wtap_pkthdr rphdr;
+    Buffer buf;
+    wtap *wth;
+    gint64 offset;
+    gint64 data_offset;
+    guint32 num;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = open_capture(path);
+    frames = read_frames(wth);
+    wtap_close(wth);
+
+    wth = open_capture(path);
+    fidx = frame_index_open(path, wth);
+    g_assert(fidx != NULL);
+    g_assert_cmpuint(frame_index_count(fidx), ==, NUM_PACKETS);
+    g_assert_cmpint(frame_index_file_encap(fidx), ==, wtap_file_encap(wth));
+
+    /* the rest of the file has been read */
+    g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+    g_assert_cmpint(err, ==, 0);
+
+    buffer_init(&buf, SNAPLEN);
+    memset(&rphdr, 0, sizeof rphdr);
+    for (num = 1; num <= NUM_PACKETS; num++) {
+        fdata = frame_data_sequence_find(frames, num);
+        frame_index_get(fidx, num, &phdr, &offset);
+        frame_data_init(&fdlocal, num, &phdr, offset, 0);
+
+        g_assert_cmpint(fdlocal.file_off, ==, fdata->file_off);
+        g_assert_cmpuint(fdlocal.pkt_len, ==, fdata->pkt_len);
+        g_assert_cmpuint(fdlocal.cap_len, ==, fdata->cap_len);
+        g_assert_cmpint(fdlocal.lnk_t, ==, fdata->lnk_t);
+        g_assert_cmpuint(fdlocal.flags.has_ts, ==, fdata->flags.has_ts);
+        g_assert_cmpint(fdlocal.abs_ts.secs, ==, fdata->abs_ts.secs);
+        g_assert_cmpint(fdlocal.abs_ts.nsecs, ==, fdata->abs_ts.nsecs);
+
+        g_assert(wtap_seek_read(wth, offset, &rphdr, &buf, &err, &err_info));
+        g_assert_cmpuint(rphdr.caplen, ==, fdlocal.cap_len);
+        g_assert_cmpuint(rphdr.len, ==, fdlocal.pkt_len);
+    }
+    buffer_free(&buf);
+
+    frame_index_close(fidx);
+    wtap_close(wth);
+    free_frame_data_sequence(frames);
+}
+
+/* Offset, in the index file, of a field of a record */
+#define rec_field(len, num, field) \
+    ((len) - (NUM_PACKETS - (num) + 1) * REC_SIZE + (field))
+
+/* Change a field of a record, as a stale or made-up index would */
+static void
+tamper_index(const gchar *index_path, guint32 num, gsize field,
+             const void *val, gsize size)
+{
+    gchar *contents;
+    gsize len;
+
+    g_assert(g_file_get_contents(index_path, &contents, &len, NULL));
+    memcpy(contents + rec_field(len, num, field), val, size);
+    g_assert(g_file_set_contents(index_path, contents, len, NULL));
+    g_free(contents);
+}
+
+static void
+check_rejected(const gchar *path)
+{
+    frame_index_t *fidx;
+    gint64 data_offset;
+    wtap *wth;
+    guint32 num = 0;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = open_capture(path);
+    fidx = frame_index_open(path, wth);
+    g_assert(fidx == NULL);
+
+    /* the file can still be read in full */
+    while (wtap_read(wth, &err, &err_info, &data_offset))
+        num++;
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(num, ==, NUM_PACKETS);
+    wtap_close(wth);
+}
+
+static void
+test_file_type(int file_type_subtype)
+{
+    gchar *path;
+    gchar *index_path;
+    gchar *good;
+    gsize len;
+    gint64 off;
+    guint32 val;
+
+    path = write_capture(file_type_subtype);
+    index_path = write_index(path);
+    check_index(path);
+
+    g_assert(g_file_get_contents(index_path, &good, &len, NULL));
+
+    /* a captured length past the packet length */
+    memcpy(&val, good + rec_field(len, 1, REC_CAP_LEN), sizeof val);
+    val++;
+    tamper_index(index_path, 1, REC_CAP_LEN, &val, sizeof val);
+    check_rejected(path);
+
+    /* frames out of order */
+    g_assert(g_file_set_contents(index_path, good, len, NULL));
+    memcpy(&off, good + rec_field(len, 1, REC_FILE_OFF), sizeof off);
+    tamper_index(index_path, 2, REC_FILE_OFF, &off, sizeof off);
+    check_rejected(path);
+
+    /* a shorter, but otherwise plausible, last frame */
+    g_assert(g_file_set_contents(index_path, good, len, NULL));
+    memcpy(&val, good + rec_field(len, NUM_PACKETS, REC_CAP_LEN), sizeof val);
+    val--;
+    tamper_index(index_path, NUM_PACKETS, REC_CAP_LEN, &val, sizeof val);
+    check_rejected(path);
+
+    /* and the untouched index is still good */
+    g_assert(g_file_set_contents(index_path, good, len, NULL));
+    check_index(path);
+
+    g_free(good);
+    ws_unlink(index_path);
+    ws_unlink(path);
+    g_free(index_path);
+    g_free(path);
+}
+
+static void
+frame_index_test_pcap(void)
+{
+    test_file_type(WTAP_FILE_TYPE_SUBTYPE_PCAP);
+}
+
+static void
+frame_index_test_pcapng(void)
+{
+    test_file_type(WTAP_FILE_TYPE_SUBTYPE_PCAPNG);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/frame_index/pcap", frame_index_test_pcap);
+    g_test_add_func("/frame_index/pcapng", frame_index_test_pcapng);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
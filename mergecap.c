@@ -34,6 +34,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
@@ -47,6 +51,7 @@
 
 #include <wsutil/strnatcmp.h>
 #include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
 
 #include <wiretap/merge.h>
 #include <wiretap/pcap-encap.h>
@@ -57,6 +62,8 @@
 #include <fcntl.h>
 #endif
 
+#define LONGOPT_COMPRESS 1   /* --compress; not a valid option character */
+
 #ifdef _WIN32
 #include <wsutil/unicode-utils.h>
 #endif /* _WIN32 */
@@ -135,6 +142,10 @@ usage(gboolean is_error)
   fprintf(output, "  -T <encap type>   set the output file encapsulation type;\n");
   fprintf(output, "                    default is the same as the first input file.\n");
   fprintf(output, "                    an empty \"-T\" option will list the encapsulation types.\n");
+  fprintf(output, "  -M <max files>    keep at most <max files> input files open; merge\n");
+  fprintf(output, "                    larger sets in passes through temporary files.\n");
+  fprintf(output, "  --compress <type> compress the output file as it's written;\n");
+  fprintf(output, "                    <type> is gzip, zstd or lz4, if supported.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
@@ -208,6 +219,361 @@ list_encap_types(void) {
   g_free(encaps);
 }
 
+static void
+list_compression_types(void) {
+  GSList *names, *name;
+
+  names = wtap_get_all_compression_type_names_list();
+  fprintf(stderr, "mergecap: The available compression types for the \"--compress\" option are:\n");
+  for (name = names; name != NULL; name = g_slist_next(name))
+    fprintf(stderr, "    %s\n", (const char *)name->data);
+  g_slist_free(names);
+}
+
+/*
+ * Build the interface description for a pcapng output file.  If any of
+ * the input files has better than microsecond time stamp resolution, we
+ * need an IDB with that resolution; otherwise the default one will do.
+ */
+static wtapng_iface_descriptions_t *
+create_idb_info(int in_file_count, merge_in_file_t in_files[],
+                int frame_type, guint snaplen)
+{
+  wtapng_iface_descriptions_t *idb_inf = NULL, *idb_inf_merge_file;
+  wtapng_if_descr_t int_data, *file_int_data;
+  guint8 if_tsresol = 6;
+  guint64 time_units_per_second = 1000000;
+  int i;
+
+  for (i = 0; i < in_file_count; i++) {
+    idb_inf_merge_file = wtap_file_get_idb_info(in_files[i].wth);
+    file_int_data = &g_array_index (idb_inf_merge_file->interface_data, wtapng_if_descr_t, 0);
+    if (file_int_data->time_units_per_second > time_units_per_second) {
+      time_units_per_second = file_int_data->time_units_per_second;
+      if_tsresol = file_int_data->if_tsresol;
+    }
+    g_free(idb_inf_merge_file);
+  }
+  if (time_units_per_second > 1000000) {
+    /* We are using a better than microsecond precision; let's create a fake IDB */
+    idb_inf = g_new(wtapng_iface_descriptions_t,1);
+    idb_inf->interface_data = g_array_new(FALSE, FALSE, sizeof(wtapng_if_descr_t));
+    int_data.wtap_encap            = frame_type;
+    int_data.time_units_per_second = time_units_per_second;
+    int_data.link_type             = wtap_wtap_encap_to_pcap_encap(frame_type);
+    int_data.snap_len              = snaplen;
+    int_data.if_name               = g_strdup("Unknown/not available in original file format(libpcap)");
+    int_data.opt_comment           = NULL;
+    int_data.if_description        = NULL;
+    int_data.if_speed              = 0;
+    int_data.if_tsresol            = if_tsresol;
+    int_data.if_filter_str         = NULL;
+    int_data.bpf_filter_len        = 0;
+    int_data.if_filter_bpf_bytes   = NULL;
+    int_data.if_os                 = NULL;
+    int_data.if_fcslen             = -1;
+    int_data.num_stat_entries      = 0;          /* Number of ISB:s */
+    int_data.interface_statistics  = NULL;
+    g_array_append_val(idb_inf->interface_data, int_data);
+  }
+  return idb_inf;
+}
+
+/*
+ * Open the output file on out_fd, compressing it with compression_type.
+ * For pcapng, the section header comment lists comment_names.
+ */
+static wtap_dumper *
+open_output(int out_fd, int file_type, int frame_type, guint snaplen,
+            wtap_compression_type compression_type,
+            int in_file_count, merge_in_file_t in_files[],
+            int comment_count, char *const *comment_names, int *open_err)
+{
+  wtap_dumper *pdh;
+  int i;
+
+  if(file_type == WTAP_FILE_TYPE_SUBTYPE_PCAPNG ){
+    wtapng_section_t *shb_hdr;
+    GString *comment_gstr;
+
+    shb_hdr = g_new(wtapng_section_t,1);
+    comment_gstr = g_string_new("File created by merging: \n");
+
+    for (i = 0; i < comment_count; i++) {
+      g_string_append_printf(comment_gstr, "File%d: %s \n",i+1,comment_names[i]);
+    }
+    shb_hdr->section_length = -1;
+    /* options */
+    shb_hdr->opt_comment   = comment_gstr->str; /* NULL if not available */
+    shb_hdr->shb_hardware  = NULL;              /* NULL if not available, UTF-8 string containing the description of the hardware used to create this section. */
+    shb_hdr->shb_os        = NULL;              /* NULL if not available, UTF-8 string containing the name of the operating system used to create this section. */
+    shb_hdr->shb_user_appl = "mergecap";        /* NULL if not available, UTF-8 string containing the name of the application used to create this section. */
+
+    pdh = wtap_dump_fdopen_ng(out_fd, file_type, frame_type, snaplen,
+                              compression_type, shb_hdr,
+                              create_idb_info(in_file_count, in_files, frame_type, snaplen),
+                              open_err);
+    g_string_free(comment_gstr, TRUE);
+  } else {
+    pdh = wtap_dump_fdopen(out_fd, file_type, frame_type, snaplen, compression_type, open_err);
+  }
+  return pdh;
+}
+
+static void
+report_open_error(const char *filename, int open_err, gchar *err_info)
+{
+  fprintf(stderr, "mergecap: Can't open %s: %s\n", filename,
+          wtap_strerror(open_err));
+  switch (open_err) {
+
+  case WTAP_ERR_UNSUPPORTED:
+  case WTAP_ERR_UNSUPPORTED_ENCAP:
+  case WTAP_ERR_BAD_FILE:
+    fprintf(stderr, "(%s)\n", err_info);
+    g_free(err_info);
+    break;
+  }
+}
+
+/*
+ * Merge (or append) the packets from the input files, writing them to pdh.
+ * Returns TRUE on success.  On a read error, *got_read_error is set; on a
+ * write error, *got_write_error is set, and *in_file points to the file
+ * whose packet we couldn't write.
+ */
+static gboolean
+merge_packets(wtap_dumper *pdh, int in_file_count, merge_in_file_t in_files[],
+              gboolean do_append, guint snaplen, gboolean verbose, int *count,
+              merge_in_file_t **in_file, int *read_err, gchar **err_info,
+              gboolean *got_read_error, int *write_err, gboolean *got_write_error)
+{
+  struct wtap_pkthdr *phdr, snap_phdr;
+
+  for (;;) {
+    if (do_append)
+      *in_file = merge_append_read_packet(in_file_count, in_files, read_err,
+                                          err_info);
+    else
+      *in_file = merge_read_packet(in_file_count, in_files, read_err,
+                                   err_info);
+    if (*in_file == NULL) {
+      /* EOF */
+      break;
+    }
+
+    if (*read_err != 0) {
+      /* I/O error reading from in_file */
+      *got_read_error = TRUE;
+      break;
+    }
+
+    if (verbose)
+      fprintf(stderr, "Record: %u\n", (*count)++);
+
+    /* We simply write it, perhaps after truncating it; we could do other
+     * things, like modify it. */
+    phdr = wtap_phdr((*in_file)->wth);
+    if (snaplen != 0 && phdr->caplen > snaplen) {
+      snap_phdr = *phdr;
+      snap_phdr.caplen = snaplen;
+      phdr = &snap_phdr;
+    }
+
+    if (!wtap_dump(pdh, phdr, wtap_buf_ptr((*in_file)->wth), write_err)) {
+      *got_write_error = TRUE;
+      break;
+    }
+  }
+  return !*got_read_error && !*got_write_error;
+}
+
+static void
+report_read_error(int in_file_count, merge_in_file_t in_files[], int read_err,
+                  gchar *err_info)
+{
+  int i;
+
+  /*
+   * Find the file on which we got the error, and report the error.
+   */
+  for (i = 0; i < in_file_count; i++) {
+    if (in_files[i].state == GOT_ERROR) {
+      fprintf(stderr, "mergecap: Error reading %s: %s\n",
+              in_files[i].filename, wtap_strerror(read_err));
+      switch (read_err) {
+
+      case WTAP_ERR_UNSUPPORTED:
+      case WTAP_ERR_UNSUPPORTED_ENCAP:
+      case WTAP_ERR_BAD_FILE:
+        fprintf(stderr, "(%s)\n", err_info);
+        g_free(err_info);
+        break;
+      }
+    }
+  }
+}
+
+static void
+report_write_error(int write_err, merge_in_file_t *in_file, int file_type)
+{
+  switch (write_err) {
+
+  case WTAP_ERR_UNSUPPORTED_ENCAP:
+    /*
+     * This is a problem with the particular frame we're writing and
+     * the file type and subtype we're wwriting; note that, and
+     * report the frame number and file type/subtype.
+     */
+    fprintf(stderr, "mergecap: Frame %u of \"%s\" has a network type that can't be saved in a \"%s\" file.\n",
+            in_file ? in_file->packet_num : 0, in_file ? in_file->filename : "UNKNOWN",
+            wtap_file_type_subtype_string(file_type));
+    break;
+
+  case WTAP_ERR_PACKET_TOO_LARGE:
+    /*
+     * This is a problem with the particular frame we're writing and
+     * the file type and subtype we're wwriting; note that, and
+     * report the frame number and file type/subtype.
+     */
+    fprintf(stderr, "mergecap: Frame %u of \"%s\" is too large for a \"%s\" file\n.",
+            in_file ? in_file->packet_num : 0, in_file ? in_file->filename : "UNKNOWN",
+            wtap_file_type_subtype_string(file_type));
+    break;
+
+  default:
+    fprintf(stderr, "mergecap: Error writing to outfile: %s\n",
+            wtap_strerror(write_err));
+    break;
+  }
+}
+
+static void
+remove_temp_files(int count, char **names)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if (names[i] != NULL) {
+      ws_unlink(names[i]);
+      g_free(names[i]);
+    }
+  }
+  g_free(names);
+}
+
+/*
+ * Merge the input files in groups of at most max_open_files into
+ * temporary files of the output file type, and then the temporary files
+ * in groups again, until there are no more than max_open_files files
+ * left.  Returns the names of those files, to be removed with
+ * remove_temp_files(), or NULL on error.
+ */
+static char **
+merge_in_batches(int in_file_count, char *const *in_file_names,
+                 int max_open_files, gboolean do_append, int file_type,
+                 int frame_type_opt, guint snaplen_opt, gboolean verbose,
+                 int *out_file_count)
+{
+  char **names = NULL, **next_names = NULL;
+  int count = in_file_count, next_count = 0;
+  int batch, first, n;
+  merge_in_file_t *in_files, *in_file = NULL;
+  wtap_dumper *pdh;
+  int open_err, read_err = 0, write_err, close_err;
+  gchar *err_info;
+  int err_fileno;
+  int frame_type;
+  guint snaplen;
+  char *tmpname;
+  int out_fd;
+  int record_count = 1;
+  gboolean got_read_error, got_write_error;
+
+  while (count > max_open_files) {
+    next_count = (count + max_open_files - 1) / max_open_files;
+    next_names = g_new0(char *, next_count);
+
+    for (batch = 0; batch < next_count; batch++) {
+      first = batch * max_open_files;
+      n = MIN(max_open_files, count - first);
+
+      if (!merge_open_in_files(n, names ? &names[first] : &in_file_names[first],
+                               &in_files, &open_err, &err_info, &err_fileno)) {
+        report_open_error(names ? names[first + err_fileno] : in_file_names[first + err_fileno],
+                          open_err, err_info);
+        g_free(in_files);
+        goto fail;
+      }
+
+      frame_type = frame_type_opt != -2 ? frame_type_opt :
+                   merge_select_frame_type(n, in_files);
+      snaplen = snaplen_opt != 0 ? snaplen_opt :
+                (guint)merge_max_snapshot_length(n, in_files);
+
+      out_fd = create_tempfile(&tmpname, "mergecap");
+      if (out_fd == -1) {
+        fprintf(stderr, "mergecap: Couldn't create temporary file: %s\n",
+                g_strerror(errno));
+        merge_close_in_files(n, in_files);
+        g_free(in_files);
+        goto fail;
+      }
+      next_names[batch] = g_strdup(tmpname);
+
+      if (verbose)
+        fprintf(stderr, "mergecap: merging %d files into %s\n", n, tmpname);
+
+      pdh = open_output(out_fd, file_type, frame_type, snaplen,
+                        WTAP_UNCOMPRESSED, n, in_files,
+                        n, names ? &names[first] : &in_file_names[first],
+                        &open_err);
+      if (pdh == NULL) {
+        ws_close(out_fd);
+        merge_close_in_files(n, in_files);
+        g_free(in_files);
+        fprintf(stderr, "mergecap: Can't open or create %s: %s\n", tmpname,
+                wtap_strerror(open_err));
+        goto fail;
+      }
+
+      got_read_error = FALSE;
+      got_write_error = FALSE;
+      merge_packets(pdh, n, in_files, do_append, snaplen_opt, verbose, &record_count,
+                    &in_file, &read_err, &err_info, &got_read_error,
+                    &write_err, &got_write_error);
+      merge_close_in_files(n, in_files);
+      if (!got_write_error) {
+        if (!wtap_dump_close(pdh, &write_err))
+          got_write_error = TRUE;
+      } else
+        (void)wtap_dump_close(pdh, &close_err);
+
+      if (got_read_error)
+        report_read_error(n, in_files, read_err, err_info);
+      if (got_write_error)
+        report_write_error(write_err, in_file, file_type);
+      g_free(in_files);
+      if (got_read_error || got_write_error)
+        goto fail;
+    }
+
+    if (names)
+      remove_temp_files(count, names);
+    names = next_names;
+    count = next_count;
+  }
+
+  *out_file_count = count;
+  return names;
+
+fail:
+  remove_temp_files(next_count, next_names);
+  if (names)
+    remove_temp_files(count, names);
+  return NULL;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -215,6 +581,9 @@ main(int argc, char *argv[])
   gboolean            do_append          = FALSE;
   gboolean            verbose            = FALSE;
   int                 in_file_count      = 0;
+  char *const        *in_file_names;
+  char              **temp_file_names    = NULL;
+  int                 max_open_files     = 0;
   guint               snaplen            = 0;
 #ifdef PCAP_NG_DEFAULT
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAPNG; /* default to pcap format */
@@ -222,10 +591,10 @@ main(int argc, char *argv[])
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcapng format */
 #endif
   int                 frame_type         = -2;
+  wtap_compression_type compression_type = WTAP_UNCOMPRESSED;
   int                 out_fd;
-  merge_in_file_t    *in_files           = NULL, *in_file;
+  merge_in_file_t    *in_files           = NULL, *in_file = NULL;
   int                 i;
-  struct wtap_pkthdr *phdr, snap_phdr;
   wtap_dumper        *pdh;
   int                 open_err, read_err = 0, write_err, close_err;
   gchar              *err_info;
@@ -233,6 +602,10 @@ main(int argc, char *argv[])
   char               *out_filename       = NULL;
   gboolean            got_read_error     = FALSE, got_write_error = FALSE;
   int                 count;
+  static const struct option long_options[] = {
+    {(char *)"compress", required_argument, NULL, LONGOPT_COMPRESS },
+    {0, 0, 0, 0 }
+  };
 
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
@@ -240,9 +613,19 @@ main(int argc, char *argv[])
 #endif /* _WIN32 */
 
   /* Process the options first */
-  while ((opt = getopt(argc, argv, "aF:hs:T:vw:")) != -1) {
+  while ((opt = getopt_long(argc, argv, "aF:hM:s:T:vw:", long_options, NULL)) != -1) {
 
     switch (opt) {
+    case LONGOPT_COMPRESS:
+      compression_type = wtap_name_to_compression_type(optarg);
+      if (compression_type == WTAP_UNKNOWN_COMPRESSION) {
+        fprintf(stderr, "mergecap: \"%s\" isn't a valid compression type\n",
+                optarg);
+        list_compression_types();
+        exit(1);
+      }
+      break;
+
     case 'a':
       do_append = !do_append;
       break;
@@ -262,6 +645,14 @@ main(int argc, char *argv[])
       exit(0);
       break;
 
+    case 'M':
+      max_open_files = get_positive_int(optarg, "maximum number of open files");
+      if (max_open_files < 2) {
+        fprintf(stderr, "mergecap: The maximum number of open files must be at least 2\n");
+        exit(1);
+      }
+      break;
+
     case 's':
       snaplen = get_positive_int(optarg, "snapshot length");
       break;
@@ -313,27 +704,34 @@ main(int argc, char *argv[])
     fprintf(stderr, "mergecap: No input files were specified\n");
     return 1;
   }
+  in_file_names = &argv[optind];
+
+  if (max_open_files != 0 && in_file_count > max_open_files) {
+    /*
+     * Too many files to have open at once; merge them in batches into
+     * temporary files first, and merge those into the output file.
+     */
+    temp_file_names = merge_in_batches(in_file_count, in_file_names,
+                                       max_open_files, do_append, file_type,
+                                       frame_type, snaplen, verbose,
+                                       &in_file_count);
+    if (temp_file_names == NULL)
+      return 2;
+    in_file_names = temp_file_names;
+  }
 
   /* open the input files */
-  if (!merge_open_in_files(in_file_count, &argv[optind], &in_files,
+  if (!merge_open_in_files(in_file_count, in_file_names, &in_files,
                            &open_err, &err_info, &err_fileno)) {
-    fprintf(stderr, "mergecap: Can't open %s: %s\n", argv[optind + err_fileno],
-            wtap_strerror(open_err));
-    switch (open_err) {
-
-    case WTAP_ERR_UNSUPPORTED:
-    case WTAP_ERR_UNSUPPORTED_ENCAP:
-    case WTAP_ERR_BAD_FILE:
-      fprintf(stderr, "(%s)\n", err_info);
-      g_free(err_info);
-      break;
-    }
+    report_open_error(in_file_names[err_fileno], open_err, err_info);
+    if (temp_file_names)
+      remove_temp_files(in_file_count, temp_file_names);
     return 2;
   }
 
   if (verbose) {
     for (i = 0; i < in_file_count; i++)
-      fprintf(stderr, "mergecap: %s is type %s.\n", argv[optind + i],
+      fprintf(stderr, "mergecap: %s is type %s.\n", in_file_names[i],
               wtap_file_type_subtype_string(wtap_file_type_subtype(in_files[i].wth)));
   }
 
@@ -392,73 +790,21 @@ main(int argc, char *argv[])
     if (out_fd == -1) {
       fprintf(stderr, "mergecap: Couldn't open output file %s: %s\n",
               out_filename, g_strerror(errno));
+      if (temp_file_names)
+        remove_temp_files(in_file_count, temp_file_names);
       exit(1);
     }
   }
 
-  /* prepare the outfile */
-  if(file_type == WTAP_FILE_TYPE_SUBTYPE_PCAPNG ){
-    wtapng_section_t *shb_hdr;
-    GString *comment_gstr;
-    wtapng_iface_descriptions_t *idb_inf = NULL, *idb_inf_merge_file;
-    wtapng_if_descr_t int_data, *file_int_data;
-    guint8 if_tsresol = 6;
-    guint64 time_units_per_second = 1000000;
-
-    shb_hdr = g_new(wtapng_section_t,1);
-    comment_gstr = g_string_new("File created by merging: \n");
-
-    for (i = 0; i < in_file_count; i++) {
-      g_string_append_printf(comment_gstr, "File%d: %s \n",i+1,in_files[i].filename);
-    }
-    shb_hdr->section_length = -1;
-    /* options */
-    shb_hdr->opt_comment   = comment_gstr->str; /* NULL if not available */
-    shb_hdr->shb_hardware  = NULL;              /* NULL if not available, UTF-8 string containing the description of the hardware used to create this section. */
-    shb_hdr->shb_os        = NULL;              /* NULL if not available, UTF-8 string containing the name of the operating system used to create this section. */
-    shb_hdr->shb_user_appl = "mergecap";        /* NULL if not available, UTF-8 string containing the name of the application used to create this section. */
-
-    for (i = 0; i < in_file_count; i++) {
-      idb_inf_merge_file = wtap_file_get_idb_info(in_files[i].wth);
-      file_int_data = &g_array_index (idb_inf_merge_file->interface_data, wtapng_if_descr_t, 0);
-      if (file_int_data->time_units_per_second > time_units_per_second) {
-        time_units_per_second = file_int_data->time_units_per_second;
-        if_tsresol = file_int_data->if_tsresol;
-      }
-      g_free(idb_inf_merge_file);
-    }
-    if (time_units_per_second > 1000000) {
-      /* We are using a better than microsecond precision; let's create a fake IDB */
-      idb_inf = g_new(wtapng_iface_descriptions_t,1);
-      idb_inf->interface_data = g_array_new(FALSE, FALSE, sizeof(wtapng_if_descr_t));
-      int_data.wtap_encap            = frame_type;
-      int_data.time_units_per_second = time_units_per_second;
-      int_data.link_type             = wtap_wtap_encap_to_pcap_encap(frame_type);
-      int_data.snap_len              = snaplen;
-      int_data.if_name               = g_strdup("Unknown/not available in original file format(libpcap)");
-      int_data.opt_comment           = NULL;
-      int_data.if_description        = NULL;
-      int_data.if_speed              = 0;
-      int_data.if_tsresol            = if_tsresol;
-      int_data.if_filter_str         = NULL;
-      int_data.bpf_filter_len        = 0;
-      int_data.if_filter_bpf_bytes   = NULL;
-      int_data.if_os                 = NULL;
-      int_data.if_fcslen             = -1;
-      int_data.num_stat_entries      = 0;          /* Number of ISB:s */
-      int_data.interface_statistics  = NULL;
-      g_array_append_val(idb_inf->interface_data, int_data);
-    }
-
-    pdh = wtap_dump_fdopen_ng(out_fd, file_type, frame_type, snaplen,
-                              FALSE /* compressed */, shb_hdr, idb_inf, &open_err);
-    g_string_free(comment_gstr, TRUE);
-  } else {
-    pdh = wtap_dump_fdopen(out_fd, file_type, frame_type, snaplen, FALSE /* compressed */, &open_err);
-  }
+  /* prepare the outfile; the section comment lists the original files */
+  pdh = open_output(out_fd, file_type, frame_type, snaplen,
+                    compression_type, in_file_count, in_files,
+                    argc - optind, &argv[optind], &open_err);
   if (pdh == NULL) {
     merge_close_in_files(in_file_count, in_files);
     g_free(in_files);
+    if (temp_file_names)
+      remove_temp_files(in_file_count, temp_file_names);
     fprintf(stderr, "mergecap: Can't open or create %s: %s\n", out_filename,
             wtap_strerror(open_err));
     exit(1);
@@ -466,41 +812,9 @@ main(int argc, char *argv[])
 
   /* do the merge (or append) */
   count = 1;
-  for (;;) {
-    if (do_append)
-      in_file = merge_append_read_packet(in_file_count, in_files, &read_err,
-                                         &err_info);
-    else
-      in_file = merge_read_packet(in_file_count, in_files, &read_err,
-                                  &err_info);
-    if (in_file == NULL) {
-      /* EOF */
-      break;
-    }
-
-    if (read_err != 0) {
-      /* I/O error reading from in_file */
-      got_read_error = TRUE;
-      break;
-    }
-
-    if (verbose)
-      fprintf(stderr, "Record: %u\n", count++);
-
-    /* We simply write it, perhaps after truncating it; we could do other
-     * things, like modify it. */
-    phdr = wtap_phdr(in_file->wth);
-    if (snaplen != 0 && phdr->caplen > snaplen) {
-      snap_phdr = *phdr;
-      snap_phdr.caplen = snaplen;
-      phdr = &snap_phdr;
-    }
-
-    if (!wtap_dump(pdh, phdr, wtap_buf_ptr(in_file->wth), &write_err)) {
-      got_write_error = TRUE;
-      break;
-    }
-  }
+  merge_packets(pdh, in_file_count, in_files, do_append, snaplen, verbose,
+                &count, &in_file, &read_err, &err_info, &got_read_error,
+                &write_err, &got_write_error);
 
   merge_close_in_files(in_file_count, in_files);
   if (!got_write_error) {
@@ -516,60 +830,15 @@ main(int argc, char *argv[])
     (void)wtap_dump_close(pdh, &close_err);
   }
 
-  if (got_read_error) {
-    /*
-     * Find the file on which we got the error, and report the error.
-     */
-    for (i = 0; i < in_file_count; i++) {
-      if (in_files[i].state == GOT_ERROR) {
-        fprintf(stderr, "mergecap: Error reading %s: %s\n",
-                in_files[i].filename, wtap_strerror(read_err));
-        switch (read_err) {
-
-        case WTAP_ERR_UNSUPPORTED:
-        case WTAP_ERR_UNSUPPORTED_ENCAP:
-        case WTAP_ERR_BAD_FILE:
-          fprintf(stderr, "(%s)\n", err_info);
-          g_free(err_info);
-          break;
-        }
-      }
-    }
-  }
-
-  if (got_write_error) {
-    switch (write_err) {
-
-    case WTAP_ERR_UNSUPPORTED_ENCAP:
-      /*
-       * This is a problem with the particular frame we're writing and
-       * the file type and subtype we're wwriting; note that, and
-       * report the frame number and file type/subtype.
-       */
-      fprintf(stderr, "mergecap: Frame %u of \"%s\" has a network type that can't be saved in a \"%s\" file.\n",
-              in_file ? in_file->packet_num : 0, in_file ? in_file->filename : "UNKNOWN",
-              wtap_file_type_subtype_string(file_type));
-      break;
-
-    case WTAP_ERR_PACKET_TOO_LARGE:
-      /*
-       * This is a problem with the particular frame we're writing and
-       * the file type and subtype we're wwriting; note that, and
-       * report the frame number and file type/subtype.
-       */
-      fprintf(stderr, "mergecap: Frame %u of \"%s\" is too large for a \"%s\" file\n.",
-              in_file ? in_file->packet_num : 0, in_file ? in_file->filename : "UNKNOWN",
-              wtap_file_type_subtype_string(file_type));
-      break;
+  if (got_read_error)
+    report_read_error(in_file_count, in_files, read_err, err_info);
 
-    default:
-      fprintf(stderr, "mergecap: Error writing to outfile: %s\n",
-              wtap_strerror(write_err));
-      break;
-    }
-  }
+  if (got_write_error)
+    report_write_error(write_err, in_file, file_type);
 
   g_free(in_files);
+  if (temp_file_names)
+    remove_temp_files(in_file_count, temp_file_names);
 
   return (!got_read_error && !got_write_error) ? 0 : 2;
 }
@@ -543,6 +543,36 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
                 return FALSE;
         if (!write_to_file(pfile, pd, caplen, bytes_written, err))
                 return FALSE;
+        if (comment == NULL) {
+                /* This is what dumpcap writes for every packet, so
+                   assemble the padding, options and trailer and hand
+                   them to stdio in one go rather than field by field. */
+                guint8 tail[3 + sizeof(struct option) + sizeof(guint32) +
+                            sizeof(struct option) + sizeof(guint32)];
+                size_t tail_length = 0;
+
+                if (caplen % 4) {
+                        memset(tail, 0, 4 - caplen % 4);
+                        tail_length += 4 - caplen % 4;
+                }
+                if (flags != 0) {
+                        option.type = EPB_FLAGS;
+                        option.value_length = sizeof(guint32);
+                        memcpy(tail + tail_length, &option, sizeof(struct option));
+                        tail_length += sizeof(struct option);
+                        memcpy(tail + tail_length, &flags, sizeof(guint32));
+                        tail_length += sizeof(guint32);
+                }
+                if (options_length != 0) {
+                        option.type = OPT_ENDOFOPT;
+                        option.value_length = 0;
+                        memcpy(tail + tail_length, &option, sizeof(struct option));
+                        tail_length += sizeof(struct option);
+                }
+                memcpy(tail + tail_length, &block_total_length, sizeof(guint32));
+                tail_length += sizeof(guint32);
+                return write_to_file(pfile, tail, tail_length, bytes_written, err);
+        }
         if (caplen % 4) {
                 if (!write_to_file(pfile, (const guint8*)&padding, 4 - caplen % 4, bytes_written, err))
                         return FALSE;
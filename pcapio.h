@@ -23,6 +23,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+/** Size of the stdio buffer callers should give the streams they write
+   capture files to (with setvbuf()), so records reach the file system
+   in large writes rather than BUFSIZ-sized ones. */
+#define PCAPIO_WRITE_BUFFER_SIZE (1024 * 1024)
+
 /* Writing pcap files */
 
 /** Write the file header to a dump file.
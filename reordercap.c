@@ -229,7 +229,7 @@ int main(int argc, char *argv[])
 
     /* Open outfile (same filetype/encap as input file) */
     pdh = wtap_dump_open_ng(outfile, wtap_file_type_subtype(wth), wtap_file_encap(wth),
-                            65535, FALSE, shb_hdr, idb_inf, &err);
+                            65535, WTAP_UNCOMPRESSED, shb_hdr, idb_inf, &err);
     g_free(idb_inf);
     if (pdh == NULL) {
         fprintf(stderr, "reordercap: Failed to open output file: (%s) - error %s\n",
@@ -38,10 +38,19 @@
  * the files at switch and not the capture stop, and by closing them which
  * makes possible their move or deletion after a switch).
  *
+ * Completed files can also be compressed, as a series of independent
+ * Zstandard or LZ4 frames that Wireshark can seek in.  That's done by a
+ * separate thread, so the capture isn't held up by the compressor; the
+ * file currently being written always stays uncompressed.
+ *
  */
 
 #include "config.h"
 
+#ifdef __linux__
+#define _GNU_SOURCE /* Otherwise fallocate() won't be declared on Linux */
+#endif
+
 #ifdef HAVE_LIBPCAP
 
 #ifdef HAVE_FCNTL_H
@@ -62,14 +71,23 @@
 #include <glib.h>
 
 #include "ringbuffer.h"
+#include "pcapio.h"
 #include <wsutil/file_util.h>
+#include <wsutil/ws_compress.h>
 
 
 /* Ringbuffer file structure */
 typedef struct _rb_file {
   gchar		*name;
+  guint		compress_job;	/* Compression job for this file, or 0 */
 } rb_file;
 
+/* A completed file for the compression thread; a NULL name stops it */
+typedef struct _rb_compress_job {
+  gchar        *name;
+  guint         seq;
+} rb_compress_job;
+
 /* Ringbuffer data structure */
 typedef struct _ringbuf_data {
   rb_file      *files;
@@ -81,12 +99,215 @@ typedef struct _ringbuf_data {
 
   int           fd;		     /* Current ringbuffer file descriptor */
   FILE         *pdh;
+  char         *pdh_buf;             /* stdio buffer for pdh, reused across files */
   gboolean      group_read_access;   /* TRUE if files need to be opened with group read access */
+  guint64       file_prealloc;       /* Bytes to reserve for each file, or 0 */
+
+  ws_compress_type compress_type;    /* Compression of completed files, or WS_COMPRESS_NONE */
+  GThread      *compress_thread;
+  GAsyncQueue  *compress_q;          /* Jobs for the compression thread */
+  GAsyncQueue  *compress_done_q;     /* Sequence numbers of finished jobs */
+  guint         compress_queued;     /* Sequence number of the last job queued */
+  guint         compress_done;       /* Sequence number of the last job known to be finished */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
 
 
+static gchar *
+ringbuf_compressed_name(const gchar *name)
+{
+  return g_strconcat(name,
+                     rb_data.compress_type == WS_COMPRESS_ZSTD ? ".zst" : ".lz4",
+                     NULL);
+}
+
+/*
+ * Compress a completed file, frame by frame, and remove the original.
+ * If anything goes wrong, the original is left alone and the partial
+ * compressed file is removed.
+ */
+static void
+ringbuf_compress_file(const gchar *name)
+{
+  gchar         *cname;
+  FILE          *in, *out = NULL;
+  int            out_fd;
+  ws_compressor *comp;
+  guint8        *ibuf = NULL, *obuf = NULL;
+  gsize          obuf_len, n, len;
+  GByteArray    *seek_table = NULL;
+  gboolean       ok = FALSE;
+
+  comp = ws_compressor_new(rb_data.compress_type);
+  if (comp == NULL)
+    return;
+  in = ws_fopen(name, "rb");
+  if (in == NULL) {
+    ws_compressor_free(comp);
+    return;
+  }
+  cname = ringbuf_compressed_name(name);
+  out_fd = ws_open(cname, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+                   rb_data.group_read_access ? 0640 : 0600);
+  if (out_fd == -1)
+    goto done;
+  out = ws_fdopen(out_fd, "wb");
+  if (out == NULL) {
+    ws_close(out_fd);
+    goto done;
+  }
+
+  obuf_len = ws_compressor_bound(comp, WS_COMPRESS_FRAME_SIZE);
+  ibuf = (guint8 *)g_try_malloc(WS_COMPRESS_FRAME_SIZE);
+  obuf = (guint8 *)g_try_malloc(obuf_len);
+  if (ibuf == NULL || obuf == NULL)
+    goto done;
+  if (rb_data.compress_type == WS_COMPRESS_ZSTD)
+    seek_table = g_byte_array_new();
+
+  while ((n = fread(ibuf, 1, WS_COMPRESS_FRAME_SIZE, in)) != 0) {
+    len = ws_compressor_frame(comp, obuf, obuf_len, ibuf, n);
+    if (len == 0 || fwrite(obuf, 1, len, out) != len)
+      goto done;
+    if (seek_table != NULL)
+      ws_compress_seek_table_add(seek_table, (guint32)len, (guint32)n);
+  }
+  if (ferror(in))
+    goto done;
+  if (seek_table != NULL) {
+    ws_compress_seek_table_finish(seek_table);
+    if (fwrite(seek_table->data, 1, seek_table->len, out) != seek_table->len)
+      goto done;
+  }
+  ok = (fclose(out) == 0);
+  out = NULL;
+
+done:
+  if (out != NULL)
+    fclose(out);
+  fclose(in);
+  if (ok) {
+    ws_unlink(name);
+  } else {
+    ws_unlink(cname);
+  }
+  if (seek_table != NULL)
+    g_byte_array_free(seek_table, TRUE);
+  g_free(ibuf);
+  g_free(obuf);
+  g_free(cname);
+  ws_compressor_free(comp);
+}
+
+static gpointer
+ringbuf_compress_thread(gpointer data _U_)
+{
+  rb_compress_job *job;
+  guint            seq;
+
+  for (;;) {
+    job = (rb_compress_job *)g_async_queue_pop(rb_data.compress_q);
+    if (job->name == NULL) {
+      g_free(job);
+      break;
+    }
+    ringbuf_compress_file(job->name);
+    seq = job->seq;
+    g_free(job->name);
+    g_free(job);
+    g_async_queue_push(rb_data.compress_done_q, GUINT_TO_POINTER(seq));
+  }
+  return NULL;
+}
+
+/*
+ * Hand a closed file to the compression thread
+ */
+static void
+ringbuf_compress_queue(rb_file *rfile)
+{
+  rb_compress_job *job;
+  gpointer         done;
+
+  if (rb_data.compress_thread == NULL) {
+    rb_data.compress_q = g_async_queue_new();
+    rb_data.compress_done_q = g_async_queue_new();
+#if GLIB_CHECK_VERSION(2,31,0)
+    rb_data.compress_thread = g_thread_new("ringbuf_compress",
+                                           &ringbuf_compress_thread, NULL);
+#else
+    rb_data.compress_thread = g_thread_create(&ringbuf_compress_thread,
+                                              NULL, TRUE, NULL);
+#endif
+  }
+
+  /* keep the finished queue short when nothing ever waits on it */
+  while ((done = g_async_queue_try_pop(rb_data.compress_done_q)) != NULL) {
+    rb_data.compress_done = GPOINTER_TO_UINT(done);
+  }
+
+  job = g_new(rb_compress_job, 1);
+  job->name = g_strdup(rfile->name);
+  job->seq = ++rb_data.compress_queued;
+  rfile->compress_job = job->seq;
+  g_async_queue_push(rb_data.compress_q, job);
+}
+
+/*
+ * Wait until a compression job has finished; jobs finish in order
+ */
+static void
+ringbuf_compress_wait(guint seq)
+{
+  while (rb_data.compress_done < seq) {
+    rb_data.compress_done =
+        GPOINTER_TO_UINT(g_async_queue_pop(rb_data.compress_done_q));
+  }
+}
+
+/*
+ * Let the compression thread finish what it has queued, and stop it
+ */
+static void
+ringbuf_compress_stop(void)
+{
+  rb_compress_job *job;
+
+  if (rb_data.compress_thread == NULL)
+    return;
+
+  job = g_new(rb_compress_job, 1);
+  job->name = NULL;
+  job->seq = 0;
+  g_async_queue_push(rb_data.compress_q, job);
+  g_thread_join(rb_data.compress_thread);
+  rb_data.compress_thread = NULL;
+  rb_data.compress_done = rb_data.compress_queued;
+
+  g_async_queue_unref(rb_data.compress_q);
+  rb_data.compress_q = NULL;
+  g_async_queue_unref(rb_data.compress_done_q);
+  rb_data.compress_done_q = NULL;
+}
+
+/*
+ * Remove a ringbuffer file, compressed or not (ignoring errors)
+ */
+static void
+ringbuf_unlink_file(rb_file *rfile)
+{
+  gchar *cname;
+
+  ws_unlink(rfile->name);
+  if (rfile->compress_job != 0) {
+    cname = ringbuf_compressed_name(rfile->name);
+    ws_unlink(cname);
+    g_free(cname);
+  }
+}
+
+
 /*
  * create the next filename and open a new binary file with that name
  */
@@ -98,11 +319,14 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
 
   if (rfile->name != NULL) {
     if (rb_data.unlimited == FALSE) {
-      /* remove old file (if any, so ignore error) */
-      ws_unlink(rfile->name);
+      /* remove old file (if any, so ignore error), once it's no
+         longer being compressed */
+      ringbuf_compress_wait(rfile->compress_job);
+      ringbuf_unlink_file(rfile);
     }
     g_free(rfile->name);
   }
+  rfile->compress_job = 0;
 
 #ifdef _WIN32
   _tzset();
@@ -127,14 +351,57 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
     *err = errno;
   }
 
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  /*
+   * Reserve the blocks the file is expected to grow to, so a busy
+   * capture doesn't fragment it or stall on block allocation.  The
+   * file size is left alone, so readers never see the reservation;
+   * it's only a hint, so ignore filesystems that don't support it.
+   */
+  if (rb_data.fd != -1 && rb_data.file_prealloc != 0) {
+    (void) fallocate(rb_data.fd, FALLOC_FL_KEEP_SIZE, 0,
+                     (off_t)rb_data.file_prealloc);
+  }
+#endif
+
   return rb_data.fd;
 }
 
+/*
+ * Give back what's left of the reservation made in ringbuf_open_file()
+ * before the current file is closed; otherwise every file in the ring
+ * keeps taking up file_prealloc bytes on disk however little was
+ * written to it.  Truncating a file to its own size frees the blocks
+ * past its end; punching a hole there doesn't on all filesystems (ext4
+ * ignores holes past the end of the file).
+ */
+static void
+ringbuf_trim_prealloc(void)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+  ws_statb64 statb;
+
+  if (rb_data.pdh == NULL || rb_data.file_prealloc == 0)
+    return;
+
+  /* any error will be reported again by fclose() */
+  if (fflush(rb_data.pdh) == EOF || ws_fstat64(rb_data.fd, &statb) == -1)
+    return;
+
+  if ((guint64)statb.st_size < rb_data.file_prealloc) {
+    if (ftruncate(rb_data.fd, statb.st_size) == -1) {
+      /* the space is wasted until the file is removed, nothing worse */
+    }
+  }
+#endif
+}
+
 /*
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
+             guint64 file_prealloc, ws_compress_type compress_type)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -147,7 +414,15 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.unlimited = FALSE;
   rb_data.fd = -1;
   rb_data.pdh = NULL;
+  rb_data.pdh_buf = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.file_prealloc = file_prealloc;
+  rb_data.compress_type = compress_type;
+  rb_data.compress_thread = NULL;
+  rb_data.compress_q = NULL;
+  rb_data.compress_done_q = NULL;
+  rb_data.compress_queued = 0;
+  rb_data.compress_done = 0;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -206,6 +481,7 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
 
   for (i=0; i < rb_data.num_files; i++) {
     rb_data.files[i].name = NULL;
+    rb_data.files[i].compress_job = 0;
   }
 
   /* create the first file */
@@ -234,7 +510,14 @@ ringbuf_init_libpcap_fdopen(int *err)
     if (err != NULL) {
       *err = errno;
     }
+    return NULL;
   }
+
+  /* Only one file is open at a time, so they can all share a buffer */
+  if (rb_data.pdh_buf == NULL) {
+    rb_data.pdh_buf = (char *)g_malloc(PCAPIO_WRITE_BUFFER_SIZE);
+  }
+  setvbuf(rb_data.pdh, rb_data.pdh_buf, _IOFBF, PCAPIO_WRITE_BUFFER_SIZE);
   return rb_data.pdh;
 }
 
@@ -249,6 +532,7 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
 
   /* close current file */
 
+  ringbuf_trim_prealloc();
   if (fclose(rb_data.pdh) == EOF) {
     if (err != NULL) {
       *err = errno;
@@ -262,6 +546,10 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
   rb_data.pdh = NULL;
   rb_data.fd  = -1;
 
+  if (rb_data.compress_type != WS_COMPRESS_NONE) {
+    ringbuf_compress_queue(&rb_data.files[rb_data.curr_file_num % rb_data.num_files]);
+  }
+
   /* get the next file number and open it */
 
   rb_data.curr_file_num++ /* = next_file_num*/;
@@ -294,6 +582,7 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
 
   /* close current file, if it's open */
   if (rb_data.pdh != NULL) {
+    ringbuf_trim_prealloc();
     if (fclose(rb_data.pdh) == EOF) {
       if (err != NULL) {
         *err = errno;
@@ -304,6 +593,11 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
     rb_data.pdh = NULL;
     rb_data.fd  = -1;
   }
+  g_free(rb_data.pdh_buf);
+  rb_data.pdh_buf = NULL;
+
+  /* don't leave any file half compressed */
+  ringbuf_compress_stop();
 
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
@@ -318,6 +612,8 @@ ringbuf_free(void)
 {
   unsigned int i;
 
+  ringbuf_compress_stop();
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
@@ -336,6 +632,11 @@ ringbuf_free(void)
     g_free(rb_data.fsuffix);
     rb_data.fsuffix = NULL;
   }
+  /* the buffer may only go away once no stream uses it any more */
+  if (rb_data.pdh == NULL) {
+    g_free(rb_data.pdh_buf);
+    rb_data.pdh_buf = NULL;
+  }
 }
 
 /*
@@ -360,10 +661,12 @@ ringbuf_error_cleanup(void)
     rb_data.fd = -1;
   }
 
+  ringbuf_compress_stop();
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
-        ws_unlink(rb_data.files[i].name);
+        ringbuf_unlink_file(&rb_data.files[i]);
       }
     }
   }
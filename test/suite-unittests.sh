@@ -61,12 +61,42 @@ unittests_step_test() {
 }
 
 
+unittests_step_aho_corasick_test() {
+	DUT=$SOURCE_DIR/wsutil/aho_corasick_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
+unittests_step_file_wrappers_test() {
+	DUT=$SOURCE_DIR/wiretap/file_wrappers_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
+unittests_step_frame_index_test() {
+	DUT=$SOURCE_DIR/frame_index_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	DUT=$SOURCE_DIR/epan/exntest
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_conversation_test() {
+	DUT=$SOURCE_DIR/epan/conversation_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
+unittests_step_proto_data_test() {
+	DUT=$SOURCE_DIR/epan/proto_data_test
+	ARGS=--verbose
+	unittests_step_test
+}
+
 unittests_step_oids_test() {
 	DUT=$SOURCE_DIR/epan/oids_test
 	ARGS=
@@ -98,7 +128,12 @@ unittests_cleanup_step() {
 unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
+	test_step_add "aho_corasick_test" unittests_step_aho_corasick_test
+	test_step_add "file_wrappers_test" unittests_step_file_wrappers_test
+	test_step_add "frame_index_test" unittests_step_frame_index_test
 	test_step_add "exntest" unittests_step_exntest
+	test_step_add "conversation_test" unittests_step_conversation_test
+	test_step_add "proto_data_test" unittests_step_proto_data_test
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
@@ -24,6 +24,7 @@ from dftestlib import util
 # The binaries to use. We assume we are running
 # from the top of the wireshark distro
 TSHARK = os.path.join(".", "tshark")
+DFTEST = os.path.join(".", "dftest")
 
 class DFTest(unittest.TestCase):
     """Base class for all tests in this dfilter-test collection."""
@@ -31,6 +32,9 @@ class DFTest(unittest.TestCase):
     # Remove these file when finished (in tearDownClass)
     files_to_remove = []
 
+    # The directory that the trace file is in
+    trace_dir = os.path.join("tools", "dftestfiles")
+
     @classmethod
     def setUpClass(cls):
         """Create the trace file to be used in the tests."""
@@ -38,10 +42,9 @@ class DFTest(unittest.TestCase):
 
         # if the class sets the 'trace_file' field, then it
         # names the trace file to use for the tests. It *should*
-        # reside in dftestfiles
+        # reside in dftestfiles, or in the 'trace_dir' the class sets
         assert not os.path.isabs(cls.trace_file)
-        cls.trace_file = os.path.join(".", "tools", "dftestfiles",
-                cls.trace_file)
+        cls.trace_file = os.path.join(".", cls.trace_dir, cls.trace_file)
 
     @classmethod
     def tearDownClass(cls):
@@ -89,3 +92,79 @@ class DFTest(unittest.TestCase):
 
         # tshark must succeed
         self.assertNotEqual(status, util.SUCCESS, output)
+
+    def runDFilterFrames(self, dfilter):
+        """Run a display filter and return the numbers of the frames
+        that pass it."""
+
+        (status, output) = self.runDFilter(dfilter)
+
+        # tshark must succeed
+        self.assertEqual(status, util.SUCCESS, output)
+
+        # The first column of the summary lines is the frame number
+        return [int(L.split()[0]) for L in output.split("\n") if L != ""]
+
+    def runDFilterGroup(self, dfilters, disabled=()):
+        """Apply display filters to the trace file as one group, the way
+        the coloring rules are applied. The filters whose indexes are in
+        'disabled' are left out of the group. Returns a dictionary with
+        the index of the first filter that matches each frame, or None."""
+
+        cmdv = [DFTEST, "-r", self.trace_file]
+        for i, dfilter in enumerate(dfilters):
+            if i in disabled:
+                cmdv.append("-x")
+            cmdv.append(dfilter)
+
+        (status, output) = util.exec_cmdv(cmdv)
+
+        # dftest must succeed
+        self.assertEqual(status, util.SUCCESS, output)
+
+        # Each packet is reported as "<frame number> <index or ->"
+        matches = {}
+        for line in output.split("\n"):
+            fields = line.split()
+            if len(fields) != 2 or not fields[0].isdigit():
+                continue
+            if fields[1] == "-":
+                matches[int(fields[0])] = None
+            else:
+                matches[int(fields[0])] = int(fields[1])
+        return matches
+
+    def assertDFilterGroup(self, dfilters, disabled=()):
+        """Apply display filters as one group and expect each frame to
+        match the first enabled filter that it passes on its own.
+        Returns what the group matched, for further checks."""
+
+        matches = self.runDFilterGroup(dfilters, disabled)
+
+        # Every frame of the trace file has to be reported
+        self.assertEqual(sorted(matches.keys()),
+                self.runDFilterFrames("frame"))
+
+        expected = dict.fromkeys(matches.keys())
+        for i, dfilter in enumerate(dfilters):
+            if i in disabled:
+                continue
+            for frame in self.runDFilterFrames(dfilter):
+                if expected[frame] is None:
+                    expected[frame] = i
+
+        self.assertEqual(matches, expected)
+        return matches
+
+    def assertDFilterSame(self, dfilter, other_dfilter, expected_count):
+        """Run two display filters that are supposed to be equivalent, and
+        expect both to pass the same packets, and a certain number of them."""
+
+        frames = self.runDFilterFrames(dfilter)
+        other_frames = self.runDFilterFrames(other_dfilter)
+
+        msg = "\"%s\" and \"%s\" differ" % (dfilter, other_dfilter)
+        self.assertEqual(frames, other_frames, msg)
+
+        msg = "Expected %d, got: %s" % (expected_count, frames)
+        self.assertEqual(len(frames), expected_count, msg)
@@ -0,0 +1,182 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+import os
+
+from dftestlib import dftest
+
+# A relation between an integer, boolean or IPv4 field and a constant
+# is done by one instruction that reads the field_infos directly. With
+# the constant on the left, the same relation is done the generic way,
+# with the field's values loaded into a register; both have to agree.
+
+class testFieldCmpSigned(dftest.DFTest):
+    trace_file = "ntp.pcap"
+
+    # ntp.precision is an FT_INT8 that is -11 here
+
+    def test_eq(self):
+        self.assertDFilterSame("ntp.precision == -11",
+                "-11 == ntp.precision", 1)
+
+    def test_ne(self):
+        self.assertDFilterSame("ntp.precision != -11",
+                "-11 != ntp.precision", 0)
+
+    def test_lt(self):
+        self.assertDFilterSame("ntp.precision < 0",
+                "0 > ntp.precision", 1)
+
+    def test_gt(self):
+        self.assertDFilterSame("ntp.precision > -12",
+                "-12 < ntp.precision", 1)
+
+    def test_gt_unsigned(self):
+        # -11 read as an unsigned byte would be 245
+        self.assertDFilterSame("ntp.precision > 100",
+                "100 < ntp.precision", 0)
+
+    def test_ge(self):
+        self.assertDFilterSame("ntp.precision >= -11",
+                "-11 <= ntp.precision", 1)
+
+    def test_le(self):
+        self.assertDFilterSame("ntp.precision <= -12",
+                "-12 >= ntp.precision", 0)
+
+    def test_min(self):
+        self.assertDFilterSame("ntp.precision >= -128",
+                "-128 <= ntp.precision", 1)
+        self.assertDFilterSame("ntp.precision < -128",
+                "-128 > ntp.precision", 0)
+
+    def test_max(self):
+        self.assertDFilterSame("ntp.precision <= 127",
+                "127 >= ntp.precision", 1)
+        self.assertDFilterSame("ntp.precision > 127",
+                "127 < ntp.precision", 0)
+
+    def test_unsigned(self):
+        # ntp.ppoll is an FT_UINT8 that is 6 here
+        self.assertDFilterSame("ntp.ppoll == 6", "6 == ntp.ppoll", 1)
+        self.assertDFilterSame("ntp.ppoll <= 255", "255 >= ntp.ppoll", 1)
+        self.assertDFilterSame("ntp.ppoll > 255", "255 < ntp.ppoll", 0)
+        self.assertDFilterSame("ntp.ppoll >= 0", "0 <= ntp.ppoll", 1)
+
+    def test_bitwise_and(self):
+        # ntp.flags is 0x1b here
+        self.assertDFilterSame("ntp.flags & 0x03", "0x03 & ntp.flags", 1)
+        self.assertDFilterSame("ntp.flags & 0xc4", "0xc4 & ntp.flags", 0)
+
+class testFieldCmpMultiple(dftest.DFTest):
+    trace_dir = os.path.join("test", "captures")
+    trace_file = "dhcp.pcap"
+
+    # Packets 1 and 3 go from 0.0.0.0 to 255.255.255.255 with a TTL of
+    # 250, from port 68 to 67. Packets 2 and 4 go from 192.168.0.1 to
+    # 192.168.0.10 with a TTL of 128, from port 67 to 68.
+
+    def test_ipv4_eq(self):
+        self.assertDFilterSame("ip.addr == 0.0.0.0",
+                "0.0.0.0 == ip.addr", 2)
+        self.assertDFilterSame("ip.addr == 255.255.255.255",
+                "255.255.255.255 == ip.addr", 2)
+        self.assertDFilterSame("ip.src == 192.168.0.10",
+                "192.168.0.10 == ip.src", 0)
+
+    def test_ipv4_ne(self):
+        # Any of the addresses may differ
+        self.assertDFilterSame("ip.addr != 0.0.0.0",
+                "0.0.0.0 != ip.addr", 4)
+        self.assertDFilterSame("ip.src != 0.0.0.0",
+                "0.0.0.0 != ip.src", 2)
+
+    def test_ipv4_order(self):
+        self.assertDFilterSame("ip.addr > 192.168.0.5",
+                "192.168.0.5 < ip.addr", 4)
+        self.assertDFilterSame("ip.addr < 1.0.0.0",
+                "1.0.0.0 > ip.addr", 2)
+        self.assertDFilterSame("ip.dst >= 255.255.255.255",
+                "255.255.255.255 <= ip.dst", 2)
+        self.assertDFilterSame("ip.src <= 0.0.0.0",
+                "0.0.0.0 >= ip.src", 2)
+
+    def test_ipv4_cidr(self):
+        self.assertDFilterSame("ip.src == 192.168.0.0/24",
+                "192.168.0.0/24 == ip.src", 2)
+        self.assertDFilterSame("ip.dst == 192.168.0.0/16",
+                "192.168.0.0/16 == ip.dst", 2)
+        self.assertDFilterSame("ip.addr == 192.168.0.10/32",
+                "192.168.0.10/32 == ip.addr", 2)
+        self.assertDFilterSame("ip.addr == 0.0.0.0/0",
+                "0.0.0.0/0 == ip.addr", 4)
+        self.assertDFilterSame("ip.src == 255.0.0.0/8",
+                "255.0.0.0/8 == ip.src", 0)
+        self.assertDFilterSame("ip.addr != 192.168.0.0/24",
+                "192.168.0.0/24 != ip.addr", 2)
+
+    def test_uint8_boundaries(self):
+        self.assertDFilterSame("ip.ttl == 250", "250 == ip.ttl", 2)
+        self.assertDFilterSame("ip.ttl == 255", "255 == ip.ttl", 0)
+        self.assertDFilterSame("ip.ttl <= 255", "255 >= ip.ttl", 4)
+        self.assertDFilterSame("ip.ttl > 128", "128 < ip.ttl", 2)
+        self.assertDFilterSame("ip.ttl >= 128", "128 <= ip.ttl", 4)
+
+    def test_multiple_occurrences(self):
+        # udp.port is in each packet twice
+        self.assertDFilterSame("udp.port == 67", "67 == udp.port", 4)
+        self.assertDFilterSame("udp.port != 67", "67 != udp.port", 4)
+        self.assertDFilterSame("udp.port > 67", "67 < udp.port", 4)
+        self.assertDFilterSame("udp.port < 68", "68 > udp.port", 4)
+        self.assertDFilterSame("udp.port > 68", "68 < udp.port", 0)
+
+class testFieldCmpUINT16(dftest.DFTest):
+    trace_dir = os.path.join("test", "captures")
+    trace_file = "dns_port.pcap"
+
+    # The ports are 65282, 65333 and 65346
+
+    def test_boundaries(self):
+        self.assertDFilterSame("udp.port == 65333", "65333 == udp.port", 2)
+        self.assertDFilterSame("udp.port >= 65535", "65535 <= udp.port", 0)
+        self.assertDFilterSame("udp.port <= 65535", "65535 >= udp.port", 4)
+        self.assertDFilterSame("udp.srcport > 65300",
+                "65300 < udp.srcport", 2)
+
+class testFieldCmpBoolean(dftest.DFTest):
+    trace_dir = os.path.join("test", "captures")
+    trace_file = "rsasnakeoil2.pcap"
+
+    # Packets 1, 2, 22 and 23 of the 58 have SYN set
+
+    def test_eq(self):
+        self.assertDFilterSame("tcp.flags.syn == 1",
+                "1 == tcp.flags.syn", 4)
+        self.assertDFilterSame("tcp.flags.syn == 0",
+                "0 == tcp.flags.syn", 54)
+
+    def test_ne(self):
+        self.assertDFilterSame("tcp.flags.syn != 1",
+                "1 != tcp.flags.syn", 54)
+
+    def test_frame_number(self):
+        self.assertDFilterSame("frame.number == 58",
+                "58 == frame.number", 1)
+        self.assertDFilterSame("frame.number > 57",
+                "57 < frame.number", 1)
+        self.assertDFilterSame("frame.number <= 4294967295",
+                "4294967295 >= frame.number", 58)
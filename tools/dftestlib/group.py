@@ -0,0 +1,100 @@
+# Copyright (c) 2013 by Gilbert Ramirez <gram@alumni.rice.edu>
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+import os
+
+from dftestlib import dftest
+
+class testGroup(dftest.DFTest):
+    trace_dir = os.path.join("test", "captures")
+    trace_file = "rsasnakeoil2.pcap"
+
+    def test_first_match(self):
+        dfilters = ["tcp.flags.syn == 1",
+                "tcp.srcport == 443",
+                "tcp.len > 0",
+                "ip"]
+        matches = self.assertDFilterGroup(dfilters)
+        self.assertEqual(matches[1], 0)     # SYN
+        self.assertEqual(matches[2], 0)     # SYN, ACK
+        self.assertEqual(matches[3], 3)     # ACK to the server
+        self.assertEqual(matches[4], 2)     # data to the server
+        self.assertEqual(matches[5], 1)     # ACK from the server
+
+    def test_no_match(self):
+        dfilters = ["udp", "ip.ttl != 64", "tcp.port == 80"]
+        matches = self.assertDFilterGroup(dfilters)
+        self.assertEqual(set(matches.values()), set([None]))
+
+    def test_shared_tests(self):
+        # "tcp.srcport == 443" and "tcp.len > 400" are in several filters
+        dfilters = ["tcp.srcport == 443 && tcp.len > 400",
+                "tcp.dstport == 443 && tcp.len > 400",
+                "tcp.srcport == 443 && tcp.len > 0",
+                "tcp.len > 400",
+                "tcp.srcport == 443"]
+        self.assertDFilterGroup(dfilters)
+
+    def test_shared_fields(self):
+        # Different tests of the same field
+        dfilters = ["ip.id == 0",
+                "ip.id >= 18796 && ip.id <= 18815",
+                "ip.id < 5000",
+                "ip.id > 20000",
+                "ip.id"]
+        matches = self.assertDFilterGroup(dfilters)
+        self.assertEqual(set(matches.values()), set([0, 1, 2, 3, 4]))
+
+    def test_shared_negated(self):
+        # A shared test has to give the same result under "not"
+        dfilters = ["!(tcp.srcport == 443) && tcp.len == 0",
+                "tcp.srcport == 443 && !(tcp.len == 0)",
+                "not tcp.srcport == 443",
+                "tcp.len == 0 || tcp.flags.syn == 1"]
+        self.assertDFilterGroup(dfilters)
+
+    def test_disabled(self):
+        dfilters = ["tcp.flags.syn == 1",
+                "tcp.srcport == 443",
+                "tcp"]
+        matches = self.assertDFilterGroup(dfilters, disabled=(1,))
+        self.assertEqual(matches[2], 0)     # SYN, ACK
+        self.assertEqual(matches[5], 2)     # ACK from the server
+
+    def test_disabled_shared(self):
+        # A disabled filter with the same tests as enabled ones
+        dfilters = ["tcp.srcport == 443 && tcp.len > 400",
+                "tcp.srcport == 443",
+                "tcp.len > 400"]
+        self.assertDFilterGroup(dfilters, disabled=(0,))
+
+    def test_all_disabled(self):
+        dfilters = ["tcp", "ip"]
+        matches = self.assertDFilterGroup(dfilters, disabled=(0, 1))
+        self.assertEqual(set(matches.values()), set([None]))
+
+class testGroupMultipleFields(dftest.DFTest):
+    trace_dir = os.path.join("test", "captures")
+    trace_file = "dhcp.pcap"
+
+    def test_multiple_occurrences(self):
+        # ip.addr and udp.port are in each packet twice
+        dfilters = ["ip.addr == 255.255.255.255",
+                "ip.addr == 192.168.0.0/24 && udp.port == 67",
+                "udp.port == 68"]
+        matches = self.assertDFilterGroup(dfilters)
+        self.assertEqual(matches, {1: 0, 2: 1, 3: 0, 4: 1})
@@ -65,6 +65,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/report_err.h>
+#include <wsutil/aho_corasick.h>
 
 #include "globals.h"
 #include <epan/timestamp.h>
@@ -79,6 +80,7 @@
 #include <epan/column.h>
 #include <epan/print.h>
 #include <epan/addr_resolv.h>
+#include <epan/strutil.h>
 #include "ui/util.h"
 #include "ui/ui_util.h"
 #include "clopts_common.h"
@@ -130,6 +132,73 @@ static const char* prev_display_dissector_name = NULL;
 
 static gboolean perform_two_pass_analysis;
 
+/*
+ * --read-ahead: read records on a separate thread.
+ *
+ * Dissection has to see packets in order and shares state between
+ * packets (conversations, reassembly, file-scoped memory), so it stays
+ * on the main thread. Reading and decompressing records is moved to a
+ * separate thread, which runs ahead of the dissector through a bounded
+ * queue of records. Output is identical to a run without it.
+ */
+static gboolean read_ahead = FALSE;
+
+#define LONGOPT_READ_AHEAD  (LONGOPT_NUM_CAP_COMMENT+1)
+
+#define READ_AHEAD_RECORDS 1024
+
+typedef struct {
+  struct wtap_pkthdr phdr;
+  Buffer             buf;
+  gint64             data_offset;
+} read_ahead_rec_t;
+
+typedef struct {
+  wtap             *wth;
+  GThread          *thread;
+  GAsyncQueue      *filled_q;   /* records read, in file order */
+  GAsyncQueue      *free_q;     /* records that can be read into */
+  read_ahead_rec_t *recs;
+  read_ahead_rec_t *cur_rec;    /* record being processed by the main thread */
+  volatile gboolean stop;
+  int               err;
+  gchar            *err_info;
+} read_ahead_t;
+
+/* Queue markers; GAsyncQueue doesn't take NULL. */
+static read_ahead_rec_t read_ahead_eof;
+static read_ahead_rec_t read_ahead_stop;
+
+/*
+ * Serializes access to the wiretap handle between the read-ahead thread
+ * and dissectors looking up interface information on the main thread.
+ */
+#if GLIB_CHECK_VERSION(2,31,0)
+static GMutex read_ahead_mtx_static;
+static GMutex *read_ahead_mtx = &read_ahead_mtx_static;
+#else
+static GMutex *read_ahead_mtx = NULL;
+#endif
+static gboolean read_ahead_active = FALSE;
+
+/*
+ * Byte strings given with --search and --search-hex.  If there are any,
+ * records that contain none of them are dropped before they're
+ * dissected, as if they weren't in the file.  All the strings are
+ * looked for in a single pass over each record; with --read-ahead,
+ * that happens on the read-ahead thread.
+ */
+static GPtrArray    *search_patterns = NULL;   /* GByteArray * */
+static ac_automaton *search_prefilter = NULL;
+
+/* Long options; these don't clash with any single-character option */
+#define LONGOPT_SEARCH      (LONGOPT_READ_AHEAD+1)
+#define LONGOPT_SEARCH_HEX  (LONGOPT_READ_AHEAD+2)
+#define LONGOPT_TAP_TIMING  (LONGOPT_READ_AHEAD+3)
+
+/* --tap-timing: report the time spent in each -z statistic's tap listener */
+static gboolean print_tap_timing = FALSE;
+
 /*
  * The way the packet decode is to be written.
  */
@@ -192,6 +261,7 @@ static int load_cap_file(capture_file *, char *, int, gboolean, int, gint64);
 static gboolean process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     struct wtap_pkthdr *whdr, const guchar *pd,
     guint tap_flags);
+static gboolean search_prefilter_match(const struct wtap_pkthdr *phdr, const guchar *pd);
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
 static gboolean write_preamble(capture_file *cf);
@@ -333,6 +403,12 @@ print_usage(gboolean print_ver)
   fprintf(output, "  -R <read filter>         packet Read filter in Wireshark display filter syntax\n");
   fprintf(output, "  -Y <display filter>      packet displaY filter in Wireshark display filter\n");
   fprintf(output, "                           syntax\n");
+  fprintf(output, "  --search <string>        only process packets containing this string;\n");
+  fprintf(output, "                           can be given several times\n");
+  fprintf(output, "  --search-hex <bytes>     only process packets containing these bytes,\n");
+  fprintf(output, "                           given in hex, e.g. 00:0e:3f\n");
+  fprintf(output, "  --read-ahead             read the file on a separate thread while\n");
+  fprintf(output, "                           dissecting\n");
   fprintf(output, "  -n                       disable all name resolutions (def: all enabled)\n");
   fprintf(output, "  -N <name resolve flags>  enable specific name resolution(s): \"mntC\"\n");
   fprintf(output, "  -d %s ...\n", decode_as_arg_template);
@@ -376,6 +452,8 @@ print_usage(gboolean print_ver)
   fprintf(output, "                           n = write network address resolution information\n");
   fprintf(output, "  -X <key>:<value>         eXtension options, see the man page for details\n");
   fprintf(output, "  -z <statistics>          various statistics, see the man page for details\n");
+  fprintf(output, "  --tap-timing             report the time spent in each statistic's tap\n");
+  fprintf(output, "                           listener on stderr\n");
   fprintf(output, "  --capture-comment <comment>\n");
   fprintf(output, "                           add a capture comment to the newly created\n");
   fprintf(output, "                           output file (only for pcapng)\n");
@@ -427,6 +505,22 @@ glossary_option_help(void)
   fprintf(output, "\n");
 }
 
+/*
+ * For --tap-timing, print one tap listener's packet callback count and
+ * time on stderr.
+ */
+static void
+print_tap_listener_timing(const char *tapname, const char *fstring,
+                          void *tapdata _U_, guint32 packet_calls,
+                          gdouble packet_time, void *user_data _U_)
+{
+  fprintf(stderr, "  %-20s %10u calls %10.3f s", tapname, packet_calls,
+          packet_time);
+  if (fstring != NULL)
+    fprintf(stderr, "  filter \"%s\"", fstring);
+  fprintf(stderr, "\n");
+}
+
 /*
  * For a dissector table, print on the stream described by output,
  * its short name (which is what's used in the "-d" option) and its
@@ -929,6 +1023,10 @@ main(int argc, char *argv[])
   int                  opt;
   struct option        long_options[] = {
     {(char *)"capture-comment", required_argument, NULL, LONGOPT_NUM_CAP_COMMENT },
+    {(char *)"search", required_argument, NULL, LONGOPT_SEARCH },
+    {(char *)"search-hex", required_argument, NULL, LONGOPT_SEARCH_HEX },
+    {(char *)"tap-timing", no_argument, NULL, LONGOPT_TAP_TIMING },
+    {(char *)"read-ahead", no_argument, NULL, LONGOPT_READ_AHEAD },
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -1416,6 +1514,43 @@ main(int argc, char *argv[])
       /* Field entry */
       output_fields_add(output_fields, optarg);
       break;
+    case LONGOPT_READ_AHEAD:   /* Read the file on a separate thread */
+      read_ahead = TRUE;
+      break;
+    case LONGOPT_SEARCH:       /* Only process packets containing a string */
+    case LONGOPT_SEARCH_HEX:   /* Only process packets containing some bytes */
+    {
+      GByteArray *pattern = g_byte_array_new();
+
+      if (opt == LONGOPT_SEARCH) {
+        g_byte_array_append(pattern, (const guint8 *)optarg, (guint)strlen(optarg));
+      } else {
+        guint8 *bytes;
+        size_t  nbytes;
+
+        bytes = convert_string_to_hex(optarg, &nbytes);
+        if (bytes == NULL) {
+          cmdarg_err("\"%s\" isn't a valid hex byte string.", optarg);
+          g_byte_array_free(pattern, TRUE);
+          return 1;
+        }
+        g_byte_array_append(pattern, bytes, (guint)nbytes);
+        g_free(bytes);
+      }
+      if (pattern->len == 0) {
+        cmdarg_err("The search string mustn't be empty.");
+        g_byte_array_free(pattern, TRUE);
+        return 1;
+      }
+      if (search_patterns == NULL)
+        search_patterns = g_ptr_array_new();
+      g_ptr_array_add(search_patterns, pattern);
+      break;
+    }
+    case LONGOPT_TAP_TIMING:   /* Report the time spent in tap listeners */
+      print_tap_timing = TRUE;
+      set_tap_listener_timing(TRUE);
+      break;
     case 'E':
       /* Field option */
       if (!output_fields_set_option(output_fields, optarg)) {
@@ -2006,6 +2141,21 @@ main(int argc, char *argv[])
   capture_opts_trim_ring_num_files(&global_capture_opts);
 #endif
 
+  if (search_patterns != NULL) {
+    guint i;
+
+    search_prefilter = ac_automaton_new(FALSE);
+    for (i = 0; i < search_patterns->len; i++) {
+      GByteArray *pattern = (GByteArray *)g_ptr_array_index(search_patterns, i);
+
+      ac_automaton_add_pattern(search_prefilter, pattern->data, pattern->len);
+      g_byte_array_free(pattern, TRUE);
+    }
+    g_ptr_array_free(search_patterns, TRUE);
+    search_patterns = NULL;
+    ac_automaton_compile(search_prefilter);
+  }
+
   if (rfilter != NULL) {
     if (!dfilter_compile(rfilter, &rfcode)) {
       cmdarg_err("%s", dfilter_error_msg);
@@ -2274,6 +2424,10 @@ main(int argc, char *argv[])
   }
 
   draw_tap_listeners(TRUE);
+  if (print_tap_timing) {
+    fprintf(stderr, "Tap listener timing:\n");
+    foreach_tap_listener_timing(print_tap_listener_timing, NULL);
+  }
   funnel_dump_all_text_windows();
   epan_free(cfile.epan);
   epan_cleanup();
@@ -2418,6 +2572,21 @@ tshark_get_frame_ts(void *data, guint32 frame_num)
   return NULL;
 }
 
+static const char *
+tshark_get_interface_name(void *data, guint32 interface_id)
+{
+  const char *interface_name;
+
+  /* The read-ahead thread might be adding interfaces. */
+  if (read_ahead_active)
+    g_mutex_lock(read_ahead_mtx);
+  interface_name = cap_file_get_interface_name(data, interface_id);
+  if (read_ahead_active)
+    g_mutex_unlock(read_ahead_mtx);
+
+  return interface_name;
+}
+
 static epan_t *
 tshark_epan_new(capture_file *cf)
 {
@@ -2425,7 +2594,7 @@ tshark_epan_new(capture_file *cf)
 
   epan->data = cf;
   epan->get_frame_ts = tshark_get_frame_ts;
-  epan->get_interface_name = cap_file_get_interface_name;
+  epan->get_interface_name = tshark_get_interface_name;
   epan->get_user_comment = NULL;
 
   return epan;
@@ -2681,6 +2850,8 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
     /* Attempt to open the capture file and set up to read from it. */
     switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
     case CF_OK:
+      /* dumpcap is still writing it */
+      wtap_set_growing(((capture_file *)cap_session->cf)->wth);
       break;
     case CF_ERROR:
       /* Don't unlink (delete) the save file - leave it around,
@@ -2748,10 +2919,12 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
         sync_pipe_stop(cap_session);
         wtap_close(cf->wth);
         cf->wth = NULL;
-      } else {
+      } else if (search_prefilter_match(wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth))) {
         ret = process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
                              wtap_buf_ptr(cf->wth),
                              tap_flags);
+      } else {
+        ret = FALSE;
       }
       if (ret != FALSE) {
         /* packet successfully read and gone through the "Read Filter" */
@@ -2825,7 +2998,8 @@ report_counts_siginfo(int signum _U_)
 
 /* capture child detected any packet drops? */
 void
-capture_input_drops(capture_session *cap_session _U_, guint32 dropped)
+capture_input_drops(capture_session *cap_session _U_, guint32 dropped,
+                    guint32 queued, guint32 queued_bytes)
 {
   if (print_packet_counts) {
     /* We're printing packet counts to stderr.
@@ -2838,6 +3012,11 @@ capture_input_drops(capture_session *cap_session _U_, guint32 dropped)
        Send a newline so that we move to the line after the packet count. */
     fprintf(stderr, "%u packet%s dropped\n", dropped, plurality(dropped, "", "s"));
   }
+  if (dropped != 0 && queued != 0) {
+    /* A full capture queue is a likely reason for the drops. */
+    fprintf(stderr, "%u packet%s (%u bytes) queued at most\n",
+            queued, plurality(queued, "", "s"), queued_bytes);
+  }
 }
 
 
@@ -3100,6 +3279,166 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt, frame_data *fd
   return passed || fdata->flags.dependent_of_displayed;
 }
 
+/*
+ * Returns TRUE if the record contains one of the --search/--search-hex
+ * patterns, or if there aren't any.
+ */
+static gboolean
+search_prefilter_match(const struct wtap_pkthdr *phdr, const guchar *pd)
+{
+  return search_prefilter == NULL ||
+         ac_automaton_search(search_prefilter, pd, phdr->caplen, NULL, NULL);
+}
+
+static gpointer
+read_ahead_thread(gpointer arg)
+{
+  read_ahead_t     *ra = (read_ahead_t *)arg;
+  read_ahead_rec_t *rec = NULL;
+  gboolean          ret;
+
+  for (;;) {
+    if (rec == NULL) {
+      rec = (read_ahead_rec_t *)g_async_queue_pop(ra->free_q);
+      if (rec == &read_ahead_stop)
+        break;
+    }
+    if (ra->stop)
+      break;
+
+    g_mutex_lock(read_ahead_mtx);
+    ret = wtap_read(ra->wth, &ra->err, &ra->err_info, &rec->data_offset);
+    if (ret) {
+      struct wtap_pkthdr *phdr = wtap_phdr(ra->wth);
+
+      rec->phdr = *phdr;
+      rec->phdr.opt_comment = g_strdup(phdr->opt_comment);
+      buffer_assure_space(&rec->buf, phdr->caplen);
+      memcpy(buffer_start_ptr(&rec->buf), wtap_buf_ptr(ra->wth), phdr->caplen);
+    }
+    g_mutex_unlock(read_ahead_mtx);
+
+    if (!ret) {
+      /* End of file or error; ra->err and ra->err_info say which. */
+      g_async_queue_push(ra->filled_q, &read_ahead_eof);
+      break;
+    }
+
+    /* Searching here takes the prefilter off the main thread. */
+    if (!search_prefilter_match(&rec->phdr, buffer_start_ptr(&rec->buf))) {
+      /* Not wanted; read the next record into the same buffer. */
+      g_free(rec->phdr.opt_comment);
+      rec->phdr.opt_comment = NULL;
+      continue;
+    }
+    g_async_queue_push(ra->filled_q, rec);
+    rec = NULL;
+  }
+
+  return NULL;
+}
+
+static void
+read_ahead_start(read_ahead_t *ra, wtap *wth)
+{
+  guint i;
+
+  memset(ra, 0, sizeof *ra);
+  ra->wth = wth;
+  ra->filled_q = g_async_queue_new();
+  ra->free_q = g_async_queue_new();
+  ra->recs = g_new0(read_ahead_rec_t, READ_AHEAD_RECORDS);
+  for (i = 0; i < READ_AHEAD_RECORDS; i++) {
+    buffer_init(&ra->recs[i].buf, 1500);
+    g_async_queue_push(ra->free_q, &ra->recs[i]);
+  }
+
+#if GLIB_CHECK_VERSION(2,31,0)
+  read_ahead_active = TRUE;
+  ra->thread = g_thread_new("Read ahead", read_ahead_thread, ra);
+#else
+  if (!g_thread_supported())
+    g_thread_init(NULL);
+  if (read_ahead_mtx == NULL)
+    read_ahead_mtx = g_mutex_new();
+  read_ahead_active = TRUE;
+  ra->thread = g_thread_create(read_ahead_thread, ra, TRUE, NULL);
+#endif
+}
+
+static void
+read_ahead_finish(read_ahead_t *ra)
+{
+  read_ahead_rec_t *rec;
+  guint i;
+
+  /* Tell the read-ahead thread to stop, in case we quit early. */
+  ra->stop = TRUE;
+  g_async_queue_push(ra->free_q, &read_ahead_stop);
+  g_thread_join(ra->thread);
+  read_ahead_active = FALSE;
+
+  if (ra->cur_rec) {
+    g_free(ra->cur_rec->phdr.opt_comment);
+    ra->cur_rec = NULL;
+  }
+  while ((rec = (read_ahead_rec_t *)g_async_queue_try_pop(ra->filled_q)) != NULL) {
+    if (rec != &read_ahead_eof)
+      g_free(rec->phdr.opt_comment);
+  }
+
+  for (i = 0; i < READ_AHEAD_RECORDS; i++)
+    buffer_free(&ra->recs[i].buf);
+  g_free(ra->recs);
+  g_free(ra->err_info);
+  g_async_queue_unref(ra->filled_q);
+  g_async_queue_unref(ra->free_q);
+}
+
+/*
+ * Get the next record, either straight from wiretap or, if "ra" isn't
+ * NULL, from the read-ahead thread.  The record is valid until the next
+ * call.
+ */
+static gboolean
+read_next_record(capture_file *cf, read_ahead_t *ra, int *err, gchar **err_info,
+                 gint64 *data_offset, struct wtap_pkthdr **phdr, const guchar **pd)
+{
+  read_ahead_rec_t *rec;
+
+  if (ra == NULL) {
+    do {
+      if (!wtap_read(cf->wth, err, err_info, data_offset))
+        return FALSE;
+      *phdr = wtap_phdr(cf->wth);
+      *pd = wtap_buf_ptr(cf->wth);
+    } while (!search_prefilter_match(*phdr, *pd));
+    return TRUE;
+  }
+
+  /* Hand the previous record back to the reader. */
+  if (ra->cur_rec) {
+    g_free(ra->cur_rec->phdr.opt_comment);
+    ra->cur_rec->phdr.opt_comment = NULL;
+    g_async_queue_push(ra->free_q, ra->cur_rec);
+    ra->cur_rec = NULL;
+  }
+
+  rec = (read_ahead_rec_t *)g_async_queue_pop(ra->filled_q);
+  if (rec == &read_ahead_eof) {
+    *err = ra->err;
+    *err_info = ra->err_info;
+    ra->err_info = NULL;
+    return FALSE;
+  }
+
+  ra->cur_rec = rec;
+  *data_offset = rec->data_offset;
+  *phdr = &rec->phdr;
+  *pd = buffer_start_ptr(&rec->buf);
+  return TRUE;
+}
+
 static int
 load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3120,6 +3459,10 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   struct wtap_pkthdr phdr;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+  read_ahead_t  ra;
+  read_ahead_t *rap = NULL;
+  struct wtap_pkthdr *rec_phdr;
+  const guchar *rec_pd;
 
   memset(&phdr, 0, sizeof(struct wtap_pkthdr));
 
@@ -3153,10 +3496,10 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     if (linktype != WTAP_ENCAP_PER_PACKET &&
         out_file_type == WTAP_FILE_TYPE_SUBTYPE_PCAP)
         pdh = wtap_dump_open(save_file, out_file_type, linktype,
-            snapshot_length, FALSE /* compressed */, &err);
+            snapshot_length, WTAP_UNCOMPRESSED, &err);
     else
         pdh = wtap_dump_open_ng(save_file, out_file_type, linktype,
-            snapshot_length, FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            snapshot_length, WTAP_UNCOMPRESSED, shb_hdr, idb_inf, &err);
 
     g_free(idb_inf);
     idb_inf = NULL;
@@ -3231,6 +3574,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     }
 
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+      if (!search_prefilter_match(wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth)))
+        continue;
       if (process_packet_first_pass(cf, edt, data_offset, wtap_phdr(cf->wth),
                          wtap_buf_ptr(cf->wth))) {
         /* Stop reading if we have the maximum number of packets;
@@ -3361,17 +3706,20 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
     }
 
-    while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+    if (read_ahead) {
+      read_ahead_start(&ra, cf->wth);
+      rap = &ra;
+    }
+
+    while (read_next_record(cf, rap, &err, &err_info, &data_offset, &rec_phdr, &rec_pd)) {
       framenum++;
 
-      if (process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth),
-                         tap_flags)) {
+      if (process_packet(cf, edt, data_offset, rec_phdr, rec_pd, tap_flags)) {
         /* Either there's no read filtering or this packet passed the
            filter, so, if we're writing to a capture file, write
            this packet out. */
         if (pdh != NULL) {
-          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth), &err)) {
+          if (!wtap_dump(pdh, rec_phdr, rec_pd, &err)) {
             /* Error writing to a capture file */
             switch (err) {
 
@@ -3420,6 +3768,11 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       }
     }
 
+    if (rap) {
+      read_ahead_finish(rap);
+      rap = NULL;
+    }
+
     if (edt) {
       epan_dissect_free(edt);
       edt = NULL;
@@ -140,45 +140,26 @@ static void
 conversation_info_to_texbuff(GtkTextBuffer *buffer)
 {
     gchar string_buff[CONV_STR_BUF_MAX];
-	GHashTable *conversation_hashtable_exact;
-	GHashTable *conversation_hashtable_no_addr2;
-	GHashTable *conversation_hashtable_no_port2;
-	GHashTable *conversation_hashtable_no_addr2_or_port2;
 
     g_snprintf(string_buff, CONV_STR_BUF_MAX, "Conversation hastables info:\n");
     gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
-	conversation_hashtable_exact = get_conversation_hashtable_exact();
-	if(conversation_hashtable_exact){
-		g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_exact %i entries\n#\n",
-			g_hash_table_size(conversation_hashtable_exact));
-		gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
-		g_hash_table_foreach( conversation_hashtable_exact, conversation_hashtable_exact_to_texbuff, buffer);
-	}
-
-	conversation_hashtable_no_addr2 = get_conversation_hashtable_no_addr2();
-	if(conversation_hashtable_no_addr2){
-		g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2 %i entries\n#\n",
-			g_hash_table_size(conversation_hashtable_no_addr2));
-		gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
-
-	}
-
-	conversation_hashtable_no_port2 = get_conversation_hashtable_no_port2();
-	if(conversation_hashtable_no_port2){
-		g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_port2 %i entries\n#\n",
-			g_hash_table_size(conversation_hashtable_no_port2));
-		gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
+	g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_exact %i entries\n#\n",
+		conversation_table_size(CONVERSATION_TABLE_EXACT));
+	gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
+	conversation_table_foreach(CONVERSATION_TABLE_EXACT, conversation_hashtable_exact_to_texbuff, buffer);
 
-	}
+	g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2 %i entries\n#\n",
+		conversation_table_size(CONVERSATION_TABLE_NO_ADDR2));
+	gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
-	conversation_hashtable_no_addr2_or_port2 = get_conversation_hashtable_no_addr2_or_port2();
-	if(conversation_hashtable_no_addr2_or_port2){
-		g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2_or_port2 %i entries\n#\n",
-			g_hash_table_size(conversation_hashtable_no_addr2_or_port2));
-		gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
+	g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_port2 %i entries\n#\n",
+		conversation_table_size(CONVERSATION_TABLE_NO_PORT2));
+	gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
-	}
+	g_snprintf(string_buff, CONV_STR_BUF_MAX, "conversation_hashtable_no_addr2_or_port2 %i entries\n#\n",
+		conversation_table_size(CONVERSATION_TABLE_NO_ADDR2_OR_PORT2));
+	gtk_text_buffer_insert_at_cursor (buffer, string_buff, -1);
 
 }
 
@@ -1263,8 +1263,8 @@ show_cell_data_func(GtkTreeViewColumn *col _U_, GtkCellRenderer *renderer,
 		color_t_to_gdkcolor(&fg_gdk, &prefs.gui_marked_fg);
 		color_t_to_gdkcolor(&bg_gdk, &prefs.gui_marked_bg);
 		color_on = TRUE;
-	} else if (fdata->color_filter) {
-		const color_filter_t *color_filter = (const color_filter_t *)fdata->color_filter;
+	} else if (frame_data_sequence_get_color_filter(cfile.frames, fdata)) {
+		const color_filter_t *color_filter = (const color_filter_t *)frame_data_sequence_get_color_filter(cfile.frames, fdata);
 
 		color_t_to_gdkcolor(&fg_gdk, &color_filter->fg_color);
 		color_t_to_gdkcolor(&bg_gdk, &color_filter->bg_color);
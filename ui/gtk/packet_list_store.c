@@ -1135,7 +1135,7 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 				packet_list_change_record(packet_list, record, col, cinfo);
 		}
 		if (dissect_color) {
-			fdata->color_filter = NULL;
+			frame_data_sequence_set_color_filter(cfile.frames, fdata, NULL);
 			record->colorized = TRUE;
 		}
 		buffer_free(&buf);
@@ -1161,7 +1161,7 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 	epan_dissect_run(&edt, cfile.cd_t, &phdr, frame_tvbuff_new_buffer(fdata, &buf), fdata, cinfo);
 
 	if (dissect_color)
-		fdata->color_filter = color_filters_colorize_packet(&edt);
+		frame_data_sequence_set_color_filter(cfile.frames, fdata, color_filters_colorize_packet(&edt));
 
 	if (dissect_columns) {
 		/* "Stringify" non frame_data vals */
@@ -138,6 +138,264 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
     return err_str;
 }
 
+io_graph_store_t *io_graph_store_new(const int *intervals, int num_intervals, int max_items)
+{
+    io_graph_store_t *store = g_new(io_graph_store_t, 1);
+    int i;
+
+    store->levels = g_new(io_graph_level_t, num_intervals);
+    store->num_levels = num_intervals;
+    store->max_items = max_items;
+    store->selected = 0;
+    for (i = 0; i < num_intervals; i++) {
+        g_assert(i == 0 || intervals[i] % intervals[i - 1] == 0);
+        store->levels[i].interval = intervals[i];
+        store->levels[i].items = NULL;
+    }
+    io_graph_store_reset(store);
+    return store;
+}
+
+void io_graph_store_free(io_graph_store_t *store)
+{
+    if (!store) return;
+
+    io_graph_store_reset(store);
+    g_free(store->levels);
+    g_free(store);
+}
+
+static void io_graph_level_clear(io_graph_level_t *level)
+{
+    g_free(level->items);
+    level->items = NULL;
+    level->num_items = 0;
+    level->cur_idx = -1;
+    level->tallied = FALSE;
+    level->stale = TRUE;
+}
+
+void io_graph_store_reset(io_graph_store_t *store)
+{
+    int i;
+
+    for (i = 0; i < store->num_levels; i++) {
+        io_graph_level_clear(&store->levels[i]);
+    }
+    store->base = 0;
+    store->levels[0].tallied = TRUE;
+}
+
+static int io_graph_store_find_level(const io_graph_store_t *store, int interval)
+{
+    int i;
+
+    for (i = 0; i < store->num_levels; i++) {
+        if (store->levels[i].interval == interval) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const io_graph_item_t *io_graph_level_get_item(const io_graph_level_t *level, int idx)
+{
+    static io_graph_item_t empty_item; /* all zero */
+
+    if (!level || idx < 0 || idx >= level->num_items) {
+        return &empty_item;
+    }
+    return &level->items[idx];
+}
+
+/* Make sure a level has items up to and including idx */
+static void io_graph_level_grow(io_graph_level_t *level, int idx, int max_items)
+{
+    int num_items;
+
+    if (idx < level->num_items) {
+        return;
+    }
+
+    num_items = level->num_items ? level->num_items : 1024;
+    while (num_items <= idx) {
+        num_items *= 2;
+    }
+    if (num_items > max_items) {
+        num_items = max_items;
+    }
+    level->items = g_renew(io_graph_item_t, level->items, num_items);
+    reset_io_graph_items(&level->items[level->num_items], num_items - level->num_items);
+    level->num_items = num_items;
+}
+
+/* Replace the items of a level with ones merged from a finer level */
+static void io_graph_level_roll_up(io_graph_level_t *level, const io_graph_level_t *from, int max_items)
+{
+    int ratio = level->interval / from->interval;
+    int i;
+
+    reset_io_graph_items(level->items, level->num_items);
+    level->cur_idx = -1;
+    level->stale = FALSE;
+    if (from->cur_idx < 0) {
+        return;
+    }
+
+    io_graph_level_grow(level, from->cur_idx / ratio, max_items);
+    for (i = 0; i <= from->cur_idx && i < from->num_items; i++) {
+        merge_io_graph_item(&level->items[i / ratio], &from->items[i]);
+    }
+    level->cur_idx = from->cur_idx / ratio;
+}
+
+/* Make the next level the base. The old one is only kept if it's selected. */
+static void io_graph_store_promote_base(io_graph_store_t *store)
+{
+    io_graph_level_t *base = &store->levels[store->base];
+    io_graph_level_t *next = &store->levels[store->base + 1];
+
+    io_graph_level_roll_up(next, base, store->max_items);
+    next->tallied = TRUE;
+    if (store->base != store->selected) {
+        io_graph_level_clear(base);
+    }
+    store->base++;
+}
+
+gboolean io_graph_store_select(io_graph_store_t *store, int interval)
+{
+    int i = io_graph_store_find_level(store, interval);
+    int old = store->selected;
+
+    if (i < 0) {
+        return FALSE;
+    }
+
+    /* A level finer than the base is only kept while it's selected */
+    store->selected = i;
+    if (old < store->base && old != i) {
+        io_graph_level_clear(&store->levels[old]);
+    }
+
+    return i >= store->base || store->levels[i].tallied;
+}
+
+io_graph_level_t *io_graph_store_get_level(io_graph_store_t *store, int interval)
+{
+    int i = io_graph_store_find_level(store, interval);
+    io_graph_level_t *level;
+
+    if (i < 0) {
+        return NULL;
+    }
+
+    level = &store->levels[i];
+    if (level->tallied) {
+        return level;
+    }
+    if (i < store->base) {
+        return NULL;
+    }
+    if (level->stale) {
+        io_graph_level_roll_up(level, &store->levels[store->base], store->max_items);
+    }
+    return level;
+}
+
+int io_graph_store_get_cur_idx(const io_graph_store_t *store, int interval)
+{
+    int i = io_graph_store_find_level(store, interval);
+    const io_graph_level_t *base;
+
+    if (i < 0) {
+        return -1;
+    }
+    if (store->levels[i].tallied) {
+        return store->levels[i].cur_idx;
+    }
+    if (i < store->base) {
+        return -1;
+    }
+
+    base = &store->levels[store->base];
+    if (base->cur_idx < 0) {
+        return -1;
+    }
+    return base->cur_idx / (store->levels[i].interval / base->interval);
+}
+
+/* Add a packet to the item idx of a tallied level */
+static gboolean io_graph_level_add_packet(io_graph_level_t *level, int idx, int max_items,
+                                          const io_graph_item_t *packet_item, packet_info *pinfo,
+                                          epan_dissect_t *edt, int hf_index, int item_unit)
+{
+    /* some sanity checks */
+    if (idx < 0) {
+        return FALSE;
+    }
+    if (idx >= max_items) {
+        level->cur_idx = max_items - 1;
+        return FALSE;
+    }
+
+    io_graph_level_grow(level, idx, max_items);
+    if (idx > level->cur_idx) {
+        level->cur_idx = idx;
+    }
+
+    if (item_unit == IOG_ITEM_UNIT_CALC_LOAD) {
+        return update_io_graph_item(level->items, idx, pinfo, edt, hf_index, item_unit, level->interval);
+    }
+    merge_io_graph_item(&level->items[idx], packet_item);
+    return TRUE;
+}
+
+gboolean io_graph_store_add_packet(io_graph_store_t *store, packet_info *pinfo, epan_dissect_t *edt, int hf_index, int item_unit)
+{
+    io_graph_item_t packet_item;
+    gboolean updated = TRUE;
+    gboolean added;
+    int i, idx;
+
+    /* LOAD spreads a value across the intervals before the packet's, so
+     * it has to be worked out for each level it's added to. Everything
+     * else is worked out once and merged. */
+    reset_io_graph_items(&packet_item, 1);
+    if (item_unit != IOG_ITEM_UNIT_CALC_LOAD) {
+        updated = update_io_graph_item(&packet_item, 0, pinfo, edt, hf_index, item_unit, 0);
+    }
+
+    /* Move the base to a coarser level if the packet doesn't fit in it */
+    idx = get_io_graph_index(pinfo, store->levels[store->base].interval);
+    while (idx >= IO_GRAPH_BASE_MAX_ITEMS && store->base < store->num_levels - 1) {
+        io_graph_store_promote_base(store);
+        idx = get_io_graph_index(pinfo, store->levels[store->base].interval);
+    }
+
+    /* Only the selected level counts; a finer one filling up, or the base
+     * moving on, doesn't matter to the graph. A selected level coarser
+     * than the base is rolled up from it. */
+    added = store->levels[store->selected].tallied || store->selected > store->base;
+    for (i = 0; i < store->num_levels; i++) {
+        io_graph_level_t *level = &store->levels[i];
+
+        if (!level->tallied) {
+            level->stale = TRUE;
+            continue;
+        }
+
+        idx = get_io_graph_index(pinfo, level->interval);
+        if (!io_graph_level_add_packet(level, idx, store->max_items, &packet_item,
+                                       pinfo, edt, hf_index, item_unit) &&
+            (i == store->selected || (i == store->base && store->selected > store->base))) {
+            added = FALSE;
+        }
+    }
+
+    return updated && added;
+}
+
 /*
  * Editor modelines
  *
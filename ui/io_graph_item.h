@@ -104,6 +104,65 @@ reset_io_graph_items(io_graph_item_t *items, int count) {
     }
 }
 
+/** Merge the values of one io_graph_item_t into another.
+ *
+ * Every value an item holds is a count, a sum, a minimum, or a maximum,
+ * so an item for an interval can be made out of the items for any
+ * finer intervals that it covers, or out of the items for its packets.
+ *
+ * @param item [in,out] The item to update.
+ * @param add [in] The item to merge into it.
+ */
+static inline void
+merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *add) {
+    if (add->first_frame_in_invl != 0 &&
+        (item->first_frame_in_invl == 0 || add->first_frame_in_invl < item->first_frame_in_invl)) {
+        item->first_frame_in_invl = add->first_frame_in_invl;
+    }
+    if (add->last_frame_in_invl > item->last_frame_in_invl) {
+        item->last_frame_in_invl = add->last_frame_in_invl;
+    }
+
+    item->frames += add->frames;
+    item->bytes  += add->bytes;
+    /* LOAD adds to time_tot without counting fields. */
+    nstime_add(&item->time_tot, &add->time_tot);
+
+    if (add->fields == 0) {
+        return;
+    }
+
+    /* If fields == 0, add holds the first values seen so take its min/max. */
+    if ((add->int_max > item->int_max) || (item->fields == 0)) {
+        item->int_max = add->int_max;
+    }
+    if ((add->int_min < item->int_min) || (item->fields == 0)) {
+        item->int_min = add->int_min;
+    }
+    if ((add->float_max > item->float_max) || (item->fields == 0)) {
+        item->float_max = add->float_max;
+    }
+    if ((add->float_min < item->float_min) || (item->fields == 0)) {
+        item->float_min = add->float_min;
+    }
+    if ((add->double_max > item->double_max) || (item->fields == 0)) {
+        item->double_max = add->double_max;
+    }
+    if ((add->double_min < item->double_min) || (item->fields == 0)) {
+        item->double_min = add->double_min;
+    }
+    if ((nstime_cmp(&add->time_max, &item->time_max) > 0) || (item->fields == 0)) {
+        item->time_max = add->time_max;
+    }
+    if ((nstime_cmp(&add->time_min, &item->time_min) < 0) || (item->fields == 0)) {
+        item->time_min = add->time_min;
+    }
+    item->int_tot    += add->int_tot;
+    item->float_tot  += add->float_tot;
+    item->double_tot += add->double_tot;
+    item->fields += add->fields;
+}
+
 /** Get the interval (array index) for a packet
  *
  * It is up to the caller to determine if the return value is valid.
@@ -320,6 +379,114 @@ update_io_graph_item(io_graph_item_t *items, int idx, packet_info *pinfo, epan_d
     return TRUE;
 }
 
+/** The items for one interval of an io_graph_store_t. */
+typedef struct _io_graph_level_t {
+    int              interval;      /* Interval in ms */
+    io_graph_item_t *items;         /* Allocated as packets are added */
+    int              num_items;     /* Number of items allocated */
+    int              cur_idx;       /* Highest index updated, or -1 */
+    gboolean         tallied;       /* Packets are added to this level */
+    gboolean         stale;         /* Packets were added since it was rolled up */
+} io_graph_level_t;
+
+/** IO graph items kept for several intervals at once, so that the interval
+ * of a graph can be changed without tapping the packets again.
+ *
+ * Packets are only added to one level, the base: the finest one that
+ * takes no more than IO_GRAPH_BASE_MAX_ITEMS items. The coarser levels
+ * are rolled up from it when they're asked for. When a packet falls past
+ * the end of the base, the base is rolled up into the next level and
+ * freed, and that level becomes the base; finer levels can then only be
+ * had by tapping the packets again. The selected level is added to
+ * directly as well if it's finer than the base, up to the store's
+ * max_items. Items are only allocated up to the last one a packet has
+ * been added to, so a store costs next to nothing until it's used.
+ */
+typedef struct _io_graph_store_t {
+    io_graph_level_t *levels;
+    int               num_levels;
+    int               max_items;    /* Maximum number of items per interval */
+    int               base;         /* Index of the level packets are added to */
+    int               selected;     /* Index of the level being graphed */
+} io_graph_store_t;
+
+/** Maximum number of items in the base level of an io_graph_store_t */
+#define IO_GRAPH_BASE_MAX_ITEMS 25000
+
+/** Create an io_graph_store_t.
+ *
+ * @param intervals [in] The intervals to keep items for, in ms, from
+ *                       finest to coarsest. Each has to be a multiple
+ *                       of the one before.
+ * @param num_intervals [in] The number of intervals.
+ * @param max_items [in] Maximum number of items to keep for each interval.
+ * @return The new store. Free it with io_graph_store_free().
+ */
+io_graph_store_t *io_graph_store_new(const int *intervals, int num_intervals, int max_items);
+
+/** Free an io_graph_store_t.
+ *
+ * @param store [in] The store to free.
+ */
+void io_graph_store_free(io_graph_store_t *store);
+
+/** Remove all items from an io_graph_store_t and free their memory.
+ *
+ * @param store [in,out] The store to reset.
+ */
+void io_graph_store_reset(io_graph_store_t *store);
+
+/** Select the interval being graphed.
+ *
+ * @param store [in,out] The store.
+ * @param interval [in] Time interval in milliseconds.
+ * @return TRUE if the store has the items for the interval, FALSE if it
+ *         doesn't keep it or the packets have to be added again.
+ */
+gboolean io_graph_store_select(io_graph_store_t *store, int interval);
+
+/** Get the items for an interval, rolling them up if need be.
+ *
+ * The level is only valid until the next packet is added.
+ *
+ * @param store [in,out] The store.
+ * @param interval [in] Time interval in milliseconds.
+ * @return The level for the interval, or NULL if the store doesn't have it.
+ */
+io_graph_level_t *io_graph_store_get_level(io_graph_store_t *store, int interval);
+
+/** Get the highest item index of an interval that has been updated.
+ *
+ * Unlike io_graph_store_get_level(), this doesn't roll anything up.
+ *
+ * @param store [in] The store.
+ * @param interval [in] Time interval in milliseconds.
+ * @return The index, or -1 if there are no items or the store doesn't
+ *         have the interval.
+ */
+int io_graph_store_get_cur_idx(const io_graph_store_t *store, int interval);
+
+/** Get an item from an io_graph_level_t.
+ *
+ * @param level [in] The level.
+ * @param idx [in] Index of the item.
+ * @return The item. Items no packet has been added to are all zero.
+ */
+const io_graph_item_t *io_graph_level_get_item(const io_graph_level_t *level, int idx);
+
+/** Add a packet to an io_graph_store_t.
+ *
+ * Arguments are as for update_io_graph_item().
+ *
+ * @param store [in,out] The store to update.
+ * @param pinfo [in] Packet containing update information.
+ * @param edt [in] Dissection information for advanced statistics. May be NULL.
+ * @param hf_index [in] Header field index for advanced statistics.
+ * @param item_unit [in] The type of unit to calculate. From IOG_ITEM_UNITS.
+ * @return TRUE if the packet was added to the selected interval, FALSE if
+ *         the update failed or the packet is past its last item.
+ */
+gboolean io_graph_store_add_packet(io_graph_store_t *store, packet_info *pinfo, epan_dissect_t *edt, int hf_index, int item_unit);
 
 #ifdef __cplusplus
 }
@@ -201,6 +201,7 @@ SOURCES_WS_C = \
     ../../file.c  \
     ../../fileset.c       \
     ../../filters.c       \
+    ../../frame_index.c   \
     ../../frame_tvbuff.c   \
     ../../proto_hier_stats.c      \
     ../../summary.c       \
@@ -548,6 +549,7 @@ HEADERS += \
     main_window.h \
     packet_list.h \
     packet_list_model.h \
+    packet_list_prefetch_worker.h \
     packet_list_record.h \
     packet_range_group_box.h \
     progress_bar.h \
@@ -614,6 +616,7 @@ SOURCES += \
     packet_format_group_box.cpp \
     packet_list.cpp \
     packet_list_model.cpp \
+    packet_list_prefetch_worker.cpp \
     packet_list_record.cpp \
     packet_range_group_box.cpp \
     preferences_dialog.cpp \
@@ -190,11 +190,18 @@ void ExportObjectDialog::show()
     }
 
     QDialog::show();
-    cf_retap_packets(cap_file_);
+    connect(wsApp, SIGNAL(retapFinished(const capture_file*)),
+            this, SLOT(retapFinished(const capture_file*)));
+    wsApp->queueRetap(cap_file_);
+}
+
+void ExportObjectDialog::retapFinished(const capture_file *)
+{
+    disconnect(wsApp, SIGNAL(retapFinished(const capture_file*)),
+               this, SLOT(retapFinished(const capture_file*)));
     eo_ui_->progressFrame->hide();
     for (int i = 0; i < eo_ui_->objectTree->columnCount(); i++)
         eo_ui_->objectTree->resizeColumnToContents(i);
-
 }
 
 void ExportObjectDialog::accept()
@@ -71,6 +71,7 @@ public slots:
 private slots:
     void accept();
     void captureFileClosing(const capture_file *cf);
+    void retapFinished(const capture_file *cf);
     void on_buttonBox_helpRequested();
     void on_objectTree_currentItemChanged(QTreeWidgetItem *item, QTreeWidgetItem *previous);
     void on_buttonBox_clicked(QAbstractButton *button);
@@ -97,6 +97,9 @@ const int min_zoom_pixels_ = 20;
 
 const int stat_update_interval_ = 200; // ms
 
+// The intervals offered by intervalComboBox, for which each graph keeps items.
+static const int io_graph_intervals_[] = { 1, 10, 100, 1000, 10000, 60000, 600000 };
+
 // Saved graph settings
 
 static const value_string graph_enabled_vs[] = {
@@ -945,7 +948,13 @@ void IOGraphDialog::updateStatistics()
 
     if (need_retap_) {
         need_retap_ = false;
-        cf_retap_packets(cap_file_);
+        // Our graphs share a retap with any other dialogs' listeners that
+        // need one. Other listeners are left alone.
+        for (int i = 0; i < ui->graphTreeWidget->topLevelItemCount(); i++) {
+            IOGraph *iog = qvariant_cast<IOGraph *>(ui->graphTreeWidget->topLevelItem(i)->data(name_col_, Qt::UserRole));
+            set_tap_listener_pending(iog);
+        }
+        wsApp->queueRetap(cap_file_);
         ui->ioPlot->setFocus();
     } else {
         if (need_recalc_) {
@@ -1112,7 +1121,7 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int index)
     Q_UNUSED(index);
 
     int interval = ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt();
-    bool need_retap = false;
+    bool need_recalc = false;
 
     for (int i = 0; i < ui->graphTreeWidget->topLevelItemCount(); i++) {
         QTreeWidgetItem *item = ui->graphTreeWidget->topLevelItem(i);
@@ -1122,14 +1131,16 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int index)
             if (iog) {
                 iog->setInterval(interval);
                 if (iog->visible()) {
-                    need_retap = true;
+                    need_recalc = true;
                 }
             }
         }
     }
 
-    if (need_retap) {
-        scheduleRetap(true);
+    // The graphs keep their data for each interval, so there's no need to
+    // retap. A graph that doesn't asks for one itself.
+    if (need_recalc) {
+        scheduleRecalc(true);
     }
 }
 
@@ -1505,9 +1516,14 @@ IOGraph::IOGraph(QCustomPlot *parent) :
     graph_(NULL),
     bars_(NULL),
     hf_index_(-1),
-    cur_idx_(-1)
+    interval_(0),
+    start_time_(0.0),
+    store_(NULL),
+    level_(NULL)
 {
     Q_ASSERT(parent_ != NULL);
+    store_ = io_graph_store_new(io_graph_intervals_, (int) G_N_ELEMENTS(io_graph_intervals_), max_io_items_);
+    setInterval(1000);
     graph_ = parent_->addGraph(parent_->xAxis, parent_->yAxis);
     Q_ASSERT(graph_ != NULL);
 
@@ -1530,6 +1546,7 @@ IOGraph::IOGraph(QCustomPlot *parent) :
 
 IOGraph::~IOGraph() {
     remove_tap_listener(this);
+    io_graph_store_free(store_);
     if (graph_) {
         parent_->removeGraph(graph_);
     }
@@ -1767,16 +1784,16 @@ double IOGraph::startOffset()
 int IOGraph::packetFromTime(double ts)
 {
     int idx = ts * 1000 / interval_;
-    if (idx >= 0 && idx < (int) cur_idx_) {
-        return items_[idx].last_frame_in_invl;
+    io_graph_level_t *level = io_graph_store_get_level(store_, interval_);
+    if (level && idx >= 0 && idx < level->cur_idx) {
+        return io_graph_level_get_item(level, idx)->last_frame_in_invl;
     }
     return -1;
 }
 
 void IOGraph::clearAllData()
 {
-    cur_idx_ = -1;
-    reset_io_graph_items(items_, max_io_items_);
+    io_graph_store_reset(store_);
     if (graph_) {
         graph_->clearData();
     }
@@ -1841,6 +1858,9 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
     double mavg_cumulated = 0;
     QCPAxis *x_axis = NULL;
 
+    level_ = io_graph_store_get_level(store_, interval_);
+    int cur_idx = level_ ? level_->cur_idx : -1;
+
     if (graph_) {
         graph_->clearData();
         x_axis = graph_->keyAxis();
@@ -1850,7 +1870,7 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
         x_axis = bars_->keyAxis();
     }
 
-    if (moving_avg_period_ > 0 && cur_idx_ >= 0) {
+    if (moving_avg_period_ > 0 && cur_idx >= 0) {
         /* "Warm-up phase" - calculate average on some data not displayed;
          * just to make sure average on leftmost and rightmost displayed
          * values is as reliable as possible
@@ -1866,7 +1886,7 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
         mavg_in_average_count++;
         for (warmup_interval = interval_;
             ((warmup_interval < (0 + (moving_avg_period_ / 2) * (guint64)interval_)) &&
-             (warmup_interval <= (cur_idx_ * (guint64)interval_)));
+             (warmup_interval <= (cur_idx * (guint64)interval_)));
              warmup_interval += interval_) {
 
             mavg_cumulated += getItemValue((int)warmup_interval / interval_, cap_file);
@@ -1876,7 +1896,7 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
         mavg_to_add = warmup_interval;
     }
 
-    for (int i = 0; i < cur_idx_; i++) {
+    for (int i = 0; i < cur_idx; i++) {
         double ts = (double) i * interval_ / 1000;
         if (x_axis && x_axis->tickLabelType() == QCPAxis::ltDateTime) {
             ts += start_time_;
@@ -1892,7 +1912,7 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
                     mavg_cumulated -= getItemValue((int)mavg_to_remove / interval_, cap_file);
                     mavg_to_remove += interval_;
                 }
-                if (mavg_to_add <= (unsigned int) cur_idx_ * interval_) {
+                if (mavg_to_add <= (unsigned int) cur_idx * interval_) {
                     mavg_in_average_count++;
                     mavg_cumulated += getItemValue((int)mavg_to_add / interval_, cap_file);
                     mavg_to_add += interval_;
@@ -1919,7 +1939,22 @@ void IOGraph::recalcGraphData(capture_file *cap_file)
 
 void IOGraph::setInterval(int interval)
 {
+    if (interval == interval_) return;
+
     interval_ = interval;
+    level_ = NULL;
+    if (!io_graph_store_select(store_, interval)) {
+        // Not an interval we keep items for, one finer than the store
+        // has left, or we've been keeping them for one that isn't
+        // offered. Start over.
+        io_graph_store_free(store_);
+        store_ = io_graph_store_new(io_graph_intervals_, (int) G_N_ELEMENTS(io_graph_intervals_), max_io_items_);
+        if (!io_graph_store_select(store_, interval)) {
+            io_graph_store_free(store_);
+            store_ = io_graph_store_new(&interval_, 1, max_io_items_);
+        }
+        emit requestRetap();
+    }
 }
 
 // Get the value at the given interval (idx) for the current value unit.
@@ -1928,12 +1963,10 @@ double IOGraph::getItemValue(int idx, capture_file *cap_file)
 {
     double     value = 0;          /* FIXME: loss of precision, visible on the graph for small values */
     int        adv_type;
-    io_graph_item_t *item;
+    const io_graph_item_t *item;
     guint32    interval;
 
-    g_assert(idx < max_io_items_);
-
-    item = &items_[idx];
+    item = io_graph_level_get_item(level_, idx);
 
     // Basic units
     switch (val_units_) {
@@ -2058,7 +2091,7 @@ double IOGraph::getItemValue(int idx, capture_file *cap_file)
             }
             break;
         case IOG_ITEM_UNIT_CALC_LOAD:
-            if (idx == (int)cur_idx_ && cap_file) {
+            if (level_ && idx == level_->cur_idx && cap_file) {
                 interval = (guint32)((cap_file->elapsed_time.secs*1000) +
                        ((cap_file->elapsed_time.nsecs+500000)/1000000));
                 interval -= (interval_ * idx);
@@ -2097,20 +2130,13 @@ gboolean IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dissect_t *e
     }
 
     int idx = get_io_graph_index(pinfo, iog->interval_);
-    bool recalc = false;
+    int prev_idx = io_graph_store_get_cur_idx(iog->store_, iog->interval_);
 
     /* some sanity checks */
-    if ((idx < 0) || (idx >= max_io_items_)) {
-        iog->cur_idx_ = max_io_items_ - 1;
+    if (idx < 0) {
         return FALSE;
     }
 
-    /* update num_items */
-    if (idx > iog->cur_idx_) {
-        iog->cur_idx_ = (guint32) idx;
-        recalc = true;
-    }
-
     /* set start time */
     if (iog->start_time_ == 0.0) {
         nstime_t start_nstime;
@@ -2125,16 +2151,15 @@ gboolean IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dissect_t *e
         adv_edt = edt;
     }
 
-    if (!update_io_graph_item(iog->items_, idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_)) {
-        return FALSE;
-    }
+    gboolean updated = io_graph_store_add_packet(iog->store_, pinfo, adv_edt, iog->hf_index_, iog->val_units_);
 
 //    qDebug() << "=tapPacket" << iog->name_ << idx << iog->hf_index_ << iog->val_units_ << iog->num_items_;
 
-    if (recalc) {
+    /* update num_items */
+    if (io_graph_store_get_cur_idx(iog->store_, iog->interval_) > prev_idx) {
         emit iog->requestRecalc();
     }
-    return TRUE;
+    return updated;
 }
 
 // "tap_draw" callback for register_tap_listener
@@ -118,9 +118,11 @@ private:
     double start_time_;
 
     // Cached data. We should be able to change the Y axis without retapping as
-    // much as is feasible.
-    io_graph_item_t items_[max_io_items_];
-    int cur_idx_;
+    // much as is feasible. Items are kept for a fine interval and rolled up
+    // into the coarser ones the dialog offers, so that changing the interval
+    // doesn't usually need a retap either.
+    io_graph_store_t *store_;
+    io_graph_level_t *level_; // The items for interval_, during recalcGraphData()
 };
 
 namespace Ui {
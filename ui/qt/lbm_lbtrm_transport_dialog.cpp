@@ -1134,6 +1134,7 @@ LBMLBTRMTransportDialog::LBMLBTRMTransportDialog(QWidget * parent, capture_file
     m_ui(new Ui::LBMLBTRMTransportDialog),
     m_dialog_info(NULL),
     m_capture_file(cfile),
+    m_tapping(false),
     m_current_source_transport(NULL),
     m_current_receiver_transport(NULL),
     m_source_context_menu(NULL),
@@ -1230,6 +1231,7 @@ LBMLBTRMTransportDialog::LBMLBTRMTransportDialog(QWidget * parent, capture_file
     m_ui->sources_TreeWidget->setColumnHidden(Source_NCFFramesCountBytes_Column, true);
     m_ui->sources_TreeWidget->setColumnHidden(Source_SMFramesBytes_Column, true);
 
+    connect(wsApp, SIGNAL(retapFinished(const capture_file *)), this, SLOT(retapFinished(const capture_file *)));
     connect(this, SIGNAL(accepted()), this, SLOT(closeDialog()));
     connect(this, SIGNAL(rejected()), this, SLOT(closeDialog()));
     fillTree();
@@ -1237,6 +1239,7 @@ LBMLBTRMTransportDialog::LBMLBTRMTransportDialog(QWidget * parent, capture_file
 
 LBMLBTRMTransportDialog::~LBMLBTRMTransportDialog(void)
 {
+    detachTap();
     resetSourcesDetail();
     resetSources();
     resetReceiversDetail();
@@ -1257,6 +1260,7 @@ void LBMLBTRMTransportDialog::setCaptureFile(capture_file * cfile)
 {
     if (cfile == NULL) // We only want to know when the file closes.
     {
+        detachTap();
         m_capture_file = NULL;
         m_ui->displayFilterLineEdit->setEnabled(false);
         m_ui->applyFilterButton->setEnabled(false);
@@ -1301,6 +1305,8 @@ void LBMLBTRMTransportDialog::fillTree(void)
     {
         return;
     }
+    // Our last retap hasn't finished. Start over.
+    detachTap();
     m_dialog_info->setDialog(this);
 
     error_string = register_tap_listener("lbtrm",
@@ -1316,11 +1322,35 @@ void LBMLBTRMTransportDialog::fillTree(void)
             error_string->str);
         g_string_free(error_string, TRUE);
         reject();
+        return;
     }
 
-    cf_retap_packets(m_capture_file);
+    // The packets are retapped along with those of any other dialogs
+    // waiting for them; see retapFinished().
+    m_tapping = true;
+    wsApp->queueRetap(m_capture_file);
+}
+
+void LBMLBTRMTransportDialog::retapFinished(const capture_file * cfile)
+{
+    Q_UNUSED(cfile)
+
+    if (!m_tapping)
+    {
+        return;
+    }
     drawTreeItems(&m_dialog_info);
+    detachTap();
+}
+
+void LBMLBTRMTransportDialog::detachTap(void)
+{
+    if (!m_tapping)
+    {
+        return;
+    }
     remove_tap_listener((void *)m_dialog_info);
+    m_tapping = false;
 }
 
 void LBMLBTRMTransportDialog::resetTap(void * tap_data)
@@ -62,6 +62,7 @@ class LBMLBTRMTransportDialog : public QDialog
         Ui::LBMLBTRMTransportDialog * m_ui;
         LBMLBTRMTransportDialogInfo * m_dialog_info;
         capture_file * m_capture_file;
+        bool m_tapping;
         LBMLBTRMSourceTransportEntry * m_current_source_transport;
         LBMLBTRMReceiverTransportEntry * m_current_receiver_transport;
         QMenu * m_source_context_menu;
@@ -73,6 +74,7 @@ class LBMLBTRMTransportDialog : public QDialog
         void resetSourcesDetail(void);
         void resetReceiversDetail(void);
         void fillTree(void);
+        void detachTap(void);
         static void resetTap(void * tap_data);
         static gboolean tapPacket(void * tap_data, packet_info * pinfo, epan_dissect_t * edt, const void * stream_info);
         static void drawTreeItems(void * tap_data);
@@ -85,6 +87,7 @@ class LBMLBTRMTransportDialog : public QDialog
 
     private slots:
         void closeDialog(void);
+        void retapFinished(const capture_file * cfile);
         void on_applyFilterButton_clicked(void);
 
         void sourcesDetailCurrentChanged(int Index);
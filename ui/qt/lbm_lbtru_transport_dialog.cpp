@@ -1473,6 +1473,7 @@ LBMLBTRUTransportDialog::LBMLBTRUTransportDialog(QWidget * parent, capture_file
     m_ui(new Ui::LBMLBTRUTransportDialog),
     m_dialog_info(NULL),
     m_capture_file(cfile),
+    m_tapping(false),
     m_current_source_transport(NULL),
     m_current_receiver_transport(NULL),
     m_source_context_menu(NULL),
@@ -1644,6 +1645,7 @@ LBMLBTRUTransportDialog::LBMLBTRUTransportDialog(QWidget * parent, capture_file
     m_ui->receivers_TreeWidget->setColumnHidden(Receiver_ACKFramesBytes_Column, true);
     m_ui->receivers_TreeWidget->setColumnHidden(Receiver_CREQFramesBytes_Column, true);
 
+    connect(wsApp, SIGNAL(retapFinished(const capture_file *)), this, SLOT(retapFinished(const capture_file *)));
     connect(this, SIGNAL(accepted()), this, SLOT(closeDialog()));
     connect(this, SIGNAL(rejected()), this, SLOT(closeDialog()));
     fillTree();
@@ -1651,6 +1653,7 @@ LBMLBTRUTransportDialog::LBMLBTRUTransportDialog(QWidget * parent, capture_file
 
 LBMLBTRUTransportDialog::~LBMLBTRUTransportDialog(void)
 {
+    detachTap();
     resetSourcesDetail();
     resetSources();
     resetReceiversDetail();
@@ -1671,6 +1674,7 @@ void LBMLBTRUTransportDialog::setCaptureFile(capture_file * cfile)
 {
     if (cfile == NULL) // We only want to know when the file closes.
     {
+        detachTap();
         m_capture_file = NULL;
         m_ui->displayFilterLineEdit->setEnabled(false);
         m_ui->applyFilterButton->setEnabled(false);
@@ -1719,6 +1723,8 @@ void LBMLBTRUTransportDialog::fillTree(void)
     {
         return;
     }
+    // Our last retap hasn't finished. Start over.
+    detachTap();
     m_dialog_info->setDialog(this);
 
     error_string = register_tap_listener("lbtru",
@@ -1734,11 +1740,35 @@ void LBMLBTRUTransportDialog::fillTree(void)
             error_string->str);
         g_string_free(error_string, TRUE);
         reject();
+        return;
     }
 
-    cf_retap_packets(m_capture_file);
+    // The packets are retapped along with those of any other dialogs
+    // waiting for them; see retapFinished().
+    m_tapping = true;
+    wsApp->queueRetap(m_capture_file);
+}
+
+void LBMLBTRUTransportDialog::retapFinished(const capture_file * cfile)
+{
+    Q_UNUSED(cfile)
+
+    if (!m_tapping)
+    {
+        return;
+    }
     drawTreeItems(&m_dialog_info);
+    detachTap();
+}
+
+void LBMLBTRUTransportDialog::detachTap(void)
+{
+    if (!m_tapping)
+    {
+        return;
+    }
     remove_tap_listener((void *)m_dialog_info);
+    m_tapping = false;
 }
 
 void LBMLBTRUTransportDialog::resetTap(void * tap_data)
@@ -62,6 +62,7 @@ class LBMLBTRUTransportDialog : public QDialog
         Ui::LBMLBTRUTransportDialog * m_ui;
         LBMLBTRUTransportDialogInfo * m_dialog_info;
         capture_file * m_capture_file;
+        bool m_tapping;
         LBMLBTRUSourceTransportEntry * m_current_source_transport;
         LBMLBTRUReceiverTransportEntry * m_current_receiver_transport;
         QMenu * m_source_context_menu;
@@ -75,6 +76,7 @@ class LBMLBTRUTransportDialog : public QDialog
         void resetSourcesDetail(void);
         void resetReceiversDetail(void);
         void fillTree(void);
+        void detachTap(void);
         static void resetTap(void * tap_data);
         static gboolean tapPacket(void * tap_data, packet_info * pinfo, epan_dissect_t * edt, const void * stream_info);
         static void drawTreeItems(void * tap_data);
@@ -89,6 +91,7 @@ class LBMLBTRUTransportDialog : public QDialog
 
     private slots:
         void closeDialog(void);
+        void retapFinished(const capture_file * cfile);
         void on_applyFilterButton_clicked(void);
 
         void sourcesDetailCurrentChanged(int index);
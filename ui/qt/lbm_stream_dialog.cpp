@@ -342,10 +342,12 @@ LBMStreamDialog::LBMStreamDialog(QWidget * parent, capture_file * cfile) :
     QDialog(parent),
     m_ui(new Ui::LBMStreamDialog),
     m_dialog_info(NULL),
-    m_capture_file(cfile)
+    m_capture_file(cfile),
+    m_tapping(false)
 {
     m_ui->setupUi(this);
     m_dialog_info = new LBMStreamDialogInfo();
+    connect(wsApp, SIGNAL(retapFinished(const capture_file *)), this, SLOT(retapFinished(const capture_file *)));
     connect(this, SIGNAL(accepted()), this, SLOT(closeDialog()));
     connect(this, SIGNAL(rejected()), this, SLOT(closeDialog()));
     fillTree();
@@ -353,6 +355,7 @@ LBMStreamDialog::LBMStreamDialog(QWidget * parent, capture_file * cfile) :
 
 LBMStreamDialog::~LBMStreamDialog(void)
 {
+    detachTap();
     delete m_ui;
     if (m_dialog_info != NULL)
     {
@@ -364,6 +367,7 @@ void LBMStreamDialog::setCaptureFile(capture_file * cfile)
 {
     if (cfile == NULL) // We only want to know when the file closes.
     {
+        detachTap();
         m_capture_file = NULL;
         m_ui->displayFilterLineEdit->setEnabled(false);
         m_ui->applyFilterButton->setEnabled(false);
@@ -378,6 +382,8 @@ void LBMStreamDialog::fillTree(void)
     {
         return;
     }
+    // Our last retap hasn't finished. Start over.
+    detachTap();
     m_dialog_info->setDialog(this);
 
     error_string = register_tap_listener("lbm_stream",
@@ -393,11 +399,35 @@ void LBMStreamDialog::fillTree(void)
             error_string->str);
         g_string_free(error_string, TRUE);
         reject();
+        return;
     }
 
-    cf_retap_packets(m_capture_file);
+    // The packets are retapped along with those of any other dialogs
+    // waiting for them; see retapFinished().
+    m_tapping = true;
+    wsApp->queueRetap(m_capture_file);
+}
+
+void LBMStreamDialog::retapFinished(const capture_file * cfile)
+{
+    Q_UNUSED(cfile)
+
+    if (!m_tapping)
+    {
+        return;
+    }
     drawTreeItems(&m_dialog_info);
+    detachTap();
+}
+
+void LBMStreamDialog::detachTap(void)
+{
+    if (!m_tapping)
+    {
+        return;
+    }
     remove_tap_listener((void *)m_dialog_info);
+    m_tapping = false;
 }
 
 void LBMStreamDialog::resetTap(void * tap_data)
@@ -58,14 +58,17 @@ class LBMStreamDialog : public QDialog
         Ui::LBMStreamDialog * m_ui;
         LBMStreamDialogInfo * m_dialog_info;
         capture_file * m_capture_file;
+        bool m_tapping;
 
         void fillTree(void);
+        void detachTap(void);
         static void resetTap(void * tap_data);
         static gboolean tapPacket(void * tap_data, packet_info * pinfo, epan_dissect_t * edt, const void * stream_info);
         static void drawTreeItems(void * tap_data);
 
     private slots:
         void closeDialog(void);
+        void retapFinished(const capture_file * cfile);
         void on_applyFilterButton_clicked(void);
 };
 
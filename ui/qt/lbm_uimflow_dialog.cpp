@@ -177,7 +177,7 @@ static void lbm_uimflow_get_analysis(capture_file * cfile, seq_analysis_info_t *
     gchar time_str[COL_MAX_LEN];
 
     register_tap_listener("lbm_uim", (void *)seq_info, NULL, TL_REQUIRES_COLUMNS, NULL, lbm_uimflow_tap_packet, NULL);
-    cf_retap_packets(cfile);
+    cf_retap_pending_packets(cfile);
     seq_info->list = g_list_reverse(seq_info->list);
     remove_tap_listener((void *)seq_info);
 
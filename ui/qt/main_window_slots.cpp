@@ -342,6 +342,9 @@ void MainWindow::captureCaptureUpdateFinished(capture_session *cap_session) {
     /* The capture isn't stopping any more - it's stopped. */
     capture_stopping_ = false;
 
+    /* Sort the packets that arrived while it was running */
+    packet_list_->packetListModel()->applyPendingSort();
+
     /* Update the main window as appropriate */
     updateForUnsavedChanges();
 
@@ -1127,6 +1130,7 @@ void MainWindow::fieldsChanged()
 {
     // Reload color filters
     color_filters_reload();
+    wsApp->emitAppSignal(WiresharkApplication::ColorFiltersChanged);
 
     // Syntax check filter
     // TODO: Check if syntax filter is still valid after fields have changed
@@ -51,6 +51,7 @@
 #include <QTextEdit>
 #include <QScrollBar>
 #include <QContextMenuEvent>
+#include <QHeaderView>
 #include <QMessageBox>
 
 // If we ever add the ability to open multiple capture files we might be
@@ -239,6 +240,9 @@ PacketList::PacketList(QWidget *parent) :
     setModel(packet_list_model_);
     packet_list_model_->setColorEnabled(recent.packet_list_colorize);
 
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(prefetchVisibleRows()));
+    connect(verticalScrollBar(), SIGNAL(rangeChanged(int,int)), this, SLOT(prefetchVisibleRows()));
+
     // XXX We might want to reimplement setParent() and fill in the context
     // menu there.
     ctx_menu_.addAction(window()->findChild<QAction *>("actionEditMarkPacket"));
@@ -528,7 +532,7 @@ void PacketList::contextMenuEvent(QContextMenuEvent *event)
 void PacketList::markFramesReady()
 {
     packets_bar_update();
-    updateAll();
+    updatePacketDetails();
 }
 
 void PacketList::setFrameMark(gboolean set, frame_data *fdata)
@@ -562,7 +566,16 @@ void PacketList::setFrameReftime(gboolean set, frame_data *fdata)
         cap_file_->displayed_count--;
         packet_list_model_->recreateVisibleRows();
     }
-    updateAll();
+
+    // The frames from this one up to the next time reference are now
+    // relative to a different one.
+    guint32 last_num = fdata->num;
+    while (last_num < cap_file_->count) {
+        frame_data *next_fdata = frame_data_sequence_find(cap_file_->frames, last_num + 1);
+        if (next_fdata->flags.ref_time) break;
+        last_num++;
+    }
+    packet_list_model_->invalidateFrames(fdata->num, last_num);
 }
 
 // Redraw the packet list and detail
@@ -571,6 +584,17 @@ void PacketList::updateAll() {
 
     if (!cap_file_) return;
 
+    updatePacketDetails();
+
+    packet_list_model_->resetColumns();
+}
+
+// Redraw the detail of the selected packet, e.g. after its frame_data
+// changed. Cached packet list text is left alone.
+void PacketList::updatePacketDetails()
+{
+    if (!cap_file_) return;
+
     if (selectedIndexes().length() > 0) {
         cf_select_packet(cap_file_, selectedIndexes()[0].row());
     }
@@ -578,8 +602,6 @@ void PacketList::updateAll() {
     if (cap_file_->edt && cap_file_->edt->tree) {
         proto_tree_->fillProtocolTree(cap_file_->edt->tree);
     }
-
-    packet_list_model_->resetColumns();
 }
 
 void PacketList::freeze()
@@ -592,6 +614,7 @@ void PacketList::thaw()
 {
     setModel(packet_list_model_);
     setUpdatesEnabled(true);
+    prefetchVisibleRows();
 }
 
 void PacketList::clear() {
@@ -601,10 +624,11 @@ void PacketList::clear() {
     proto_tree_->clear();
     byte_view_tab_->clear();
 
-    /* XXX is this correct in all cases?
-     * Reset the sort column, use packetlist as model in case the list is frozen.
+    /* Clear the sort indicator, which leaves the rows in frame order.
+     * Sorting by the first column instead would sort every time the rows
+     * are recreated.
      */
-    sortByColumn(0, Qt::AscendingOrder);
+    header()->setSortIndicator(-1, Qt::AscendingOrder);
 }
 
 void PacketList::writeRecent(FILE *rf) {
@@ -741,7 +765,9 @@ void PacketList::setPacketComment(QString new_comment)
 
     cf_set_user_packet_comment(cap_file_, fdata, new_packet_comment);
 
-    updateAll();
+    // Only this frame's dissection changes
+    packet_list_model_->invalidateFrames(fdata->num, fdata->num);
+    updatePacketDetails();
 }
 
 QString PacketList::allPacketComments()
@@ -811,7 +837,11 @@ void PacketList::markFrame()
 
     fdata = packet_list_model_->getRowFdata(row);
 
+    if (!fdata) return;
+
     setFrameMark(!fdata->flags.marked, fdata);
+    // Marking changes the row's colors, and frame.marked
+    packet_list_model_->invalidateFrames(fdata->num, fdata->num);
     markFramesReady();
 }
 
@@ -827,6 +857,7 @@ void PacketList::markAllDisplayedFrames(bool set)
         if (fdata->flags.passed_dfilter)
             setFrameMark(set, fdata);
     }
+    packet_list_model_->invalidateFrames(1, cap_file_->count);
     markFramesReady();
 }
 
@@ -875,13 +906,15 @@ void PacketList::setTimeReference()
                 timestamp_set_type(TS_RELATIVE);
                 recent.gui_time_format  = TS_RELATIVE;
                 cf_timestamp_auto_precision(cap_file_);
+                updateAll();
             }
         } else {
             setFrameReftime(!cap_file_->current_frame->flags.ref_time,
                             cap_file_->current_frame);
+            update();
+            updatePacketDetails();
         }
     }
-    updateAll();
 }
 
 void PacketList::unsetAllTimeReferences()
@@ -897,7 +930,8 @@ void PacketList::unsetAllTimeReferences()
             setFrameReftime(FALSE, fdata);
         }
     }
-    updateAll();
+    update();
+    updatePacketDetails();
 }
 
 void PacketList::addRelatedFrame(int related_frame)
@@ -905,6 +939,20 @@ void PacketList::addRelatedFrame(int related_frame)
     related_packet_delegate_.addRelatedFrame(related_frame);
 }
 
+// Have the model read and columnize the rows around the viewport so that
+// they're ready by the time we scroll to them.
+void PacketList::prefetchVisibleRows()
+{
+    if (!packet_list_model_ || model() != packet_list_model_) return;
+
+    QModelIndex first = indexAt(viewport()->rect().topLeft());
+    QModelIndex last = indexAt(viewport()->rect().bottomLeft());
+    int first_row = first.isValid() ? first.row() : 0;
+    int last_row = last.isValid() ? last.row() : packet_list_model_->rowCount() - 1;
+
+    packet_list_model_->prefetchRows(first_row, last_row);
+}
+
 /*
  * Editor modelines
  *
@@ -70,6 +70,7 @@ private:
     RelatedPacketDelegate related_packet_delegate_;
 
     void markFramesReady();
+    void updatePacketDetails();
     void setFrameMark(gboolean set, frame_data *fdata);
     void setFrameIgnore(gboolean set, frame_data *fdata);
     void setFrameReftime(gboolean set, frame_data *fdata);
@@ -94,6 +95,7 @@ public slots:
 
 private slots:
     void addRelatedFrame(int related_frame);
+    void prefetchVisibleRows();
 };
 
 #endif // PACKET_LIST_H
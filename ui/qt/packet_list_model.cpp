@@ -28,6 +28,7 @@
 #include <epan/prefs.h>
 
 #include "ui/packet_list_utils.h"
+#include "ui/progress_dlg.h"
 #include "ui/recent.h"
 
 #include "color.h"
@@ -36,12 +37,164 @@
 
 #include "wireshark_application.h"
 #include <QColor>
+#include <QElapsedTimer>
 #include <QModelIndex>
+#include <QTimer>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Rows read ahead of and behind the viewport.
+const int prefetch_ahead_ = 500;
+const int prefetch_behind_ = 100;
+// Time budget for columnizing prefetched rows before yielding to the
+// event loop. Keeps scrolling at 60 fps.
+const int columnize_slice_ms_ = 8;
+
+// Sort key extracted from a row's column text. Numeric keys sort before
+// text keys; ties are broken by frame number.
+typedef struct {
+    PacketListRecord *record;
+    double num;
+    const gchar *str; /* NULL for numeric keys */
+} sort_key_t;
+
+class SortKeyLessThan
+{
+public:
+    SortKeyLessThan(Qt::SortOrder order) : descending_(order == Qt::DescendingOrder) {}
+    bool operator()(const sort_key_t &a, const sort_key_t &b) const {
+        int ret;
+
+        if (!a.str && !b.str) {
+            ret = a.num < b.num ? -1 : (a.num > b.num ? 1 : 0);
+        } else if (!a.str || !b.str) {
+            ret = a.str ? 1 : -1;
+        } else if (a.str == b.str) {
+            ret = 0; /* Interned, no need to call strcmp() */
+        } else {
+            ret = strcmp(a.str, b.str);
+        }
+
+        if (ret == 0) {
+            guint32 num_a = a.record->getFdata()->num;
+            guint32 num_b = b.record->getFdata()->num;
+            ret = num_a < num_b ? -1 : (num_a > num_b ? 1 : 0);
+        }
+
+        return descending_ ? ret > 0 : ret < 0;
+    }
+private:
+    bool descending_;
+};
+
+class FrameDataLessThan
+{
+public:
+    FrameDataLessThan(const struct epan_session *epan, int field, Qt::SortOrder order) :
+        epan_(epan), field_(field), descending_(order == Qt::DescendingOrder) {}
+    bool operator()(PacketListRecord *a, PacketListRecord *b) const {
+        gint ret = frame_data_compare(epan_, a->getFdata(), b->getFdata(), field_);
+        return descending_ ? ret > 0 : ret < 0;
+    }
+private:
+    const struct epan_session *epan_;
+    int field_;
+    bool descending_;
+};
+
+// Parse a dotted quad so that IPv4 addresses sort numerically.
+static gboolean
+ipv4_sort_key(const gchar *str, double *num)
+{
+    guint a, b, c, d;
+    char extra;
+
+    if (sscanf(str, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4)
+        return FALSE;
+    if (a > 255 || b > 255 || c > 255 || d > 255)
+        return FALSE;
+
+    *num = (double) ((a << 24) | (b << 16) | (c << 8) | d);
+    return TRUE;
+}
+
+// Copied from ui/gtk/packet_list_store.c:packet_list_compare_custom
+static gboolean
+custom_column_is_numeric(column_info *cinfo, int column)
+{
+    header_field_info *hfi = proto_registrar_get_byname(cinfo->col_custom_field[column]);
+
+    if (!hfi || hfi->strings != NULL)
+        return FALSE;
+
+    return (((IS_FT_INT(hfi->type) || IS_FT_UINT(hfi->type)) &&
+             ((hfi->display == BASE_DEC) || (hfi->display == BASE_DEC_HEX) ||
+              (hfi->display == BASE_OCT))) ||
+            (hfi->type == FT_DOUBLE) || (hfi->type == FT_FLOAT) ||
+            (hfi->type == FT_BOOLEAN) || (hfi->type == FT_FRAMENUM) ||
+            (hfi->type == FT_RELATIVE_TIME));
+}
+
+static gboolean
+column_is_address(column_info *cinfo, int column)
+{
+    switch (cinfo->col_fmt[column]) {
+    case COL_DEF_SRC:
+    case COL_RES_SRC:
+    case COL_UNRES_SRC:
+    case COL_DEF_NET_SRC:
+    case COL_RES_NET_SRC:
+    case COL_UNRES_NET_SRC:
+    case COL_DEF_DST:
+    case COL_RES_DST:
+    case COL_UNRES_DST:
+    case COL_DEF_NET_DST:
+    case COL_RES_NET_DST:
+    case COL_UNRES_NET_DST:
+        return TRUE;
+    case COL_CUSTOM:
+    {
+        header_field_info *hfi = proto_registrar_get_byname(cinfo->col_custom_field[column]);
+        return hfi && hfi->type == FT_IPv4;
+    }
+    default:
+        break;
+    }
+    return FALSE;
+}
 
 PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
-    QAbstractItemModel(parent)
+    QAbstractItemModel(parent),
+    enable_color_(false),
+    sort_column_(-1),
+    sort_order_(Qt::AscendingOrder),
+    sort_pending_(false)
 {
     cap_file_ = cf;
+    connect(wsApp, SIGNAL(preferencesChanged()), this, SLOT(resetColorized()));
+    connect(wsApp, SIGNAL(colorFiltersChanged()), this, SLOT(resetColorized()));
+
+    prefetch_thread_ = new QThread;
+    prefetch_worker_ = new PacketListPrefetchWorker;
+    prefetch_worker_->moveToThread(prefetch_thread_);
+    connect(prefetch_thread_, SIGNAL(started()), prefetch_worker_, SLOT(start()));
+    connect(prefetch_worker_, SIGNAL(recordsReady()),
+            this, SLOT(columnizePrefetchedRecords()), Qt::QueuedConnection);
+    connect(prefetch_thread_, SIGNAL(finished()), prefetch_worker_, SLOT(deleteLater()));
+    prefetch_thread_->start();
+}
+
+PacketListModel::~PacketListModel()
+{
+    prefetch_worker_->stop();
+    prefetch_thread_->quit();
+    prefetch_thread_->wait();
+    delete prefetch_thread_;
+
+    qDeleteAll(physical_rows_);
+    PacketListRecord::invalidateAll();
 }
 
 void PacketListModel::setCaptureFile(capture_file *cf)
@@ -78,41 +231,159 @@ int PacketListModel::packetNumberToRow(int packet_num) const
 guint PacketListModel::recreateVisibleRows()
 {
     int pos = visible_rows_.count() + 1;
+    QVector<PacketListRecord *> new_rows;
     PacketListRecord *record;
 
+    foreach (record, physical_rows_) {
+        if (record->getFdata()->flags.passed_dfilter || record->getFdata()->flags.ref_time) {
+            new_rows << record;
+        }
+    }
+
+    // Only the rows that were shown were sorted; sort the new set now,
+    // before we tell the view about it. If that's cancelled they're
+    // left in frame order.
+    if (sort_column_ >= 0) {
+        sort_pending_ = !sortRows(sort_column_, sort_order_, new_rows);
+    }
+
     beginResetModel();
     visible_rows_.clear();
     number_to_row_.clear();
     endResetModel();
     beginInsertRows(QModelIndex(), pos, pos);
-    foreach (record, physical_rows_) {
-        if (record->getFdata()->flags.passed_dfilter || record->getFdata()->flags.ref_time) {
-            visible_rows_ << record;
-            number_to_row_[record->getFdata()->num] = visible_rows_.count() - 1;
-        }
+    foreach (record, new_rows) {
+        visible_rows_ << record;
+        number_to_row_[record->getFdata()->num] = visible_rows_.count() - 1;
     }
     endInsertRows();
     return visible_rows_.count();
 }
 
 void PacketListModel::setColorEnabled(bool enable_color) {
+    if (enable_color != enable_color_)
+        PacketListRecord::invalidateAll();
     enable_color_ = enable_color;
 }
 
 void PacketListModel::clear() {
     beginResetModel();
+    qDeleteAll(physical_rows_);
     physical_rows_.clear();
     visible_rows_.clear();
     number_to_row_.clear();
+    sort_column_ = -1;
+    sort_pending_ = false;
+    prefetched_.clear();
+    prefetch_worker_->setCaptureFile(QString(), WTAP_TYPE_AUTO);
+    PacketListRecord::invalidateAll();
     endResetModel();
 }
 
 void PacketListModel::resetColumns()
 {
     beginResetModel();
+    PacketListRecord::resetColumns(cap_file_ ? &cap_file_->cinfo : NULL);
     endResetModel();
 }
 
+void PacketListModel::invalidateFrames(guint32 first_frame, guint32 last_frame)
+{
+    int first_row = -1, last_row = -1;
+
+    // Records are in frame order in physical_rows_.
+    for (guint32 num = first_frame; num != 0 && num <= last_frame && num <= (guint32) physical_rows_.count(); num++) {
+        physical_rows_[num - 1]->invalidate();
+
+        int row = packetNumberToRow(num);
+        if (row < 0) continue;
+        if (first_row < 0 || row < first_row) first_row = row;
+        if (row > last_row) last_row = row;
+    }
+
+    if (first_row >= 0) {
+        emit dataChanged(index(first_row, 0), index(last_row, columnCount() - 1));
+    }
+}
+
+void PacketListModel::prefetchRows(int first_row, int last_row)
+{
+    // We need a complete file and stable dissection state.
+    if (!cap_file_ || cap_file_->state != FILE_READ_DONE || cap_file_->redissecting
+            || !cap_file_->filename || visible_rows_.isEmpty())
+        return;
+
+    prefetch_worker_->setCaptureFile(cap_file_->filename, cap_file_->open_type);
+
+    first_row = qMax(first_row - prefetch_behind_, 0);
+    last_row = qMin(last_row + prefetch_ahead_, visible_rows_.count() - 1);
+
+    QList<QPair<guint32, gint64> > frames;
+    for (int row = first_row; row <= last_row; row++) {
+        PacketListRecord *record = visible_rows_[row];
+        frame_data *fdata = record->getFdata();
+
+        // Edited frames (file_off == -1) aren't in the file.
+        if (!record->needsColumnizing(enable_color_) || fdata->file_off < 0)
+            continue;
+
+        frames << QPair<guint32, gint64>(fdata->num, fdata->file_off);
+    }
+
+    prefetch_worker_->prefetch(frames);
+}
+
+void PacketListModel::columnizePrefetchedRecords()
+{
+    QElapsedTimer slice_timer;
+    int first_row = -1, last_row = -1;
+
+    prefetched_ << prefetch_worker_->takeRecords();
+
+    if (!cap_file_ || cap_file_->state != FILE_READ_DONE || cap_file_->redissecting) {
+        prefetched_.clear();
+        return;
+    }
+
+    slice_timer.start();
+    while (!prefetched_.isEmpty() && slice_timer.elapsed() < columnize_slice_ms_) {
+        prefetched_record_t pr = prefetched_.takeFirst();
+        int row = packetNumberToRow(pr.frame_num);
+
+        if (row < 0) continue;
+
+        PacketListRecord *record = visible_rows_[row];
+        if (record->getFdata()->file_off != pr.file_off || !record->needsColumnizing(enable_color_))
+            continue;
+
+        Buffer buf;
+        buffer_init(&buf, qMax(pr.data.size(), 1));
+        memcpy(buffer_start_ptr(&buf), pr.data.constData(), pr.data.size());
+        if (!pr.comment.isEmpty()) {
+            pr.phdr.opt_comment = pr.comment.data();
+        }
+        record->columnize(cap_file_, &pr.phdr, &buf, enable_color_);
+        buffer_free(&buf);
+
+        if (first_row < 0 || row < first_row) first_row = row;
+        if (row > last_row) last_row = row;
+    }
+
+    if (first_row >= 0) {
+        emit dataChanged(index(first_row, 0), index(last_row, columnCount() - 1));
+    }
+
+    if (!prefetched_.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(columnizePrefetchedRecords()));
+    }
+}
+
+void PacketListModel::resetColorized()
+{
+    PacketListRecord::invalidateAll();
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+}
+
 int PacketListModel::rowCount(const QModelIndex &parent) const
 {
     if (!cap_file_) return 0;
@@ -132,6 +403,30 @@ int PacketListModel::columnCount(const QModelIndex &parent) const
     return cap_file_->cinfo.num_cols;
 }
 
+void PacketListModel::repaintRow(int row)
+{
+    if (row < 0 || row >= visible_rows_.count())
+        return;
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+}
+
+// data() is called while the view paints, so the view isn't told about
+// the new colors until the event loop runs again.
+void PacketListModel::queueRowRepaint(int row) const
+{
+    QMetaObject::invokeMethod(const_cast<PacketListModel *>(this), "repaintRow",
+                              Qt::QueuedConnection, Q_ARG(int, row));
+}
+
+// The color filter a frame was colored with, if any.
+static const color_filter_t *
+frame_color_filter(capture_file *cf, const frame_data *fdata)
+{
+    if (!cf || !cf->frames)
+        return NULL;
+    return (const color_filter_t *) frame_data_sequence_get_color_filter(cf->frames, fdata);
+}
+
 QVariant PacketListModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid())
@@ -169,167 +464,330 @@ QVariant PacketListModel::data(const QModelIndex &index, int role) const
 
     case Qt::BackgroundRole:
         const color_t *color;
+        if (enable_color_ && record->colorize(cap_file_))
+            queueRowRepaint(index.row());
         if (fdata->flags.ignored) {
             color = &prefs.gui_ignored_bg;
         } else if (fdata->flags.marked) {
             color = &prefs.gui_marked_bg;
-        } else if (fdata->color_filter) {
-            const color_filter_t *color_filter = (const color_filter_t *) fdata->color_filter;
-            color = &color_filter->bg_color;
+        } else if (enable_color_ && frame_color_filter(cap_file_, fdata)) {
+            color = &frame_color_filter(cap_file_, fdata)->bg_color;
         } else {
             return QVariant();
         }
-//        g_log(NULL, G_LOG_LEVEL_DEBUG, "i: %d m: %d cf: %p bg: %d %d %d", fdata->flags.ignored, fdata->flags.marked, fdata->color_filter, color->red, color->green, color->blue);
+//        g_log(NULL, G_LOG_LEVEL_DEBUG, "i: %d m: %d cf: %p bg: %d %d %d", fdata->flags.ignored, fdata->flags.marked, frame_color_filter(cap_file_, fdata), color->red, color->green, color->blue);
         return QColor(color->red >> 8, color->green >> 8, color->blue >> 8);
     case Qt::ForegroundRole:
+        if (enable_color_ && record->colorize(cap_file_))
+            queueRowRepaint(index.row());
         if (fdata->flags.ignored) {
             color = &prefs.gui_ignored_fg;
         } else if (fdata->flags.marked) {
             color = &prefs.gui_marked_fg;
-        } else if (fdata->color_filter) {
-            const color_filter_t *color_filter = (const color_filter_t *) fdata->color_filter;
-            color = &color_filter->fg_color;
+        } else if (enable_color_ && frame_color_filter(cap_file_, fdata)) {
+            color = &frame_color_filter(cap_file_, fdata)->fg_color;
         } else {
             return QVariant();
         }
         return QColor(color->red >> 8, color->green >> 8, color->blue >> 8);
     case Qt::DisplayRole:
-        // Need packet data -- fall through
-        break;
+        return record->columnString(cap_file_, index.column(), enable_color_);
     default:
-        return QVariant();
+        break;
     }
+    return QVariant();
+}
 
-    int col_num = index.column();
-//    g_log(NULL, G_LOG_LEVEL_DEBUG, "showing col %d", col_num);
+QVariant PacketListModel::headerData(int section, Qt::Orientation orientation,
+                               int role) const
+{
+    if (!cap_file_) return QVariant();
 
-    if (!cap_file_ || col_num > cap_file_->cinfo.num_cols)
-        return QVariant();
+    if (orientation == Qt::Horizontal && section < cap_file_->cinfo.num_cols) {
+        switch (role) {
+        case Qt::DisplayRole:
+            return cap_file_->cinfo.col_title[section];
+        default:
+            break;
+        }
+    }
 
-    epan_dissect_t edt;
-    column_info *cinfo;
-    gboolean create_proto_tree;
-    struct wtap_pkthdr phdr; /* Packet header */
-    Buffer buf;  /* Packet data */
-    gboolean dissect_columns = TRUE; // XXX - Currently only a placeholder
+    return QVariant();
+}
 
-    if (dissect_columns && cap_file_)
-        cinfo = &cap_file_->cinfo;
-    else
-        cinfo = NULL;
+// Only the visible rows are sorted; physical_rows_ stays in frame order.
+// Rows that are hidden by the display filter are sorted when they're
+// shown, in recreateVisibleRows().
+// Sorting by a negative column, which is what the view asks for when its
+// sort indicator is cleared, puts the rows back in frame order.
+void PacketListModel::sort(int column, Qt::SortOrder order)
+{
+    if (!cap_file_ || column >= cap_file_->cinfo.num_cols)
+        return;
+
+    if (column < 0 || isFrameOrder(column, order)) {
+        bool sorted = sort_column_ >= 0 || sort_pending_;
+
+        sort_column_ = -1;
+        sort_pending_ = false;
+        if (sorted && visible_rows_.count() > 0) {
+            // Rows are in frame order in physical_rows_.
+            QVector<PacketListRecord *> sorted_rows;
+            foreach (PacketListRecord *record, physical_rows_) {
+                if (packetNumberToRow(record->getFdata()->num) >= 0)
+                    sorted_rows << record;
+            }
+            applySortOrder(sorted_rows);
+        }
+        return;
+    }
 
-    memset(&phdr, 0, sizeof(struct wtap_pkthdr));
+    if (visible_rows_.count() < 1) {
+        sort_column_ = column;
+        sort_order_ = order;
+        return;
+    }
+
+    QVector<PacketListRecord *> sorted_rows = visible_rows_;
+    if (sortRows(column, order, sorted_rows)) {
+        sort_column_ = column;
+        sort_order_ = order;
+        sort_pending_ = false;
+        applySortOrder(sorted_rows);
+    }
+}
+
+void PacketListModel::applyPendingSort()
+{
+    if (!sort_pending_ || sort_column_ < 0)
+        return;
+
+    QVector<PacketListRecord *> sorted_rows = visible_rows_;
+    if (sortRows(sort_column_, sort_order_, sorted_rows)) {
+        sort_pending_ = false;
+        applySortOrder(sorted_rows);
+    }
+}
+
+// Sorting by ascending frame number doesn't change anything; remember
+// it as frame order so that we don't sort again and again.
+bool PacketListModel::isFrameOrder(int column, Qt::SortOrder order) const
+{
+    return order == Qt::AscendingOrder &&
+            cap_file_->cinfo.col_fmt[column] == COL_NUMBER;
+}
 
+// Sort rows in place. Returns false, leaving rows alone, if they can't
+// be sorted right now or the user cancelled.
+bool PacketListModel::sortRows(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows)
+{
+    if (!cap_file_ || column < 0 || column >= cap_file_->cinfo.num_cols || rows.count() < 1)
+        return false;
+
+    // Don't pull the rug out from under a read or redissection in progress.
+    if (cap_file_->state != FILE_READ_DONE || cap_file_->redissecting)
+        return false;
+
+    if (col_based_on_frame_data(&cap_file_->cinfo, column)) {
+        return sortByFrameData(column, order, rows);
+    }
+    return sortByColumnText(column, order, rows);
+}
+
+bool PacketListModel::sortByFrameData(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows)
+{
+    std::stable_sort(rows.begin(), rows.end(),
+                     FrameDataLessThan(cap_file_->epan, cap_file_->cinfo.col_fmt[column], order));
+    return true;
+}
+
+// Extract a typed sort key for every row in one streaming pass, then merge
+// sort the keys. Only the resulting row order is kept. Rows that are in the
+// column cache aren't dissected again.
+bool PacketListModel::sortByColumnText(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows)
+{
+    column_info *cinfo = &cap_file_->cinfo;
+    gboolean numeric, address;
+    GStringChunk *text_pool;
+    GHashTable *text_table;
+    QVector<sort_key_t> keys;
+    struct wtap_pkthdr phdr; /* Packet header */
+    Buffer buf; /* Packet data */
+    int row_count = rows.count();
+    int physical_count = physical_rows_.count();
+
+    int          progbar_nextstep;
+    int          progbar_quantum;
+    gboolean     progbar_stop_flag;
+    GTimeVal     progbar_start_time;
+    float        progbar_val;
+    progdlg_t   *progbar = NULL;
+    gchar        progbar_status_str[100];
+    const int    progbar_updates = 100 /* 100% */;
+
+    numeric = right_justify_column(column, cap_file_) ||
+              (cinfo->col_fmt[column] == COL_CUSTOM && custom_column_is_numeric(cinfo, column));
+    address = column_is_address(cinfo, column);
+
+    text_pool = g_string_chunk_new(4096);
+    text_table = g_hash_table_new(g_str_hash, g_str_equal);
+    keys.reserve(row_count);
     buffer_init(&buf, 1500);
-    if (!cap_file_ || !cf_read_record_r(cap_file_, fdata, &phdr, &buf)) {
-        /*
-         * Error reading the record.
-         *
-         * Don't set the color filter for now (we might want
-         * to colorize it in some fashion to warn that the
-         * row couldn't be filled in or colorized), and
-         * set the columns to placeholder values, except
-         * for the Info column, where we'll put in an
-         * error message.
-         */
-        if (dissect_columns) {
-            col_fill_in_error(cinfo, fdata, FALSE, FALSE /* fill_fd_columns */);
-
-            //            for(gint col = 0; col < cinfo->num_cols; ++col) {
-            //                /* Skip columns based on frame_data because we already store those. */
-            //                if (!col_based_on_frame_data(cinfo, col))
-            //                    packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-            //            }
-            //            record->columnized = TRUE;
-        }
-        if (enable_color_) {
-            fdata->color_filter = NULL;
-            //            record->colorized = TRUE;
+
+    progbar_nextstep = 0;
+    progbar_quantum = row_count / progbar_updates;
+    progbar_val = 0.0f;
+    progbar_stop_flag = FALSE;
+    g_get_current_time(&progbar_start_time);
+
+    // Stop if the list is cleared while we're processing events.
+    for (int row = 0; row < row_count && physical_rows_.count() == physical_count; row++) {
+        PacketListRecord *record = rows[row];
+        frame_data *fdata = record->getFdata();
+        const gchar *text = record->cachedColumnText(column);
+        epan_dissect_t edt;
+        sort_key_t key;
+        bool dissected = false;
+
+        if (!text) {
+            memset(&phdr, 0, sizeof(struct wtap_pkthdr));
+            if (cf_read_record_r(cap_file_, fdata, &phdr, &buf)) {
+                epan_dissect_init(&edt, cap_file_->epan, have_custom_cols(cinfo), FALSE);
+                col_custom_prime_edt(&edt, cinfo);
+                epan_dissect_run(&edt, cap_file_->cd_t, &phdr, frame_tvbuff_new_buffer(fdata, &buf), fdata, cinfo);
+                epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+                if (!get_column_resolved(column) && cinfo->col_expr.col_expr_val[column]) {
+                    text = cinfo->col_expr.col_expr_val[column];
+                } else {
+                    text = cinfo->col_data[column];
+                }
+                dissected = true;
+            }
+            if (!text) text = "";
         }
-        buffer_free(&buf);
-        return QVariant();	/* error reading the record */
-    }
 
-    create_proto_tree = (color_filters_used() && enable_color_) ||
-                        (have_custom_cols(cinfo) && dissect_columns);
+        key.record = record;
+        key.str = NULL;
+        if (address && ipv4_sort_key(text, &key.num)) {
+            /* Numeric address */
+        } else {
+            gchar *end = NULL;
+            if (numeric) key.num = g_ascii_strtod(text, &end);
+            if (!numeric || end == text) {
+                key.str = (const gchar *) g_hash_table_lookup(text_table, text);
+                if (!key.str) {
+                    gchar *interned = g_string_chunk_insert(text_pool, text);
+                    g_hash_table_insert(text_table, interned, interned);
+                    key.str = interned;
+                }
+            }
+        }
+        keys << key;
 
-    epan_dissect_init(&edt, cap_file_->epan,
-                      create_proto_tree,
-                      FALSE /* proto_tree_visible */);
+        if (dissected) epan_dissect_cleanup(&edt);
 
-    if (enable_color_)
-        color_filters_prime_edt(&edt);
-    if (dissect_columns)
-        col_custom_prime_edt(&edt, cinfo);
+        /* Create the progress bar if necessary. */
+        if (progbar == NULL)
+            progbar = delayed_create_progress_dlg(cap_file_->window, "Sorting", "Packets",
+                                                  TRUE, &progbar_stop_flag,
+                                                  &progbar_start_time, progbar_val);
 
-    epan_dissect_run(&edt, cap_file_->cd_t, &phdr, frame_tvbuff_new_buffer(fdata, &buf), fdata, cinfo);
+        if (row >= progbar_nextstep) {
+            progbar_val = (gfloat) row / row_count;
 
-    if (enable_color_)
-        fdata->color_filter = color_filters_colorize_packet(&edt);
+            if (progbar != NULL) {
+                g_snprintf(progbar_status_str, sizeof(progbar_status_str),
+                           "%u of %u frames", row + 1, row_count);
+                update_progress_dlg(progbar, progbar_val, progbar_status_str);
+            }
 
-    if (dissect_columns) {
-        /* "Stringify" non frame_data vals */
-        epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+            progbar_nextstep += progbar_quantum;
+        }
 
-        //            for(col = 0; col < cinfo->num_cols; ++col) {
-        //                    /* Skip columns based on frame_data because we already store those. */
-        //                    if (!col_based_on_frame_data(cinfo, col))
-        //                            packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-        //            }
-//        g_log(NULL, G_LOG_LEVEL_DEBUG, "d_c %d: %s", col_num, cinfo->col_data[col_num]);
+        if (progbar_stop_flag) {
+            /* Well, the user decided to abort ... */
+            break;
+        }
     }
 
-    //    if (dissect_columns)
-    //            record->columnized = TRUE;
-    //    if (enable_color_)
-    //            record->colorized = TRUE;
-
-    epan_dissect_cleanup(&edt);
+    /* We're done; destroy the progress bar if it was created. */
+    if (progbar != NULL)
+        destroy_progress_dlg(progbar);
     buffer_free(&buf);
 
-    switch (role) {
-    case Qt::DisplayRole:
-        return record->data(col_num, cinfo);
-        break;
-    default:
-        break;
+    // The list might have changed underneath us while we processed events.
+    bool completed = !progbar_stop_flag && keys.count() == row_count && physical_rows_.count() == physical_count;
+    if (completed) {
+        std::stable_sort(keys.begin(), keys.end(), SortKeyLessThan(order));
+
+        for (int row = 0; row < row_count; row++) {
+            rows[row] = keys[row].record;
+        }
+        keys.clear();
     }
-    return QVariant();
+
+    g_hash_table_destroy(text_table);
+    g_string_chunk_free(text_pool);
+    return completed;
 }
 
-QVariant PacketListModel::headerData(int section, Qt::Orientation orientation,
-                               int role) const
+void PacketListModel::applySortOrder(const QVector<PacketListRecord *> &sorted_rows)
 {
-    if (!cap_file_) return QVariant();
+    emit layoutAboutToBeChanged();
 
-    if (orientation == Qt::Horizontal && section < cap_file_->cinfo.num_cols) {
-        switch (role) {
-        case Qt::DisplayRole:
-            return cap_file_->cinfo.col_title[section];
-        default:
-            break;
-        }
+    QModelIndexList old_indexes = persistentIndexList();
+    QList<PacketListRecord *> old_records;
+    foreach (QModelIndex old_index, old_indexes) {
+        old_records << static_cast<PacketListRecord*>(old_index.internalPointer());
     }
 
-    return QVariant();
+    visible_rows_ = sorted_rows;
+    number_to_row_.clear();
+    for (int row = 0; row < visible_rows_.count(); row++) {
+        number_to_row_[visible_rows_[row]->getFdata()->num] = row;
+    }
+
+    QModelIndexList new_indexes;
+    for (int i = 0; i < old_indexes.count(); i++) {
+        int row = old_records[i] ? packetNumberToRow(old_records[i]->getFdata()->num) : -1;
+        new_indexes << (row < 0 ? QModelIndex() : index(row, old_indexes[i].column()));
+    }
+    changePersistentIndexList(old_indexes, new_indexes);
+
+    emit layoutChanged();
 }
 
+// Appended rows are put in place if the list is sorted by a frame_data
+// column. Other columns would have to be dissected for every new row,
+// so those rows go at the end and are sorted by applyPendingSort().
 gint PacketListModel::appendPacket(frame_data *fdata)
 {
     PacketListRecord *record = new PacketListRecord(fdata);
-    gint pos = visible_rows_.count() + 1;
+    int row = visible_rows_.count();
 
     physical_rows_ << record;
 
-    if (fdata->flags.passed_dfilter || fdata->flags.ref_time) {
-        beginInsertRows(QModelIndex(), pos, pos);
-        visible_rows_ << record;
-        number_to_row_[fdata->num] = visible_rows_.count() - 1;
-        endInsertRows();
-    } else {
-        pos = -1;
+    if (!fdata->flags.passed_dfilter && !fdata->flags.ref_time)
+        return -1;
+
+    if (sort_column_ >= 0 && cap_file_) {
+        if (col_based_on_frame_data(&cap_file_->cinfo, sort_column_)) {
+            row = std::upper_bound(visible_rows_.begin(), visible_rows_.end(), record,
+                                   FrameDataLessThan(cap_file_->epan, cap_file_->cinfo.col_fmt[sort_column_], sort_order_))
+                    - visible_rows_.begin();
+        } else {
+            sort_pending_ = true;
+        }
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    visible_rows_.insert(row, record);
+    for (int i = row; i < visible_rows_.count(); i++) {
+        number_to_row_[visible_rows_[i]->getFdata()->num] = i;
     }
-    return pos;
+    endInsertRows();
+
+    return row + 1;
 }
 
 frame_data *PacketListModel::getRowFdata(int row) {
@@ -32,8 +32,10 @@
 
 #include <QAbstractItemModel>
 #include <QFont>
+#include <QThread>
 #include <QVector>
 
+#include "packet_list_prefetch_worker.h"
 #include "packet_list_record.h"
 
 #include "cfile.h"
@@ -43,6 +45,7 @@ class PacketListModel : public QAbstractItemModel
     Q_OBJECT
 public:
     explicit PacketListModel(QObject *parent = 0, capture_file *cf = NULL);
+    ~PacketListModel();
     void setCaptureFile(capture_file *cf);
     QModelIndex index(int row, int column,
                       const QModelIndex &parent = QModelIndex()) const;
@@ -57,15 +60,32 @@ public:
     QVariant data(const QModelIndex &index, int role) const;
     QVariant headerData(int section, Qt::Orientation orientation,
                              int role = Qt::DisplayRole) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+    // Sort the rows that were appended while they couldn't be sorted,
+    // e.g. once a live capture has stopped.
+    void applyPendingSort();
 
     gint appendPacket(frame_data *fdata);
     frame_data *getRowFdata(int row);
     int visibleIndexOf(frame_data *fdata) const;
     void resetColumns();
+    // Drop the cached column text and colors of a range of frames and
+    // redraw the rows that show them.
+    void invalidateFrames(guint32 first_frame, guint32 last_frame);
+    // Read and columnize rows around the given visible range in the background.
+    void prefetchRows(int first_row, int last_row);
 
 signals:
 
 public slots:
+    // Drop cached column text and colors, e.g. after a preference or
+    // coloring rule change.
+    void resetColorized();
+
+private slots:
+    void columnizePrefetchedRecords();
+    // Cells of a row painted before it was colorized have to be repainted.
+    void repaintRow(int row);
 
 private:
     capture_file *cap_file_;
@@ -77,6 +97,22 @@ private:
 
     int header_height_;
     bool enable_color_;
+    // The column and order of the last sort, or -1 for frame order.
+    int sort_column_;
+    Qt::SortOrder sort_order_;
+    // Rows were appended out of sort order.
+    bool sort_pending_;
+
+    PacketListPrefetchWorker *prefetch_worker_;
+    QThread *prefetch_thread_;
+    QList<prefetched_record_t> prefetched_;
+
+    bool isFrameOrder(int column, Qt::SortOrder order) const;
+    bool sortRows(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows);
+    bool sortByFrameData(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows);
+    bool sortByColumnText(int column, Qt::SortOrder order, QVector<PacketListRecord *> &rows);
+    void applySortOrder(const QVector<PacketListRecord *> &sorted_rows);
+    void queueRowRepaint(int row) const;
 };
 
 #endif // PACKET_LIST_MODEL_H
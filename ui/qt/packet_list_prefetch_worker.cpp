@@ -0,0 +1,206 @@
+/* packet_list_prefetch_worker.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "packet_list_prefetch_worker.h"
+
+#include <wsutil/buffer.h>
+
+#include <QMutexLocker>
+
+// Number of records read before results are handed back.
+const int prefetch_batch_size_ = 64;
+
+PacketListPrefetchWorker::PacketListPrefetchWorker(QObject *parent) :
+    QObject(parent),
+    open_type_(WTAP_TYPE_AUTO),
+    file_changed_(false),
+    stop_(false),
+    failed_(false),
+    wth_(NULL)
+{
+}
+
+PacketListPrefetchWorker::~PacketListPrefetchWorker()
+{
+    if (wth_) {
+        wtap_close(wth_);
+    }
+}
+
+void PacketListPrefetchWorker::setCaptureFile(const QString &filename, unsigned int open_type)
+{
+    QMutexLocker ml(&data_mtx_);
+
+    if (filename == filename_ && open_type == open_type_)
+        return;
+
+    filename_ = filename;
+    open_type_ = open_type;
+    file_changed_ = true;
+    failed_ = false;
+    pending_.clear();
+    results_.clear();
+    data_cond_.wakeOne();
+}
+
+void PacketListPrefetchWorker::prefetch(const QList<QPair<guint32, gint64> > &frames)
+{
+    QMutexLocker ml(&data_mtx_);
+    if (failed_)
+        return;
+    /* Ruthlessly clobber the current request. */
+    pending_ = frames;
+    data_cond_.wakeOne();
+}
+
+QList<prefetched_record_t> PacketListPrefetchWorker::takeRecords()
+{
+    QMutexLocker ml(&data_mtx_);
+    QList<prefetched_record_t> records = results_;
+    results_.clear();
+    return records;
+}
+
+void PacketListPrefetchWorker::start()
+{
+    Buffer buf;
+
+    buffer_init(&buf, 1500);
+
+    forever {
+        QList<QPair<guint32, gint64> > frames;
+        QList<prefetched_record_t> records;
+
+        data_mtx_.lock();
+        while (pending_.isEmpty() && !file_changed_ && !stop_) {
+            data_cond_.wait(&data_mtx_);
+        }
+
+        if (stop_) {
+            data_mtx_.unlock();
+            break;
+        }
+
+        if (file_changed_) {
+            QByteArray filename = filename_.toUtf8();
+            int err;
+            gchar *err_info = NULL;
+
+            file_changed_ = false;
+            if (wth_) {
+                wtap_close(wth_);
+                wth_ = NULL;
+            }
+            if (!filename.isEmpty()) {
+                wth_ = wtap_open_offline(filename.constData(), open_type_, &err, &err_info, TRUE);
+                if (!wth_)
+                    fail(filename, "opened", err, err_info);
+            }
+        }
+
+        frames = pending_.mid(0, prefetch_batch_size_);
+        pending_ = pending_.mid(prefetch_batch_size_);
+        QByteArray filename = filename_.toUtf8();
+        data_mtx_.unlock();
+
+        if (!wth_) continue;
+
+        QPair<guint32, gint64> frame;
+        foreach (frame, frames) {
+            prefetched_record_t record;
+            int err;
+            gchar *err_info = NULL;
+
+            record.frame_num = frame.first;
+            record.file_off = frame.second;
+            memset(&record.phdr, 0, sizeof(struct wtap_pkthdr));
+            record.ok = wtap_seek_read(wth_, frame.second, &record.phdr, &buf, &err, &err_info) ? true : false;
+            if (record.ok) {
+                if (record.phdr.opt_comment) {
+                    record.comment = record.phdr.opt_comment;
+                    record.phdr.opt_comment = NULL;
+                }
+                record.data = QByteArray((const char *) buffer_start_ptr(&buf), record.phdr.caplen);
+            } else {
+                // The GUI thread will try again and report the error.
+                // Don't keep reading a file we can't read.
+                data_mtx_.lock();
+                if (!file_changed_)
+                    fail(filename, "read", err, err_info);
+                else
+                    g_free(err_info);
+                data_mtx_.unlock();
+                break;
+            }
+            records << record;
+        }
+
+        if (records.isEmpty()) continue;
+
+        data_mtx_.lock();
+        bool was_empty = results_.isEmpty();
+        if (!file_changed_) {
+            results_ << records;
+        }
+        data_mtx_.unlock();
+
+        if (was_empty) emit recordsReady();
+    }
+
+    buffer_free(&buf);
+}
+
+// Give up on the current file until another one is set.  Called with
+// data_mtx_ held.
+void PacketListPrefetchWorker::fail(const QByteArray &filename, const char *what, int err, gchar *err_info)
+{
+    g_warning("Not reading ahead in \"%s\": it couldn't be %s: %s%s%s",
+              filename.constData(), what, wtap_strerror(err),
+              err_info ? ": " : "", err_info ? err_info : "");
+    g_free(err_info);
+
+    failed_ = true;
+    pending_.clear();
+    if (wth_) {
+        wtap_close(wth_);
+        wth_ = NULL;
+    }
+}
+
+void PacketListPrefetchWorker::stop()
+{
+    QMutexLocker ml(&data_mtx_);
+    stop_ = true;
+    data_cond_.wakeOne();
+}
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
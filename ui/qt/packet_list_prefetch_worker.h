@@ -0,0 +1,104 @@
+/* packet_list_prefetch_worker.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PACKET_LIST_PREFETCH_WORKER_H
+#define PACKET_LIST_PREFETCH_WORKER_H
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "wiretap/wtap.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QWaitCondition>
+
+// A record read ahead of the viewport. The header is a copy; the packet
+// comment and data are owned by the record.
+typedef struct {
+    guint32 frame_num;
+    gint64 file_off;
+    struct wtap_pkthdr phdr;
+    QByteArray comment;
+    QByteArray data;
+    bool ok;
+} prefetched_record_t;
+
+// Reads records for rows near the packet list viewport using its own wiretap
+// handle so that the GUI thread doesn't block on file I/O when scrolling
+// into uncached parts of a large file. Dissection itself isn't thread safe,
+// so prefetched records are handed back to PacketListModel, which columnizes
+// them in small batches when the event loop is idle. If the file can't be
+// opened or read, prefetching is disabled until another file is set, and
+// the GUI thread reads the records itself.
+class PacketListPrefetchWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    PacketListPrefetchWorker(QObject *parent = 0);
+    ~PacketListPrefetchWorker();
+    void setCaptureFile(const QString &filename, unsigned int open_type);
+    // Replace any pending request with a new list of (frame number, offset) pairs.
+    void prefetch(const QList<QPair<guint32, gint64> > &frames);
+    QList<prefetched_record_t> takeRecords();
+    // Make start() return. Safe to call from any thread.
+    void stop();
+
+public slots:
+    void start();
+
+private:
+    QMutex data_mtx_;
+    QWaitCondition data_cond_;
+    QString filename_;
+    unsigned int open_type_;
+    bool file_changed_;
+    bool stop_;
+    bool failed_;
+    QList<QPair<guint32, gint64> > pending_;
+    QList<prefetched_record_t> results_;
+    wtap *wth_;
+
+    void fail(const QByteArray &filename, const char *what, int err, gchar *err_info);
+
+signals:
+    void recordsReady();
+};
+
+#endif // PACKET_LIST_PREFETCH_WORKER_H
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * ex: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
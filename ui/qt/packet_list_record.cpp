@@ -21,30 +21,365 @@
 
 #include "packet_list_record.h"
 
+#include <epan/epan_dissect.h>
+#include <epan/column-info.h>
+#include <epan/column.h>
+
+#include "color.h"
+#include "color_filters.h"
+#include "frame_tvbuff.h"
+
+#include <string.h>
+
+// Upper bounds for the column text cache. Rows beyond max_cached_rows_
+// have their text dropped in least recently used order. If the string pool
+// grows beyond max_string_pool_size_ the entire cache is thrown away.
+static const int max_cached_rows_ = 250000;
+static const gsize max_string_pool_size_ = 64 * 1024 * 1024;
+
+QVector<int> PacketListRecord::col_to_text_;
+int PacketListRecord::n_text_cols_ = 0;
+unsigned int PacketListRecord::col_data_ver_ = 1;
+GStringChunk *PacketListRecord::string_pool_ = NULL;
+GHashTable *PacketListRecord::string_table_ = NULL;
+gsize PacketListRecord::string_pool_size_ = 0;
+PacketListRecord *PacketListRecord::lru_head_ = NULL;
+PacketListRecord *PacketListRecord::lru_tail_ = NULL;
+int PacketListRecord::lru_count_ = 0;
+
 PacketListRecord::PacketListRecord(frame_data *frameData) :
-    //col_text_(NULL),
-    //col_text_len_(NULL),
-    fdata_(frameData)
+    col_text_(NULL),
+    fdata_(frameData),
+    data_ver_(0),
+    colorized_(false),
+    lru_prev_(NULL),
+    lru_next_(NULL)
 {
 }
 
-QVariant PacketListRecord::data(int col_num, column_info *cinfo) const
+PacketListRecord::~PacketListRecord()
+{
+    freeColumnText();
+}
+
+QVariant PacketListRecord::columnString(capture_file *cap_file, int column, bool dissect_color)
 {
     g_assert(fdata_);
 
-    if (!cinfo)
+    if (!cap_file || column < 0 || column >= cap_file->cinfo.num_cols)
         return QVariant();
 
-    if (col_based_on_frame_data(cinfo, col_num))
-        col_fill_in_frame_data(fdata_, cinfo, col_num, FALSE);
+    if (col_to_text_.size() != cap_file->cinfo.num_cols)
+        resetColumns(&cap_file->cinfo);
+
+    int text_col = col_to_text_[column];
+
+    if (text_col < 0) {
+        // Based on frame_data. Cheap enough to fill in on demand.
+        col_fill_in_frame_data(fdata_, &cap_file->cinfo, column, FALSE);
+        return cap_file->cinfo.col_data[column];
+    }
 
-    return cinfo->col_data[col_num];
+    if (needsColumnizing(dissect_color)) {
+        dissect(cap_file, dissect_color);
+    }
+
+    lruTouch();
+    return col_text_[text_col];
+}
+
+const gchar *PacketListRecord::cachedColumnText(int column) const
+{
+    if (!col_text_ || data_ver_ != col_data_ver_ || column < 0 || column >= col_to_text_.size())
+        return NULL;
+
+    int text_col = col_to_text_[column];
+    return text_col < 0 ? NULL : col_text_[text_col];
 }
 
 frame_data *PacketListRecord::getFdata() {
     return fdata_;
 }
 
+void PacketListRecord::resetColumns(column_info *cinfo)
+{
+    invalidateAll();
+
+    col_to_text_.clear();
+    n_text_cols_ = 0;
+
+    if (!cinfo)
+        return;
+
+    col_to_text_.resize(cinfo->num_cols);
+    for (int col = 0; col < cinfo->num_cols; col++) {
+        if (col_based_on_frame_data(cinfo, col)) {
+            col_to_text_[col] = -1;
+        } else {
+            col_to_text_[col] = n_text_cols_++;
+        }
+    }
+}
+
+void PacketListRecord::invalidateAll()
+{
+    // Stale records notice the version change and re-dissect on demand.
+    col_data_ver_++;
+
+    while (lru_head_) {
+        lru_head_->freeColumnText();
+    }
+
+    if (string_table_) {
+        g_hash_table_destroy(string_table_);
+        string_table_ = NULL;
+    }
+    if (string_pool_) {
+        g_string_chunk_free(string_pool_);
+        string_pool_ = NULL;
+    }
+    string_pool_size_ = 0;
+}
+
+bool PacketListRecord::colorize(capture_file *cap_file)
+{
+    g_assert(fdata_);
+
+    if (!cap_file || colorized())
+        return false;
+
+    if (col_to_text_.size() != cap_file->cinfo.num_cols)
+        resetColumns(&cap_file->cinfo);
+
+    dissect(cap_file, true);
+    return true;
+}
+
+void PacketListRecord::columnize(capture_file *cap_file, struct wtap_pkthdr *phdr, Buffer *buf, bool dissect_color)
+{
+    if (!cap_file || !phdr || !buf)
+        return;
+
+    if (col_to_text_.size() != cap_file->cinfo.num_cols)
+        resetColumns(&cap_file->cinfo);
+
+    if (!needsColumnizing(dissect_color))
+        return;
+
+    dissectRecord(cap_file, phdr, buf, dissect_color);
+}
+
+void PacketListRecord::dissect(capture_file *cap_file, bool dissect_color)
+{
+    struct wtap_pkthdr phdr; /* Packet header */
+    Buffer buf; /* Packet data */
+
+    memset(&phdr, 0, sizeof(struct wtap_pkthdr));
+
+    buffer_init(&buf, 1500);
+    if (!cf_read_record_r(cap_file, fdata_, &phdr, &buf)) {
+        /*
+         * Error reading the record.
+         *
+         * Don't set the color filter for now (we might want
+         * to colorize it in some fashion to warn that the
+         * row couldn't be filled in or colorized), and
+         * set the columns to placeholder values, except
+         * for the Info column, where we'll put in an
+         * error message.
+         */
+        col_fill_in_error(&cap_file->cinfo, fdata_, FALSE, FALSE /* fill_fd_columns */);
+        cacheColumnStrings(&cap_file->cinfo);
+        if (dissect_color) {
+            frame_data_sequence_set_color_filter(cap_file->frames, fdata_, NULL);
+            colorized_ = true;
+        }
+        buffer_free(&buf);
+        return; /* error reading the record */
+    }
+
+    dissectRecord(cap_file, &phdr, &buf, dissect_color);
+    buffer_free(&buf);
+}
+
+void PacketListRecord::dissectRecord(capture_file *cap_file, struct wtap_pkthdr *phdr, Buffer *buf, bool dissect_color)
+{
+    epan_dissect_t edt;
+    column_info *cinfo = &cap_file->cinfo;
+    gboolean create_proto_tree;
+
+    create_proto_tree = (dissect_color && color_filters_used()) || have_custom_cols(cinfo);
+
+    epan_dissect_init(&edt, cap_file->epan,
+                      create_proto_tree,
+                      FALSE /* proto_tree_visible */);
+
+    if (dissect_color)
+        color_filters_prime_edt(&edt);
+    col_custom_prime_edt(&edt, cinfo);
+
+    /*
+     * XXX - need to catch an OutOfMemoryError exception and
+     * attempt to recover from it.
+     */
+    epan_dissect_run(&edt, cap_file->cd_t, phdr, frame_tvbuff_new_buffer(fdata_, buf), fdata_, cinfo);
+
+    if (dissect_color) {
+        frame_data_sequence_set_color_filter(cap_file->frames, fdata_, color_filters_colorize_packet(&edt));
+    }
+
+    /* "Stringify" non frame_data vals */
+    epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+    cacheColumnStrings(cinfo);
+
+    colorized_ = dissect_color;
+
+    epan_dissect_cleanup(&edt);
+}
+
+// Copied from ui/gtk/packet_list_store.c:packet_list_change_record
+void PacketListRecord::cacheColumnStrings(column_info *cinfo)
+{
+    if (!cinfo || col_to_text_.size() != cinfo->num_cols)
+        return;
+
+    if (string_pool_size_ > max_string_pool_size_) {
+        invalidateAll();
+    }
+
+    if (!col_text_ || data_ver_ != col_data_ver_) {
+        g_free(col_text_);
+        col_text_ = g_new0(const gchar *, n_text_cols_ > 0 ? n_text_cols_ : 1);
+    }
+    data_ver_ = col_data_ver_;
+
+    if (!string_pool_) {
+        string_pool_ = g_string_chunk_new(32);
+        string_table_ = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    for (int col = 0; col < cinfo->num_cols; col++) {
+        int text_col = col_to_text_[col];
+        const gchar *col_str;
+
+        // Column based on frame_data
+        if (text_col < 0)
+            continue;
+
+        switch (cinfo->col_fmt[col]) {
+        case COL_DEF_SRC:
+        case COL_RES_SRC: /* COL_DEF_SRC is currently just like COL_RES_SRC */
+        case COL_UNRES_SRC:
+        case COL_DEF_DL_SRC:
+        case COL_RES_DL_SRC:
+        case COL_UNRES_DL_SRC:
+        case COL_DEF_NET_SRC:
+        case COL_RES_NET_SRC:
+        case COL_UNRES_NET_SRC:
+        case COL_DEF_DST:
+        case COL_RES_DST: /* COL_DEF_DST is currently just like COL_RES_DST */
+        case COL_UNRES_DST:
+        case COL_DEF_DL_DST:
+        case COL_RES_DL_DST:
+        case COL_UNRES_DL_DST:
+        case COL_DEF_NET_DST:
+        case COL_RES_NET_DST:
+        case COL_UNRES_NET_DST:
+        case COL_PROTOCOL:
+        case COL_INFO:
+        case COL_IF_DIR:
+        case COL_DCE_CALL:
+        case COL_8021Q_VLAN_ID:
+        case COL_EXPERT:
+        case COL_FREQ_CHAN:
+            if (cinfo->col_data[col] && cinfo->col_data[col] != cinfo->col_buf[col]) {
+                /* This is a constant string, so we don't have to copy it */
+                col_text_[text_col] = cinfo->col_data[col];
+                break;
+            }
+            /* !! FALL-THROUGH!! */
+
+        default:
+            if (!cinfo->col_data[col] || !cinfo->col_data[col][0]) {
+                col_text_[text_col] = "";
+                break;
+            }
+
+            if (!get_column_resolved(col) && cinfo->col_expr.col_expr_val[col]) {
+                /* Use the unresolved value in col_expr_val */
+                col_str = cinfo->col_expr.col_expr_val[col];
+            } else {
+                col_str = cinfo->col_data[col];
+            }
+
+            gchar *interned = (gchar *) g_hash_table_lookup(string_table_, col_str);
+            if (!interned) {
+                gsize col_str_len = strlen(col_str);
+                interned = g_string_chunk_insert_len(string_pool_, col_str, col_str_len);
+                g_hash_table_insert(string_table_, interned, interned);
+                string_pool_size_ += col_str_len + 1;
+            }
+            col_text_[text_col] = interned;
+            break;
+        }
+    }
+
+    lruTouch();
+}
+
+// Move this record to the head of the LRU list, evicting from the tail
+// if we have too many cached rows.
+void PacketListRecord::lruTouch()
+{
+    if (lru_head_ == this)
+        return;
+
+    if (lru_prev_ || lru_next_ || lru_tail_ == this) {
+        lruUnlink();
+    }
+
+    lru_next_ = lru_head_;
+    if (lru_head_)
+        lru_head_->lru_prev_ = this;
+    lru_head_ = this;
+    if (!lru_tail_)
+        lru_tail_ = this;
+    lru_count_++;
+
+    while (lru_count_ > max_cached_rows_ && lru_tail_ && lru_tail_ != this) {
+        lru_tail_->freeColumnText();
+    }
+}
+
+void PacketListRecord::lruUnlink()
+{
+    if (lru_prev_) {
+        lru_prev_->lru_next_ = lru_next_;
+    } else if (lru_head_ == this) {
+        lru_head_ = lru_next_;
+    } else {
+        // Not in the list.
+        return;
+    }
+
+    if (lru_next_) {
+        lru_next_->lru_prev_ = lru_prev_;
+    } else {
+        lru_tail_ = lru_prev_;
+    }
+
+    lru_prev_ = lru_next_ = NULL;
+    lru_count_--;
+}
+
+void PacketListRecord::freeColumnText()
+{
+    lruUnlink();
+    g_free(col_text_);
+    col_text_ = NULL;
+    colorized_ = false;
+}
+
 /*
  * Editor modelines
  *
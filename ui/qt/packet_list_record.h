@@ -29,35 +29,79 @@
 #include <epan/column-info.h>
 #include <epan/packet.h>
 
-#include <QList>
+#include "cfile.h"
+
 #include <QVariant>
+#include <QVector>
 
 class PacketListRecord
 {
 public:
     PacketListRecord(frame_data *frameData);
-    QVariant data(int col_num, column_info *cinfo) const;
+    ~PacketListRecord();
+
+    // Return the text for a column, dissecting and caching the row if needed.
+    // If dissect_color is true the row is colorized as well.
+    QVariant columnString(capture_file *cap_file, int column, bool dissect_color = false);
+    // Dissect and cache a record that has already been read, e.g. by
+    // PacketListPrefetchWorker.
+    void columnize(capture_file *cap_file, struct wtap_pkthdr *phdr, Buffer *buf, bool dissect_color);
+    bool needsColumnizing(bool dissect_color) const {
+        return !col_text_ || data_ver_ != col_data_ver_ || (dissect_color && !colorized_);
+    }
+    // Dissect the record for its color if it hasn't been colorized. Columns
+    // based on frame_data don't need dissecting, so their text doesn't do
+    // this. Returns true if the record was dissected.
+    bool colorize(capture_file *cap_file);
+    // Cached text for a column or NULL if the row hasn't been columnized.
+    const gchar *cachedColumnText(int column) const;
     frame_data *getFdata();
+    bool colorized() const { return colorized_ && data_ver_ == col_data_ver_; }
+
+    // Drop this record's cached column text and colors, e.g. after its
+    // frame was marked or commented. It's re-dissected the next time it's shown.
+    void invalidate() { freeColumnText(); }
+
+    // Rebuild the column to cached text mapping and drop all cached text.
+    // Must be called when the column layout changes.
+    static void resetColumns(column_info *cinfo);
+    // Drop all cached column text and colors, e.g. after a preference or
+    // color rule change. Records are re-dissected the next time they're shown.
+    static void invalidateAll();
 
 private:
-    /** The column text for some columns */
-    //gchar **col_text_;
-    /**< The length of the column text strings in 'col_text' */
-    //guint *col_text_len_;
+    /** The column text for columns not based on frame_data. Strings live in string_pool_. */
+    const gchar **col_text_;
 
     frame_data *fdata_;
 
-    /** Has this record been columnized? */
-    //gboolean columnized_;
+    /** Cache generation of col_text_. Stale if it doesn't match col_data_ver_. */
+    unsigned int data_ver_;
     /** Has this record been colorized? */
-    //gboolean colorized_;
+    bool colorized_;
+
+    /** Least recently used list of records that have cached column text. */
+    PacketListRecord *lru_prev_;
+    PacketListRecord *lru_next_;
 
-    /* admin stuff used by the custom list model */
-    /** position within the physical array */
-    //guint physical_pos_;
-    /** position within the visible array */
-    //gint visible_pos_;
+    void dissect(capture_file *cap_file, bool dissect_color);
+    void dissectRecord(capture_file *cap_file, struct wtap_pkthdr *phdr, Buffer *buf, bool dissect_color);
+    void cacheColumnStrings(column_info *cinfo);
+    void lruTouch();
+    void lruUnlink();
+    void freeColumnText();
 
+    /** Maps a column number to its col_text_ index, -1 for frame_data columns. */
+    static QVector<int> col_to_text_;
+    static int n_text_cols_;
+    static unsigned int col_data_ver_;
+    /** Interned column strings shared by all records. */
+    static GStringChunk *string_pool_;
+    static GHashTable *string_table_;
+    static gsize string_pool_size_;
+    static PacketListRecord *lru_head_;
+    static PacketListRecord *lru_tail_;
+    static int lru_count_;
 };
 
 #endif // PACKET_LIST_RECORD_H
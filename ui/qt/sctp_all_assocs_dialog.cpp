@@ -68,7 +68,7 @@ void SCTPAllAssocsDialog::fillTable()
     if (sctp_stat_get_info()->is_registered == FALSE) {
         register_tap_listener_sctp_stat();
         /*  (redissect all packets) */
-        cf_retap_packets(cap_file_);
+        cf_retap_pending_packets(cap_file_);
     }
     numAssocs = 0;
     ui->assocList->setRowCount(g_list_length(sctp_assocs->assoc_info_list));
@@ -43,7 +43,7 @@ SCTPAssocAnalyseDialog::SCTPAssocAnalyseDialog(QWidget *parent, sctp_assoc_info_
             register_tap_listener_sctp_stat();
         }
         /*  (redissect all packets) */
-        cf_retap_packets(cap_file_);
+        cf_retap_pending_packets(cap_file_);
         selected_assoc = findAssocForPacket(cap_file_);
     }
     this->setWindowTitle(QString(tr("SCTP Analyse Association: %1 Port1 %2 Port2 %3")).arg(cf_get_display_name(cap_file_)).arg(selected_assoc->port1).arg(selected_assoc->port2));
@@ -66,7 +66,7 @@ sctp_assoc_info_t* SCTPAssocAnalyseDialog::findAssocForPacket(capture_file* cf)
     if (sctp_stat_get_info()->is_registered == FALSE) {
         register_tap_listener_sctp_stat();
         /*  (redissect all packets) */
-        cf_retap_packets(cf);
+        cf_retap_pending_packets(cf);
     }
     list = g_list_first(sctp_stat_get_info()->assoc_info_list);
 
@@ -77,7 +77,8 @@ StatsTreeDialog::StatsTreeDialog(QWidget *parent, capture_file *cf, const char *
     ui(new Ui::StatsTreeDialog),
     st_(NULL),
     st_cfg_(NULL),
-    cap_file_(cf)
+    cap_file_(cf),
+    tapping_(false)
 {
     ui->setupUi(this);
     st_cfg_ = stats_tree_get_cfg_by_abbr(cfg_abbr);
@@ -99,11 +100,15 @@ StatsTreeDialog::StatsTreeDialog(QWidget *parent, capture_file *cf, const char *
     button = ui->buttonBox->addButton(tr("Save as..."), QDialogButtonBox::ActionRole);
     connect(button, SIGNAL(clicked()), this, SLOT(on_actionSaveAs_triggered()));
 
+    connect(wsApp, SIGNAL(retapFinished(const capture_file*)),
+            this, SLOT(retapFinished(const capture_file*)));
+
     fillTree();
 }
 
 StatsTreeDialog::~StatsTreeDialog()
 {
+    detachTap();
     if (st_) {
         stats_tree_free(st_);
     }
@@ -113,6 +118,7 @@ StatsTreeDialog::~StatsTreeDialog()
 void StatsTreeDialog::setCaptureFile(capture_file *cf)
 {
     if (!cf) { // We only want to know when the file closes.
+        detachTap();
         cap_file_ = NULL;
         ui->displayFilterLineEdit->setEnabled(false);
         ui->applyFilterButton->setEnabled(false);
@@ -132,6 +138,9 @@ void StatsTreeDialog::fillTree()
 
     if (!cap_file_) return;
 
+    // Our last retap hasn't finished. Start over.
+    detachTap();
+
     if (st_cfg_->in_use) {
         QMessageBox::warning(this, tr("%1 already open").arg(display_name),
                              tr("Each type of tree can only be generated one at time."));
@@ -171,17 +180,37 @@ void StatsTreeDialog::fillTree()
         QMessageBox::critical(this, tr("%1 failed to attach to tap").arg(display_name),
                              error_string->str);
         g_string_free(error_string, TRUE);
+        st_cfg_->in_use = FALSE;
+        st_cfg_->pr = NULL;
         reject();
+        return;
     }
 
-    cf_retap_packets(cap_file_);
+    // The packets are retapped along with those of any other dialogs
+    // waiting for them; see retapFinished().
+    tapping_ = true;
+    wsApp->queueRetap(cap_file_);
+}
+
+void StatsTreeDialog::retapFinished(const capture_file *)
+{
+    if (!tapping_) return;
+
     drawTreeItems(st_);
 
     ui->statsTreeWidget->setSortingEnabled(true);
+    detachTap();
+}
+
+void StatsTreeDialog::detachTap()
+{
+    if (!tapping_) return;
+
     remove_tap_listener(st_);
 
     st_cfg_->in_use = FALSE;
     st_cfg_->pr = NULL;
+    tapping_ = false;
 }
 
 void StatsTreeDialog::resetTap(void *st_ptr)
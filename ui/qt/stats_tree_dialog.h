@@ -60,12 +60,15 @@ private:
     stats_tree *st_;
     stats_tree_cfg *st_cfg_;
     capture_file *cap_file_;
+    bool tapping_;
 
     void fillTree();
+    void detachTap();
     static void resetTap(void *st_ptr);
     static void drawTreeItems(void *st_ptr);
 
 private slots:
+    void retapFinished(const capture_file *cf);
     void on_applyFilterButton_clicked();
     void on_actionCopyToClipboard_triggered();
     void on_actionSaveAs_triggered();
@@ -188,6 +188,41 @@ void WiresharkApplication::updateTaps()
     draw_tap_listeners(FALSE);
 }
 
+void WiresharkApplication::queueRetap(capture_file *cf)
+{
+    retap_cf_ = cf;
+    if (retapping_) {
+        // The listener might have been marked after its pass started.
+        retap_queued_ = true;
+    } else {
+        // Let the rest of this trip through the event loop add listeners.
+        retap_timer_.start();
+    }
+}
+
+// Dissection isn't thread safe, so we retap here. The progress dialog
+// keeps the UI responsive, and lets the user stop the pass.
+void WiresharkApplication::retapPending()
+{
+    capture_file *cf = retap_cf_;
+
+    if (!cf || retapping_) return;
+
+    retapping_ = true;
+    cf_retap_pending_packets(cf);
+    retapping_ = false;
+
+    // Anyone waiting on this pass also waits on the one queued during it.
+    if (retap_queued_ && retap_cf_) {
+        retap_queued_ = false;
+        retap_timer_.start();
+        return;
+    }
+    retap_queued_ = false;
+
+    emit retapFinished(cf);
+}
+
 void WiresharkApplication::captureCallback(int event _U_, capture_session *cap_session _U_)
 {
 #ifdef HAVE_LIBPCAP
@@ -248,6 +283,8 @@ void WiresharkApplication::captureFileCallback(int event, void * data)
         break;
     case(cf_cb_file_closing):
         g_log(LOG_DOMAIN_MAIN, G_LOG_LEVEL_DEBUG, "Callback: Closing");
+        retap_cf_ = NULL;
+        retap_timer_.stop();
         emit captureFileClosing(cf);
         break;
     case(cf_cb_file_closed):
@@ -461,6 +498,7 @@ void WiresharkApplication::setConfigurationProfile(const gchar *profile_name)
 
     /* Reload color filters */
     color_filters_reload();
+    emit colorFiltersChanged();
 
 //    user_font_apply();
 
@@ -557,7 +595,10 @@ void WiresharkApplication::itemStatusFinished(const QString &filename, qint64 si
 
 WiresharkApplication::WiresharkApplication(int &argc,  char **argv) :
     QApplication(argc, argv),
-    initialized_(false)
+    initialized_(false),
+    retap_cf_(NULL),
+    retapping_(false),
+    retap_queued_(false)
 {
     wsApp = this;
 
@@ -591,6 +632,11 @@ WiresharkApplication::WiresharkApplication(int &argc,  char **argv) :
     connect(this, SIGNAL(appInitialized()), &tap_update_timer_, SLOT(start()));
     connect(&tap_update_timer_, SIGNAL(timeout()), this, SLOT(updateTaps()));
 
+    retap_timer_.setParent(this);
+    retap_timer_.setSingleShot(true);
+    retap_timer_.setInterval(0);
+    connect(&retap_timer_, SIGNAL(timeout()), this, SLOT(retapPending()));
+
     connect(qApp, SIGNAL(aboutToQuit()), this, SLOT(cleanup()));
 }
 
@@ -619,6 +665,9 @@ void WiresharkApplication::emitAppSignal(AppSignal signal)
     case FieldsChanged:
         emit fieldsChanged();
         break;
+    case ColorFiltersChanged:
+        emit colorFiltersChanged();
+        break;
     default:
         break;
     }
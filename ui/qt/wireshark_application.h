@@ -67,7 +67,8 @@ public:
         PacketDissectionChanged,
         PreferencesChanged,
         StaticRecentFilesRead,
-        FieldsChanged
+        FieldsChanged,
+        ColorFiltersChanged
     };
 
     void registerUpdate(register_action_e action, const char *message);
@@ -87,6 +88,11 @@ public:
     int monospaceTextSize(const char *str, bool bold = false);
     void setConfigurationProfile(const gchar *profile_name);
     bool isInitialized() { return initialized_; }
+    // Retap the packets for the pending tap listeners (see
+    // set_tap_listener_pending()). Requests made before the retap starts
+    // share a single pass; retapFinished() is emitted once there are no
+    // more to do.
+    void queueRetap(capture_file *cf);
 
 private:
     bool initialized_;
@@ -94,6 +100,10 @@ private:
     QFont mono_bold_font_;
     QTimer recent_timer_;
     QTimer tap_update_timer_;
+    QTimer retap_timer_;
+    capture_file *retap_cf_;
+    bool retapping_;
+    bool retap_queued_;
     QList<QString> pending_open_files_;
 
 protected:
@@ -112,6 +122,7 @@ signals:
     void packetDissectionChanged();
     void preferencesChanged();
     void fieldsChanged();
+    void colorFiltersChanged(); // The coloring rules were reloaded or applied.
 
     // XXX It might make more sense to move these to main.cpp or main_window.cpp or their own class.
     void captureCapturePrepared(capture_session *cap_session);
@@ -129,6 +140,8 @@ signals:
     void captureFileClosing(const capture_file *cf);
     void captureFileClosed(const capture_file *cf);
 
+    void retapFinished(const capture_file *cf);
+
 public slots:
     void clearRecentItems();
 
@@ -137,6 +150,7 @@ private slots:
     void itemStatusFinished(const QString &filename = "", qint64 size = 0, bool accessible = false);
     void refreshRecentFiles(void);
     void updateTaps();
+    void retapPending();
 };
 
 extern WiresharkApplication *wsApp;
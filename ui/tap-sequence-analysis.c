@@ -233,7 +233,7 @@ sequence_analysis_list_get(capture_file *cf, seq_analysis_info_t *sainfo)
 
     }
 
-    cf_retap_packets(cf);
+    cf_retap_pending_packets(cf);
     sainfo->list = g_list_reverse(sainfo->list);
     remove_tap_listener(sainfo);
 
@@ -158,7 +158,7 @@ graph_segment_list_get(capture_file *cf, struct tcp_graph *tg, gboolean stream_k
         g_string_free(error_string, TRUE);
         exit(1);   /* XXX: fix this */
     }
-    cf_retap_packets(cf);
+    cf_retap_pending_packets(cf);
     remove_tap_listener(&ts);
 }
 
@@ -2004,26 +2004,28 @@ gboolean wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_LIBZ
 gboolean wtap_dump_can_compress(int file_type_subtype)
+{
+	return wtap_dump_can_compress_type(file_type_subtype, WTAP_GZIP_COMPRESSED);
+}
+
+gboolean wtap_dump_can_compress_type(int file_type_subtype,
+    wtap_compression_type compression_type)
 {
 	/*
-	 * If this is an unknown file type, or if we have to
-	 * seek when writing out a file with this file type,
-	 * return FALSE.
+	 * If we weren't built with support for this type of compression,
+	 * if this is an unknown file type, or if we have to seek when
+	 * writing out a file with this file type, return FALSE.
 	 */
+	if (compression_type == WTAP_UNCOMPRESSED ||
+	    !wtap_compression_type_supported(compression_type))
+		return FALSE;
 	if (file_type_subtype < 0 || file_type_subtype >= wtap_num_file_types_subtypes
 	    || dump_open_table[file_type_subtype].writing_must_seek)
 		return FALSE;
 
 	return TRUE;
 }
-#else
-gboolean wtap_dump_can_compress(int file_type_subtype _U_)
-{
-	return FALSE;
-}
-#endif
 
 gboolean wtap_dump_has_name_resolution(int file_type_subtype)
 {
@@ -2048,30 +2050,32 @@ gboolean wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap,
+					wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype,
+					wtap_compression_type compression_type, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
 static int wtap_dump_file_close(wtap_dumper *wdh);
 
 wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int encap,
-				int snaplen, gboolean compressed, int *err)
+				int snaplen, wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compressed, NULL, NULL, err);
+	return wtap_dump_open_ng(filename, file_type_subtype, encap,snaplen, compression_type, NULL, NULL, err);
 }
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	wtapng_if_descr_t descr, *file_int_data;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2117,25 +2121,25 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 }
 
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
-				int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+				int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
 
 	/* "-" means stdout */
 	if (strcmp(filename, "-") == 0) {
-		if (compressed) {
+		if (compression_type != WTAP_UNCOMPRESSED) {
 			*err = EINVAL;	/* XXX - return a Wiretap error code for this */
 			g_free(wdh);
 			return NULL;	/* compress won't work on stdout */
@@ -2162,7 +2166,7 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int
 		wdh->fh = fh;
 	}
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		if (wdh->fh != stdout) {
@@ -2176,24 +2180,24 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int
 }
 
 wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snaplen,
-				gboolean compressed, int *err)
+				wtap_compression_type compression_type, int *err)
 {
-	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compressed, NULL, NULL, err);
+	return wtap_dump_fdopen_ng(fd, file_type_subtype, encap, snaplen, compression_type, NULL, NULL, err);
 }
 
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
-				gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+				wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2220,7 +2224,7 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2228,7 +2232,7 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	return wdh;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2251,8 +2255,10 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support it, and do we support
+	   it for this file_type_subtype? */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    !wtap_dump_can_compress_type(file_type_subtype, compression_type)) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2262,7 +2268,7 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 }
 
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err)
+					wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2275,19 +2281,19 @@ static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int sn
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
 
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if (compression_type != WTAP_UNCOMPRESSED) {
 		cant_seek = TRUE;
 	} else {
 		fd = fileno((FILE *)wdh->fh);
@@ -2328,9 +2334,9 @@ gboolean wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 
 void wtap_dump_flush(wtap_dumper *wdh)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
-		gzwfile_flush((GZWFILE_T)wdh->fh);
+#ifdef CAN_WRITE_COMPRESSED
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		cwfile_flush((CWFILE_T)wdh->fh);
 	} else
 #endif
 	{
@@ -2390,11 +2396,11 @@ gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinf
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
+#ifdef CAN_WRITE_COMPRESSED
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
-		return gzwfile_open(filename);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_open(filename, wdh->compression_type);
 	} else {
 		return ws_fopen(filename, "wb");
 	}
@@ -2407,11 +2413,11 @@ static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
 #endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
+#ifdef CAN_WRITE_COMPRESSED
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
-		return gzwfile_fdopen(fd);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_fdopen(fd, wdh->compression_type);
 	} else {
 		return fdopen(fd, "wb");
 	}
@@ -2429,14 +2435,14 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 {
 	size_t nwritten;
 
-#ifdef HAVE_LIBZ
-	if (wdh->compressed) {
-		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned) bufsize);
+#ifdef CAN_WRITE_COMPRESSED
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
+		nwritten = cwfile_write((CWFILE_T)wdh->fh, buf, (unsigned) bufsize);
 		/*
-		 * gzwfile_write() returns 0 on error.
+		 * cwfile_write() returns 0 on error.
 		 */
 		if (nwritten == 0) {
-			*err = gzwfile_geterr((GZWFILE_T)wdh->fh);
+			*err = cwfile_geterr((CWFILE_T)wdh->fh);
 			return FALSE;
 		}
 	} else
@@ -2461,9 +2467,9 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 /* internally close a file for writing (compressed or not) */
 static int wtap_dump_file_close(wtap_dumper *wdh)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
-		return gzwfile_close((GZWFILE_T)wdh->fh);
+#ifdef CAN_WRITE_COMPRESSED
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_close((CWFILE_T)wdh->fh);
 	} else
 #endif
 	{
@@ -2473,8 +2479,8 @@ static int wtap_dump_file_close(wtap_dumper *wdh)
 
 gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+#ifdef CAN_WRITE_COMPRESSED
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -2492,8 +2498,8 @@ gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err
 gint64 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+#ifdef CAN_WRITE_COMPRESSED
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -50,17 +50,33 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
+#ifdef HAVE_MMAP
+#include <signal.h>
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 #include <string.h>
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/ws_compress.h>
 
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif /* HAVE_LIBZ */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
+
 /*
- * See RFC 1952 for a description of the gzip file format.
+ * See RFC 1952 for a description of the gzip file format, RFC 8478 for
+ * the Zstandard format, and lz4_Frame_format.md in the LZ4 sources for
+ * the LZ4 frame format.
  *
  * Some other compressed file formats we might want to support:
  *
@@ -70,49 +86,152 @@
  */
 
 /*
- * List of extensions for compressed files.
- * If we add support for more compressed file types, this table
- * might be expanded to include routines to handle the various
- * compression types.
+ * Compression types we know about, along with the extensions used for
+ * files compressed with them.
  */
-static const char *compressed_file_extensions[] = {
+static const struct compression_type {
+	wtap_compression_type type;
+	const char *extension;
+	const char *name;
+	const char *description;
+} compression_types[] = {
 #ifdef HAVE_LIBZ
-	"gz",
+	{ WTAP_GZIP_COMPRESSED, "gz", "gzip", "gzip compressed" },
+#endif
+#ifdef HAVE_ZSTD
+	{ WTAP_ZSTD_COMPRESSED, "zst", "zstd", "Zstandard compressed" },
+#endif
+#ifdef HAVE_LZ4
+	{ WTAP_LZ4_COMPRESSED, "lz4", "lz4", "LZ4 compressed" },
 #endif
-	NULL
+	{ WTAP_UNCOMPRESSED, NULL, NULL, NULL }
 };
 
 /*
  * Return a GSList of all the compressed file extensions.
- * The data pointers all point to items in compressed_file_extensions[],
+ * The data pointers all point to items in compression_types[],
  * so the GSList can just be freed with g_slist_free().
  */
 GSList *
 wtap_get_compressed_file_extensions(void)
 {
-	const char **extension;
+	const struct compression_type *p;
 	GSList *extensions;
 
 	extensions = NULL;
-	for (extension = &compressed_file_extensions[0]; *extension != NULL;
-	    extension++)
-		extensions = g_slist_append(extensions, (gpointer)(*extension));
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++)
+		extensions = g_slist_append(extensions, (gpointer)p->extension);
 	return extensions;
 }
 
+gboolean
+wtap_compression_type_supported(wtap_compression_type compression_type)
+{
+	const struct compression_type *p;
+
+	if (compression_type == WTAP_UNCOMPRESSED)
+		return TRUE;
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++) {
+		if (p->type == compression_type)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+wtap_compression_type
+wtap_name_to_compression_type(const char *name)
+{
+	const struct compression_type *p;
+
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++) {
+		if (g_ascii_strcasecmp(name, p->name) == 0)
+			return p->type;
+	}
+	return WTAP_UNKNOWN_COMPRESSION;
+}
+
+const char *
+wtap_compression_type_name(wtap_compression_type compression_type)
+{
+	const struct compression_type *p;
+
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++) {
+		if (p->type == compression_type)
+			return p->name;
+	}
+	return NULL;
+}
+
+const char *
+wtap_compression_type_extension(wtap_compression_type compression_type)
+{
+	const struct compression_type *p;
+
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++) {
+		if (p->type == compression_type)
+			return p->extension;
+	}
+	return NULL;
+}
+
+GSList *
+wtap_get_all_compression_type_names_list(void)
+{
+	const struct compression_type *p;
+	GSList *names;
+
+	names = NULL;
+	for (p = compression_types; p->type != WTAP_UNCOMPRESSED; p++)
+		names = g_slist_append(names, (gpointer)p->name);
+	return names;
+}
+
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
-/* values for wtap_reader compression */
+/* values for wtap_reader compression; these are saved in fast seek
+   indexes, so don't renumber them */
 typedef enum {
-	UNKNOWN,	/* unknown - look for a gzip header */
-	UNCOMPRESSED,	/* uncompressed - copy input directly */
+	UNKNOWN = 0,		/* unknown - look for a gzip header or frame magic */
+	UNCOMPRESSED = 1,	/* uncompressed - copy input directly */
 #ifdef HAVE_LIBZ
-	ZLIB,		/* decompress a zlib stream */
-	GZIP_AFTER_HEADER
+	ZLIB = 2,		/* decompress a zlib stream */
+	GZIP_AFTER_HEADER = 3,
+	BGZF = 4,		/* inflate BGZF blocks on worker threads */
 #endif
+#ifdef HAVE_ZSTD
+	ZSTD = 5,		/* decompress a Zstandard frame */
+#endif
+#ifdef HAVE_LZ4
+	LZ4 = 6,		/* decompress an LZ4 frame */
+#endif
+	COMPRESSION_MAX
 } compression_t;
 
+/* frame magic numbers, as they'd be read little-endian */
+#define ZSTD_FRAME_MAGIC	0xFD2FB528
+#define LZ4_FRAME_MAGIC		0x184D2204
+#define SKIPPABLE_FRAME_MAGIC	0x184D2A50	/* low four bits are ignored */
+#define SKIPPABLE_FRAME_MASK	0xFFFFFFF0
+
+/* what's appended to a file's name to get the name of its seek index */
+#define GZIDX_SUFFIX		".gzidx"
+
+#ifdef HAVE_MMAP
+/*
+ * A mapping of an uncompressed file.  Buffers that packet data was
+ * handed out in refer to it, and may outlive the file being closed,
+ * so it's only unmapped once the file and all those Buffers are done
+ * with it.
+ */
+struct file_map {
+	unsigned char *addr;
+	gint64 size;
+	guint refcount;            /* the reader, plus each Buffer referring to it */
+	volatile sig_atomic_t truncated; /* part of it is past the end of the file */
+};
+#endif
+
 struct wtap_reader {
 	int fd;                    /* file descriptor */
 	gint64 raw_pos;            /* current position in file (just to not call lseek()) */
@@ -145,6 +264,29 @@ struct wtap_reader {
 	/* fast seeking */
 	GPtrArray *fast_seek;
 	void *fast_seek_cur;
+	gchar *index_path;         /* where the fast seek index is kept, or NULL */
+	gboolean index_loaded;     /* TRUE if fast_seek was loaded from index_path */
+	gboolean index_save;       /* TRUE if fast_seek should be saved to index_path */
+	gboolean random;           /* TRUE if this is the random-access stream */
+	gboolean slow_seek_warned; /* TRUE if we've said that seeking will be slow */
+#ifdef HAVE_LIBZ
+	/* parallel inflate of BGZF files */
+	struct bgzf_inflater *bgzf;
+	gboolean bgzf_disabled;    /* TRUE if we've given up on inflating in parallel */
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *zstd_dctx;   /* Zstandard decompression context */
+#endif
+#ifdef HAVE_LZ4
+	LZ4F_dctx *lz4_dctx;       /* LZ4 frame decompression context */
+#endif
+#ifdef HAVE_MMAP
+	/* uncompressed files mapped into memory */
+	struct file_map *map;      /* the mapping, or NULL */
+	gboolean map_wanted;       /* TRUE once file_read_mapped() has been called */
+	gboolean map_tried;        /* TRUE if we've tried to map the file */
+	unsigned char *map_chunk;  /* part of the mapping next points into, or NULL */
+#endif
 };
 
 static int	/* gz_load */
@@ -183,6 +325,29 @@ fill_in_buffer(FILE_T state)
 	return 0;
 }
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Make sure at least n bytes are available at next_in, unless we hit
+   the end of the file first; n must be no more than the buffer size. */
+static int
+fill_in_buffer_n(FILE_T state, guint n)
+{
+	guint got;
+
+	if (state->err)
+		return -1;
+	if (state->avail_in >= n || state->eof)
+		return 0;
+	if (state->avail_in != 0 && state->next_in != state->in)
+		memmove(state->in, state->next_in, state->avail_in);
+	state->next_in = state->in;
+	if (raw_read(state, state->in + state->avail_in,
+	    state->size - state->avail_in, &got) == -1)
+		return -1;
+	state->avail_in += got;
+	return 0;
+}
+#endif
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -268,6 +433,318 @@ fast_seek_reset(FILE_T state _U_)
 #endif
 }
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*
+ * Zstandard and LZ4 files are a series of frames, each of which can be
+ * decompressed on its own, so the start of any frame is a place we can
+ * seek to without saving any decompressor state.  Unlike with zlib,
+ * there's no way to save the state part way through a frame, so the
+ * frame starts are the only seek points; a file compressed as a single
+ * frame, which is what the zstd and lz4 command-line tools write, has
+ * to be decompressed from the beginning for every random access.
+ */
+static gboolean
+is_frame_compression(compression_t compression)
+{
+#ifdef HAVE_ZSTD
+	if (compression == ZSTD)
+		return TRUE;
+#endif
+#ifdef HAVE_LZ4
+	if (compression == LZ4)
+		return TRUE;
+#endif
+	return FALSE;
+}
+
+/* Frames longer than this make random access noticeably slow */
+#define FRAME_SLOW_SEEK_SPAN (16 * SPAN)
+
+/* Warn, once, if the sequential stream has read more than
+   FRAME_SLOW_SEEK_SPAN bytes past the last seek point. */
+static void
+frame_check_seek_span(FILE_T state, const char *format)
+{
+	struct fast_seek_point *item;
+
+	if (state->random || state->slow_seek_warned ||
+	    !state->fast_seek || state->fast_seek->len == 0)
+		return;
+
+	item = (struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1];
+	if (item->out + FRAME_SLOW_SEEK_SPAN <= state->pos) {
+		g_warning("%s file has frames larger than %u MB; random access to it will be slow.  Recompress it with \"editcap --compress\" to fix this.",
+		    format,
+		    (unsigned)(FRAME_SLOW_SEEK_SPAN / SPAN));
+		state->slow_seek_warned = TRUE;
+	}
+}
+
+/* Set up to decompress a frame starting at next_in.  Return -1, and set
+   state->err, on failure; return 0 on success. */
+static int
+frame_reset(FILE_T state, compression_t compression)
+{
+#ifdef HAVE_ZSTD
+	if (compression == ZSTD) {
+		size_t ret;
+
+		if (state->zstd_dctx == NULL) {
+			state->zstd_dctx = ZSTD_createDStream();
+			if (state->zstd_dctx == NULL) {
+				state->err = ENOMEM;
+				state->err_info = NULL;
+				return -1;
+			}
+		}
+		ret = ZSTD_initDStream(state->zstd_dctx);
+		if (ZSTD_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = ZSTD_getErrorName(ret);
+			return -1;
+		}
+	}
+#endif
+#ifdef HAVE_LZ4
+	if (compression == LZ4) {
+		LZ4F_errorCode_t ret;
+
+		/* a new context forgets about any frame we gave up on part
+		   way through */
+		if (state->lz4_dctx != NULL)
+			(void)LZ4F_freeDecompressionContext(state->lz4_dctx);
+		ret = LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION);
+		if (LZ4F_isError(ret)) {
+			state->lz4_dctx = NULL;
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = LZ4F_getErrorName(ret);
+			return -1;
+		}
+	}
+#endif
+	state->compression = compression;
+	state->is_compressed = TRUE;
+	return 0;
+}
+
+/* We've found the magic number of a frame at next_in; set up to
+   decompress it, and note where it is if it's far enough past the
+   last seek point.  Return -1, and set state->err, on failure; return
+   0 on success. */
+static int
+frame_start(FILE_T state, compression_t compression)
+{
+	struct fast_seek_point *item = NULL;
+
+	if (frame_reset(state, compression) == -1)
+		return -1;
+
+	if (state->fast_seek) {
+		if (state->fast_seek->len != 0)
+			item = (struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1];
+		if (!item || item->out + SPAN <= state->pos)
+			fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, compression);
+	}
+	return 0;
+}
+
+#ifdef HAVE_ZSTD
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	ZSTD_outBuffer output;
+	size_t ret;
+
+	output.dst = buf;
+	output.size = count;
+	output.pos = 0;
+	for (;;) {
+		ZSTD_inBuffer input;
+
+		/* this also flushes anything the decoder had no room for
+		   last time */
+		input.src = state->next_in;
+		input.size = state->avail_in;
+		input.pos = 0;
+		ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+		state->next_in += input.pos;
+		state->avail_in -= (guint)input.pos;
+		if (ZSTD_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = ZSTD_getErrorName(ret);
+			break;
+		}
+		if (ret == 0 || output.pos == output.size)
+			break;
+
+		/* the decoder needs more input */
+		if (state->avail_in == 0) {
+			if (fill_in_buffer(state) == -1)
+				break;
+			if (state->avail_in == 0) {
+				/* EOF in the middle of a frame */
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+				break;
+			}
+		}
+	}
+
+	state->next = buf;
+	state->have = (guint)output.pos;
+	if (ret == 0) {
+		state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+	} else if (output.pos == output.size && state->avail_in == 0) {
+		/* The decoder may still be holding output even though it's
+		   read all the input; don't look like we're at the end of
+		   the file until it's been flushed. */
+		state->eof = FALSE;
+	}
+}
+#endif
+
+#ifdef HAVE_LZ4
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	size_t got = 0;
+	size_t ret;
+
+	for (;;) {
+		size_t out_len = count - got;
+		size_t in_len = state->avail_in;
+
+		/* this also flushes anything the decoder had no room for
+		   last time */
+		ret = LZ4F_decompress(state->lz4_dctx, buf + got, &out_len,
+		    state->next_in, &in_len, NULL);
+		state->next_in += in_len;
+		state->avail_in -= (guint)in_len;
+		got += out_len;
+		if (LZ4F_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = LZ4F_getErrorName(ret);
+			break;
+		}
+		if (ret == 0 || got == count)
+			break;
+
+		/* the decoder needs more input */
+		if (state->avail_in == 0) {
+			if (fill_in_buffer(state) == -1)
+				break;
+			if (state->avail_in == 0) {
+				/* EOF in the middle of a frame */
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+				break;
+			}
+		}
+	}
+
+	state->next = buf;
+	state->have = (guint)got;
+	if (ret == 0) {
+		state->compression = UNKNOWN;      /* ready for next frame, once have is 0 */
+	} else if (got == count && state->avail_in == 0) {
+		/* see zstd_read() */
+		state->eof = FALSE;
+	}
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/*
+ * Seekable Zstandard files, such as the ones we write, end with a seek
+ * table in a skippable frame, giving the compressed and uncompressed
+ * size of every frame; see contrib/seekable_format in the zstd sources.
+ * Turn that into seek points, so that random access is fast without
+ * having to read the whole file first.
+ */
+static void
+zstd_seek_table_load(FILE_T state)
+{
+	ws_statb64 statb;
+	guint8 footer[WS_COMPRESS_SEEK_TABLE_FOOTER];
+	guint8 *table;
+	gint64 table_start, in, out;
+	guint32 num_frames, entry_len, table_len, i;
+	GPtrArray *points;
+
+	if (ws_fstat64(state->fd, &statb) == -1)
+		return;
+	if (statb.st_size - state->start < 8 + WS_COMPRESS_SEEK_TABLE_FOOTER)
+		return;
+
+	/* footer: number of frames, descriptor, magic number */
+	if (ws_lseek64(state->fd, statb.st_size - WS_COMPRESS_SEEK_TABLE_FOOTER, SEEK_SET) == -1 ||
+	    read(state->fd, footer, sizeof footer) != sizeof footer)
+		goto done;
+	if (pletoh32(footer + 5) != WS_COMPRESS_SEEKABLE_MAGIC ||
+	    (footer[4] & 0x7f) != 0)    /* reserved bits */
+		goto done;
+	num_frames = pletoh32(footer);
+	entry_len = (footer[4] & 0x80) ? 12 : 8;  /* with or without checksums */
+	if (num_frames == 0 || num_frames > G_MAXINT32 / 16 ||
+	    num_frames > (statb.st_size - state->start) / entry_len)
+		goto done;
+	table_len = num_frames * entry_len + WS_COMPRESS_SEEK_TABLE_FOOTER;
+	table_start = statb.st_size - table_len - 8;
+	if (table_start < state->start)
+		goto done;
+
+	table = (guint8 *)g_try_malloc(table_len + 8);
+	if (table == NULL)
+		goto done;
+	if (ws_lseek64(state->fd, table_start, SEEK_SET) == -1 ||
+	    read(state->fd, table, table_len + 8) != (ssize_t)(table_len + 8) ||
+	    pletoh32(table) != WS_COMPRESS_SEEK_TABLE_MAGIC ||
+	    pletoh32(table + 4) != table_len) {
+		g_free(table);
+		goto done;
+	}
+
+	points = g_ptr_array_new();
+	in = state->start;
+	out = 0;
+	for (i = 0; i < num_frames; i++) {
+		const guint8 *entry = table + 8 + i * entry_len;
+
+		if (points->len == 0 ||
+		    ((struct fast_seek_point *)points->pdata[points->len - 1])->out + SPAN <= out) {
+			struct fast_seek_point *val = g_new(struct fast_seek_point, 1);
+
+			val->in = in;
+			val->out = out;
+			val->compression = ZSTD;
+			g_ptr_array_add(points, val);
+		}
+		in += pletoh32(entry);
+		out += pletoh32(entry + 4);
+	}
+	g_free(table);
+
+	/* the frames had better add up to everything before the table */
+	if (in == table_start) {
+		for (i = 0; i < points->len; i++)
+			g_ptr_array_add(state->fast_seek, points->pdata[i]);
+		state->index_loaded = TRUE;
+	} else {
+		for (i = 0; i < points->len; i++)
+			g_free(points->pdata[i]);
+	}
+	g_ptr_array_free(points, TRUE);
+
+done:
+	/* carry on reading from where we were */
+	if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+		state->err = errno;
+		state->err_info = NULL;
+	}
+}
+#endif
+#endif
+
 #ifdef HAVE_LIBZ
 
 /* Get next byte from input, or -1 if end or error.
@@ -397,6 +874,35 @@ gz_skipzstr(FILE_T state)
 	return 0;
 }
 
+/* Skip the gzip extra field of length xlen, returning in *bgzf_size the
+   size of the whole member if the field has a BGZF "BC" subfield giving
+   it, or 0 otherwise.  Return 0 on success; otherwise -1 is returned. */
+static int
+gz_skipextra(FILE_T state, guint16 xlen, guint *bgzf_size)
+{
+	guint8 si1, si2;
+	guint16 slen, bsize;
+
+	*bgzf_size = 0;
+	while (xlen >= 4) {
+		if (gz_next1(state, &si1) == -1 ||
+		    gz_next1(state, &si2) == -1 ||
+		    gz_next2(state, &slen) == -1)
+			return -1;
+		xlen -= 4;
+		if (slen > xlen)
+			break;          /* malformed; just skip the rest */
+		if (si1 == 'B' && si2 == 'C' && slen == 2) {
+			if (gz_next2(state, &bsize) == -1)
+				return -1;
+			*bgzf_size = (guint)bsize + 1;
+		} else if (gz_skipn(state, slen) == -1)
+			return -1;
+		xlen -= slen;
+	}
+	return gz_skipn(state, xlen);
+}
+
 static void
 zlib_fast_seek_add(FILE_T file, struct zlib_cur_seek_point *point, int bits, gint64 in_pos, gint64 out_pos)
 {
@@ -545,38 +1051,846 @@ zlib_read(FILE_T state, unsigned char *buf, unsigned int count)
 		buf2 = (buf2 + count2 - strm->avail_out);
 		count2 = strm->avail_out;
 
-	} while (strm->avail_out && ret != Z_STREAM_END);
+	} while (strm->avail_out && ret != Z_STREAM_END);
+
+	/* update available output and crc check value */
+	state->next = buf;
+	state->have = count - strm->avail_out;
+
+	/* Check gzip trailer if at end of deflate stream.
+	   We don't fail immediately here, we just set an error
+	   indication, so that we try to process what data we
+	   got before the error.  The next attempt to read
+	   something past that data will get the error. */
+	if (ret == Z_STREAM_END) {
+		if (gz_next4(state, &crc) != -1 &&
+		    gz_next4(state, &len) != -1) {
+			if (crc != strm->adler && !state->dont_check_crc) {
+				state->err = WTAP_ERR_DECOMPRESS;
+				state->err_info = "bad CRC";
+			} else if (len != (strm->total_out & 0xffffffffL)) {
+				state->err = WTAP_ERR_DECOMPRESS;
+				state->err_info = "length field wrong";
+			}
+		}
+		state->compression = UNKNOWN;      /* ready for next stream, once have is 0 */
+		g_free(state->fast_seek_cur);
+		state->fast_seek_cur = NULL;
+	}
+}
+
+/*
+ * BGZF ("blocked gzip", as written by bgzip and samtools and by our own
+ * gzwfile_ routines) is a series of gzip members, each holding at most
+ * 64 KiB of uncompressed data and giving its own size in a "BC" extra
+ * subfield.  The members are independent and can be found without
+ * inflating anything, so the sequential stream reads them ahead and
+ * inflates them on a pool of worker threads, handing the results back
+ * in file order.
+ */
+#define BGZF_HEADER_MIN  12     /* gzip header up to and including XLEN */
+#define BGZF_TRAILER     8      /* CRC32 and ISIZE */
+#define BGZF_MAX_BLOCK   65536  /* largest member, and largest ISIZE */
+#define BGZF_MAX_THREADS 8
+
+struct bgzf_job {
+	unsigned char *in;         /* the whole member */
+	guint in_len;
+	guint hdr_len;             /* length of the member's gzip header */
+	gint64 raw_pos;            /* offset of the member in the file */
+	unsigned char *out;        /* inflated data */
+	guint out_len;
+	gboolean dont_check_crc;
+	gboolean done;             /* TRUE once taken off done_q */
+	int err;
+	const char *err_info;
+};
+
+struct bgzf_inflater {
+	GThreadPool *pool;
+	GAsyncQueue *done_q;       /* jobs the workers have finished */
+	struct bgzf_job *jobs;     /* ring of jobs, in file order */
+	guint njobs;
+	guint head;                /* oldest job in the ring */
+	guint queued;              /* jobs in the ring */
+	guint out_size;            /* size of every output buffer */
+	gboolean end;              /* no more BGZF members to read ahead */
+	int err;                   /* error reading ahead */
+};
+
+static void
+bgzf_inflate_job(gpointer data, gpointer user_data)
+{
+	struct bgzf_job *job = (struct bgzf_job *)data;
+	struct bgzf_inflater *bgzf = (struct bgzf_inflater *)user_data;
+	const unsigned char *trailer = job->in + job->in_len - BGZF_TRAILER;
+	z_stream strm;
+	int ret;
+
+	job->err = 0;
+	job->err_info = NULL;
+	job->out_len = 0;
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.avail_in = 0;
+	strm.next_in = Z_NULL;
+	if (inflateInit2(&strm, -15) != Z_OK) {    /* raw inflate */
+		job->err = ENOMEM;
+	} else {
+		strm.next_in = job->in + job->hdr_len;
+		strm.avail_in = job->in_len - job->hdr_len - BGZF_TRAILER;
+		strm.next_out = job->out;
+		strm.avail_out = bgzf->out_size;
+		ret = inflate(&strm, Z_FINISH);
+		job->out_len = bgzf->out_size - strm.avail_out;
+		if (ret == Z_MEM_ERROR) {
+			job->err = ENOMEM;
+		} else if (ret != Z_STREAM_END) {
+			job->err = WTAP_ERR_DECOMPRESS;
+			job->err_info = strm.msg != NULL ? strm.msg : "length field wrong";
+		} else if (!job->dont_check_crc &&
+		    pletoh32(trailer) != (guint32)crc32(0L, job->out, job->out_len)) {
+			job->err = WTAP_ERR_DECOMPRESS;
+			job->err_info = "bad CRC";
+		} else if (pletoh32(trailer + 4) != job->out_len) {
+			job->err = WTAP_ERR_DECOMPRESS;
+			job->err_info = "length field wrong";
+		}
+		inflateEnd(&strm);
+	}
+	g_async_queue_push(bgzf->done_q, job);
+}
+
+/* Wait for the oldest job in the ring to finish. */
+static struct bgzf_job *
+bgzf_wait_head(struct bgzf_inflater *bgzf)
+{
+	struct bgzf_job *job = &bgzf->jobs[bgzf->head];
+
+	while (!job->done) {
+		struct bgzf_job *finished = (struct bgzf_job *)g_async_queue_pop(bgzf->done_q);
+
+		finished->done = TRUE;
+	}
+	return job;
+}
+
+/* Read count bytes, returning the number read (less than count only at
+   the end of the file), or -1 on error.  Unlike raw_read() this doesn't
+   touch state->eof, as data may still be queued for inflating. */
+static int
+bgzf_read_raw(FILE_T state, unsigned char *buf, guint count)
+{
+	guint have = 0;
+	ssize_t ret;
+
+	while (have < count) {
+		ret = read(state->fd, buf + have, count - have);
+		if (ret < 0)
+			return -1;
+		if (ret == 0)
+			break;
+		have += (guint)ret;
+	}
+	state->raw_pos += have;
+	return (int)have;
+}
+
+/* Queue BGZF members until the ring is full.  Anything that isn't a
+   well-formed BGZF member ends the read-ahead, leaving the file
+   positioned at its start for the ordinary gzip code to deal with. */
+static void
+bgzf_read_ahead(FILE_T state)
+{
+	struct bgzf_inflater *bgzf = state->bgzf;
+
+	while (!bgzf->end && bgzf->queued < bgzf->njobs) {
+		struct bgzf_job *job = &bgzf->jobs[(bgzf->head + bgzf->queued) % bgzf->njobs];
+		gint64 start = state->raw_pos;
+		guint hdr_len, bsize = 0;
+		guint16 slen;
+		int got;
+
+		got = bgzf_read_raw(state, job->in, BGZF_HEADER_MIN);
+		if (got == BGZF_HEADER_MIN && job->in[0] == 31 && job->in[1] == 139 &&
+		    job->in[2] == 8 && job->in[3] == 4) {
+			hdr_len = BGZF_HEADER_MIN + pletoh16(job->in + 10);
+			if (hdr_len <= BGZF_MAX_BLOCK - BGZF_TRAILER)
+				got = bgzf_read_raw(state, job->in + BGZF_HEADER_MIN, hdr_len - BGZF_HEADER_MIN);
+			else
+				got = 0;
+			if (got > 0 && (guint)got == hdr_len - BGZF_HEADER_MIN) {
+				const unsigned char *sub = job->in + BGZF_HEADER_MIN;
+
+				while (sub + 4 <= job->in + hdr_len) {
+					slen = pletoh16(sub + 2);
+					if (sub[0] == 'B' && sub[1] == 'C' && slen == 2 &&
+					    sub + 6 <= job->in + hdr_len) {
+						bsize = (guint)pletoh16(sub + 4) + 1;
+						break;
+					}
+					sub += 4 + slen;
+				}
+			}
+			if (bsize >= hdr_len + BGZF_TRAILER) {
+				got = bgzf_read_raw(state, job->in + hdr_len, bsize - hdr_len);
+				if (got >= 0 && (guint)got == bsize - hdr_len &&
+				    pletoh32(job->in + bsize - 4) <= bgzf->out_size) {
+					job->in_len = bsize;
+					job->hdr_len = hdr_len;
+					job->raw_pos = start;
+					job->dont_check_crc = state->dont_check_crc;
+					job->done = FALSE;
+					g_thread_pool_push(bgzf->pool, job, NULL);
+					bgzf->queued++;
+					continue;
+				}
+			}
+		}
+		if (got == -1)
+			bgzf->err = errno;
+		else if (ws_lseek64(state->fd, start, SEEK_SET) != -1)
+			state->raw_pos = start;
+		else
+			bgzf->err = errno;
+		bgzf->end = TRUE;
+	}
+}
+
+/* Wait for any queued jobs and empty the ring, e.g. before seeking. */
+static void
+bgzf_reset(FILE_T state)
+{
+	struct bgzf_inflater *bgzf = state->bgzf;
+
+	if (bgzf == NULL)
+		return;
+	while (bgzf->queued) {
+		bgzf_wait_head(bgzf);
+		bgzf->head = (bgzf->head + 1) % bgzf->njobs;
+		bgzf->queued--;
+	}
+	bgzf->head = 0;
+	bgzf->end = FALSE;
+	bgzf->err = 0;
+}
+
+static void
+bgzf_free(FILE_T state)
+{
+	struct bgzf_inflater *bgzf = state->bgzf;
+	guint i;
+
+	if (bgzf == NULL)
+		return;
+	bgzf_reset(state);
+	g_thread_pool_free(bgzf->pool, FALSE, TRUE);
+	g_async_queue_unref(bgzf->done_q);
+	for (i = 0; i < bgzf->njobs; i++) {
+		g_free(bgzf->jobs[i].in);
+		g_free(bgzf->jobs[i].out);
+	}
+	g_free(bgzf->jobs);
+	g_free(bgzf);
+	state->bgzf = NULL;
+}
+
+static guint
+bgzf_threads(void)
+{
+#if GLIB_CHECK_VERSION(2,36,0)
+	guint n = g_get_num_processors();
+#else
+	guint n = 2;
+#endif
+
+	return MIN(n, BGZF_MAX_THREADS);
+}
+
+/* Called by gz_head() on finding a BGZF member header starting at
+   member_start.  Switch to inflating in parallel and return TRUE, or
+   return FALSE to inflate the member the ordinary way. */
+static gboolean
+bgzf_start(FILE_T state, gint64 member_start)
+{
+	struct bgzf_inflater *bgzf = state->bgzf;
+	guint nthreads, i;
+
+	/* Reading ahead is wasted on the random-access stream. */
+	if (state->random || state->bgzf_disabled)
+		return FALSE;
+
+	if (bgzf == NULL) {
+		unsigned char *out;
+
+		nthreads = bgzf_threads();
+		if (nthreads < 2) {
+			state->bgzf_disabled = TRUE;
+			return FALSE;
+		}
+#if !GLIB_CHECK_VERSION(2,31,0)
+		if (!g_thread_supported())
+			g_thread_init(NULL);
+#endif
+		bgzf = g_new0(struct bgzf_inflater, 1);
+		/* Output buffers are swapped with state->out, so they
+		   must all be at least as big as it is. */
+		bgzf->out_size = MAX(BGZF_MAX_BLOCK, state->size << 1);
+		out = (unsigned char *)g_try_realloc(state->out, bgzf->out_size);
+		if (out == NULL) {
+			g_free(bgzf);
+			state->bgzf_disabled = TRUE;
+			return FALSE;
+		}
+		state->out = out;
+		state->next = out;
+		bgzf->njobs = nthreads * 2;
+		bgzf->jobs = g_new0(struct bgzf_job, bgzf->njobs);
+		for (i = 0; i < bgzf->njobs; i++) {
+			bgzf->jobs[i].in = (unsigned char *)g_malloc(BGZF_MAX_BLOCK);
+			bgzf->jobs[i].out = (unsigned char *)g_malloc(bgzf->out_size);
+		}
+		bgzf->done_q = g_async_queue_new();
+		bgzf->pool = g_thread_pool_new(bgzf_inflate_job, bgzf, nthreads, FALSE, NULL);
+		state->bgzf = bgzf;
+		if (bgzf->pool == NULL) {
+			bgzf_free(state);
+			state->bgzf_disabled = TRUE;
+			return FALSE;
+		}
+	}
+
+	/* Go back to the start of the member; this fails on pipes, which
+	   just get inflated the ordinary way. */
+	if (ws_lseek64(state->fd, member_start, SEEK_SET) == -1) {
+		state->bgzf_disabled = TRUE;
+		return FALSE;
+	}
+	bgzf_reset(state);
+	state->raw_pos = member_start;
+	state->avail_in = 0;
+	state->eof = FALSE;
+	state->compression = BGZF;
+	state->is_compressed = TRUE;
+	return TRUE;
+}
+
+/* Hand the next inflated block to the caller, or, when the BGZF members
+   run out, set state->compression back to UNKNOWN to look at whatever
+   follows.  Return -1, with state->err set, on error. */
+static int
+bgzf_read(FILE_T state)
+{
+	struct bgzf_inflater *bgzf = state->bgzf;
+	struct bgzf_job *job;
+	unsigned char *out;
+
+	state->have = 0;
+	do {
+		bgzf_read_ahead(state);
+		if (bgzf->queued == 0) {
+			if (bgzf->err) {
+				state->err = bgzf->err;
+				state->err_info = NULL;
+				return -1;
+			}
+			state->compression = UNKNOWN;
+			state->bgzf_disabled = TRUE;
+			return 0;
+		}
+
+		job = bgzf_wait_head(bgzf);
+		bgzf->head = (bgzf->head + 1) % bgzf->njobs;
+		bgzf->queued--;
+		if (job->err) {
+			state->err = job->err;
+			state->err_info = job->err_info;
+			return -1;
+		}
+		if (job->out_len == 0)
+			continue;       /* e.g. the end-of-file marker block */
+
+		/* Members are independent, so any of them is a seek point
+		   that needs no window; record one every SPAN bytes. */
+		if (state->fast_seek) {
+			struct fast_seek_point *item = NULL;
+
+			if (state->fast_seek->len != 0)
+				item = (struct fast_seek_point *)state->fast_seek->pdata[state->fast_seek->len - 1];
+			if (!item || item->out + SPAN < state->pos)
+				fast_seek_header(state, job->raw_pos + job->hdr_len, state->pos, GZIP_AFTER_HEADER);
+		}
+
+		/* hand over the output by swapping buffers with the job */
+		out = state->out;
+		state->out = job->out;
+		job->out = out;
+		state->next = state->out;
+		state->have = job->out_len;
+	} while (state->have == 0);
+	return 0;
+}
+
+/*
+ * The fast seek points for a compressed file can be saved in a file
+ * next to it, so that the next time it's opened random access is fast
+ * without first reading all of it.  All values are little-endian:
+ *
+ *	magic (8 bytes), size and modification time of the compressed
+ *	file (8 bytes each), CRC-32 of its first GZIDX_CHECK_LEN bytes
+ *	(4 bytes), number of points (4 bytes), then for each
+ *	point:  out and in (8 bytes each), compression and bits (1 byte
+ *	each), adler and total_out (4 bytes each), and the length (4 bytes)
+ *	of the point's window, compressed with zlib, followed by the
+ *	window itself.  Only ZLIB points have a window.
+ *
+ * The index is ignored if the file's size, modification time or CRC
+ * doesn't match, or if anything in it doesn't make sense.  It's only
+ * written if the reader asked for that with file_set_index_save().
+ */
+#define GZIDX_MIN_SIZE    (8 * SPAN)  /* don't bother indexing smaller files */
+#define GZIDX_CHECK_LEN   65536
+#define GZIDX_HEADER_LEN  32
+#define GZIDX_POINT_LEN   30
+
+static const guint8 gzidx_magic[8] = { 'W', 'S', 'G', 'Z', 'I', 'D', 'X', 2 };
+
+static void
+gzidx_put32(GByteArray *buf, guint32 val)
+{
+	guint8 b[4];
+
+	b[0] = (guint8)val;
+	b[1] = (guint8)(val >> 8);
+	b[2] = (guint8)(val >> 16);
+	b[3] = (guint8)(val >> 24);
+	g_byte_array_append(buf, b, 4);
+}
+
+static void
+gzidx_put64(GByteArray *buf, guint64 val)
+{
+	gzidx_put32(buf, (guint32)val);
+	gzidx_put32(buf, (guint32)(val >> 32));
+}
+
+/*
+ * The CRC-32 of the start of the file, so that an index made for some
+ * other file that happens to have the same size and modification time
+ * isn't used.  The descriptor's position is left as it was.
+ */
+static gboolean
+gzidx_check(FILE_T state, guint32 *crc)
+{
+	unsigned char *buf;
+	gint64 pos;
+	ssize_t got;
+
+	pos = ws_lseek64(state->fd, 0, SEEK_CUR);
+	if (pos == -1 || ws_lseek64(state->fd, 0, SEEK_SET) == -1)
+		return FALSE;
+	buf = (unsigned char *)g_malloc(GZIDX_CHECK_LEN);
+	got = read(state->fd, buf, GZIDX_CHECK_LEN);
+	if (ws_lseek64(state->fd, pos, SEEK_SET) == -1)
+		got = -1;
+	if (got >= 0)
+		*crc = (guint32)crc32(0L, buf, (uInt)got);
+	g_free(buf);
+	return got >= 0;
+}
+
+static void
+gzidx_load(FILE_T state)
+{
+	ws_statb64 statb;
+	gchar *contents;
+	gsize length;
+	const guint8 *p, *end;
+	guint32 crc, count, i;
+	GPtrArray *points;
+
+	if (state->index_path == NULL || ws_fstat64(state->fd, &statb) == -1)
+		return;
+	if (!g_file_get_contents(state->index_path, &contents, &length, NULL))
+		return;
+
+	p = (const guint8 *)contents;
+	end = p + length;
+	if (length < GZIDX_HEADER_LEN || memcmp(p, gzidx_magic, sizeof gzidx_magic) != 0 ||
+	    pletoh64(p + 8) != (guint64)statb.st_size ||
+	    pletoh64(p + 16) != (guint64)statb.st_mtime ||
+	    !gzidx_check(state, &crc) || pletoh32(p + 24) != crc) {
+		g_free(contents);
+		return;
+	}
+	count = pletoh32(p + 28);
+	p += GZIDX_HEADER_LEN;
+
+	points = g_ptr_array_new();
+	for (i = 0; i < count; i++) {
+		struct fast_seek_point *val;
+		guint32 wlen;
+
+		if ((gsize)(end - p) < GZIDX_POINT_LEN)
+			break;
+		wlen = pletoh32(p + 26);
+		if ((gsize)(end - p - GZIDX_POINT_LEN) < wlen)
+			break;
+
+		val = g_new(struct fast_seek_point, 1);
+		val->out = (gint64)pletoh64(p);
+		val->in = (gint64)pletoh64(p + 8);
+		val->compression = (compression_t)p[16];
+		if (val->out < 0 || val->in < 0 || val->in > statb.st_size ||
+		    (points->len != 0 &&
+		     val->out <= ((struct fast_seek_point *)points->pdata[points->len - 1])->out)) {
+			g_free(val);
+			break;
+		}
+		if (val->compression == ZLIB) {
+			uLongf winsize = ZLIB_WINSIZE;
+
+#ifdef HAVE_INFLATEPRIME
+			val->data.zlib.bits = p[17];
+#else
+			if (p[17] != 0) {
+				/* we can't resume in the middle of a byte */
+				g_free(val);
+				p += GZIDX_POINT_LEN + wlen;
+				continue;
+			}
+#endif
+			val->data.zlib.adler = pletoh32(p + 18);
+			val->data.zlib.total_out = pletoh32(p + 22);
+			if (uncompress(val->data.zlib.window, &winsize, p + GZIDX_POINT_LEN, wlen) != Z_OK ||
+			    winsize != ZLIB_WINSIZE) {
+				g_free(val);
+				break;
+			}
+		} else if (val->compression != UNCOMPRESSED &&
+		    val->compression != GZIP_AFTER_HEADER
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+		    && !is_frame_compression(val->compression)
+#endif
+		    ) {
+			g_free(val);
+			break;
+		}
+		g_ptr_array_add(points, val);
+		p += GZIDX_POINT_LEN + wlen;
+	}
+	g_free(contents);
+
+	if (i == count) {
+		for (i = 0; i < points->len; i++)
+			g_ptr_array_add(state->fast_seek, points->pdata[i]);
+		state->index_loaded = TRUE;
+	} else {
+		for (i = 0; i < points->len; i++)
+			g_free(points->pdata[i]);
+	}
+	g_ptr_array_free(points, TRUE);
+}
+
+static void
+gzidx_save(FILE_T state)
+{
+	ws_statb64 statb;
+	GByteArray *buf;
+	unsigned char *window;
+	uLong window_bound = compressBound(ZLIB_WINSIZE);
+	guint32 crc;
+	guint i;
+
+	if (ws_fstat64(state->fd, &statb) == -1 || !gzidx_check(state, &crc))
+		return;
+
+	buf = g_byte_array_new();
+	window = (unsigned char *)g_malloc(window_bound);
+	g_byte_array_append(buf, gzidx_magic, sizeof gzidx_magic);
+	gzidx_put64(buf, (guint64)statb.st_size);
+	gzidx_put64(buf, (guint64)statb.st_mtime);
+	gzidx_put32(buf, crc);
+	gzidx_put32(buf, state->fast_seek->len);
+	for (i = 0; i < state->fast_seek->len; i++) {
+		struct fast_seek_point *item = (struct fast_seek_point *)state->fast_seek->pdata[i];
+		guint8 b[2];
+		uLongf wlen = 0;
+
+		b[0] = (guint8)item->compression;
+		b[1] = 0;
+		gzidx_put64(buf, (guint64)item->out);
+		gzidx_put64(buf, (guint64)item->in);
+		if (item->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+			b[1] = (guint8)item->data.zlib.bits;
+#endif
+			wlen = window_bound;
+			if (compress2(window, &wlen, item->data.zlib.window, ZLIB_WINSIZE,
+			    Z_DEFAULT_COMPRESSION) != Z_OK)
+				break;
+			g_byte_array_append(buf, b, 2);
+			gzidx_put32(buf, item->data.zlib.adler);
+			gzidx_put32(buf, item->data.zlib.total_out);
+		} else {
+			g_byte_array_append(buf, b, 2);
+			gzidx_put32(buf, 0);
+			gzidx_put32(buf, 0);
+		}
+		gzidx_put32(buf, (guint32)wlen);
+		g_byte_array_append(buf, window, (guint)wlen);
+	}
+
+	/* Failing to save the index (read-only directory, say) isn't an
+	   error as far as reading the capture goes. */
+	if (i == state->fast_seek->len)
+		(void)g_file_set_contents(state->index_path, (const gchar *)buf->data,
+		    buf->len, NULL);
+	g_free(window);
+	g_byte_array_free(buf, TRUE);
+}
+#endif
+
+#ifdef HAVE_MMAP
+/* Most of the mapping handed out as output at once, so have fits */
+#define MAP_CHUNK	(1024 * 1024 * 1024)
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+
+/*
+ * Mappings that are still in use, by a reader or by Buffers, for the
+ * SIGBUS handler to look up.  A file is read without mapping it if
+ * there are already this many.
+ */
+#define MAX_MAPS	64
+
+static struct file_map * volatile live_maps[MAX_MAPS];
+static struct sigaction old_sigbus;
+static gsize page_size;
+
+/*
+ * A file that's mapped can shrink after we've checked its size, for
+ * example if somebody overwrites it; touching a page of the mapping
+ * that's no longer backed by the file raises SIGBUS.  If that happens
+ * in one of our mappings, put zero-filled pages in place of the rest of
+ * it, so that whatever touched it, be it the reader or somebody with a
+ * Buffer referring to it, gets zeroes, and flag the mapping so that the
+ * reader stops using it and reports the file as cut short.  Anything
+ * else is left to whatever handled SIGBUS before.
+ */
+static void
+file_map_sigbus(int sig, siginfo_t *info, void *context)
+{
+	unsigned char *addr = (unsigned char *)info->si_addr;
+	unsigned char *page;
+	struct file_map *map;
+	int i;
+
+	for (i = 0; i < MAX_MAPS; i++) {
+		map = live_maps[i];
+		if (map == NULL || addr < map->addr || addr >= map->addr + map->size)
+			continue;
+		page = map->addr + ((gsize)(addr - map->addr) & ~(page_size - 1));
+		if (mmap(page, (size_t)(map->addr + map->size - page),
+		    PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED,
+		    -1, 0) == MAP_FAILED)
+			break;
+		map->truncated = 1;
+		return;
+	}
+
+	if (old_sigbus.sa_flags & SA_SIGINFO)
+		old_sigbus.sa_sigaction(sig, info, context);
+	else if (old_sigbus.sa_handler != SIG_DFL && old_sigbus.sa_handler != SIG_IGN)
+		old_sigbus.sa_handler(sig);
+	else {
+		/* the fault happens again on return, and is fatal this time */
+		signal(SIGBUS, SIG_DFL);
+	}
+}
+
+static gboolean
+file_map_sigbus_init(void)
+{
+	static gsize initialized = 0;
+	static gboolean ok = FALSE;
+	struct sigaction sa;
+
+	if (g_once_init_enter(&initialized)) {
+		page_size = (gsize)sysconf(_SC_PAGESIZE);
+		memset(&sa, 0, sizeof sa);
+		sa.sa_sigaction = file_map_sigbus;
+		sa.sa_flags = SA_SIGINFO;
+		sigemptyset(&sa.sa_mask);
+		ok = page_size != 0 && (page_size & (page_size - 1)) == 0 &&
+		    sigaction(SIGBUS, &sa, &old_sigbus) == 0;
+		g_once_init_leave(&initialized, 1);
+	}
+	return ok;
+}
+
+static void
+file_map_advise(FILE_T state)
+{
+#if defined(MADV_SEQUENTIAL) && defined(MADV_RANDOM)
+	if (state->map != NULL)
+		(void)madvise(state->map->addr, (size_t)state->map->size,
+		    state->random ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+}
+
+static void
+file_map_unref(void *data)
+{
+	struct file_map *map = (struct file_map *)data;
+	int i;
+
+	if (--map->refcount == 0) {
+		for (i = 0; i < MAX_MAPS; i++) {
+			if (g_atomic_pointer_compare_and_exchange(&live_maps[i], map, NULL))
+				break;
+		}
+		(void)munmap(map->addr, (size_t)map->size);
+		g_free(map);
+	}
+}
+
+/*
+ * Map an uncompressed file into memory, so its data can be handed out
+ * in place instead of being read into the output buffer and copied
+ * from there.  That's only done for readers that take packet data with
+ * file_read_mapped(), once they first do so, and not for files that
+ * are still being written, as a capture in progress is.
+ *
+ * The mapping is private and writable, so that anybody who modifies
+ * packet data they were handed gets their own copy of the page rather
+ * than a crash, and the file itself is never touched.
+ */
+static void
+file_map(FILE_T state)
+{
+	ws_statb64 statb;
+	struct file_map *map;
+	void *addr;
+	int i;
+
+	state->map_tried = TRUE;
+	if (state->start != 0 || ws_fstat64(state->fd, &statb) == -1 ||
+	    !S_ISREG(statb.st_mode) || statb.st_size <= 0 ||
+	    (guint64)statb.st_size > G_MAXSIZE || !file_map_sigbus_init())
+		return;
+	addr = mmap(NULL, (size_t)statb.st_size, PROT_READ|PROT_WRITE,
+	    MAP_PRIVATE, state->fd, 0);
+	if (addr == MAP_FAILED)
+		return;
+	map = g_new(struct file_map, 1);
+	map->addr = (unsigned char *)addr;
+	map->size = statb.st_size;
+	map->refcount = 1;
+	map->truncated = 0;
+	for (i = 0; i < MAX_MAPS; i++) {
+		if (g_atomic_pointer_compare_and_exchange(&live_maps[i], NULL, map))
+			break;
+	}
+	if (i == MAX_MAPS) {
+		(void)munmap(addr, (size_t)statb.st_size);
+		g_free(map);
+		return;
+	}
+	state->map = map;
+	file_map_advise(state);
+}
+
+/*
+ * Stop handing out the mapping, because the file has shrunk and parts
+ * of it are no longer backed by the file.  Whatever's left of the
+ * current chunk is read again, with read(), which gets the short read.
+ * Buffers already referring to the mapping keep it.
+ */
+static void
+file_map_drop(FILE_T file)
+{
+	file->raw_pos -= file->have;
+	file->have = 0;
+	file->map_chunk = NULL;
+	file_map_unref(file->map);
+	file->map = NULL;
+	if (ws_lseek64(file->fd, file->raw_pos, SEEK_SET) == -1) {
+		file->err = errno;
+		file->err_info = NULL;
+	}
+}
+
+/* Hand out the next chunk of the mapping as output, if there's any
+   left; returns 1 if there was, 0 if not and -1 on an error. */
+static int
+file_map_next(FILE_T state)
+{
+	ws_statb64 statb;
+	gint64 left;
 
-	/* update available output and crc check value */
-	state->next = buf;
-	state->have = count - strm->avail_out;
+	if (!state->map_tried && state->map_wanted)
+		file_map(state);
+	state->map_chunk = NULL;
+	if (state->map == NULL || state->raw_pos >= state->map->size)
+		return 0;
 
-	/* Check gzip trailer if at end of deflate stream.
-	   We don't fail immediately here, we just set an error
-	   indication, so that we try to process what data we
-	   got before the error.  The next attempt to read
-	   something past that data will get the error. */
-	if (ret == Z_STREAM_END) {
-		if (gz_next4(state, &crc) != -1 &&
-		    gz_next4(state, &len) != -1) {
-			if (crc != strm->adler && !state->dont_check_crc) {
-				state->err = WTAP_ERR_DECOMPRESS;
-				state->err_info = "bad CRC";
-			} else if (len != (strm->total_out & 0xffffffffL)) {
-				state->err = WTAP_ERR_DECOMPRESS;
-				state->err_info = "length field wrong";
-			}
-		}
-		state->compression = UNKNOWN;      /* ready for next stream, once have is 0 */
-		g_free(state->fast_seek_cur);
-		state->fast_seek_cur = NULL;
+	/* the file is only checked for having shrunk once for each chunk;
+	   if it shrinks while the chunk is in use, the SIGBUS handler
+	   catches it */
+	if (state->map->truncated || ws_fstat64(state->fd, &statb) == -1 ||
+	    statb.st_size < state->map->size) {
+		state->have = 0;
+		file_map_drop(state);
+		return state->err ? -1 : 0;
+	}
+
+	left = state->map->size - state->raw_pos;
+	state->have = left > MAP_CHUNK ? MAP_CHUNK : (guint)left;
+	state->next = state->map_chunk = state->map->addr + state->raw_pos;
+	state->raw_pos += state->have;
+
+	/* keep the descriptor in step, for seeking relative to it and for
+	   reading anything past the end of the mapping */
+	if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+		state->err = errno;
+		state->err_info = NULL;
+		state->have = 0;
+		return -1;
 	}
+	return 1;
+}
+
+/*
+ * If the output buffer is part of a mapping that the SIGBUS handler
+ * found to be past the end of the file, stop using the mapping, leaving
+ * the output buffer empty.  Returns TRUE if it did, in which case
+ * whatever was just taken from the output buffer may be zeroes and has
+ * to be read again.  This is only a look at a flag, so it's done after
+ * each use of the output buffer; single bytes are loaded through a
+ * volatile pointer, so that the load isn't moved after the check.
+ */
+static gboolean
+file_map_check(FILE_T file)
+{
+	if (file->map_chunk == NULL || !file->map->truncated)
+		return FALSE;
+	file_map_drop(file);
+	return TRUE;
 }
 #endif
 
 static int
 gz_head(FILE_T state)
 {
+#ifdef HAVE_LIBZ
+	gint64 member_start;
+#endif
+
 	/* get some data in the input buffer */
 	if (state->avail_in == 0) {
 		if (fill_in_buffer(state) == -1)
@@ -585,6 +1899,39 @@ gz_head(FILE_T state)
 			return 0;
 	}
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	/* look for the magic number of a Zstandard or LZ4 frame, or of a
+	   skippable frame, which either format can have */
+	if (fill_in_buffer_n(state, 4) == -1)
+		return -1;
+	if (state->avail_in >= 4) {
+		guint32 magic = pletoh32(state->next_in);
+		compression_t frame = UNKNOWN;
+
+		if ((magic & SKIPPABLE_FRAME_MASK) == SKIPPABLE_FRAME_MAGIC) {
+#ifdef HAVE_ZSTD
+			frame = ZSTD;
+#else
+			frame = LZ4;
+#endif
+		}
+#ifdef HAVE_ZSTD
+		if (magic == ZSTD_FRAME_MAGIC)
+			frame = ZSTD;
+#endif
+#ifdef HAVE_LZ4
+		if (magic == LZ4_FRAME_MAGIC)
+			frame = LZ4;
+#endif
+		if (frame != UNKNOWN)
+			return frame_start(state, frame);
+	}
+#endif
+
+#ifdef HAVE_LIBZ
+	member_start = state->raw_pos - state->avail_in;
+#endif
+
 	/* look for the gzip magic header bytes 31 and 139 */
 #ifdef HAVE_LIBZ
 	if (state->next_in[0] == 31) {
@@ -597,6 +1944,7 @@ gz_head(FILE_T state)
 			guint8 flags;
 			guint16 len;
 			guint16 hcrc;
+			guint bgzf_size = 0;
 
 			/* we have a gzip header, woo hoo! */
 			state->avail_in--;
@@ -639,8 +1987,8 @@ gz_head(FILE_T state)
 				if (gz_next2(state, &len) == -1)
 					return -1;
 
-				/* skip the extra field */
-				if (gz_skipn(state, len) == -1)
+				/* skip the extra field, noting any BGZF block size */
+				if (gz_skipextra(state, len, &bgzf_size) == -1)
 					return -1;
 			}
 			if (flags & 8) {
@@ -660,6 +2008,10 @@ gz_head(FILE_T state)
 				/* XXX - check the CRC? */
 			}
 
+			/* BGZF blocks can be read ahead and inflated in parallel */
+			if (bgzf_size != 0 && flags == 4 && bgzf_start(state, member_start))
+				return 0;
+
 			/* set up for decompression */
 			inflateReset(&(state->strm));
 			state->strm.adler = crc32(0L, Z_NULL, 0);
@@ -696,6 +2048,9 @@ gz_head(FILE_T state)
 	   the input buffer, which also assures space for gzungetc() */
 	state->raw = state->pos;
 	state->next = state->out;
+#ifdef HAVE_MMAP
+	state->map_chunk = NULL;
+#endif
 	if (state->avail_in) {
 		memcpy(state->next + state->have, state->next_in, state->avail_in);
 		state->have += state->avail_in;
@@ -715,6 +2070,14 @@ fill_out_buffer(FILE_T state)
 			return 0;
 	}
 	if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+		switch (file_map_next(state)) {
+		case -1:
+			return -1;
+		case 1:
+			return 0;
+		}
+#endif
 		if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
 			return -1;
 		state->next = state->out;
@@ -723,6 +2086,24 @@ fill_out_buffer(FILE_T state)
 	else if (state->compression == ZLIB) {      /* decompress */
 		zlib_read(state, state->out, state->size << 1);
 	}
+	else if (state->compression == BGZF) {      /* inflated by the workers */
+		if (bgzf_read(state) == -1)
+			return -1;
+		if (state->compression == UNKNOWN)  /* no longer BGZF */
+			return fill_out_buffer(state);
+	}
+#endif
+#ifdef HAVE_ZSTD
+	else if (state->compression == ZSTD) {
+		zstd_read(state, state->out, state->size << 1);
+		frame_check_seek_span(state, "Zstandard");
+	}
+#endif
+#ifdef HAVE_LZ4
+	else if (state->compression == LZ4) {
+		lz4_read(state, state->out, state->size << 1);
+		frame_check_seek_span(state, "LZ4");
+	}
 #endif
 	return 0;
 }
@@ -775,6 +2156,12 @@ gz_reset(FILE_T state)
 	state->err_info = NULL;
 	state->pos = 0;               /* no uncompressed data yet */
 	state->avail_in = 0;          /* no input data yet */
+#ifdef HAVE_MMAP
+	state->map_chunk = NULL;      /* not handing out the mapping */
+#endif
+#ifdef HAVE_LIBZ
+	state->bgzf_disabled = FALSE; /* try inflating BGZF in parallel again */
+#endif
 }
 
 FILE_T
@@ -796,6 +2183,26 @@ file_fdopen(int fd)
 
 	state->fast_seek_cur = NULL;
 	state->fast_seek = NULL;
+	state->index_path = NULL;
+	state->index_save = FALSE;
+	state->index_loaded = FALSE;
+	state->random = FALSE;
+	state->slow_seek_warned = FALSE;
+#ifdef HAVE_LIBZ
+	state->bgzf = NULL;
+#endif
+#ifdef HAVE_ZSTD
+	state->zstd_dctx = NULL;
+#endif
+#ifdef HAVE_LZ4
+	state->lz4_dctx = NULL;
+#endif
+#ifdef HAVE_MMAP
+	state->map = NULL;
+	state->map_wanted = FALSE;
+	state->map_tried = FALSE;
+	state->map_chunk = NULL;
+#endif
 
 	/* open the file with the appropriate mode (or just use fd) */
 	state->fd = fd;
@@ -907,15 +2314,48 @@ file_open(const char *path)
 		if (g_ascii_strcasecmp(suffixp, ".caz") == 0)
 			ft->dont_check_crc = TRUE;
 	}
+
+	ft->index_path = g_strconcat(path, GZIDX_SUFFIX, NULL);
 #endif
 
 	return ft;
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
 	stream->fast_seek = seek;
+	stream->random = random_flag;
+#ifdef HAVE_MMAP
+	file_map_advise(stream);
+#endif
+	/* The streams share the seek points; load any saved ones once,
+	   preferring the seek table of a seekable Zstandard file. */
+#ifdef HAVE_ZSTD
+	if (!random_flag && seek->len == 0)
+		zstd_seek_table_load(stream);
+#endif
+#ifdef HAVE_LIBZ
+	if (!random_flag && seek->len == 0)
+		gzidx_load(stream);
+#endif
+}
+
+void
+file_set_index_save(FILE_T stream, gboolean save)
+{
+	stream->index_save = save;
+}
+
+void
+file_set_growing(FILE_T stream)
+{
+#ifdef HAVE_MMAP
+	/* it's read with read(); see file_map() */
+	stream->map_tried = TRUE;
+#else
+	(void)stream;
+#endif
 }
 
 gint64
@@ -941,12 +2381,17 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 	file->seek_pending = FALSE;
 
 	if (offset < 0 && file->next) {
+#ifdef HAVE_MMAP
+		unsigned char *base = file->map_chunk != NULL ? file->map_chunk : file->out;
+#else
+		unsigned char *base = file->out;
+#endif
 		/*
 		 * This is guaranteed to fit in an unsigned int.
 		 * To squelch compiler warnings, we cast the
 		 * result.
 		 */
-		guint had = (unsigned)(file->next - file->out);
+		guint had = (unsigned)(file->next - base);
 		if (-offset <= had) {
 			/*
 			 * Offset is negative, so -offset is
@@ -972,6 +2417,12 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 	if ((here = fast_seek_find(file, file->pos + offset)) && (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
 		gint64 off, off2;
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+		if (is_frame_compression(here->compression)) {
+			off = here->in;
+			off2 = here->out;
+		} else
+#endif
 #ifdef HAVE_LIBZ
 		if (here->compression == ZLIB) {
 #ifdef HAVE_INFLATEPRIME
@@ -995,6 +2446,9 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 			return -1;
 		}
 		fast_seek_reset(file);
+#ifdef HAVE_LIBZ
+		bgzf_reset(file);
+#endif
 
 		file->raw_pos = off;
 		file->have = 0;
@@ -1004,6 +2458,14 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 		file->err_info = NULL;
 		file->avail_in = 0;
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+		if (is_frame_compression(here->compression)) {
+			if (frame_reset(file, here->compression) == -1) {
+				*err = file->err;
+				return -1;
+			}
+		} else
+#endif
 #ifdef HAVE_LIBZ
 		if (here->compression == ZLIB) {
 			z_stream *strm = &file->strm;
@@ -1085,6 +2547,9 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 			return -1;
 		}
 		fast_seek_reset(file);
+#ifdef HAVE_LIBZ
+		bgzf_reset(file);
+#endif
 		file->raw_pos = file->start;
 		gz_reset(file);
 	}
@@ -1173,6 +2638,12 @@ file_read(void *buf, unsigned int len, FILE_T file)
 			   what we have. */
 			n = file->have > len ? len : file->have;
 			memcpy(buf, file->next, n);
+#ifdef HAVE_MMAP
+			/* if that was past the end of the file, read
+			   it again without the mapping */
+			if (file_map_check(file))
+				continue;
+#endif
 			file->next += n;
 			file->have -= n;
 		} else if (file->err) {
@@ -1207,6 +2678,56 @@ file_read(void *buf, unsigned int len, FILE_T file)
 	return (int)got;
 }
 
+/*
+ * If the next len bytes of the file are in memory we've mapped, make buf
+ * refer to them and move past them, so they needn't be copied; buf keeps
+ * the mapping around for as long as it refers to it, even after the file
+ * is closed.  Otherwise, return FALSE without consuming anything, and
+ * the caller should use file_read().
+ */
+gboolean
+file_read_mapped(FILE_T file, Buffer *buf, unsigned int len)
+{
+#ifdef HAVE_MMAP
+	file->map_wanted = TRUE;
+	if (len == 0 || file->err || file->compression != UNCOMPRESSED)
+		return FALSE;
+
+	/* process a skip request */
+	if (file->seek_pending) {
+		file->seek_pending = FALSE;
+		if (gz_skip(file, file->skip) == -1)
+			return FALSE;
+	}
+
+	if (file->have == 0 && !file->eof) {
+		if (fill_out_buffer(file) == -1)
+			return FALSE;
+	}
+	if (file->map_chunk == NULL || file->have < len)
+		return FALSE;
+
+	/* Touch the end of it, so that if the file has shrunk since we
+	   checked, the SIGBUS handler catches that now rather than when
+	   whoever gets the Buffer looks at it. */
+	(void)*(volatile unsigned char *)(file->next + len - 1);
+	if (file_map_check(file))
+		return FALSE;
+
+	file->map->refcount++;
+	buffer_assign_ref(buf, file->next, len, file_map_unref, file->map);
+	file->next += len;
+	file->have -= len;
+	file->pos += len;
+	return TRUE;
+#else
+	(void)file;
+	(void)buf;
+	(void)len;
+	return FALSE;
+#endif
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -1221,7 +2742,12 @@ file_peekc(FILE_T file)
 
 	/* try output buffer (no need to check for skip request) */
 	if (file->have) {
-		return *(file->next);
+		ret = *(volatile unsigned char *)file->next;
+#ifdef HAVE_MMAP
+		if (file_map_check(file))
+			return file_peekc(file);
+#endif
+		return ret;
 	}
 
 	/* process a skip request */
@@ -1238,7 +2764,12 @@ file_peekc(FILE_T file)
 	 */
 	while (1) {
 		if (file->have) {
-			return *(file->next);
+			ret = *(volatile unsigned char *)file->next;
+#ifdef HAVE_MMAP
+			if (file_map_check(file))
+				continue;
+#endif
+			return ret;
 		}
 		else if (file->err) {
 			return -1;
@@ -1269,9 +2800,15 @@ file_getc(FILE_T file)
 
 	/* try output buffer (no need to check for skip request) */
 	if (file->have) {
+		ret = *(volatile unsigned char *)file->next;
+#ifdef HAVE_MMAP
+		if (file_map_check(file))
+			return file_getc(file);
+#endif
 		file->have--;
 		file->pos++;
-		return *(file->next)++;
+		file->next++;
+		return ret;
 	}
 
 	ret = file_read(buf, 1, file);
@@ -1334,6 +2871,12 @@ file_gets(char *buf, int len, FILE_T file)
 
 		/* copy through end-of-line, or remainder if not found */
 		memcpy(buf, file->next, n);
+#ifdef HAVE_MMAP
+		if (file_map_check(file)) {
+			eol = NULL;
+			continue;
+		}
+#endif
 		file->have -= n;
 		file->next += n;
 		file->pos += n;
@@ -1392,6 +2935,10 @@ file_fdreopen(FILE_T file, const char *path)
 	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
 		return FALSE;
 	file->fd = fd;
+	if (file->index_path != NULL) {
+		g_free(file->index_path);
+		file->index_path = g_strconcat(path, GZIDX_SUFFIX, NULL);
+	}
 	return TRUE;
 }
 
@@ -1400,6 +2947,20 @@ file_close(FILE_T file)
 {
 	int fd = file->fd;
 
+#ifdef HAVE_LIBZ
+	/*
+	 * If we've read all of a big compressed file sequentially, we've
+	 * got seek points for all of it; if we were asked to, save them
+	 * so that next time the file is opened random access is fast from
+	 * the start.
+	 */
+	if (file->index_save && !file->random && file->fast_seek != NULL && !file->index_loaded &&
+	    file->is_compressed && file->eof && file->avail_in == 0 &&
+	    file->err == 0 && file->pos >= GZIDX_MIN_SIZE && fd != -1)
+		gzidx_save(file);
+	bgzf_free(file);
+#endif
+
 	/* free memory and close file */
 	if (file->size) {
 #ifdef HAVE_LIBZ
@@ -1408,7 +2969,21 @@ file_close(FILE_T file)
 		g_free(file->out);
 		g_free(file->in);
 	}
+#ifdef HAVE_ZSTD
+	if (file->zstd_dctx != NULL)
+		ZSTD_freeDStream(file->zstd_dctx);
+#endif
+#ifdef HAVE_LZ4
+	if (file->lz4_dctx != NULL)
+		(void)LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
+#ifdef HAVE_MMAP
+	/* Buffers may still be referring to it */
+	if (file->map != NULL)
+		file_map_unref(file->map);
+#endif
 	g_free(file->fast_seek_cur);
+	g_free(file->index_path);
 	file->err = 0;
 	file->err_info = NULL;
 	g_free(file);
@@ -1421,34 +2996,68 @@ file_close(FILE_T file)
 		ws_close(fd);
 }
 
+#ifdef CAN_WRITE_COMPRESSED
 #ifdef HAVE_LIBZ
-/* internal gzip file state data structure for writing */
+/*
+ * We write BGZF, so that the files we write can be read back with the
+ * blocks inflated in parallel.  Each block is a complete gzip member,
+ * so this is still an ordinary gzip file as far as anybody else is
+ * concerned.
+ */
+#define BGZF_HEADER_LEN  18     /* gzip header with a "BC" subfield */
+#define BGZF_BLOCK_DATA  0xff00 /* uncompressed data per block; always fits */
+
+static const unsigned char bgzf_header[BGZF_HEADER_LEN] = {
+    31, 139, 8, 4,              /* ID1, ID2, CM = deflate, FLG = FEXTRA */
+    0, 0, 0, 0,                 /* MTIME */
+    0, 255,                     /* XFL, OS = unknown */
+    6, 0,                       /* XLEN */
+    'B', 'C', 2, 0,             /* BGZF subfield ID and length */
+    0, 0                        /* BSIZE - 1, filled in per block */
+};
+#endif
+
+/*
+ * Zstandard and LZ4 files are written as a series of independent frames
+ * of WS_COMPRESS_FRAME_SIZE bytes each, so that they can be read back
+ * with fast seeking; Zstandard files end with a seek table giving the
+ * frame boundaries.
+ */
+
+/* internal compressed file state data structure for writing */
 struct wtap_writer {
     int fd;                 /* file descriptor */
+    wtap_compression_type compression_type; /* how we're compressing */
     gint64 pos;             /* current position in uncompressed data */
     guint size;          /* buffer size, zero if not allocated yet */
-    guint want;          /* requested buffer size, default is GZBUFSIZE */
-    unsigned char *in;      /* input buffer */
-    unsigned char *out;     /* output buffer (double-sized when reading) */
-    unsigned char *next;    /* next output data to deliver or write */
+    guint have;          /* amount of data in the input buffer */
+    unsigned char *in;      /* input buffer, holding one block or frame */
+    unsigned char *out;     /* output buffer, holding one compressed block or frame */
+    int err;                /* error code */
+#ifdef HAVE_LIBZ
     int level;              /* compression level */
     int strategy;           /* compression strategy */
-    int err;                /* error code */
 	/* zlib deflate stream */
     z_stream strm;          /* stream structure in-place (not a pointer) */
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    ws_compressor *comp;    /* Zstandard or LZ4 frame compressor */
+    gsize out_size;         /* output buffer size */
+    GByteArray *seek_table; /* Zstandard seek table, or NULL */
+#endif
 };
 
-GZWFILE_T
-gzwfile_open(const char *path)
+CWFILE_T
+cwfile_open(const char *path, wtap_compression_type compression_type)
 {
     int fd;
-    GZWFILE_T state;
+    CWFILE_T state;
     int save_errno;
 
     fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
     if (fd == -1)
         return NULL;
-    state = gzwfile_fdopen(fd);
+    state = cwfile_fdopen(fd, compression_type);
     if (state == NULL) {
         save_errno = errno;
         close(fd);
@@ -1457,43 +3066,69 @@ gzwfile_open(const char *path)
     return state;
 }
 
-GZWFILE_T
-gzwfile_fdopen(int fd)
+CWFILE_T
+cwfile_fdopen(int fd, wtap_compression_type compression_type)
 {
-    GZWFILE_T state;
+    CWFILE_T state;
 
     /* allocate wtap_writer structure to return */
-    state = (GZWFILE_T)g_try_malloc(sizeof *state);
+    state = (CWFILE_T)g_try_malloc0(sizeof *state);
     if (state == NULL)
         return NULL;
     state->fd = fd;
+    state->compression_type = compression_type;
     state->size = 0;            /* no buffers allocated yet */
-    state->want = GZBUFSIZE;    /* requested buffer size */
+    state->have = 0;            /* no input data yet */
 
+#ifdef HAVE_LIBZ
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
+#endif
 
     /* initialize stream */
-    state->err = Z_OK;              /* clear error */
+    state->err = 0;                 /* clear error */
     state->pos = 0;                 /* no uncompressed data yet */
-    state->strm.avail_in = 0;       /* no input data yet */
 
     /* return stream */
     return state;
 }
 
+/* Write len bytes of compressed data from buf to the output file.  Return
+   -1, and set state->err, on failure; return 0 on success. */
+static int
+cw_write_out(CWFILE_T state, const unsigned char *buf, gsize len)
+{
+    ssize_t got;
+
+    while (len != 0) {
+        got = write(state->fd, buf, (unsigned int)len);
+        if (got < 0) {
+            state->err = errno;
+            return -1;
+        }
+        if (got == 0) {
+            state->err = WTAP_ERR_SHORT_WRITE;
+            return -1;
+        }
+        buf += got;
+        len -= got;
+    }
+    return 0;
+}
+
+#ifdef HAVE_LIBZ
 /* Initialize state for writing a gzip file.  Mark initialization by setting
    state->size to non-zero.  Return -1, and set state->err, on failure;
    return 0 on success. */
 static int
-gz_init(GZWFILE_T state)
+gz_init(CWFILE_T state)
 {
     int ret;
     z_streamp strm = &(state->strm);
 
     /* allocate input and output buffers */
-    state->in = (unsigned char *)g_try_malloc(state->want);
-    state->out = (unsigned char *)g_try_malloc(state->want);
+    state->in = (unsigned char *)g_try_malloc(BGZF_BLOCK_DATA);
+    state->out = (unsigned char *)g_try_malloc(BGZF_MAX_BLOCK);
     if (state->in == NULL || state->out == NULL) {
         g_free(state->out);
         g_free(state->in);
@@ -1501,12 +3136,13 @@ gz_init(GZWFILE_T state)
         return -1;
     }
 
-    /* allocate deflate memory, set up for gzip compression */
+    /* allocate deflate memory, set up for raw deflate; we write the
+       gzip header and trailer of each block ourselves */
     strm->zalloc = Z_NULL;
     strm->zfree = Z_NULL;
     strm->opaque = Z_NULL;
     ret = deflateInit2(strm, state->level, Z_DEFLATED,
-                       15 + 16, 8, state->strategy);
+                       -15, 8, state->strategy);
     if (ret != Z_OK) {
         g_free(state->out);
         g_free(state->in);
@@ -1521,91 +3157,216 @@ gz_init(GZWFILE_T state)
     }
 
     /* mark state as initialized */
-    state->size = state->want;
-
-    /* initialize write buffer */
-    strm->avail_out = state->size;
-    strm->next_out = state->out;
-    state->next = strm->next_out;
+    state->size = BGZF_BLOCK_DATA;
     return 0;
 }
 
-/* Compress whatever is at avail_in and next_in and write to the output file.
-   Return -1, and set state->err, if there is an error writing to the output
-   file; return 0 on success.
-   flush is assumed to be a valid deflate() flush value.  If flush is Z_FINISH,
-   then the deflate() state is reset to start a new gzip stream. */
+/* Compress whatever is in the input buffer as one BGZF block and write it
+   to the output file; with an empty input buffer, this writes the BGZF
+   end-of-file marker.  Return -1, and set state->err, if there is an error
+   writing to the output file; return 0 on success. */
 static int
-gz_comp(GZWFILE_T state, int flush)
+gz_comp(CWFILE_T state)
 {
     int ret;
-    ssize_t got;
-    ptrdiff_t have;
+    guint bsize;
+    guint32 crc;
+    unsigned char *out = state->out;
     z_streamp strm = &(state->strm);
 
-    /* allocate memory if this is the first time through */
-    if (state->size == 0 && gz_init(state) == -1)
+    /* compress the block, leaving room for the header and trailer */
+    strm->next_in = state->in;
+    strm->avail_in = state->have;
+    strm->next_out = out + BGZF_HEADER_LEN;
+    strm->avail_out = BGZF_MAX_BLOCK - BGZF_HEADER_LEN - BGZF_TRAILER;
+    ret = deflate(strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        /* This "shouldn't happen"; BGZF_BLOCK_DATA bytes always fit. */
+        state->err = WTAP_ERR_INTERNAL;
         return -1;
+    }
+    bsize = (guint)(strm->next_out - out) + BGZF_TRAILER;
+    (void)deflateReset(strm);
+
+    memcpy(out, bgzf_header, BGZF_HEADER_LEN);
+    out[16] = (unsigned char)(bsize - 1);
+    out[17] = (unsigned char)((bsize - 1) >> 8);
+    crc = (guint32)crc32(0L, state->in, state->have);
+    out[bsize - 8] = (unsigned char)crc;
+    out[bsize - 7] = (unsigned char)(crc >> 8);
+    out[bsize - 6] = (unsigned char)(crc >> 16);
+    out[bsize - 5] = (unsigned char)(crc >> 24);
+    out[bsize - 4] = (unsigned char)state->have;
+    out[bsize - 3] = (unsigned char)(state->have >> 8);
+    out[bsize - 2] = (unsigned char)(state->have >> 16);
+    out[bsize - 1] = (unsigned char)(state->have >> 24);
+    state->have = 0;
+
+    return cw_write_out(state, out, bsize);
+}
 
-    /* run deflate() on provided input until it produces no more output */
-    ret = Z_OK;
-    do {
-        /* write out current buffer contents if full, or if flushing, but if
-           doing Z_FINISH then don't write until we get to Z_STREAM_END */
-        if (strm->avail_out == 0 || (flush != Z_NO_FLUSH &&
-            (flush != Z_FINISH || ret == Z_STREAM_END))) {
-            have = strm->next_out - state->next;
-            if (have) {
-		got = write(state->fd, state->next, (unsigned int)have);
-		if (got < 0) {
-                    state->err = errno;
-                    return -1;
-                }
-                if ((ptrdiff_t)got != have) {
-                    state->err = WTAP_ERR_SHORT_WRITE;
-                    return -1;
-                }
-            }
-            if (strm->avail_out == 0) {
-                strm->avail_out = state->size;
-                strm->next_out = state->out;
-            }
-            state->next = strm->next_out;
-        }
+/* Write the end-of-file marker, if asked to, and free the compression
+   state.  Return -1, and set state->err, on failure; return 0 on
+   success. */
+static int
+gz_end(CWFILE_T state, gboolean finish)
+{
+    int ret = 0;
 
-        /* compress */
-        have = strm->avail_out;
-        ret = deflate(strm, flush);
-        if (ret == Z_STREAM_ERROR) {
-            /* This "shouldn't happen". */
-            state->err = WTAP_ERR_INTERNAL;
-            return -1;
-        }
-        have -= strm->avail_out;
-    } while (have);
+    if (finish)
+        ret = gz_comp(state);
+    (void)deflateEnd(&(state->strm));
+    g_free(state->out);
+    g_free(state->in);
+    return ret;
+}
+#endif
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Initialize state for writing a Zstandard or LZ4 file.  Mark
+   initialization by setting state->size to non-zero.  Return -1, and
+   set state->err, on failure; return 0 on success. */
+static int
+frame_init(CWFILE_T state)
+{
+    ws_compress_type type;
+
+    type = state->compression_type == WTAP_ZSTD_COMPRESSED ?
+        WS_COMPRESS_ZSTD : WS_COMPRESS_LZ4;
+    if (!ws_compress_available(type)) {
+        /* This "shouldn't happen"; wtap_dump_open_check() rejects it. */
+        state->err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return -1;
+    }
 
-    /* if that completed a deflate stream, allow another to start */
-    if (flush == Z_FINISH)
-        deflateReset(strm);
+    /* allocate the compressor and the input and output buffers */
+    state->comp = ws_compressor_new(type);
+    if (state->comp != NULL) {
+        state->out_size = ws_compressor_bound(state->comp, WS_COMPRESS_FRAME_SIZE);
+        state->in = (unsigned char *)g_try_malloc(WS_COMPRESS_FRAME_SIZE);
+        state->out = (unsigned char *)g_try_malloc(state->out_size);
+    }
+    if (state->comp == NULL || state->in == NULL || state->out == NULL) {
+        g_free(state->out);
+        g_free(state->in);
+        ws_compressor_free(state->comp);
+        state->err = ENOMEM;
+        return -1;
+    }
+    if (type == WS_COMPRESS_ZSTD)
+        state->seek_table = g_byte_array_new();
 
-    /* all done, no errors */
+    /* mark state as initialized */
+    state->size = WS_COMPRESS_FRAME_SIZE;
     return 0;
 }
 
+/* Compress whatever is in the input buffer as one frame and write it to
+   the output file.  Return -1, and set state->err, on failure; return 0
+   on success. */
+static int
+frame_comp(CWFILE_T state)
+{
+    gsize len;
+
+    len = ws_compressor_frame(state->comp, state->out, state->out_size,
+        state->in, state->have);
+    if (len == 0) {
+        /* This "shouldn't happen"; the output buffer is big enough. */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    if (state->seek_table != NULL)
+        ws_compress_seek_table_add(state->seek_table, (guint32)len, state->have);
+    state->have = 0;
+
+    return cw_write_out(state, state->out, len);
+}
+
+/* Write the seek table, if there is one and we're asked to, and free the
+   compression state.  Return -1, and set state->err, on failure; return 0
+   on success. */
+static int
+frame_end(CWFILE_T state, gboolean finish)
+{
+    int ret = 0;
+
+    if (state->seek_table != NULL) {
+        if (finish) {
+            ws_compress_seek_table_finish(state->seek_table);
+            ret = cw_write_out(state, state->seek_table->data,
+                state->seek_table->len);
+        }
+        g_byte_array_free(state->seek_table, TRUE);
+    }
+    ws_compressor_free(state->comp);
+    g_free(state->out);
+    g_free(state->in);
+    return ret;
+}
+#endif
+
+static int
+cw_init(CWFILE_T state)
+{
+    switch (state->compression_type) {
+#ifdef HAVE_LIBZ
+    case WTAP_GZIP_COMPRESSED:
+        return gz_init(state);
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    case WTAP_ZSTD_COMPRESSED:
+    case WTAP_LZ4_COMPRESSED:
+        return frame_init(state);
+#endif
+    default:
+        /* This "shouldn't happen"; wtap_dump_open_check() rejects it. */
+        state->err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+        return -1;
+    }
+}
+
+static int
+cw_comp(CWFILE_T state)
+{
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    if (state->compression_type != WTAP_GZIP_COMPRESSED)
+        return frame_comp(state);
+#endif
+#ifdef HAVE_LIBZ
+    return gz_comp(state);
+#else
+    /* cw_init() only succeeds for types we support */
+    return -1;
+#endif
+}
+
+static int
+cw_end(CWFILE_T state, gboolean finish)
+{
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+    if (state->compression_type != WTAP_GZIP_COMPRESSED)
+        return frame_end(state, finish);
+#endif
+#ifdef HAVE_LIBZ
+    return gz_end(state, finish);
+#else
+    /* cw_init() only succeeds for types we support */
+    return -1;
+#endif
+}
+
 /* Write out len bytes from buf.  Return 0, and set state->err, on
    failure or on an attempt to write 0 bytes (in which case state->err
-   is Z_OK); return the number of bytes written on success. */
+   is 0); return the number of bytes written on success. */
 unsigned
-gzwfile_write(GZWFILE_T state, const void *buf, guint len)
+cwfile_write(CWFILE_T state, const void *buf, guint len)
 {
     guint put = len;
     guint n;
-    z_streamp strm;
-
-    strm = &(state->strm);
 
     /* check that there's no error */
-    if (state->err != Z_OK)
+    if (state->err != 0)
         return 0;
 
     /* if len is zero, avoid unnecessary operations */
@@ -1613,56 +3374,38 @@ gzwfile_write(GZWFILE_T state, const void *buf, guint len)
         return 0;
 
     /* allocate memory if this is the first time through */
-    if (state->size == 0 && gz_init(state) == -1)
+    if (state->size == 0 && cw_init(state) == -1)
         return 0;
 
-    /* for small len, copy to input buffer, otherwise compress directly */
-    if (len < state->size) {
-        /* copy to input buffer, compress when full */
-        do {
-            if (strm->avail_in == 0)
-                strm->next_in = state->in;
-            n = state->size - strm->avail_in;
-            if (n > len)
-                n = len;
-            memcpy(strm->next_in + strm->avail_in, buf, n);
-            strm->avail_in += n;
-            state->pos += n;
-            buf = (const char *)buf + n;
-            len -= n;
-            if (len && gz_comp(state, Z_NO_FLUSH) == -1)
-                return 0;
-        } while (len);
-    }
-    else {
-        /* consume whatever's left in the input buffer */
-        if (strm->avail_in && gz_comp(state, Z_NO_FLUSH) == -1)
-            return 0;
-
-        /* directly compress user buffer to file */
-        strm->avail_in = len;
-        strm->next_in = (Bytef *)buf;
-        state->pos += len;
-        if (gz_comp(state, Z_NO_FLUSH) == -1)
+    /* copy to input buffer, compress a block whenever it's full */
+    do {
+        n = state->size - state->have;
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->have, buf, n);
+        state->have += n;
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->have == state->size && cw_comp(state) == -1)
             return 0;
-    }
+    } while (len);
 
     /* input was all buffered or compressed (put will fit in int) */
     return (int)put;
 }
 
-/* Flush out what we've written so far.  Returns -1, and sets state->err,
-   on failure; returns 0 on success. */
+/* Flush out what we've written so far, ending the current block or frame.
+   Returns -1, and sets state->err, on failure; returns 0 on success. */
 int
-gzwfile_flush(GZWFILE_T state)
+cwfile_flush(CWFILE_T state)
 {
     /* check that there's no error */
-    if (state->err != Z_OK)
+    if (state->err != 0)
         return -1;
 
-    /* compress remaining data with Z_SYNC_FLUSH */
-    gz_comp(state, Z_SYNC_FLUSH);
-    if (state->err != Z_OK)
+    /* compress remaining data into a block of its own */
+    if (state->have != 0 && cw_comp(state) == -1)
         return -1;
     return 0;
 }
@@ -1670,17 +3413,21 @@ gzwfile_flush(GZWFILE_T state)
 /* Flush out all data written, and close the file.  Returns a Wiretap
    error on failure; returns 0 on success. */
 int
-gzwfile_close(GZWFILE_T state)
+cwfile_close(CWFILE_T state)
 {
     int ret = 0;
 
-    /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
+    /* flush, write the end-of-file marker or seek table, free memory,
+       and close file */
+    if (state->size == 0 && cw_init(state) == -1) {
         ret = state->err;
-    (void)deflateEnd(&(state->strm));
-    g_free(state->out);
-    g_free(state->in);
-    state->err = Z_OK;
+    } else {
+        if (state->have != 0 && cw_comp(state) == -1)
+            ret = state->err;
+        if (cw_end(state, ret == 0) == -1 && ret == 0)
+            ret = state->err;
+    }
+    state->err = 0;
     if (close(state->fd) == -1 && ret == 0)
         ret = errno;
     g_free(state);
@@ -1688,8 +3435,8 @@ gzwfile_close(GZWFILE_T state)
 }
 
 int
-gzwfile_geterr(GZWFILE_T state)
+cwfile_geterr(CWFILE_T state)
 {
     return state->err;
 }
-#endif
+#endif /* CAN_WRITE_COMPRESSED */
@@ -29,6 +29,8 @@
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_set_index_save(FILE_T stream, gboolean save);
+extern void file_set_growing(FILE_T stream);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 extern gboolean file_skip(FILE_T file, gint64 delta, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
@@ -36,6 +38,7 @@ extern gint64 file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC gboolean file_iscompressed(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
+extern gboolean file_read_mapped(FILE_T file, Buffer *buf, unsigned int count);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
 WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
@@ -46,15 +49,17 @@ extern void file_fdclose(FILE_T file);
 extern int file_fdreopen(FILE_T file, const char *path);
 extern void file_close(FILE_T file);
 
-#ifdef HAVE_LIBZ
-typedef struct wtap_writer *GZWFILE_T;
+#if defined(HAVE_LIBZ) || defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+#define CAN_WRITE_COMPRESSED
 
-extern GZWFILE_T gzwfile_open(const char *path);
-extern GZWFILE_T gzwfile_fdopen(int fd);
-extern guint gzwfile_write(GZWFILE_T state, const void *buf, guint len);
-extern int gzwfile_flush(GZWFILE_T state);
-extern int gzwfile_close(GZWFILE_T state);
-extern int gzwfile_geterr(GZWFILE_T state);
-#endif /* HAVE_LIBZ */
+typedef struct wtap_writer *CWFILE_T;
+
+extern CWFILE_T cwfile_open(const char *path, wtap_compression_type compression_type);
+extern CWFILE_T cwfile_fdopen(int fd, wtap_compression_type compression_type);
+extern guint cwfile_write(CWFILE_T state, const void *buf, guint len);
+extern int cwfile_flush(CWFILE_T state);
+extern int cwfile_close(CWFILE_T state);
+extern int cwfile_geterr(CWFILE_T state);
+#endif /* HAVE_LIBZ || HAVE_ZSTD || HAVE_LZ4 */
 
 #endif /* __FILE_H__ */
@@ -0,0 +1,522 @@
+/* file_wrappers_test.c
+ * Tests for reading capture files through the file wrappers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+
+#include "wtap.h"
+#include <wsutil/buffer.h>
+#include <wsutil/file_util.h>
+
+/*
+ * The test file is a libpcap file with enough packets that most of it
+ * is read through the mapping, when files are mapped, rather than
+ * through the reader's own buffer.
+ */
+#define NUM_PACKETS	512
+#define PACKET_LEN	1000
+#define PCAP_HDR_LEN	24
+#define PCAP_REC_LEN	16
+
+#define packet_offset(n)	(PCAP_HDR_LEN + (gint64)(n) * (PCAP_REC_LEN + PACKET_LEN))
+
+static void
+append_le32(GByteArray *bytes, guint32 val)
+{
+	guint8 le[4];
+
+	le[0] = (guint8)val;
+	le[1] = (guint8)(val >> 8);
+	le[2] = (guint8)(val >> 16);
+	le[3] = (guint8)(val >> 24);
+	g_byte_array_append(bytes, le, 4);
+}
+
+/* Files written with different seeds have different data throughout */
+static guint8
+packet_byte(guint seed, guint n, guint i)
+{
+	return (guint8)(seed * 13 + n * 7 + i);
+}
+
+static gboolean
+packet_data_ok(guint seed, guint n, const guint8 *data, guint len)
+{
+	guint i;
+
+	if (len != PACKET_LEN)
+		return FALSE;
+	for (i = 0; i < len; i++) {
+		if (data[i] != packet_byte(seed, n, i))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Write the test file, and return its name, to be freed with g_free() */
+static gchar *
+write_test_file(void)
+{
+	GByteArray *bytes = g_byte_array_new();
+	guint8 data[PACKET_LEN];
+	gchar *path;
+	guint n, i;
+	int fd;
+
+	append_le32(bytes, 0xa1b2c3d4);		/* magic */
+	append_le32(bytes, 2 | (4 << 16));	/* version 2.4 */
+	append_le32(bytes, 0);			/* thiszone */
+	append_le32(bytes, 0);			/* sigfigs */
+	append_le32(bytes, 65535);		/* snaplen */
+	append_le32(bytes, 1);			/* LINKTYPE_ETHERNET */
+
+	for (n = 0; n < NUM_PACKETS; n++) {
+		append_le32(bytes, 1000000000 + n);	/* ts_sec */
+		append_le32(bytes, n);			/* ts_usec */
+		append_le32(bytes, PACKET_LEN);		/* incl_len */
+		append_le32(bytes, PACKET_LEN);		/* orig_len */
+		for (i = 0; i < PACKET_LEN; i++)
+			data[i] = packet_byte(0, n, i);
+		g_byte_array_append(bytes, data, PACKET_LEN);
+	}
+
+	fd = g_file_open_tmp("wtap_testXXXXXX", &path, NULL);
+	g_assert(fd != -1);
+	ws_close(fd);
+	g_assert(g_file_set_contents(path, (const gchar *)bytes->data,
+	    bytes->len, NULL));
+	g_byte_array_free(bytes, TRUE);
+
+	return path;
+}
+
+#ifdef HAVE_LIBZ
+/*
+ * Enough packets for the file to be indexed when it's read through, and
+ * for there to be several seek points in it.
+ */
+#define GZIP_PACKETS	9000
+
+/* Write a gzipped test file, with our own writer */
+static void
+write_gzip_test_file(const gchar *path, guint seed, guint num_packets)
+{
+	struct wtap_pkthdr phdr;
+	wtap_dumper *wdh;
+	guint8 data[PACKET_LEN];
+	guint n, i;
+	int err;
+
+	wdh = wtap_dump_open(path, WTAP_FILE_TYPE_SUBTYPE_PCAP, WTAP_ENCAP_ETHERNET,
+	    65535, WTAP_GZIP_COMPRESSED, &err);
+	g_assert(wdh != NULL);
+
+	memset(&phdr, 0, sizeof phdr);
+	phdr.rec_type = REC_TYPE_PACKET;
+	phdr.presence_flags = WTAP_HAS_TS;
+	phdr.pkt_encap = WTAP_ENCAP_ETHERNET;
+	phdr.caplen = PACKET_LEN;
+	phdr.len = PACKET_LEN;
+	for (n = 0; n < num_packets; n++) {
+		phdr.ts.secs = 1000000000 + n;
+		phdr.ts.nsecs = 0;
+		for (i = 0; i < PACKET_LEN; i++)
+			data[i] = packet_byte(seed, n, i);
+		g_assert(wtap_dump(wdh, &phdr, data, &err));
+	}
+	g_assert(wtap_dump_close(wdh, &err));
+}
+
+static gchar *
+new_gzip_test_file(guint seed, guint num_packets)
+{
+	gchar *path;
+	int fd;
+
+	fd = g_file_open_tmp("wtap_testXXXXXX", &path, NULL);
+	g_assert(fd != -1);
+	ws_close(fd);
+	write_gzip_test_file(path, seed, num_packets);
+	return path;
+}
+#endif
+
+static wtap *
+open_test_file(const gchar *path)
+{
+	wtap *wth;
+	int err;
+	gchar *err_info;
+
+	wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+	g_assert(wth != NULL);
+	g_assert_cmpint(wtap_file_type_subtype(wth), ==, WTAP_FILE_TYPE_SUBTYPE_PCAP);
+	return wth;
+}
+
+/*
+ * Packet data read from a mapped file may be handed out by making the
+ * caller's Buffer refer to the mapping; such a Buffer has to stay
+ * usable after the file is closed, even once the file is gone.
+ */
+static void
+file_wrappers_test_close_with_ref(void)
+{
+	gchar *path = write_test_file();
+	struct wtap_pkthdr phdr;
+	wtap *wth = open_test_file(path);
+	Buffer buf, other_buf;
+	int err;
+	gchar *err_info;
+	guint n;
+
+	memset(&phdr, 0, sizeof phdr);
+	buffer_init(&buf, 1500);
+	buffer_init(&other_buf, 1500);
+
+	/* Going backwards, each read is a seek outside what's been read */
+	n = NUM_PACKETS;
+	do {
+		n--;
+		g_assert(wtap_seek_read(wth, packet_offset(n), &phdr, &buf,
+		    &err, &err_info));
+		g_assert(packet_data_ok(0, n, buffer_start_ptr(&buf), buffer_length(&buf)));
+	} while (!buf.is_ref && n > 0);
+#ifdef HAVE_MMAP
+	g_assert(buf.is_ref);
+#endif
+	g_assert(wtap_seek_read(wth, packet_offset(0), &phdr, &other_buf,
+	    &err, &err_info));
+
+	wtap_close(wth);
+	g_assert_cmpint(ws_unlink(path), ==, 0);
+
+	/* Still there after closing */
+	g_assert(packet_data_ok(0, n, buffer_start_ptr(&buf), buffer_length(&buf)));
+	g_assert(packet_data_ok(0, 0, buffer_start_ptr(&other_buf), buffer_length(&other_buf)));
+
+	/* Adding to the buffer copies the data out first */
+	buffer_assure_space(&buf, 100);
+	g_assert(!buf.is_ref);
+	g_assert(packet_data_ok(0, n, buffer_start_ptr(&buf), buffer_length(&buf)));
+
+	buffer_free(&other_buf);
+	buffer_free(&buf);
+	g_free(path);
+}
+
+#ifdef HAVE_MMAP
+/*
+ * A file that shrinks while it's being read, mapped, has to give a
+ * short read rather than SIGBUS.  The file's size is only checked when
+ * a chunk of the mapping is handed out, so this has the file cut off
+ * at a page boundary, past which the mapping faults; what's between
+ * the end of the file and the end of its last page reads as zeroes.
+ */
+static void
+file_wrappers_test_truncated(void)
+{
+	gchar *path = write_test_file();
+	struct wtap_pkthdr phdr;
+	wtap *wth = open_test_file(path);
+	Buffer buf, early_buf;
+	gint64 page = (gint64)sysconf(_SC_PAGESIZE);
+	gint64 cut;
+	gint64 data_offset;
+	int err;
+	gchar *err_info;
+	guint n, last;
+
+	memset(&phdr, 0, sizeof phdr);
+	buffer_init(&buf, 1500);
+	buffer_init(&early_buf, 1500);
+
+	/* Get both streams well into the mapping */
+	for (n = 0; n < NUM_PACKETS / 2; n++) {
+		g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+		g_assert(packet_data_ok(0, n, wtap_buf_ptr(wth), wtap_phdr(wth)->caplen));
+	}
+	g_assert(wtap_seek_read(wth, packet_offset(NUM_PACKETS - 1), &phdr, &buf,
+	    &err, &err_info));
+	g_assert(wtap_seek_read(wth, packet_offset(NUM_PACKETS / 2 + 1), &phdr, &buf,
+	    &err, &err_info));
+	g_assert(packet_data_ok(0, NUM_PACKETS / 2 + 1, buffer_start_ptr(&buf), buffer_length(&buf)));
+
+	/* A Buffer referring to the mapping, past where the file's cut */
+	g_assert(wtap_seek_read(wth, packet_offset(NUM_PACKETS - 2), &phdr, &early_buf,
+	    &err, &err_info));
+
+	/* Cut the file off at a page boundary a few packets on; last is
+	   the first packet that isn't all there */
+	cut = (packet_offset(NUM_PACKETS / 2 + 4) + page - 1) / page * page;
+	g_assert_cmpint(cut, <, packet_offset(NUM_PACKETS - 2));
+	for (last = NUM_PACKETS / 2 + 4; packet_offset(last + 1) <= cut; last++)
+		;
+	g_assert_cmpint(truncate(path, (off_t)cut), ==, 0);
+
+	/* What's still there reads as before */
+	for (; n < last; n++) {
+		g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+		g_assert(packet_data_ok(0, n, wtap_buf_ptr(wth), wtap_phdr(wth)->caplen));
+	}
+	g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+	if (packet_offset(last) < cut)
+		g_assert_cmpint(err, ==, WTAP_ERR_SHORT_READ);
+	else
+		g_assert_cmpint(err, ==, 0);
+
+	g_assert(wtap_seek_read(wth, packet_offset(last - 1), &phdr, &buf,
+	    &err, &err_info));
+	g_assert(packet_data_ok(0, last - 1, buffer_start_ptr(&buf), buffer_length(&buf)));
+	g_assert(!wtap_seek_read(wth, packet_offset(last), &phdr, &buf,
+	    &err, &err_info));
+	g_assert(!wtap_seek_read(wth, packet_offset(NUM_PACKETS - 1), &phdr, &buf,
+	    &err, &err_info));
+
+	/* The Buffer handed out before the cut reads as zeroes */
+	g_assert_cmpuint(buffer_length(&early_buf), ==, PACKET_LEN);
+	g_assert_cmpuint(buffer_start_ptr(&early_buf)[0], ==, 0);
+	g_assert_cmpuint(buffer_start_ptr(&early_buf)[PACKET_LEN - 1], ==, 0);
+
+	wtap_close(wth);
+	buffer_free(&early_buf);
+	buffer_free(&buf);
+	ws_unlink(path);
+	g_free(path);
+}
+#endif
+
+#ifdef HAVE_LIBZ
+/* Read all of a file sequentially, checking every packet */
+static void
+read_all(wtap *wth, guint seed, guint num_packets)
+{
+	gint64 data_offset;
+	int err;
+	gchar *err_info;
+	guint n;
+
+	for (n = 0; n < num_packets; n++) {
+		g_assert(wtap_read(wth, &err, &err_info, &data_offset));
+		g_assert_cmpint(data_offset, ==, packet_offset(n));
+		g_assert(packet_data_ok(seed, n, wtap_buf_ptr(wth), wtap_phdr(wth)->caplen));
+	}
+	g_assert(!wtap_read(wth, &err, &err_info, &data_offset));
+	g_assert_cmpint(err, ==, 0);
+}
+
+/* Read packets all over the file with the random access stream */
+static void
+seek_read_some(wtap *wth, guint seed, guint num_packets)
+{
+	struct wtap_pkthdr phdr;
+	Buffer buf;
+	int err;
+	gchar *err_info;
+	guint n;
+
+	memset(&phdr, 0, sizeof phdr);
+	buffer_init(&buf, 1500);
+	for (n = num_packets - 1; n > 97; n -= 97) {
+		g_assert(wtap_seek_read(wth, packet_offset(n), &phdr, &buf,
+		    &err, &err_info));
+		g_assert(packet_data_ok(seed, n, buffer_start_ptr(&buf), buffer_length(&buf)));
+		/* and one forward from there */
+		g_assert(wtap_seek_read(wth, packet_offset(n + 13 < num_packets ? n + 13 : 0),
+		    &phdr, &buf, &err, &err_info));
+		g_assert(packet_data_ok(seed, n + 13 < num_packets ? n + 13 : 0,
+		    buffer_start_ptr(&buf), buffer_length(&buf)));
+	}
+	buffer_free(&buf);
+}
+
+/* Open a file, optionally saving its seek index, and read all of it */
+static void
+read_test_file(const gchar *path, guint seed, guint num_packets, gboolean save_index)
+{
+	wtap *wth = open_test_file(path);
+
+	wtap_set_save_seek_index(wth, save_index);
+	read_all(wth, seed, num_packets);
+	seek_read_some(wth, seed, num_packets);
+	wtap_close(wth);
+}
+
+/* Open a file and seek around in it before reading it sequentially */
+static void
+seek_test_file(const gchar *path, guint seed, guint num_packets)
+{
+	wtap *wth = open_test_file(path);
+
+	seek_read_some(wth, seed, num_packets);
+	read_all(wth, seed, num_packets);
+	wtap_close(wth);
+}
+
+static void
+put_le64(gchar *p, guint64 val)
+{
+	guint i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = (gchar)(val >> (8 * i));
+}
+
+/*
+ * We write BGZF, which is read a member at a time and gets a seek point
+ * at member boundaries; it has to read back the same both ways.
+ */
+static void
+file_wrappers_test_bgzf(void)
+{
+	gchar *path = new_gzip_test_file(0, GZIP_PACKETS);
+	gchar *contents;
+	gsize length;
+
+	/* FEXTRA, with a "BC" subfield first */
+	g_assert(g_file_get_contents(path, &contents, &length, NULL));
+	g_assert_cmpuint(length, >, 18);
+	g_assert_cmpint((guint8)contents[0], ==, 31);
+	g_assert_cmpint((guint8)contents[1], ==, 139);
+	g_assert((contents[3] & 4) != 0);
+	g_assert(contents[12] == 'B' && contents[13] == 'C');
+	g_free(contents);
+
+	read_test_file(path, 0, GZIP_PACKETS, FALSE);
+	seek_test_file(path, 0, GZIP_PACKETS);
+
+	ws_unlink(path);
+	g_free(path);
+}
+
+/* The index is only written when asked for, and is then used */
+static void
+file_wrappers_test_gzidx(void)
+{
+	gchar *path = new_gzip_test_file(0, GZIP_PACKETS);
+	gchar *index_path = g_strconcat(path, ".gzidx", NULL);
+	gchar *contents;
+	gsize length;
+
+	read_test_file(path, 0, GZIP_PACKETS, FALSE);
+	g_assert(!g_file_test(index_path, G_FILE_TEST_EXISTS));
+
+	read_test_file(path, 0, GZIP_PACKETS, TRUE);
+	g_assert(g_file_get_contents(index_path, &contents, &length, NULL));
+	g_assert_cmpuint(length, >, 32);
+	g_assert(memcmp(contents, "WSGZIDX", 7) == 0);
+	g_free(contents);
+
+	seek_test_file(path, 0, GZIP_PACKETS);
+
+	ws_unlink(index_path);
+	ws_unlink(path);
+	g_free(index_path);
+	g_free(path);
+}
+
+/*
+ * An index that doesn't belong to the file has to be ignored: one left
+ * over from an earlier version of the file, one for another file that's
+ * been given the file's size and time stamp, and a damaged one.
+ */
+static void
+file_wrappers_test_gzidx_mismatch(void)
+{
+	gchar *path = new_gzip_test_file(0, GZIP_PACKETS);
+	gchar *index_path = g_strconcat(path, ".gzidx", NULL);
+	gchar *old_index, *new_index;
+	gsize old_length, new_length;
+	ws_statb64 statb;
+
+	read_test_file(path, 0, GZIP_PACKETS, TRUE);
+	g_assert(g_file_get_contents(index_path, &old_index, &old_length, NULL));
+
+	/* Stale: the file's been rewritten, with less in it */
+	write_gzip_test_file(path, 1, GZIP_PACKETS - 500);
+	seek_test_file(path, 1, GZIP_PACKETS - 500);
+
+	/* Reading it through replaces the index */
+	read_test_file(path, 1, GZIP_PACKETS - 500, TRUE);
+	g_assert(g_file_get_contents(index_path, &new_index, &new_length, NULL));
+	g_assert(new_length != old_length || memcmp(new_index, old_index, old_length) != 0);
+	g_free(new_index);
+
+	/* Mismatched: the old index, claiming the new file's size and time */
+	g_assert_cmpint(ws_stat64(path, &statb), ==, 0);
+	put_le64(old_index + 8, (guint64)statb.st_size);
+	put_le64(old_index + 16, (guint64)statb.st_mtime);
+	g_assert(g_file_set_contents(index_path, old_index, old_length, NULL));
+	seek_test_file(path, 1, GZIP_PACKETS - 500);
+
+	/* Damaged: the right index, cut short */
+	read_test_file(path, 1, GZIP_PACKETS - 500, TRUE);
+	g_assert(g_file_get_contents(index_path, &new_index, &new_length, NULL));
+	g_assert(g_file_set_contents(index_path, new_index, new_length - 10, NULL));
+	seek_test_file(path, 1, GZIP_PACKETS - 500);
+	g_free(new_index);
+
+	g_free(old_index);
+	ws_unlink(index_path);
+	ws_unlink(path);
+	g_free(index_path);
+	g_free(path);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/file_wrappers/mmap/close_with_ref", file_wrappers_test_close_with_ref);
+#ifdef HAVE_MMAP
+	g_test_add_func("/file_wrappers/mmap/truncated", file_wrappers_test_truncated);
+#endif
+#ifdef HAVE_LIBZ
+	g_test_add_func("/file_wrappers/gzip/bgzf", file_wrappers_test_bgzf);
+	g_test_add_func("/file_wrappers/gzip/index", file_wrappers_test_gzidx);
+	g_test_add_func("/file_wrappers/gzip/index_mismatch", file_wrappers_test_gzidx_mismatch);
+#endif
+
+	return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
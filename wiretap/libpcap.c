@@ -688,12 +688,21 @@ libpcap_read_packet(wtap *wth, FILE_T fh, struct wtap_pkthdr *phdr,
 	phdr->len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data, leaving it in place if the file is
+	 * mapped and we won't be modifying it.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return FALSE;	/* failed */
-
 	libpcap = (libpcap_t *)wth->priv;
+	if (pcap_read_post_process_modifies_data(wth->file_encap,
+	    libpcap->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err,
+		    err_info))
+			return FALSE;	/* failed */
+	} else {
+		if (!wtap_ref_packet_bytes(fh, buf, packet_size, err,
+		    err_info))
+			return FALSE;	/* failed */
+	}
+
 	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
 	    phdr, buffer_start_ptr(buf), libpcap->byte_swapped, -1);
 	return TRUE;
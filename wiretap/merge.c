@@ -42,6 +42,29 @@
 #include <string.h>
 #include "merge.h"
 
+/*
+ * Min-heap of the files that have a packet available, ordered by the
+ * time stamp of that packet, so that picking the next packet to write
+ * is O(log N) rather than a scan of all N input files.
+ *
+ * It lives in the same allocation as the merge_in_file_t array, right
+ * after the last entry, so that callers can keep freeing the array
+ * returned by merge_open_in_files() with g_free().
+ */
+typedef struct merge_heap_s {
+  int count;       /* files in the heap, or -1 if not built yet */
+  int files[1];    /* indices into the in_files array */
+} merge_heap_t;
+
+#define MERGE_HEAP_SIZE(n) \
+  (sizeof(merge_heap_t) + ((n) > 1 ? (n) - 1 : 0) * sizeof(int))
+
+static merge_heap_t *
+merge_heap(int in_file_count, merge_in_file_t in_files[])
+{
+  return (merge_heap_t *)&in_files[in_file_count];
+}
+
 /*
  * Scan through the arguments and open the input files
  */
@@ -55,8 +78,9 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
   merge_in_file_t *files;
   gint64 size;
 
-  files = (merge_in_file_t *)g_malloc(files_size);
+  files = (merge_in_file_t *)g_malloc(files_size + MERGE_HEAP_SIZE(in_file_count));
   *in_files = files;
+  merge_heap(in_file_count, files)->count = -1;
 
   for (i = 0; i < in_file_count; i++) {
     files[i].filename    = in_file_names[i];
@@ -145,22 +169,42 @@ merge_max_snapshot_length(int count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * returns TRUE if the packet available from the first file should be
+ * written before the packet available from the second file
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+is_earlier(merge_in_file_t in_files[], int l, int r)
 {
-  if (l->secs > r->secs) {  /* left is later */
-    return FALSE;
-  } else if (l->secs < r->secs) { /* left is earlier */
-    return TRUE;
-  } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-    return FALSE;
-  }
-  /* either one < two or one == two
-   * either way, return one
+  nstime_t *lt = &wtap_phdr(in_files[l].wth)->ts;
+  nstime_t *rt = &wtap_phdr(in_files[r].wth)->ts;
+
+  if (lt->secs != rt->secs)
+    return lt->secs < rt->secs;
+  if (lt->nsecs != rt->nsecs)
+    return lt->nsecs < rt->nsecs;
+  /*
+   * Equal time stamps; the packet from the file later in the list
+   * goes first, as it always has.
    */
-  return TRUE;
+  return l > r;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *heap, merge_in_file_t in_files[], int pos)
+{
+  int file = heap->files[pos];
+  int child;
+
+  while ((child = 2 * pos + 1) < heap->count) {
+    if (child + 1 < heap->count &&
+        is_earlier(in_files, heap->files[child + 1], heap->files[child]))
+      child++;
+    if (!is_earlier(in_files, heap->files[child], file))
+      break;
+    heap->files[pos] = heap->files[child];
+    pos = child;
+  }
+  heap->files[pos] = file;
 }
 
 /*
@@ -180,47 +224,65 @@ merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
                   int *err, gchar **err_info)
 {
+  merge_heap_t *heap = merge_heap(in_file_count, in_files);
   int i;
-  int ei = -1;
-  nstime_t tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-  struct wtap_pkthdr *phdr;
+  int ei;
 
-  /*
-   * Make sure we have a packet available from each file, if there are any
-   * packets left in the file in question, and search for the packet
-   * with the earliest time stamp.
-   */
-  for (i = 0; i < in_file_count; i++) {
-    if (in_files[i].state == PACKET_NOT_PRESENT) {
-      /*
-       * No packet available, and we haven't seen an error or EOF yet,
-       * so try to read the next packet.
-       */
-      if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-        if (*err != 0) {
-          in_files[i].state = GOT_ERROR;
-          return &in_files[i];
-        }
-        in_files[i].state = AT_EOF;
-      } else
-        in_files[i].state = PACKET_PRESENT;
+  if (heap->count == -1) {
+    /*
+     * First call; make sure we have a packet available from each file,
+     * if there are any packets in the file in question, and build the
+     * heap from the files that have one.
+     */
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].state == PACKET_NOT_PRESENT) {
+        if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
+          if (*err != 0) {
+            in_files[i].state = GOT_ERROR;
+            return &in_files[i];
+          }
+          in_files[i].state = AT_EOF;
+        } else
+          in_files[i].state = PACKET_PRESENT;
+      }
     }
 
-    if (in_files[i].state == PACKET_PRESENT) {
-      phdr = wtap_phdr(in_files[i].wth);
-      if (is_earlier(&phdr->ts, &tv)) {
-        tv = phdr->ts;
-        ei = i;
-      }
+    heap->count = 0;
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].state == PACKET_PRESENT)
+        heap->files[heap->count++] = i;
     }
+    for (i = heap->count / 2 - 1; i >= 0; i--)
+      merge_heap_sift_down(heap, in_files, i);
+  } else if (heap->count > 0 &&
+             in_files[heap->files[0]].state == PACKET_NOT_PRESENT) {
+    /*
+     * We handed out the packet from the file at the top of the heap
+     * last time; read the next packet from that file, and put the file
+     * back where it now belongs, or drop it from the heap at EOF.
+     */
+    ei = heap->files[0];
+    if (!wtap_read(in_files[ei].wth, err, err_info, &in_files[ei].data_offset)) {
+      if (*err != 0) {
+        in_files[ei].state = GOT_ERROR;
+        return &in_files[ei];
+      }
+      in_files[ei].state = AT_EOF;
+      heap->files[0] = heap->files[--heap->count];
+    } else
+      in_files[ei].state = PACKET_PRESENT;
+    if (heap->count > 0)
+      merge_heap_sift_down(heap, in_files, 0);
   }
 
-  if (ei == -1) {
+  if (heap->count == 0) {
     /* All the streams are at EOF.  Return an EOF indication. */
     *err = 0;
     return NULL;
   }
 
+  ei = heap->files[0];
+
   /* We'll need to read another packet from this file. */
   in_files[ei].state = PACKET_NOT_PRESENT;
 
@@ -54,7 +54,9 @@ typedef struct merge_in_file_s {
  *
  * @param in_file_count number of entries in in_file_names and in_files
  * @param in_file_names filenames of the input files
- * @param in_files input file array to be filled (>= sizeof(merge_in_file_t) * in_file_count)
+ * @param in_files set to the input file array, to be freed with g_free();
+ *        merge_read_packet() keeps its state at the end of it, so it must
+ *        not be copied
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @param err_fileno file on which open failed, if failed
@@ -92,7 +94,8 @@ WS_DLL_PUBLIC int
 merge_max_snapshot_length(int in_file_count, merge_in_file_t in_files[]);
 
 /** Read the next packet, in chronological order, from the set of files to
- * be merged.
+ * be merged.  Packets with the same time stamp are returned in reverse
+ * order of their files in in_files.
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
@@ -1904,6 +1904,26 @@ pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
 	return phdr_len;
 }
 
+/*
+ * Does pcap_read_post_process() rewrite the packet data in place?  If
+ * so, the packet data can't be left in the file's memory mapping, as
+ * reading the same packet again would rewrite it again.
+ */
+gboolean
+pcap_read_post_process_modifies_data(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 void
 pcap_read_post_process(int file_type, int wtap_encap,
     struct wtap_pkthdr *phdr, guint8 *pd, gboolean bytes_swapped, int fcs_len)
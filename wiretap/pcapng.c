@@ -1193,9 +1193,17 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 
         /* "(Enhanced) Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-	if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-	    packet.cap_len - pseudo_header_len, err, err_info))
-		return 0;
+	if (pcap_read_post_process_modifies_data(iface_info.wtap_encap,
+	    pn->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+		    packet.cap_len - pseudo_header_len, err, err_info))
+			return 0;
+	} else {
+		/* leave it in place if the file is mapped */
+		if (!wtap_ref_packet_bytes(fh, wblock->frame_buffer,
+		    packet.cap_len - pseudo_header_len, err, err_info))
+			return 0;
+	}
         block_read += packet.cap_len - pseudo_header_len;
 
         /* jump over potential padding bytes at end of the packet data */
@@ -1472,9 +1480,17 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
 
         /* "Simple Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-	if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-	    simple_packet.cap_len, err, err_info))
-		return 0;
+	if (pcap_read_post_process_modifies_data(iface_info.wtap_encap,
+	    pn->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+		    simple_packet.cap_len, err, err_info))
+			return 0;
+	} else {
+		/* leave it in place if the file is mapped */
+		if (!wtap_ref_packet_bytes(fh, wblock->frame_buffer,
+		    simple_packet.cap_len, err, err_info))
+			return 0;
+	}
         block_read += simple_packet.cap_len;
 
         /* jump over potential padding bytes at end of the packet data */
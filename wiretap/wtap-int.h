@@ -95,7 +95,7 @@ struct wtap_dumper {
     int                     file_type_subtype;
     int                     snaplen;
     int                     encap;
-    gboolean                compressed;
+    wtap_compression_type   compression_type;
     gint64                  bytes_dumped;
 
     void                    *priv;       /* this one holds per-file state and is free'd automatically by wtap_dump_close() */
@@ -286,6 +286,15 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Like wtap_read_packet_bytes(), but if the file is mapped into memory,
+ * make the Buffer refer to the packet data in place rather than copying
+ * it.  Only for readers that don't modify the packet data afterwards.
+ */
+gboolean
+wtap_ref_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
+    gchar **err_info);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
@@ -970,6 +970,22 @@ wtap_cleareof(wtap *wth) {
 	file_clearerr(wth->fh);
 }
 
+void
+wtap_set_save_seek_index(wtap *wth, gboolean save)
+{
+	if (wth->fh != NULL)
+		file_set_index_save(wth->fh, save);
+}
+
+void
+wtap_set_growing(wtap *wth)
+{
+	if (wth->fh != NULL)
+		file_set_growing(wth->fh);
+	if (wth->random_fh != NULL)
+		file_set_growing(wth->random_fh);
+}
+
 void wtap_set_cb_new_ipv4(wtap *wth, wtap_new_ipv4_callback_t add_new_ipv4) {
 	if (wth)
 		wth->add_new_ipv4 = add_new_ipv4;
@@ -1026,6 +1042,21 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	return TRUE;	/* success */
 }
 
+gint64
+wtap_tell_sequential(wtap *wth)
+{
+	return file_tell(wth->fh);
+}
+
+gboolean
+wtap_seek_sequential(wtap *wth, gint64 offset, int *err)
+{
+	if (file_seek(wth->fh, offset, SEEK_SET, err) == -1)
+		return FALSE;
+	file_clearerr(wth->fh);
+	return TRUE;
+}
+
 /*
  * Read packet data into a Buffer, growing the buffer as necessary.
  *
@@ -1054,6 +1085,22 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 	return TRUE;
 }
 
+/*
+ * Read packet data into a Buffer, without copying it if we can.
+ *
+ * If the data is in a memory-mapped file, the Buffer is made to refer to
+ * it there, which keeps the mapping until the Buffer is freed or reused,
+ * so this saves both the copy from the file and the copy into the Buffer.
+ */
+gboolean
+wtap_ref_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
+    gchar **err_info)
+{
+	if (file_read_mapped(fh, buf, length))
+		return TRUE;
+	return wtap_read_packet_bytes(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1385,6 +1385,25 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * If save is TRUE, then once a compressed file has been read all the way
+ * through, the points that were found for seeking in it are saved in a
+ * file next to it ("<file>.gzidx"), so that the next time it's opened
+ * random access doesn't need the whole file to be read first.  Indexes
+ * are used when they're there either way; this only controls writing
+ * them.  Call this right after opening the file.
+ */
+WS_DLL_PUBLIC
+void wtap_set_save_seek_index(wtap *wth, gboolean save);
+
+/**
+ * Tell the library that the file is a capture in progress, which is
+ * still being written to, so that it's read with read() calls rather
+ * than mapped into memory.  Call this right after opening the file.
+ */
+WS_DLL_PUBLIC
+void wtap_set_growing(wtap *wth);
+
 /**
  * Set callback functions to add new hostnames. Currently pcapng-only.
  * MUST match add_ipv4_name and add_ipv6_name in addr_resolv.c.
@@ -1408,6 +1427,16 @@ WS_DLL_PUBLIC
 gboolean wtap_seek_read (wtap *wth, gint64 seek_off,
 	struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
 
+/** Return the offset in the file at which wtap_read() will continue. */
+WS_DLL_PUBLIC
+gint64 wtap_tell_sequential(wtap *wth);
+
+/** Make wtap_read() continue at the given offset, which must be one
+ * that wtap_tell_sequential() returned, or the data_offset of a packet
+ * that wtap_read() returned.  Returns TRUE on success. */
+WS_DLL_PUBLIC
+gboolean wtap_seek_sequential(wtap *wth, gint64 offset, int *err);
+
 /*** get various information snippets about the current packet ***/
 WS_DLL_PUBLIC
 struct wtap_pkthdr *wtap_phdr(wtap *wth);
@@ -1454,6 +1483,50 @@ WS_DLL_PUBLIC
 void wtap_close(wtap *wth);
 
 /*** dump packets into a capture file ***/
+
+/**
+ * Ways a capture file can be compressed as it's written.
+ *
+ * The first two have the values FALSE and TRUE had when this was
+ * a gboolean.
+ */
+typedef enum {
+    WTAP_UNKNOWN_COMPRESSION = -1,  /**< not a compression type we know */
+    WTAP_UNCOMPRESSED = 0,
+    WTAP_GZIP_COMPRESSED = 1,
+    WTAP_ZSTD_COMPRESSED = 2,       /**< Zstandard frames, with a seek table */
+    WTAP_LZ4_COMPRESSED = 3         /**< LZ4 frames */
+} wtap_compression_type;
+
+/**
+ * Return TRUE if we were built with support for reading and writing
+ * files compressed with the given compression type.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_compression_type_supported(wtap_compression_type compression_type);
+
+/**
+ * Map a name such as "gzip", "zstd" or "lz4" to a compression type,
+ * or WTAP_UNKNOWN_COMPRESSION if it's not one we support.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_name_to_compression_type(const char *name);
+
+/** Return the name of a supported compression type, or NULL. */
+WS_DLL_PUBLIC
+const char *wtap_compression_type_name(wtap_compression_type compression_type);
+
+/** Return the file extension for a supported compression type, or NULL. */
+WS_DLL_PUBLIC
+const char *wtap_compression_type_extension(wtap_compression_type compression_type);
+
+/**
+ * Return a GSList of the names of all the supported compression types;
+ * the list can be freed with g_slist_free().
+ */
+WS_DLL_PUBLIC
+GSList *wtap_get_all_compression_type_names_list(void);
+
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_open(int filetype);
 
@@ -1466,11 +1539,19 @@ int wtap_dump_file_encap_type(const GArray *file_encaps);
 
 /**
  * Return TRUE if we can write this capture file format out in
- * compressed form, FALSE if not.
+ * gzip-compressed form, FALSE if not.
  */
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_compress(int filetype);
 
+/**
+ * Return TRUE if we can write this capture file format out compressed
+ * with the given compression type, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_dump_can_compress_type(int filetype,
+    wtap_compression_type compression_type);
+
 /**
  * Return TRUE if this capture file format supports storing name
  * resolution information in it, FALSE if not.
@@ -1487,19 +1568,19 @@ gboolean wtap_dump_supports_comment_types(int filetype, guint32 comment_types);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open(const char *filename, int filetype, int encap,
-    int snaplen, gboolean compressed, int *err);
+    int snaplen, wtap_compression_type compression_type, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_open_ng(const char *filename, int filetype, int encap,
-    int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
+    int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen(int fd, int filetype, int encap, int snaplen,
-    gboolean compressed, int *err);
+    wtap_compression_type compression_type, int *err);
 
 WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
-                gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
+                wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
 
 WS_DLL_PUBLIC
@@ -1660,7 +1741,8 @@ int wtap_register_encap_type(const char* name, const char* short_name);
     /** We're trying to open the standard input for random access */
 
 #define WTAP_ERR_COMPRESSION_NOT_SUPPORTED    -19
-    /* The filetype doesn't support output compression */
+    /* The filetype doesn't support output compression, or we weren't
+       built with support for the compression type */
 
 #define WTAP_ERR_CANT_SEEK                    -20
     /** An attempt to seek failed, reason unknown */
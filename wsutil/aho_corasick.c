@@ -0,0 +1,265 @@
+/* aho_corasick.c
+ * Search for several byte strings at once
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "aho_corasick.h"
+
+/*
+ * The automaton is compiled into a deterministic one, so searching is a
+ * single table lookup per byte with no failure links to follow.
+ *
+ * To keep the table small, bytes are mapped to classes first: every byte
+ * that occurs in a pattern gets its own class (after case folding) and
+ * all other bytes share class 0.  A row of the table has one entry per
+ * class.  Entries hold the target state's row offset, so the search
+ * loop doesn't multiply, with AC_MATCH set if a pattern ends there.
+ */
+
+#define AC_MATCH	0x80000000U
+#define AC_NONE		G_MAXUINT32
+
+struct _ac_automaton {
+	gboolean    case_insensitive;
+	GPtrArray  *patterns;		/* GByteArray *, case folded */
+	gboolean    compiled;
+
+	guint8      byte_class[256];
+	guint       num_classes;
+	guint       num_states;
+	guint32    *delta;		/* num_states rows of num_classes */
+	guint      *match_id;		/* per state: pattern ID + 1, or 0 */
+};
+
+ac_automaton *
+ac_automaton_new(gboolean case_insensitive)
+{
+	ac_automaton *ac = g_new0(ac_automaton, 1);
+
+	ac->case_insensitive = case_insensitive;
+	ac->patterns = g_ptr_array_new();
+	return ac;
+}
+
+static guint
+ac_automaton_add_folded(ac_automaton *ac, GByteArray *bytes)
+{
+	guint i;
+
+	g_assert(!ac->compiled);
+
+	if (ac->case_insensitive) {
+		for (i = 0; i < bytes->len; i++)
+			bytes->data[i] = g_ascii_toupper(bytes->data[i]);
+	}
+	g_ptr_array_add(ac->patterns, bytes);
+	return ac->patterns->len - 1;
+}
+
+guint
+ac_automaton_add_pattern(ac_automaton *ac, const guint8 *pattern,
+		size_t pattern_len)
+{
+	GByteArray *bytes = g_byte_array_sized_new((guint) pattern_len);
+
+	g_byte_array_append(bytes, pattern, (guint) pattern_len);
+	return ac_automaton_add_folded(ac, bytes);
+}
+
+guint
+ac_automaton_add_pattern_utf16le(ac_automaton *ac, const guint8 *pattern,
+		size_t pattern_len)
+{
+	GByteArray  *bytes = g_byte_array_sized_new((guint) pattern_len * 2);
+	const guint8 nul = 0;
+	size_t       i;
+
+	for (i = 0; i < pattern_len; i++) {
+		if (i != 0)
+			g_byte_array_append(bytes, &nul, 1);
+		g_byte_array_append(bytes, &pattern[i], 1);
+	}
+	return ac_automaton_add_folded(ac, bytes);
+}
+
+void
+ac_automaton_compile(ac_automaton *ac)
+{
+	gboolean  used[256];
+	guint     max_states = 1;
+	guint     ncls, c, i, j;
+	guint    *fail;
+	guint    *queue;
+	guint     head = 0, tail = 0;
+
+	g_assert(!ac->compiled);
+
+	/* Byte classes */
+	memset(used, 0, sizeof(used));
+	for (i = 0; i < ac->patterns->len; i++) {
+		GByteArray *bytes = (GByteArray *) g_ptr_array_index(ac->patterns, i);
+
+		for (j = 0; j < bytes->len; j++)
+			used[bytes->data[j]] = TRUE;
+		max_states += bytes->len;
+	}
+	ncls = 1;
+	for (c = 0; c < 256; c++) {
+		if (used[c])
+			ac->byte_class[c] = (guint8) ncls++;
+		else
+			ac->byte_class[c] = 0;
+	}
+	if (ac->case_insensitive) {
+		for (c = 0; c < 256; c++)
+			ac->byte_class[c] = ac->byte_class[g_ascii_toupper((gchar) c) & 0xff];
+	}
+	ac->num_classes = ncls;
+
+	/* The trie; state 0 is the root */
+	g_assert((guint64) max_states * ncls < AC_MATCH);
+	ac->delta = g_new(guint32, max_states * ncls);
+	memset(ac->delta, 0xff, max_states * ncls * sizeof(guint32));
+	ac->match_id = g_new0(guint, max_states);
+	ac->num_states = 1;
+	for (i = 0; i < ac->patterns->len; i++) {
+		GByteArray *bytes = (GByteArray *) g_ptr_array_index(ac->patterns, i);
+		guint       state = 0;
+
+		if (bytes->len == 0)
+			continue;
+		for (j = 0; j < bytes->len; j++) {
+			guint32 *next = &ac->delta[state * ncls + ac->byte_class[bytes->data[j]]];
+
+			if (*next == AC_NONE)
+				*next = ac->num_states++;
+			state = *next;
+		}
+		if (ac->match_id[state] == 0)
+			ac->match_id[state] = i + 1;
+	}
+
+	/*
+	 * Breadth first, fill in the missing transitions from the state
+	 * the failure link points to, which is shallower and so already
+	 * complete, and inherit its match.
+	 */
+	fail = g_new0(guint, ac->num_states);
+	queue = g_new(guint, ac->num_states);
+	for (c = 0; c < ncls; c++) {
+		guint32 next = ac->delta[c];
+
+		if (next == AC_NONE) {
+			ac->delta[c] = 0;
+		} else {
+			fail[next] = 0;
+			queue[tail++] = next;
+		}
+	}
+	while (head < tail) {
+		guint state = queue[head++];
+
+		if (ac->match_id[state] == 0)
+			ac->match_id[state] = ac->match_id[fail[state]];
+		for (c = 0; c < ncls; c++) {
+			guint32 *next = &ac->delta[state * ncls + c];
+
+			if (*next == AC_NONE) {
+				*next = ac->delta[fail[state] * ncls + c];
+			} else {
+				fail[*next] = ac->delta[fail[state] * ncls + c];
+				queue[tail++] = *next;
+			}
+		}
+	}
+	g_free(queue);
+	g_free(fail);
+
+	/* Switch to row offsets and flag the matching states */
+	ac->delta = (guint32 *) g_realloc(ac->delta, ac->num_states * ncls * sizeof(guint32));
+	for (i = 0; i < ac->num_states * ncls; i++) {
+		guint32 next = ac->delta[i];
+
+		ac->delta[i] = next * ncls;
+		if (ac->match_id[next] != 0)
+			ac->delta[i] |= AC_MATCH;
+	}
+
+	ac->compiled = TRUE;
+}
+
+gboolean
+ac_automaton_search(const ac_automaton *ac, const guint8 *data,
+		size_t data_len, size_t *match_end, guint *pattern_id)
+{
+	const guint32 *delta = ac->delta;
+	const guint8  *byte_class = ac->byte_class;
+	guint32        state = 0;
+	size_t         i;
+
+	g_assert(ac->compiled);
+
+	for (i = 0; i < data_len; i++) {
+		state = delta[state + byte_class[data[i]]];
+		if (state & AC_MATCH) {
+			if (match_end)
+				*match_end = i;
+			if (pattern_id)
+				*pattern_id = ac->match_id[(state & ~AC_MATCH) / ac->num_classes] - 1;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+void
+ac_automaton_free(ac_automaton *ac)
+{
+	guint i;
+
+	if (!ac)
+		return;
+	for (i = 0; i < ac->patterns->len; i++)
+		g_byte_array_free((GByteArray *) g_ptr_array_index(ac->patterns, i), TRUE);
+	g_ptr_array_free(ac->patterns, TRUE);
+	g_free(ac->delta);
+	g_free(ac->match_id);
+	g_free(ac);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,107 @@
+/* aho_corasick.h
+ * Search for several byte strings at once
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __AHO_CORASICK_H__
+#define __AHO_CORASICK_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** An Aho-Corasick automaton: any number of patterns, searched for in one
+ * pass over the data, looking at every byte once.
+ *
+ * Add the patterns, compile, then search as often as needed.  A compiled
+ * automaton isn't modified by searching, so several threads can search
+ * with it at once. */
+typedef struct _ac_automaton ac_automaton;
+
+/** Create an empty automaton.
+ *
+ * @param case_insensitive TRUE to ignore ASCII case, in the patterns as
+ *        well as in the data
+ * @return The new automaton
+ */
+WS_DLL_PUBLIC
+ac_automaton *ac_automaton_new(gboolean case_insensitive);
+
+/** Add a pattern to an automaton that hasn't been compiled yet.
+ *
+ * @param ac The automaton
+ * @param pattern The bytes to look for
+ * @param pattern_len The number of bytes; empty patterns are ignored
+ * @return The pattern's ID, counting from 0 in the order added
+ */
+WS_DLL_PUBLIC
+guint ac_automaton_add_pattern(ac_automaton *ac, const guint8 *pattern,
+		size_t pattern_len);
+
+/** Add an ASCII pattern as UTF-16LE, i.e. with a NUL after each byte
+ * but the last (so a match ends on the last character, as with
+ * ac_automaton_add_pattern()).
+ *
+ * @param ac The automaton
+ * @param pattern The ASCII characters to look for
+ * @param pattern_len The number of characters
+ * @return The pattern's ID
+ */
+WS_DLL_PUBLIC
+guint ac_automaton_add_pattern_utf16le(ac_automaton *ac, const guint8 *pattern,
+		size_t pattern_len);
+
+/** Build the automaton's transition table from the patterns added.
+ *
+ * @param ac The automaton
+ */
+WS_DLL_PUBLIC
+void ac_automaton_compile(ac_automaton *ac);
+
+/** Look for the first place any pattern ends in the data.
+ *
+ * @param ac A compiled automaton
+ * @param data The data to search
+ * @param data_len The length of the data
+ * @param match_end If not NULL, set to the offset of the last byte of the
+ *        match
+ * @param pattern_id If not NULL, set to the ID of a pattern that matched
+ * @return TRUE if a pattern was found
+ */
+WS_DLL_PUBLIC
+gboolean ac_automaton_search(const ac_automaton *ac, const guint8 *data,
+		size_t data_len, size_t *match_end, guint *pattern_id);
+
+/** Free an automaton.
+ *
+ * @param ac The automaton
+ */
+WS_DLL_PUBLIC
+void ac_automaton_free(ac_automaton *ac);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __AHO_CORASICK_H__ */
@@ -0,0 +1,223 @@
+/* aho_corasick_test.c
+ * Tests for the Aho-Corasick multiple pattern matcher
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "aho_corasick.h"
+
+static guint
+add_str(ac_automaton *ac, const char *pattern)
+{
+	return ac_automaton_add_pattern(ac, (const guint8 *) pattern, strlen(pattern));
+}
+
+/* Search all of a string; returns the match end, or -1 if nothing matched. */
+static gint
+search_str(const ac_automaton *ac, const char *data, guint *pattern_id)
+{
+	size_t match_end;
+
+	if (!ac_automaton_search(ac, (const guint8 *) data, strlen(data),
+				&match_end, pattern_id))
+		return -1;
+	return (gint) match_end;
+}
+
+static void
+ac_test_overlapping(void)
+{
+	ac_automaton *ac = ac_automaton_new(FALSE);
+	guint he, she, his, hers, id;
+
+	he = add_str(ac, "he");
+	she = add_str(ac, "she");
+	his = add_str(ac, "his");
+	hers = add_str(ac, "hers");
+	ac_automaton_compile(ac);
+
+	/* "she" and "he" both end at offset 3; the longer one is reported */
+	g_assert_cmpint(search_str(ac, "ushers", &id), ==, 3);
+	g_assert_cmpuint(id, ==, she);
+
+	/* A repeated first byte mustn't lose the partial match */
+	g_assert_cmpint(search_str(ac, "sshe", &id), ==, 3);
+	g_assert_cmpuint(id, ==, she);
+	g_assert_cmpint(search_str(ac, "xhe", &id), ==, 2);
+	g_assert_cmpuint(id, ==, he);
+
+	/* "hi" is a dead end for "he", but "his" goes on */
+	g_assert_cmpint(search_str(ac, "ahhis", &id), ==, 4);
+	g_assert_cmpuint(id, ==, his);
+
+	/* "hers" can never be reported first: "he" always ends earlier */
+	g_assert_cmpint(search_str(ac, "hers", &id), ==, 1);
+	g_assert_cmpuint(id, ==, he);
+	g_assert_cmpuint(hers, ==, 3);
+
+	g_assert_cmpint(search_str(ac, "shore", NULL), ==, -1);
+
+	ac_automaton_free(ac);
+
+	/* A pattern wholly inside another one ends first */
+	ac = ac_automaton_new(FALSE);
+	add_str(ac, "abcde");
+	his = add_str(ac, "bc");
+	ac_automaton_compile(ac);
+	g_assert_cmpint(search_str(ac, "xabcde", &id), ==, 3);
+	g_assert_cmpuint(id, ==, his);
+	ac_automaton_free(ac);
+}
+
+static void
+ac_test_prefix(void)
+{
+	ac_automaton *ac = ac_automaton_new(FALSE);
+	guint ab, abcd, id;
+
+	abcd = add_str(ac, "abcd");
+	ab = add_str(ac, "ab");
+	ac_automaton_compile(ac);
+
+	/* The prefix ends on a state inside the longer pattern's path */
+	g_assert_cmpint(search_str(ac, "xxabcd", &id), ==, 3);
+	g_assert_cmpuint(id, ==, ab);
+	g_assert_cmpint(search_str(ac, "aab", &id), ==, 2);
+	g_assert_cmpuint(id, ==, ab);
+	g_assert_cmpint(search_str(ac, "a", NULL), ==, -1);
+	ac_automaton_free(ac);
+
+	/* Without the prefix pattern, partial matches have to restart */
+	ac = ac_automaton_new(FALSE);
+	abcd = add_str(ac, "abcd");
+	ac_automaton_compile(ac);
+	g_assert_cmpint(search_str(ac, "abcabcd", &id), ==, 6);
+	g_assert_cmpuint(id, ==, abcd);
+	g_assert_cmpint(search_str(ac, "ababcabc", NULL), ==, -1);
+	ac_automaton_free(ac);
+}
+
+static void
+ac_test_empty(void)
+{
+	ac_automaton *ac = ac_automaton_new(FALSE);
+	size_t match_end = 42;
+	guint id = 42;
+
+	add_str(ac, "abc");
+	ac_automaton_compile(ac);
+
+	/* Empty data matches nothing and leaves the outputs alone */
+	g_assert(!ac_automaton_search(ac, (const guint8 *) "", 0, &match_end, &id));
+	g_assert(!ac_automaton_search(ac, NULL, 0, &match_end, &id));
+	g_assert_cmpuint(match_end, ==, 42);
+	g_assert_cmpuint(id, ==, 42);
+	ac_automaton_free(ac);
+
+	/* An empty pattern is ignored, so it doesn't match everywhere */
+	ac = ac_automaton_new(FALSE);
+	add_str(ac, "");
+	ac_automaton_compile(ac);
+	g_assert_cmpint(search_str(ac, "anything", NULL), ==, -1);
+	ac_automaton_free(ac);
+
+	/* No patterns at all */
+	ac = ac_automaton_new(TRUE);
+	ac_automaton_compile(ac);
+	g_assert_cmpint(search_str(ac, "anything", NULL), ==, -1);
+	ac_automaton_free(ac);
+}
+
+static void
+ac_test_last_byte(void)
+{
+	static const guint8 data[] = { 'x', 'y', 'n', 'e', 'e', 'd', 'l', 'e' };
+	ac_automaton *ac = ac_automaton_new(FALSE);
+	size_t match_end;
+	guint needle, e, id;
+
+	needle = add_str(ac, "needle");
+	ac_automaton_compile(ac);
+
+	g_assert(ac_automaton_search(ac, data, sizeof data, &match_end, &id));
+	g_assert_cmpuint(match_end, ==, sizeof data - 1);
+	g_assert_cmpuint(id, ==, needle);
+
+	/* One byte short of the end of the match */
+	g_assert(!ac_automaton_search(ac, data, sizeof data - 1, &match_end, &id));
+	ac_automaton_free(ac);
+
+	/* A one byte pattern that only occurs as the last byte */
+	ac = ac_automaton_new(FALSE);
+	e = add_str(ac, "e");
+	ac_automaton_compile(ac);
+	g_assert_cmpint(search_str(ac, "xyz.e", &id), ==, 4);
+	g_assert_cmpuint(id, ==, e);
+	ac_automaton_free(ac);
+}
+
+static void
+ac_test_case_insensitive(void)
+{
+	ac_automaton *ac = ac_automaton_new(TRUE);
+	guint id;
+
+	add_str(ac, "Host");
+	id = ac_automaton_add_pattern_utf16le(ac, (const guint8 *) "ab", 2);
+	ac_automaton_compile(ac);
+
+	g_assert_cmpint(search_str(ac, "GET / HTTP/1.1\r\nhOST:", NULL), ==, 19);
+	g_assert(ac_automaton_search(ac, (const guint8 *) "zA\0B\0", 5, NULL, NULL));
+	g_assert_cmpint(search_str(ac, "AB", NULL), ==, -1);
+	g_assert_cmpuint(id, ==, 1);
+	ac_automaton_free(ac);
+}
+
+int
+main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/aho_corasick/overlapping", ac_test_overlapping);
+	g_test_add_func("/aho_corasick/prefix", ac_test_prefix);
+	g_test_add_func("/aho_corasick/empty", ac_test_empty);
+	g_test_add_func("/aho_corasick/last_byte", ac_test_last_byte);
+	g_test_add_func("/aho_corasick/case_insensitive", ac_test_case_insensitive);
+
+	return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ *
+ */
@@ -35,16 +35,100 @@ buffer_init(Buffer* buffer, gsize space)
 	buffer->allocated = space;
 	buffer->start = 0;
 	buffer->first_free = 0;
+	buffer->is_ref = FALSE;
+	buffer->saved_data = NULL;
+	buffer->saved_allocated = 0;
+	buffer->ref_release = NULL;
+	buffer->ref_owner = NULL;
+}
+
+/* Lets the owner of the data the buffer referred to know that it no
+	longer does */
+static void
+buffer_release_ref(void (*release)(void *), void *owner)
+{
+	if (release != NULL)
+		release(owner);
 }
 
 /* Frees the memory used by a buffer */
 void
 buffer_free(Buffer* buffer)
 {
+	if (buffer->is_ref) {
+		buffer->data = buffer->saved_data;
+		buffer->saved_data = NULL;
+		buffer->is_ref = FALSE;
+		buffer_release_ref(buffer->ref_release, buffer->ref_owner);
+		buffer->ref_release = NULL;
+		buffer->ref_owner = NULL;
+	}
 	g_free(buffer->data);
 	buffer->data = NULL;
 }
 
+/* Makes the buffer refer to 'bytes' bytes of somebody else's data rather
+	than copying them.  The buffer goes back to its own storage, with a
+	copy of the data, as soon as anything is added to it.
+
+	The data has to stay put for as long as the buffer refers to it; if
+	'release' isn't NULL, it's called with 'owner' once the buffer no
+	longer does, so the owner can hold on to the data until then. */
+void
+buffer_assign_ref(Buffer* buffer, const guint8 *data, gsize bytes,
+    void (*release)(void *), void *owner)
+{
+	void (*old_release)(void *) = NULL;
+	void *old_owner = NULL;
+
+	if (!buffer->is_ref) {
+		buffer->saved_data = buffer->data;
+		buffer->saved_allocated = buffer->allocated;
+		buffer->is_ref = TRUE;
+	} else {
+		old_release = buffer->ref_release;
+		old_owner = buffer->ref_owner;
+	}
+	buffer->data = (guint8*)data;
+	buffer->allocated = bytes;
+	buffer->start = 0;
+	buffer->first_free = bytes;
+	buffer->ref_release = release;
+	buffer->ref_owner = owner;
+
+	/* After taking on the new data, in case it has the same owner */
+	buffer_release_ref(old_release, old_owner);
+}
+
+/* Makes a buffer that refers to somebody else's data copy it into its
+	own storage */
+void
+buffer_unref(Buffer* buffer)
+{
+	const guint8 *ref_data = buffer->data + buffer->start;
+	gsize space_used = buffer->first_free - buffer->start;
+
+	if (!buffer->is_ref)
+		return;
+
+	buffer->data = buffer->saved_data;
+	buffer->allocated = buffer->saved_allocated;
+	buffer->saved_data = NULL;
+	buffer->is_ref = FALSE;
+	if (space_used > buffer->allocated) {
+		buffer->allocated = space_used + 1024;
+		buffer->data = (guint8*)g_realloc(buffer->data, buffer->allocated);
+	}
+	memcpy(buffer->data, ref_data, space_used);
+	buffer->start = 0;
+	buffer->first_free = space_used;
+
+	/* Only now that we've copied the data */
+	buffer_release_ref(buffer->ref_release, buffer->ref_owner);
+	buffer->ref_release = NULL;
+	buffer->ref_owner = NULL;
+}
+
 /* Assures that there are 'space' bytes at the end of the used space
 	so that another routine can copy directly into the buffer space. After
 	doing that, the routine will also want to run
@@ -56,6 +140,12 @@ buffer_assure_space(Buffer* buffer, gsize space)
 	gsize space_used;
 	gboolean space_at_beginning;
 
+	/* We can't add to somebody else's data */
+	if (buffer->is_ref) {
+		buffer_unref(buffer);
+		available_at_end = buffer->allocated - buffer->first_free;
+	}
+
 	/* If we've got the space already, good! */
 	if (space <= available_at_end) {
 		return;
@@ -36,6 +36,11 @@ typedef struct Buffer {
 	gsize	allocated;
 	gsize	start;
 	gsize	first_free;
+	gboolean	is_ref;		/* data belongs to somebody else */
+	guint8	*saved_data;		/* our own storage, while is_ref */
+	gsize	saved_allocated;
+	void	(*ref_release)(void *);	/* tells the owner we're done with it */
+	void	*ref_owner;
 } Buffer;
 
 WS_DLL_PUBLIC
@@ -48,6 +53,11 @@ WS_DLL_PUBLIC
 void buffer_append(Buffer* buffer, guint8 *from, gsize bytes);
 WS_DLL_PUBLIC
 void buffer_remove_start(Buffer* buffer, gsize bytes);
+WS_DLL_PUBLIC
+void buffer_assign_ref(Buffer* buffer, const guint8 *data, gsize bytes,
+    void (*release)(void *), void *owner);
+WS_DLL_PUBLIC
+void buffer_unref(Buffer* buffer);
 
 #ifdef SOME_FUNCTIONS_ARE_DEFINES
 # define buffer_clean(buffer) buffer_remove_start((buffer), buffer_length(buffer))
@@ -0,0 +1,222 @@
+/* ws_compress.c
+ * Independent Zstandard and LZ4 frames, as used for compressed capture
+ * files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+#include "ws_compress.h"
+
+/*
+ * Captures are compressed for speed rather than size: the point is to
+ * keep up with the capture, which deflate can't do on one core.
+ */
+#define WS_COMPRESS_ZSTD_LEVEL 1
+
+/*
+ * Seek tables follow the Zstandard seekable format, as described in
+ * contrib/seekable_format in the zstd sources.
+ */
+#define SEEK_TABLE_ENTRY_LEN   8       /* no checksums */
+
+struct ws_compressor {
+	ws_compress_type type;
+#ifdef HAVE_ZSTD
+	ZSTD_CCtx *zstd;
+#endif
+};
+
+gboolean
+ws_compress_available(ws_compress_type type)
+{
+	switch (type) {
+#ifdef HAVE_ZSTD
+	case WS_COMPRESS_ZSTD:
+		return TRUE;
+#endif
+#ifdef HAVE_LZ4
+	case WS_COMPRESS_LZ4:
+		return TRUE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+ws_compressor *
+ws_compressor_new(ws_compress_type type)
+{
+	ws_compressor *comp;
+
+	if (!ws_compress_available(type))
+		return NULL;
+
+	comp = g_new0(ws_compressor, 1);
+	comp->type = type;
+#ifdef HAVE_ZSTD
+	if (type == WS_COMPRESS_ZSTD) {
+		comp->zstd = ZSTD_createCCtx();
+		if (comp->zstd == NULL) {
+			g_free(comp);
+			return NULL;
+		}
+	}
+#endif
+	return comp;
+}
+
+#ifdef HAVE_LZ4
+static void
+lz4_prefs(LZ4F_preferences_t *prefs, gsize len)
+{
+	memset(prefs, 0, sizeof *prefs);
+	prefs->frameInfo.blockSizeID = LZ4F_max256KB;
+	prefs->frameInfo.blockMode = LZ4F_blockIndependent;
+	prefs->frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+	prefs->frameInfo.contentSize = len;
+}
+#endif
+
+gsize
+ws_compressor_bound(ws_compressor *comp, gsize len)
+{
+	switch (comp->type) {
+#ifdef HAVE_ZSTD
+	case WS_COMPRESS_ZSTD:
+		return ZSTD_compressBound(len);
+#endif
+#ifdef HAVE_LZ4
+	case WS_COMPRESS_LZ4:
+	{
+		LZ4F_preferences_t prefs;
+
+		lz4_prefs(&prefs, len);
+		return LZ4F_compressFrameBound(len, &prefs);
+	}
+#endif
+	default:
+		return 0;
+	}
+}
+
+gsize
+ws_compressor_frame(ws_compressor *comp, guint8 *dst, gsize dst_len,
+		const guint8 *src, gsize len)
+{
+	size_t ret;
+
+	switch (comp->type) {
+#ifdef HAVE_ZSTD
+	case WS_COMPRESS_ZSTD:
+		ret = ZSTD_compressCCtx(comp->zstd, dst, dst_len, src, len,
+		    WS_COMPRESS_ZSTD_LEVEL);
+		return ZSTD_isError(ret) ? 0 : ret;
+#endif
+#ifdef HAVE_LZ4
+	case WS_COMPRESS_LZ4:
+	{
+		LZ4F_preferences_t prefs;
+
+		lz4_prefs(&prefs, len);
+		ret = LZ4F_compressFrame(dst, dst_len, src, len, &prefs);
+		return LZ4F_isError(ret) ? 0 : ret;
+	}
+#endif
+	default:
+		(void)ret;
+		return 0;
+	}
+}
+
+void
+ws_compressor_free(ws_compressor *comp)
+{
+	if (comp == NULL)
+		return;
+#ifdef HAVE_ZSTD
+	if (comp->zstd != NULL)
+		ZSTD_freeCCtx(comp->zstd);
+#endif
+	g_free(comp);
+}
+
+static void
+put_le32(guint8 *p, guint32 val)
+{
+	p[0] = (guint8)val;
+	p[1] = (guint8)(val >> 8);
+	p[2] = (guint8)(val >> 16);
+	p[3] = (guint8)(val >> 24);
+}
+
+void
+ws_compress_seek_table_add(GByteArray *entries, guint32 compressed_size,
+		guint32 decompressed_size)
+{
+	guint8 entry[SEEK_TABLE_ENTRY_LEN];
+
+	put_le32(entry, compressed_size);
+	put_le32(entry + 4, decompressed_size);
+	g_byte_array_append(entries, entry, SEEK_TABLE_ENTRY_LEN);
+}
+
+void
+ws_compress_seek_table_finish(GByteArray *entries)
+{
+	guint8 header[8];
+	guint8 footer[WS_COMPRESS_SEEK_TABLE_FOOTER];
+	guint32 num_frames = entries->len / SEEK_TABLE_ENTRY_LEN;
+
+	/* skippable frame header: magic and the length of what follows */
+	put_le32(header, WS_COMPRESS_SEEK_TABLE_MAGIC);
+	put_le32(header + 4, entries->len + WS_COMPRESS_SEEK_TABLE_FOOTER);
+	g_byte_array_prepend(entries, header, sizeof header);
+
+	/* footer: number of frames, descriptor (no checksums), magic */
+	put_le32(footer, num_frames);
+	footer[4] = 0;
+	put_le32(footer + 5, WS_COMPRESS_SEEKABLE_MAGIC);
+	g_byte_array_append(entries, footer, sizeof footer);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,104 @@
+/* ws_compress.h
+ * Independent Zstandard and LZ4 frames, as used for compressed capture
+ * files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_COMPRESS_H__
+#define __WS_COMPRESS_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Compression formats written as a series of independent frames. */
+typedef enum {
+	WS_COMPRESS_NONE,      /**< Not compressed */
+	WS_COMPRESS_ZSTD,      /**< Zstandard, with a seekable-format seek table */
+	WS_COMPRESS_LZ4        /**< LZ4 frame format */
+} ws_compress_type;
+
+/** Uncompressed bytes per frame.  Each frame can be decompressed on
+ * its own, so this is also the granularity of random access. */
+#define WS_COMPRESS_FRAME_SIZE (1024 * 1024)
+
+/** Magic number of a Zstandard (and LZ4) skippable frame holding a
+ * seekable-format seek table. */
+#define WS_COMPRESS_SEEK_TABLE_MAGIC    0x184D2A5E
+/** Magic number at the very end of a seekable Zstandard file. */
+#define WS_COMPRESS_SEEKABLE_MAGIC      0x8F92EAB1
+/** Length of the seek table footer. */
+#define WS_COMPRESS_SEEK_TABLE_FOOTER   9
+
+typedef struct ws_compressor ws_compressor;
+
+/** Return TRUE if we were built with support for the format. */
+WS_DLL_PUBLIC
+gboolean ws_compress_available(ws_compress_type type);
+
+/** Create a compressor.
+ *
+ * @param type The format to write
+ * @return The compressor, or NULL if the format isn't available or
+ *         there isn't enough memory
+ */
+WS_DLL_PUBLIC
+ws_compressor *ws_compressor_new(ws_compress_type type);
+
+/** Return the largest frame ws_compressor_frame() can produce from
+ * len bytes of input. */
+WS_DLL_PUBLIC
+gsize ws_compressor_bound(ws_compressor *comp, gsize len);
+
+/** Compress a buffer as one complete, independent frame.
+ *
+ * @param comp The compressor
+ * @param dst Where to put the frame
+ * @param dst_len The size of dst; ws_compressor_bound() is always enough
+ * @param src The data to compress
+ * @param len The length of the data, at most WS_COMPRESS_FRAME_SIZE
+ * @return The length of the frame, or 0 on failure
+ */
+WS_DLL_PUBLIC
+gsize ws_compressor_frame(ws_compressor *comp, guint8 *dst, gsize dst_len,
+		const guint8 *src, gsize len);
+
+WS_DLL_PUBLIC
+void ws_compressor_free(ws_compressor *comp);
+
+/** Add a frame to a seek table being built up in entries. */
+WS_DLL_PUBLIC
+void ws_compress_seek_table_add(GByteArray *entries, guint32 compressed_size,
+		guint32 decompressed_size);
+
+/** Turn the entries added with ws_compress_seek_table_add() into the
+ * skippable frame that ends a seekable Zstandard file. */
+WS_DLL_PUBLIC
+void ws_compress_seek_table_finish(GByteArray *entries);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_COMPRESS_H__ */
@@ -0,0 +1,123 @@
+/*
+ * ws_cpuid.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __WSUTIL_WS_CPUID_H__
+#define __WSUTIL_WS_CPUID_H__
+
+#include <glib.h>
+
+/*
+ * Get CPU info on platforms where the cpuid instruction can be used;
+ * like get_cpu_info() in version_info.c, skip 32-bit versions for GCC.
+ * ws_cpuid() returns FALSE if cpuid isn't available.
+ */
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector)
+{
+	__cpuidex((int *) CPUInfo, selector, 0);
+	return TRUE;
+}
+
+static inline guint64
+ws_xgetbv(guint32 selector)
+{
+#if _MSC_FULL_VER >= 160040219
+	return _xgetbv(selector);
+#else
+	return 0;
+#endif
+}
+
+#elif defined(__GNUC__) && defined(__x86_64__)
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector)
+{
+	__asm__ __volatile__("cpuid"
+			     : "=a" (CPUInfo[0]),
+			       "=b" (CPUInfo[1]),
+			       "=c" (CPUInfo[2]),
+			       "=d" (CPUInfo[3])
+			     : "a" (selector), "c" (0));
+	return TRUE;
+}
+
+static inline guint64
+ws_xgetbv(guint32 selector)
+{
+	guint32 lo, hi;
+
+	/* "xgetbv", spelled out for assemblers that don't know it */
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+			     : "=a" (lo), "=d" (hi)
+			     : "c" (selector));
+	return ((guint64) hi << 32) | lo;
+}
+
+#else /* Other compilers */
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector _U_)
+{
+	CPUInfo[0] = CPUInfo[1] = CPUInfo[2] = CPUInfo[3] = 0;
+	return FALSE;
+}
+
+static inline guint64
+ws_xgetbv(guint32 selector _U_)
+{
+	return 0;
+}
+
+#endif
+
+/*
+ * Returns TRUE if both the CPU and the OS support AVX2, i.e. the CPU
+ * has the instructions and the OS saves the YMM registers on context
+ * switches.
+ */
+static inline gboolean
+ws_cpuid_avx2(void)
+{
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return FALSE;
+
+	/* OSXSAVE and AVX */
+	ws_cpuid(CPUInfo, 1);
+	if ((CPUInfo[2] & ((1U << 27) | (1U << 28))) != ((1U << 27) | (1U << 28)))
+		return FALSE;
+
+	/* XMM and YMM state enabled in XCR0 */
+	if ((ws_xgetbv(0) & 0x6) != 0x6)
+		return FALSE;
+
+	ws_cpuid(CPUInfo, 7);
+	return (CPUInfo[1] & (1U << 5)) != 0;
+}
+
+#endif /* __WSUTIL_WS_CPUID_H__ */
@@ -0,0 +1,330 @@
+/* ws_mempbrk.c
+ * Byte set and substring search, with SSE2 and AVX2 versions where the
+ * compiler and CPU allow them.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "ws_mempbrk.h"
+#include "ws_cpuid.h"
+#include "bits_ctz.h"
+
+/*
+ * SSE2 is part of the x86-64 baseline, so it needs neither compiler
+ * flags nor a run-time check.  AVX2 code is compiled with a function
+ * target attribute (or, with MSVC, as is) and only called if the CPU
+ * and OS support it.
+ */
+#if defined(__x86_64__) || defined(_M_X64)
+#define HAVE_MEMPBRK_SSE2
+#include <emmintrin.h>
+
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define HAVE_MEMPBRK_AVX2
+#define MEMPBRK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define HAVE_MEMPBRK_AVX2
+#define MEMPBRK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1800
+#define HAVE_MEMPBRK_AVX2
+#define MEMPBRK_TARGET_AVX2
+#endif
+
+#ifdef HAVE_MEMPBRK_AVX2
+#include <immintrin.h>
+#endif
+#endif /* __x86_64__ || _M_X64 */
+
+#ifdef HAVE_MEMPBRK_AVX2
+static gboolean
+have_avx2(void)
+{
+	/* -1 until checked; checking twice from two threads is harmless */
+	static volatile int avx2 = -1;
+
+	if (avx2 == -1)
+		avx2 = ws_cpuid_avx2() ? 1 : 0;
+	return avx2 == 1;
+}
+#endif
+
+void
+ws_mempbrk_compile(ws_mempbrk_pattern *pattern, const gchar *needles)
+{
+	const guint8 *n;
+	guint         count = 0;
+
+	memset(pattern->patt, 0, sizeof(pattern->patt));
+	for (n = (const guint8 *) needles; *n; n++) {
+		if (pattern->patt[*n])
+			continue;
+		pattern->patt[*n] = 1;
+		if (count < WS_MEMPBRK_VECTOR_NEEDLES)
+			pattern->needles[count] = *n;
+		count++;
+	}
+	pattern->num_needles = (count <= WS_MEMPBRK_VECTOR_NEEDLES) ? (guint8) count : 0;
+}
+
+static const guint8 *
+mempbrk_scalar(const guint8 *haystack, size_t haystacklen,
+		const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	const guint8 *haystack_end = haystack + haystacklen;
+
+	while (haystack < haystack_end) {
+		if (pattern->patt[*haystack]) {
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack++;
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_MEMPBRK_SSE2
+static const guint8 *
+mempbrk_sse2(const guint8 *haystack, size_t haystacklen,
+		const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	__m128i       needles[WS_MEMPBRK_VECTOR_NEEDLES];
+	const guint8 *haystack_end = haystack + haystacklen;
+	guint         i, n = pattern->num_needles;
+
+	for (i = 0; i < n; i++)
+		needles[i] = _mm_set1_epi8((char) pattern->needles[i]);
+
+	while (haystack_end - haystack >= 16) {
+		__m128i data = _mm_loadu_si128((const __m128i *) haystack);
+		__m128i hits = _mm_cmpeq_epi8(data, needles[0]);
+		guint32 mask;
+
+		for (i = 1; i < n; i++)
+			hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, needles[i]));
+		mask = (guint32) _mm_movemask_epi8(hits);
+		if (mask != 0) {
+			haystack += ws_ctz(mask);
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack += 16;
+	}
+
+	return mempbrk_scalar(haystack, haystack_end - haystack, pattern, found_needle);
+}
+#endif
+
+#ifdef HAVE_MEMPBRK_AVX2
+static MEMPBRK_TARGET_AVX2 const guint8 *
+mempbrk_avx2(const guint8 *haystack, size_t haystacklen,
+		const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	__m256i       needles[WS_MEMPBRK_VECTOR_NEEDLES];
+	const guint8 *haystack_end = haystack + haystacklen;
+	guint         i, n = pattern->num_needles;
+
+	for (i = 0; i < n; i++)
+		needles[i] = _mm256_set1_epi8((char) pattern->needles[i]);
+
+	while (haystack_end - haystack >= 32) {
+		__m256i data = _mm256_loadu_si256((const __m256i *) haystack);
+		__m256i hits = _mm256_cmpeq_epi8(data, needles[0]);
+		guint32 mask;
+
+		for (i = 1; i < n; i++)
+			hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(data, needles[i]));
+		mask = (guint32) _mm256_movemask_epi8(hits);
+		if (mask != 0) {
+			haystack += ws_ctz(mask);
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack += 32;
+	}
+
+	return mempbrk_sse2(haystack, haystack_end - haystack, pattern, found_needle);
+}
+#endif
+
+const guint8 *
+ws_mempbrk_exec(const guint8 *haystack, size_t haystacklen,
+		const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	if (pattern->num_needles == 1) {
+		const guint8 *result;
+
+		/* The C library's memchr() is about as fast as it gets */
+		result = (const guint8 *) memchr(haystack, pattern->needles[0], haystacklen);
+		if (result && found_needle)
+			*found_needle = *result;
+		return result;
+	}
+
+#ifdef HAVE_MEMPBRK_SSE2
+	if (pattern->num_needles != 0) {
+#ifdef HAVE_MEMPBRK_AVX2
+		if (haystacklen >= 32 && have_avx2())
+			return mempbrk_avx2(haystack, haystacklen, pattern, found_needle);
+#endif
+		return mempbrk_sse2(haystack, haystacklen, pattern, found_needle);
+	}
+#endif
+
+	return mempbrk_scalar(haystack, haystacklen, pattern, found_needle);
+}
+
+/*
+ * Substring search.  The vector versions compare the first and the last
+ * byte of the needle at 16 or 32 positions at once and only memcmp()
+ * the rest at positions where both match, which rejects almost every
+ * position in real packet data without touching it twice.
+ */
+
+static const guint8 *
+memmem_scalar(const guint8 *haystack, size_t haystacklen,
+		const guint8 *needle, size_t needlelen)
+{
+	const guint8 *last_possible;
+	const guint8 *begin = haystack;
+
+	if (needlelen > haystacklen)
+		return NULL;
+
+	last_possible = haystack + haystacklen - needlelen;
+	while (begin <= last_possible) {
+		begin = (const guint8 *) memchr(begin, needle[0], last_possible - begin + 1);
+		if (begin == NULL)
+			return NULL;
+		if (!memcmp(begin + 1, needle + 1, needlelen - 1))
+			return begin;
+		begin++;
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_MEMPBRK_SSE2
+static const guint8 *
+memmem_sse2(const guint8 *haystack, size_t haystacklen,
+		const guint8 *needle, size_t needlelen)
+{
+	const __m128i first = _mm_set1_epi8((char) needle[0]);
+	const __m128i last = _mm_set1_epi8((char) needle[needlelen - 1]);
+	size_t        i;
+
+	/* Blocks whose last-byte load stays inside the haystack */
+	for (i = 0; i + 16 + needlelen - 1 <= haystacklen; i += 16) {
+		__m128i block_first = _mm_loadu_si128((const __m128i *) (haystack + i));
+		__m128i block_last = _mm_loadu_si128((const __m128i *) (haystack + i + needlelen - 1));
+		guint32 mask;
+
+		mask = (guint32) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+								 _mm_cmpeq_epi8(last, block_last)));
+		while (mask != 0) {
+			int bit = ws_ctz(mask);
+
+			if (!memcmp(haystack + i + bit + 1, needle + 1, needlelen - 2))
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	return memmem_scalar(haystack + i, haystacklen - i, needle, needlelen);
+}
+#endif
+
+#ifdef HAVE_MEMPBRK_AVX2
+static MEMPBRK_TARGET_AVX2 const guint8 *
+memmem_avx2(const guint8 *haystack, size_t haystacklen,
+		const guint8 *needle, size_t needlelen)
+{
+	const __m256i first = _mm256_set1_epi8((char) needle[0]);
+	const __m256i last = _mm256_set1_epi8((char) needle[needlelen - 1]);
+	size_t        i;
+
+	for (i = 0; i + 32 + needlelen - 1 <= haystacklen; i += 32) {
+		__m256i block_first = _mm256_loadu_si256((const __m256i *) (haystack + i));
+		__m256i block_last = _mm256_loadu_si256((const __m256i *) (haystack + i + needlelen - 1));
+		guint32 mask;
+
+		mask = (guint32) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+								       _mm256_cmpeq_epi8(last, block_last)));
+		while (mask != 0) {
+			int bit = ws_ctz(mask);
+
+			if (!memcmp(haystack + i + bit + 1, needle + 1, needlelen - 2))
+				return haystack + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	return memmem_sse2(haystack + i, haystacklen - i, needle, needlelen);
+}
+#endif
+
+const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystacklen,
+		const guint8 *needle, size_t needlelen)
+{
+	if (needlelen == 0)
+		return haystack;
+
+	if (needlelen > haystacklen)
+		return NULL;
+
+	if (needlelen == 1)
+		return (const guint8 *) memchr(haystack, needle[0], haystacklen);
+
+#ifdef HAVE_MEMPBRK_AVX2
+	if (haystacklen >= 32 + needlelen - 1 && have_avx2())
+		return memmem_avx2(haystack, haystacklen, needle, needlelen);
+#endif
+#ifdef HAVE_MEMPBRK_SSE2
+	return memmem_sse2(haystack, haystacklen, needle, needlelen);
+#else
+	return memmem_scalar(haystack, haystacklen, needle, needlelen);
+#endif
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,82 @@
+/* ws_mempbrk.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMPBRK_H__
+#define __WS_MEMPBRK_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Largest needle set searched with vector compares; bigger sets use
+ * the lookup table only. */
+#define WS_MEMPBRK_VECTOR_NEEDLES 16
+
+/** A set of needle bytes compiled for ws_mempbrk_exec().
+ * Compile it once (e.g. when registering a dissector) and reuse it. */
+typedef struct {
+	gchar  patt[256];      /**< patt[c] is non-zero if c is a needle */
+	guint8 num_needles;    /**< Distinct needles, or 0 if there are more than WS_MEMPBRK_VECTOR_NEEDLES */
+	guint8 needles[WS_MEMPBRK_VECTOR_NEEDLES];
+} ws_mempbrk_pattern;
+
+/** Compile a NUL-terminated set of needle bytes into a pattern.
+ *
+ * @param pattern The pattern to fill in
+ * @param needles The bytes to look for; NUL can't be one of them
+ */
+WS_DLL_PUBLIC
+void ws_mempbrk_compile(ws_mempbrk_pattern *pattern, const gchar *needles);
+
+/** Find the first byte in haystack that is in the pattern.
+ *
+ * @param haystack The data to search
+ * @param haystacklen The length of the search data
+ * @param pattern A pattern compiled by ws_mempbrk_compile()
+ * @param found_needle If not NULL, set to the byte that was found
+ * @return A pointer to the first matching byte, or NULL if there's none
+ */
+WS_DLL_PUBLIC
+const guint8 *ws_mempbrk_exec(const guint8 *haystack, size_t haystacklen,
+		const ws_mempbrk_pattern *pattern, guchar *found_needle);
+
+/** Return the first occurrence of needle in haystack, like memmem().
+ *
+ * @param haystack The data to search
+ * @param haystacklen The length of the search data
+ * @param needle The bytes to look for
+ * @param needlelen The length of needle
+ * @return A pointer to the first occurrence of needle in haystack,
+ *         haystack if needlelen is 0, or NULL if needle isn't found
+ */
+WS_DLL_PUBLIC
+const guint8 *ws_memmem(const guint8 *haystack, size_t haystacklen,
+		const guint8 *needle, size_t needlelen);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_MEMPBRK_H__ */